@@ -37,6 +37,8 @@
 * -# Libs\FMC116\Incs\fmc116_cpld.h (fans, clock, HDMI signal directions)
 * -# Libs\FMC116\Incs\fmc116_clocktree.h (internal/external clock, part id verification)
 * -# Libs\FMC116\Incs\fmc116_adc.h (analog to digital converter)
+* -# Libs\FMC116\Incs\fmc116_calib.h (ADC IDELAY taps snapshot)
+* -# Libs\FMC116\Incs\fmc116_telemetry.h (background voltage, temperature and frequency sampler)
 *
 * - Interface to the I2C master firmware star (IP Core).
 * -# Libs\I2CMASTER\Incs\i2cmaster.h (i2cmaster generic)
@@ -48,5 +50,30 @@
 *
 * - Interface to the sipif module.
 * -# Libs\SIPIF\Incs\sipif.h (sipif)
+* -# Libs\SIPIF\Incs\regtable.h (register programming tables)
+* -# Libs\SIPIF\Bench\sipif_bench.cpp (transport micro-benchmark, JSON results)
+* -# Libs\SIPIF\Bench\sipif_standin.h (TCP/IP firmware stand-in for runs without hardware)
+*
+* - Command latency tracing of the socket server.
+* -# Libs\TRACE\Incs\trace.h (latency histograms and Chrome trace export)
+*
+* - Processing of the channels on several cores.
+* -# Libs\PIPELINE\Incs\pipeline.h (per channel stages on a work stealing thread pool)
+*
+* - Streams published to the monitoring clients.
+* -# Libs\MONITOR\Incs\monitor.h (subscriptions and messages on the monitoring port)
+*
+* - Signal processing of the received bursts.
+* -# Libs\DSP\Incs\dsp_fft.h (radix-4 SIMD complex and real FFT, shared plans)
+* -# Libs\DSP\Incs\dsp_resample.h (polyphase rational resampler, native updnClock)
+* -# Libs\DSP\Incs\dsp_simd.h (vector instruction selection and aligned buffers)
+* -# Libs\DSP\Incs\dsp_cond.h (polarity, gain and offset calibration, float conversion)
+* -# Libs\DSP\Incs\dsp_pilot.h (Barker pilot alignment, native cPilotBarker.alignPilot)
+* -# Libs\DSP\Incs\dsp_ook.h (OOK demodulation, native cDemodOOK.demodulate)
+* -# Libs\DSP\Incs\dsp_ofdm.h (optical OFDM demodulation, native cDemodOFDM.demodulate)
+* -# Libs\DSP\Incs\dsp_ber.h (bit error rate and pilot SNR per channel, native demodRxTimer BERs)
+* -# Libs\DSP\Incs\dsp_env.h (min/max envelope of a burst for display)
+* -# Libs\DSP\Incs\dsp_psd.h (averaged Welch power spectral density, server side plotFreq)
+* -# Libs\DSP\Incs\dsp_ring.h (lock free sample queue between two threads, native cFIFO)
 *
 */
\ No newline at end of file
@@ -12,6 +12,10 @@
 // Socket 
 #define SKT_PORT	(unsigned short)30002
 
+// Monitoring socket, MONITOR_MAX_CLIENTS clients at once subscribe to the streams computed from the bursts of CMD_DATA,
+// see Libs\MONITOR\Incs\monitor.h for the subscription message
+#define MON_PORT	(unsigned short)30003
+
 // Command Config
 #define IDX_CMD		0x00	
 #define IDX_CHNL	0x01
@@ -21,7 +25,168 @@
 
 // Commands
 #define CMD_BURSTSIZE	0x10
-#define CMD_DATA		0x20
+#define CMD_DATA		0x20	// no payload, IDX_CHNL is a mask of CHNL_x, one reply per channel in the order CHNL_1..CHNL_4
+#define CMD_TELEMETRY	0x90	// no payload, answered with the latest telemetry snapshot
+#define CMD_ALIGN		0xA0	// ALN_LEN bytes payload, no reply, Barker pilot alignment of the following CMD_DATA
+#define CMD_DEMOD		0xB0	// DMD_LEN or OFDM_LEN(msc) bytes payload, no reply, demodulation of the following CMD_DATA
+#define CMD_BER			0xC0	// BER_LEN(nbits) bytes payload, no reply, reference payload of the channels of the IDX_CHNL mask, their statistics cleared
+#define CMD_LINK		0xC1	// no payload, IDX_CHNL is a mask of CHNL_x, one LNK_LEN reply per channel in the order CHNL_1..CHNL_4
+#define CMD_COND		0xD0	// CND_LEN bytes payload, no reply, calibration of the bursts of the following CMD_DATA
+#define CMD_PSD			0xE0	// PSD_LEN bytes payload, no reply, spectrum of the bursts of the channels of the IDX_CHNL mask, published as MON_SPECTRUM
+
+// Telemetry reply, sent for CMD_TELEMETRY (little endian)
+#define IDX_TLM_CMD			0x00	// CMD_TELEMETRY
+#define IDX_TLM_ERR			0x01	// 0 when all values of the snapshot are fresh, the negated error code of IDX_TLM_SRC otherwise
+#define IDX_TLM_NBVAL		0x02	// 16 bit, number of values at IDX_TLM_VALUES
+#define IDX_TLM_SEQ			0x04	// 32 bit, snapshot number, 0 before the first snapshot
+#define IDX_TLM_AGE			0x08	// 32 bit, ms since the snapshot was taken
+#define IDX_TLM_DEFERRED	0x0C	// 32 bit, sampler batches postponed behind the capture path
+#define IDX_TLM_SRC			0x10	// 32 bit, TLM_SRC_x, function whose error code is IDX_TLM_ERR, the codes of two sources overlap
+#define IDX_TLM_VALUES		0x14	// IEEE 754 floats: temperature (C), 9 voltages (V), 7 clocks (MHz)
+#define TLM_NBVAL			17
+#define TLM_LEN				(IDX_TLM_VALUES+4*TLM_NBVAL)
+#define TLM_SRC_NONE		0x00	// IDX_TLM_SRC, no error
+#define TLM_SRC_MONITOR		0x01	// IDX_TLM_SRC, monitoring device, FMC116_monitor_read() or FMC116_monitor_start() codes
+#define TLM_SRC_FREQCNT		0x02	// IDX_TLM_SRC, frequency counters, sipif codes
+
+// Alignment configuration, payload of CMD_ALIGN (little endian)
+#define IDX_ALN_MODE		0x00	// ALIGN_OFF, ALIGN_TAG or ALIGN_ROTATE
+#define IDX_ALN_PILOT		0x01	// 11 ( BARKER11 ) or 13 ( BARKER13 )
+#define IDX_ALN_FILTER		0x02	// 0 ( RAISEDCOSINE ) or 1 ( IDEALRECT )
+#define IDX_ALN_INVERT		0x03	// CHNL_x mask of the channels wired with an inverted polarity
+#define IDX_ALN_CLKIN		0x04	// 32 bit, pilot chip clock (Hz)
+#define IDX_ALN_CLKSMP		0x08	// 32 bit, ADC sample clock (Hz)
+#define IDX_ALN_FRAMELEN	0x0C	// 32 bit, frame samples at the beginning of the burst, 0 for the whole burst
+#define IDX_ALN_WINDOW		0x10	// 16 bit, samples searched around the last offset of the channel, 0 for a full search of every burst
+#define IDX_ALN_THRESHOLD	0x12	// correlation (percent) below which the window is discarded and the whole frame searched
+#define ALN_LEN				0x14
+#define ALN_LEN_NOTRACK		0x10	// shorter payload, without the tracking fields, every burst is searched in full
+
+// Alignment modes, with ALIGN_TAG and ALIGN_ROTATE the CMD_DATA reply is followed by the 32 bit pilot offset
+#define ALIGN_OFF			0x00	// burst sent as captured, no offset
+#define ALIGN_TAG			0x01	// burst sent as captured
+#define ALIGN_ROTATE		0x02	// frame rotated so that the pilot comes first
+#define ALIGN_NO_OFFSET		0xFFFFFFFF	// offset sent when the pilot could not be aligned
+
+// Demodulation configuration, payload of CMD_DEMOD (little endian)
+#define IDX_DMD_MODE		0x00	// DEMOD_OFF, DEMOD_OOK or DEMOD_OFDM
+#define IDX_DMD_RAW			0x01	// 1 to send the burst before the bits
+#define IDX_DMD_NPSYM		0x02	// 16 bit, samples per symbol
+#define IDX_DMD_ON			0x04	// 16 bit signed, ON level (ADC counts, after the polarity correction)
+#define IDX_DMD_OFF			0x06	// 16 bit signed, OFF level, equal to the ON level to measure both levels on every burst
+#define IDX_DMD_NSYM		0x08	// 16 bit, symbols per frame, 0 for as many as fit after the pilot
+#define DMD_LEN				0x0A
+
+// OFDM demodulation configuration, payload of CMD_DEMOD with DEMOD_OFDM (little endian), the sample clock, the pilot
+// and the channels wired with an inverted polarity are those of CMD_ALIGN
+#define IDX_OFDM_TYPE		0x02	// 0 ( ACOOFDM ), 1 ( DCOOFDM ) or 2 ( DMT )
+#define IDX_OFDM_EQ			0x03	// 0 ( one gain for all the subcarriers ) or 1 ( one gain per subcarrier, from the pilot )
+#define IDX_OFDM_NSC		0x04	// 16 bit, subcarriers
+#define IDX_OFDM_MSC		0x06	// 16 bit, constellation points, OFDM_MAX_MSC at most
+#define IDX_OFDM_NSYM		0x08	// 16 bit, symbols per frame, 0 for as many as fit after the pilot
+#define IDX_OFDM_FILTER		0x0A	// 0 ( RAISEDCOSINE ) or 1 ( IDEALRECT )
+#define IDX_OFDM_CLKSIG		0x0C	// 32 bit, OFDM signal clock (Hz)
+#define IDX_OFDM_PLTSCALE	0x10	// IEEE 754 float, pilot chip amplitude in OFDM signal units ( SIGMAX-SIGMIN )
+#define IDX_OFDM_SYMBOLS	0x14	// IEEE 754 floats, real and imaginary part of each constellation point
+#define OFDM_MAX_MSC		64
+#define OFDM_LEN(msc)		(IDX_OFDM_SYMBOLS+8*(msc))
+
+// Demodulation modes, with DEMOD_OOK and DEMOD_OFDM the CMD_DATA reply is made of the burst ( IDX_DMD_RAW only ), the
+// pilot offset ( CMD_ALIGN only ), then the 32 bit number of bits and the packed bits, bit k in bit k%8 of byte k/8.
+// The symbols start after the pilot, at the beginning of the frame when the alignment is off. No bit is sent when the
+// pilot could not be aligned.
+#define DEMOD_OFF			0x00	// burst sent as captured
+#define DEMOD_OOK			0x01	// on-off keying, threshold (ON+OFF)/2 and majority of the samples of each symbol, one bit per symbol
+#define DEMOD_OFDM			0x02	// optical OFDM, log2(MSC) bits per data subcarrier MSB first, needs CMD_ALIGN
+
+// Conditioning configuration, payload of CMD_COND (little endian). Each sample becomes GAIN*(+-x-OFFSET), in place
+// before the alignment, the demodulation and the files, which then work on calibrated samples ( the ON and OFF levels of
+// CMD_DEMOD included ). The channels of IDX_CND_INVERT are negated, the polarity given by IDX_ALN_INVERT is that of the
+// samples before the conditioning.
+#define IDX_CND_MODE		0x00	// COND_OFF, COND_INT16 or COND_FLOAT
+#define IDX_CND_INVERT		0x01	// CHNL_x mask of the channels negated first
+#define IDX_CND_TABLE		0x04	// IEEE 754 floats, GAIN then OFFSET (ADC counts) of CHNL_1..CHNL_4
+#define CND_LEN				(IDX_CND_TABLE+8*4)
+
+// Conditioning modes, with COND_FLOAT the burst of the CMD_DATA reply is made of 4 byte IEEE 754 floats in volts, 14 bit
+// ADC counts over a 2 Vpp range, instead of 16 bit samples
+#define COND_OFF			0x00	// burst sent as captured
+#define COND_INT16			0x01	// calibrated 16 bit samples, rounded and saturated
+#define COND_FLOAT			0x02	// calibrated samples in volts, not saturated
+
+// Bit error rate configuration, payload of CMD_BER (little endian), the bits demodulated from every burst of the channels
+// are compared with the reference payload
+#define IDX_BER_PERIOD		0x00	// 16 bit, the CMD_LINK reply of a channel follows its CMD_DATA reply every PERIOD CMD_DATA, 0 for CMD_LINK only
+#define IDX_BER_NBITS		0x04	// 32 bit, bits of the reference payload, 0 to stop the measurement
+#define IDX_BER_BITS		0x08	// packed bits, bit k in bit k%8 of byte k/8, compared with the first bits of the CMD_DATA reply
+#define BER_MAX_BITS		32768
+#define BER_LEN(nbits)		(IDX_BER_BITS+((nbits)+7)/8)
+#define CFG_MAX_LEN			BER_LEN(BER_MAX_BITS)	// largest command payload
+
+// Spectrum configuration, payload of CMD_PSD (little endian). Welch estimate of the power spectral density of every burst
+// of the channels, segments of NFFT samples windowed and overlapping, averaged over the segments then over the bursts,
+// after the conditioning of CMD_COND. The estimate runs whether a monitoring client subscribes to MON_SPECTRUM or not.
+#define IDX_PSD_WINDOW		0x00	// PSD_WIN_RECT, PSD_WIN_HANN or PSD_WIN_BLACKMAN
+#define IDX_PSD_OVERLAP		0x01	// percent of a segment shared with the next one, 0..90
+#define IDX_PSD_AVERAGES	0x02	// 16 bit, bursts of the running mean, exponential mean afterwards, 0 to average all the bursts
+#define IDX_PSD_NFFT		0x04	// 32 bit, samples per segment, power of 2 from 16 to 65536, 0 to stop the estimate
+#define IDX_PSD_CLKSMP		0x08	// 32 bit, ADC sample clock (Hz)
+#define PSD_LEN				0x0C
+
+// Spectrum windows
+#define PSD_WIN_RECT		0x00	// rectangular, the padded transform of plotFreq.m
+#define PSD_WIN_HANN		0x01	// hann(NFFT)
+#define PSD_WIN_BLACKMAN	0x02	// blackman(NFFT)
+
+// Link statistics reply, sent for CMD_LINK (little endian), counted since the CMD_BER of the channel
+#define IDX_LNK_CMD			0x00	// CMD_LINK
+#define IDX_LNK_CHNL		0x01	// CHNL_x
+#define IDX_LNK_ERR			0x02	// 0 when the channel has a reference payload, all values are 0 otherwise
+#define IDX_LNK_FRAMES		0x04	// 32 bit, bursts demodulated
+#define IDX_LNK_SYNCLOSS	0x08	// 32 bit, bursts without bits ( pilot lost ) or with more than 25% bit errors, not counted below
+#define IDX_LNK_ERRFRAMES	0x0C	// 32 bit, bursts with at least one bit error
+#define IDX_LNK_BITS		0x10	// 64 bit, bits compared
+#define IDX_LNK_ERRORS		0x18	// 64 bit, bit errors
+#define IDX_LNK_VALUES		0x20	// IEEE 754 floats: BER, last, mean and lowest pilot correlation, last and mean pilot SNR (dB)
+#define LNK_NBVAL			6
+#define LNK_LEN				(IDX_LNK_VALUES+4*LNK_NBVAL)
+
+// Monitoring streams, MONITOR_SUB_STREAM of the subscription. A client still taking a message misses the bursts processed
+// meanwhile, the burst numbers of its messages are not consecutive then.
+#define MON_ENVELOPE		0x01	// min/max envelope of the bursts, POINTS buckets, FLAGS MON_ENV_MEAN
+#define MON_SPECTRUM		0x02	// averaged spectrum of CMD_PSD, POINTS frequencies, FLAGS MON_SPC_x
+
+// Envelope subscription
+#define MON_ENV_MEAN		0x0001	// MONITOR_SUB_FLAGS, the means of the buckets follow the minima and maxima
+#define MON_ENV_POINTS		1024	// buckets when the subscription gives 0 POINTS
+
+// Envelope message, MON_ENVELOPE stream (little endian), the burst as sent to the control client
+#define IDX_ENV_STREAM		0x00	// MON_ENVELOPE
+#define IDX_ENV_CHNL		0x01	// CHNL_x
+#define IDX_ENV_POINTS		0x02	// 16 bit, buckets, the POINTS subscribed but the samples of the burst at most
+#define IDX_ENV_BURST		0x04	// 32 bit, burst number of the channel
+#define IDX_ENV_SAMPLES		0x08	// 32 bit, samples of the burst, bucket k holds samples k*SAMPLES/POINTS to (k+1)*SAMPLES/POINTS-1
+#define IDX_ENV_LSB			0x0C	// IEEE 754 float, volts per count of the minima, maxima and means
+#define IDX_ENV_DATA		0x10	// 16 bit minima, 16 bit maxima, then with MON_ENV_MEAN IEEE 754 float means, POINTS of each
+#define ENV_LEN(points, mean)	(IDX_ENV_DATA+4*(points)+((mean) ? 4*(points) : 0))
+
+// Spectrum subscription, the channels without CMD_PSD send nothing
+#define MON_SPC_WHOLE		0x0001	// MONITOR_SUB_FLAGS, two-sided spectrum -CLKSMP/2..CLKSMP/2 as the 'whole' side of plotFreq.m, one-sided 0..CLKSMP/2 otherwise
+#define MON_SPC_PEAK		0x0002	// MONITOR_SUB_FLAGS, largest density of the bins of each point instead of their mean
+#define MON_SPC_DB			0x0004	// MONITOR_SUB_FLAGS, densities in dB ( 10*log10 )
+#define MON_SPC_POINTS		512		// points when the subscription gives 0 POINTS, NFFT/2+1 ( NFFT two-sided ) bins at most
+
+// Spectrum message, MON_SPECTRUM stream (little endian), consecutive bins merged into POINTS points
+#define IDX_SPC_STREAM		0x00	// MON_SPECTRUM
+#define IDX_SPC_CHNL		0x01	// CHNL_x
+#define IDX_SPC_POINTS		0x02	// 16 bit, points, every point but the last one covers the same number of bins
+#define IDX_SPC_BURST		0x04	// 32 bit, burst number of the channel, last burst averaged
+#define IDX_SPC_BURSTS		0x08	// 32 bit, bursts averaged since CMD_PSD, the ones processed while the client was busy included
+#define IDX_SPC_NFFT		0x0C	// 32 bit, samples per segment
+#define IDX_SPC_FIRST		0x10	// IEEE 754 float, frequency of the first point, center of its bins (Hz)
+#define IDX_SPC_STEP		0x14	// IEEE 754 float, frequency between two points (Hz)
+#define IDX_SPC_DATA		0x18	// IEEE 754 floats, density of each point (V^2/Hz or dB)
+#define SPC_LEN(points)		(IDX_SPC_DATA+4*(points))
 
 // ADC Channel 
 #define CHNL_1		0x01
@@ -5,9 +5,133 @@
 //////////////////////////////////////////////////////////////////////////////
 #include <Windows.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include "cid.h"
 #include "sipif.h"
 
+/**
+ * Slot of the star ID index, the instances of a star are stored contiguously in g_cidoffsets.
+ */
+typedef struct {
+	unsigned short star_id;						/*!< star ID, 0 for an empty slot */
+	unsigned short count;						/*!< number of instances of the star */
+	unsigned short first;						/*!< index of the first instance in g_cidoffsets */
+} cid_index_slot;
+
+static cid_index_slot g_cidindex[SIP_CID_INDEX_SIZE];	/*!< Open addressing hash table on star ID */
+static unsigned long g_cidoffsets[MAX_NBR_STAR];		/*!< Base addresses grouped by star ID */
+
+/**
+ * Header of a cache file, followed by number_stars rows of 3 registers as read from the firmware.
+ */
+typedef struct {
+	unsigned long magic;						/*!< SIP_CID_CACHE_MAGIC */
+	unsigned long header[4];					/*!< the four header registers of the sip_cid star */
+} cid_cache_header;
+
+/**
+ * Find the index slot of a star ID, or the empty slot where it would go.
+ */
+static cid_index_slot *cid_index_find(unsigned int starid)
+{
+	unsigned int slot = (starid*2654435761u)>>22;	// Fibonacci hashing on 10 bits ( SIP_CID_INDEX_SIZE )
+
+	while(g_cidindex[slot].star_id!=0 && g_cidindex[slot].star_id!=starid)
+		slot = (slot+1)&(SIP_CID_INDEX_SIZE-1);
+
+	return &g_cidindex[slot];
+}
+
+/**
+ * Build the star ID index from the rows of the sip_cid table.
+ */
+static void cid_index_build(void)
+{
+	cid_index_slot *slot;
+	unsigned int iter;
+	unsigned short next = 0;
+
+	memset(g_cidindex, 0, sizeof(g_cidindex));
+
+	// count the instances of every star
+	for(iter = 0; iter < g_sipcidtbl.number_stars; iter++) {
+		if(g_sipcidtbl.rows[iter].star_id==0)
+			continue;
+		slot = cid_index_find(g_sipcidtbl.rows[iter].star_id);
+		slot->star_id = g_sipcidtbl.rows[iter].star_id;
+		slot->count++;
+	}
+	// give every star a contiguous range in g_cidoffsets
+	for(iter = 0; iter < SIP_CID_INDEX_SIZE; iter++) {
+		if(g_cidindex[iter].star_id==0)
+			continue;
+		g_cidindex[iter].first = next;
+		next += g_cidindex[iter].count;
+		g_cidindex[iter].count = 0;
+	}
+	// fill the ranges in the order of the table
+	for(iter = 0; iter < g_sipcidtbl.number_stars; iter++) {
+		if(g_sipcidtbl.rows[iter].star_id==0)
+			continue;
+		slot = cid_index_find(g_sipcidtbl.rows[iter].star_id);
+		g_cidoffsets[slot->first+slot->count] = g_sipcidtbl.rows[iter].base_address;
+		slot->count++;
+	}
+}
+
+/**
+ * Build the name of the cache file for the firmware described by the header registers.
+ */
+static void cid_cache_filename(const unsigned long *header, char *filename)
+{
+	sprintf(filename, "sipcid_%04lX_%08lX.bin", header[0]>>16, header[2]);
+}
+
+/**
+ * Read the rows registers from the cache file, only when the header registers match.
+ */
+static int cid_cache_load(const unsigned long *header, unsigned long *rows, unsigned int count)
+{
+	cid_cache_header cache;
+	char filename[64];
+	FILE *file;
+	int valid;
+
+	cid_cache_filename(header, filename);
+	file = fopen(filename, "rb");
+	if(file==NULL)
+		return 0;
+	valid = fread(&cache, sizeof(cache), 1, file)==1 && cache.magic==SIP_CID_CACHE_MAGIC &&
+		memcmp(cache.header, header, sizeof(cache.header))==0 && fread(rows, sizeof(unsigned long), count, file)==count;
+	fclose(file);
+
+	return valid;
+}
+
+/**
+ * Save the header and rows registers to the cache file. A failure only means the next start reads the firmware again.
+ */
+static void cid_cache_save(const unsigned long *header, const unsigned long *rows, unsigned int count)
+{
+	cid_cache_header cache;
+	char filename[64];
+	FILE *file;
+
+	cache.magic = SIP_CID_CACHE_MAGIC;
+	memcpy(cache.header, header, sizeof(cache.header));
+
+	cid_cache_filename(header, filename);
+	file = fopen(filename, "wb");
+	if(file==NULL)
+		return;
+	if(fwrite(&cache, sizeof(cache), 1, file)!=1 || fwrite(rows, sizeof(unsigned long), count, file)!=count) {
+		fclose(file);
+		remove(filename);
+		return;
+	}
+	fclose(file);
+}
+
 unsigned long cid_getswbuildcode(void)
 {
 	return g_sipcidtbl.sw_build_code;
@@ -36,9 +160,9 @@ unsigned long cid_getfirmwareversion(void)
 
 int cid_getstaroffset(unsigned int starid, unsigned long *offset, unsigned long *size)
 {
-	int mainiter;
-	int typeiter;
-	int typereq;
+	const unsigned long *instances;
+	unsigned long count;
+	int rc;
 
 	// offset cannot be NULL
 	if(offset == NULL)
@@ -48,36 +172,40 @@ int cid_getstaroffset(unsigned int starid, unsigned long *offset, unsigned long
 	if(size == NULL)
 		return SIP_CID_ERR_NULL_ARG;
 
-	// star id cannot be 0
-	if(starid == 0)
-		return SIP_CID_ERR_NOTHING_TO_DO;
-
-
-	// compute how many times that given star id is part of the constellation
-	for(mainiter = 0, typereq = 0; mainiter < g_sipcidtbl.number_stars; mainiter++) {
-		if(g_sipcidtbl.rows[mainiter].star_id == starid)
-			typereq++;
-	}
+	rc = cid_getstarinstances(starid, &instances, &count);
+	if(rc != SIP_CID_ERR_OK)
+		return rc;
 
 	// if the buffer is not big enough, let the caller aware about how many word should be present in his buffer
-	if((unsigned long)typereq>*size) {
-		*size = typereq;
+	if(count>*size) {
+		*size = count;
 		return SIP_CID_ERR_OUTBUF_TOO_SMALL;
 	}
 
-	// scan for a given star ID populating the array passed as argument
-	for(mainiter = 0, typeiter = 0; mainiter < g_sipcidtbl.number_stars; mainiter++) {
-		if(g_sipcidtbl.rows[mainiter].star_id == starid) {
-			if((unsigned long)typeiter <= *size) {
-				offset[typeiter] = g_sipcidtbl.rows[mainiter].base_address;
-				typeiter++;
-			}
-		}
-	}
+	memcpy(offset, instances, count*sizeof(unsigned long));
 
 	return SIP_CID_ERR_OK;	
 }
 
+int cid_getstarinstances(unsigned int starid, const unsigned long **offset, unsigned long *count)
+{
+	cid_index_slot *slot;
+
+	// offset and count cannot be NULL
+	if(offset == NULL || count == NULL)
+		return SIP_CID_ERR_NULL_ARG;
+
+	// star id cannot be 0
+	if(starid == 0)
+		return SIP_CID_ERR_NOTHING_TO_DO;
+
+	slot = cid_index_find(starid);
+	*offset = &g_cidoffsets[slot->first];
+	*count = slot->count;
+
+	return SIP_CID_ERR_OK;
+}
+
 
 psipcid_table cid_get_sipcidtbl()
 {
@@ -86,22 +214,24 @@ psipcid_table cid_get_sipcidtbl()
 
 int cid_init(unsigned int constellationid)
 {
-	unsigned long dword;
+	static unsigned long rows[3*MAX_NBR_STAR];
+	unsigned long header[4];
 	unsigned long rc;
 	unsigned int iter;
 
-	// zero the complete sipcid array
+	// zero the complete sipcid array and its index
 	memset(&g_sipcidtbl, 0, sizeof(g_sipcidtbl));
+	memset(g_cidindex, 0, sizeof(g_cidindex));
 
-	// first of all read the first register in the sip_cid star implemented in the firmware
-	// this register contains constellationID as well as number of stars present in the sip_cid
-	// table
-	rc = sipif_readsipreg(SIP_CID_BAR, &dword);
+	// first of all read the header of the sip_cid star implemented in the firmware, the first register
+	// contains constellationID as well as number of stars present in the sip_cid table, then come the
+	// software build, the firmware build and the firmware version
+	rc = sipif_readsipregs(SIP_CID_BAR, 4, header);
 	if(rc!=SIPIF_ERR_OK) {
 		return SIP_CID_ERR_LOW_LEVEL_IO;
 	}
-	g_sipcidtbl.constellation_id = dword>>16;
-	g_sipcidtbl.number_stars = dword&0xFFFF;
+	g_sipcidtbl.constellation_id = (unsigned short)(header[0]>>16);
+	g_sipcidtbl.number_stars = (unsigned short)(header[0]&0xFFFF);
 
 	// we want to make sure that the constellation ID is what we excpect. A wrong constellation ID mean wrong firmware
 	// installed on the hardware or that we are communicating to the wrong device
@@ -109,47 +239,32 @@ int cid_init(unsigned int constellationid)
 		if(constellationid!=0)
 			return SIP_CID_ERR_WRONG_CONSTELLATION_ID;
 	}
-
-	// read the software build. The software build is written by stellarIP at the time a design is generated
-	rc = sipif_readsipreg(SIP_CID_SW_BUILD, &g_sipcidtbl.sw_build_code);
-	if(rc!=SIPIF_ERR_OK) {
-		return SIP_CID_ERR_LOW_LEVEL_IO;
-	}
-	// read the firmware build. The firmware build is undefined
-	rc = sipif_readsipreg(SIP_CID_FW_BUILD, &g_sipcidtbl.fw_build_code);
-	if(rc!=SIPIF_ERR_OK) {
+	if(g_sipcidtbl.number_stars>MAX_NBR_STAR) {
 		return SIP_CID_ERR_LOW_LEVEL_IO;
 	}
-	// read the firmware version
-	rc = sipif_readsipreg(SIP_CID_FW_VERSION, &dword);
-	if(rc!=SIPIF_ERR_OK) {
-		return SIP_CID_ERR_LOW_LEVEL_IO;
-	}
-	g_sipcidtbl.fw_version_low = dword&0xFFFF;
-	g_sipcidtbl.fw_version_high = dword>>16;
 
-	// iterate here as many times we have stars present in the sipcid
-	// one row is composed of three registers 
-	for(iter = 0; iter <  g_sipcidtbl.number_stars; iter++) {
-		rc = sipif_readsipreg(SIP_CID_ROW_START+3*iter, &dword);
-		if(rc!=SIPIF_ERR_OK) {
-			return SIP_CID_ERR_LOW_LEVEL_IO;
-		}
-		g_sipcidtbl.rows[iter+0].base_address = dword;
-
-		rc = sipif_readsipreg(SIP_CID_ROW_START+3*iter+1, &dword);
-		if(rc!=SIPIF_ERR_OK) {
-			return SIP_CID_ERR_LOW_LEVEL_IO;
-		}
-		g_sipcidtbl.rows[iter].end_address = dword;
+	// the software build is written by stellarIP at the time a design is generated, the firmware build is undefined
+	g_sipcidtbl.sw_build_code = header[1];
+	g_sipcidtbl.fw_build_code = header[2];
+	g_sipcidtbl.fw_version_low = header[3]&0xFFFF;
+	g_sipcidtbl.fw_version_high = header[3]>>16;
 
-		rc = sipif_readsipreg(SIP_CID_ROW_START+3*iter+2, &dword);
+	// read all the rows at once, one row is composed of three registers. The header registers identify the
+	// firmware, when they match the cache there is no need to walk the table in the firmware
+	if(!cid_cache_load(header, rows, 3*g_sipcidtbl.number_stars)) {
+		rc = sipif_readsipregs(SIP_CID_ROW_START, 3*g_sipcidtbl.number_stars, rows);
 		if(rc!=SIPIF_ERR_OK) {
 			return SIP_CID_ERR_LOW_LEVEL_IO;
 		}
-		g_sipcidtbl.rows[iter].star_id = dword>>16;
-		g_sipcidtbl.rows[iter].star_version = dword&0xFFFF;
+		cid_cache_save(header, rows, 3*g_sipcidtbl.number_stars);
+	}
+	for(iter = 0; iter <  g_sipcidtbl.number_stars; iter++) {
+		g_sipcidtbl.rows[iter].base_address = rows[3*iter+0];
+		g_sipcidtbl.rows[iter].end_address = rows[3*iter+1];
+		g_sipcidtbl.rows[iter].star_id = (unsigned short)(rows[3*iter+2]>>16);
+		g_sipcidtbl.rows[iter].star_version = (unsigned short)(rows[3*iter+2]&0xFFFF);
 	}
+	cid_index_build();
 	
 	return g_sipcidtbl.number_stars;
 }
\ No newline at end of file
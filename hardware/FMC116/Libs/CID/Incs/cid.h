@@ -13,6 +13,8 @@
 #define SIP_CID_FW_BUILD					(SIP_CID_BAR+0x02)		/*!< Address where the firmware build register is located on the firmware's memory address space. */
 #define SIP_CID_FW_VERSION					(SIP_CID_BAR+0x03)		/*!< Address where the firmware version register is located on the firmware's memory address space. */
 #define SIP_CID_ROW_START					(SIP_CID_BAR+0x04)		/*!< Address where the first ROW register is located on the firmware's memory address space. */
+#define SIP_CID_INDEX_SIZE					1024					/*!< Number of slots in the star ID index, a power of 2 at least twice MAX_NBR_STAR. */
+#define SIP_CID_CACHE_MAGIC					0x43494443				/*!< Marker at the beginning of every sip_cid cache file ( 'CIDC' ). */
 
 /* error codes */
 #define SIP_CID_ERR_OK						0						/*!< No error encountered during execution. */
@@ -77,6 +79,9 @@ extern "C" {
  *
  * @note Communication with the hardware/firmware over Ethernet is happening in this function.
  * @param   constellationid		the constellation (firmware) identification code we expect to read back from the firmware.
+ * The rows of the table are kept in a cache file keyed by the constellation ID and the firmware build code. When the header
+ * registers read from the firmware match the cache the rows are taken from the cache instead of being read from the firmware.
+ *
  * @return  SIP_CID_ERR_LOW_LEVEL_IO, SIP_CID_ERR_WRONG_CONSTELLATION_ID or the number of ipcores blocks found in the firmware. Note that a return value of 0 indicates
  * that no ipcores blocks have been found in the firmware.
  */
@@ -160,6 +165,20 @@ unsigned long cid_getnbrstar(void);
  */
 int cid_getstaroffset(unsigned int starid, unsigned long *offset, unsigned long *size);
 
+/**
+ * \brief Get the offsets(addresses) of all the instances of an ipcore block in the firmware at once.
+ *
+ * The offsets come from an index built by cid_init(), the lookup does not depend on the number of stars in the constellation.
+ *
+ * @note This function does not communicate with the hardware.
+ * @warning Calling cid_init() prior calling this function is mandatory.
+ * @param   starid     the ipcore's identification code we want to retrieve offsets for.
+ * @param   offset     pointer receiving the address of a read only array holding the offsets, in the order of the sip_cid table. The array remains valid until the next cid_init().
+ * @param   count     pointer receiving the number of offsets in the array, 0 when the star is not part of the constellation.
+ * @return  SIP_CID_ERR_NULL_ARG ( arguments cannot be NULL ), SIP_CID_ERR_NOTHING_TO_DO ( starid cannot be 0 ) and SIP_CID_ERR_OK ( no error ).
+ */
+int cid_getstarinstances(unsigned int starid, const unsigned long **offset, unsigned long *count);
+
 
 
 // C++ "helper"
@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ber.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ber module measures the bit error rate and the link quality of a channel (implementation)
+///
+/// Native version of the BERs and CHNLRDCNT bookkeeping of demodRxTimer.m. The demodulated bits
+/// of every frame are compared with a known reference payload, 32 bytes at a time with AVX2 or
+/// 16 bytes at a time with SSE2: the bytes are XORed and the bits set in the result counted
+/// per byte ( nibble table or shifts and masks ), then summed with a sum of absolute differences.
+/// A frame without bits, its pilot could not be aligned, or with more than DSP_BER_SYNC_RATE of
+/// its bits in error, the payload is not where it is expected, counts as a loss of the frame
+/// synchronization and not as bit errors.
+///
+/// The link quality is taken from the normalized correlation r of the pilot with the expected
+/// one: the signal to noise ratio of the pilot is estimated as r^2/(1-r^2), which holds for
+/// white noise on an otherwise undistorted pilot and underestimates it otherwise. The counters
+/// run until dsp_ber_reset(). A statistics engine is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dsp_simd.h"
+#include "dsp_ber.h"
+
+
+/**
+ * Number of bits set in a word.
+ */
+static inline unsigned int dsp_ber_popcount(unsigned int x)
+{
+	x = x-((x>>1)&0x55555555);
+	x = (x&0x33333333)+((x>>2)&0x33333333);
+	x = (x+(x>>4))&0x0F0F0F0F;
+	return (x*0x01010101)>>24;
+}
+
+/**
+ * Number of bits that differ between the first nbits bits of a and b.
+ */
+static unsigned int dsp_ber_count(const unsigned char *a, const unsigned char *b, unsigned int nbits)
+{
+	unsigned int nbytes = nbits/8, i = 0, count = 0;
+
+#if defined(DSP_SIMD_AVX2)
+	{
+		// bits set per nibble, looked up by a byte shuffle
+		const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i low = _mm256_set1_epi8(0x0F);
+		__m256i acc = _mm256_setzero_si256(), x, c;
+		unsigned long long lanes[4];
+
+		for(; i+32 <= nbytes; i += 32) {
+			x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a+i)), _mm256_loadu_si256((const __m256i *)(b+i)));
+			c = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)), _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+			acc = _mm256_add_epi64(acc, _mm256_sad_epu8(c, _mm256_setzero_si256()));
+		}
+		_mm256_storeu_si256((__m256i *)lanes, acc);
+		count += (unsigned int)(lanes[0]+lanes[1]+lanes[2]+lanes[3]);
+	}
+#endif
+#if defined(DSP_SIMD_SSE2)
+	{
+		// bits set per byte with shifts and masks, the 16 bit shifts leak into bits the masks clear
+		const __m128i m1 = _mm_set1_epi8(0x55), m2 = _mm_set1_epi8(0x33), m4 = _mm_set1_epi8(0x0F);
+		__m128i acc = _mm_setzero_si128(), x;
+		unsigned long long lanes[2];
+
+		for(; i+16 <= nbytes; i += 16) {
+			x = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(a+i)), _mm_loadu_si128((const __m128i *)(b+i)));
+			x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi16(x, 1), m1));
+			x = _mm_add_epi8(_mm_and_si128(x, m2), _mm_and_si128(_mm_srli_epi16(x, 2), m2));
+			x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi16(x, 4)), m4);
+			acc = _mm_add_epi64(acc, _mm_sad_epu8(x, _mm_setzero_si128()));
+		}
+		_mm_storeu_si128((__m128i *)lanes, acc);
+		count += (unsigned int)(lanes[0]+lanes[1]);
+	}
+#endif
+	for(; i < nbytes; i++)
+		count += dsp_ber_popcount(a[i]^b[i]);
+	if(nbits%8)
+		count += dsp_ber_popcount((a[i]^b[i])&((1u<<(nbits%8))-1));
+	return count;
+}
+
+/**
+ * SNR in dB of a linear estimate, bounded by DSP_BER_SNR_MAX.
+ */
+static float dsp_ber_db(double snr)
+{
+	double db;
+
+	if(snr<=0.0)
+		return -DSP_BER_SNR_MAX;
+	db = 10.0*log10(snr);
+	if(db>DSP_BER_SNR_MAX)
+		return DSP_BER_SNR_MAX;
+	if(db<-DSP_BER_SNR_MAX)
+		return -DSP_BER_SNR_MAX;
+	return (float)db;
+}
+
+int dsp_ber_init(DSP_BER *ber, const unsigned char *ref, unsigned int refbits)
+{
+	if(!ber)
+		return DSP_BER_ERR_ARGUMENT;
+	memset(ber, 0, sizeof(DSP_BER));
+	if(!ref)
+		return DSP_BER_ERR_ARGUMENT;
+	if(refbits==0)
+		return DSP_BER_ERR_LENGTH;
+
+	ber->ref = (unsigned char *)dsp_malloc(DSP_BER_NBYTES(refbits));
+	if(!ber->ref)
+		return DSP_BER_ERR_ALLOC;
+	memcpy(ber->ref, ref, DSP_BER_NBYTES(refbits));
+	ber->refbits = refbits;
+	return DSP_BER_ERR_OK;
+}
+
+int dsp_ber_frame(DSP_BER *ber, const unsigned char *bits, unsigned int nbits)
+{
+	unsigned int n, errors;
+
+	if(!ber || !ber->ref || (!bits && nbits))
+		return DSP_BER_ERR_ARGUMENT;
+
+	ber->frames++;
+	ber->lasterrors = 0;
+	if(nbits==0) {
+		ber->synclosses++;
+		return DSP_BER_ERR_OK;
+	}
+
+	n = nbits<ber->refbits ? nbits : ber->refbits;
+	errors = dsp_ber_count(bits, ber->ref, n);
+	ber->lasterrors = errors;
+	// that many errors mean the payload has been missed, not that the link is noisy
+	if(errors>DSP_BER_SYNC_RATE*n) {
+		ber->synclosses++;
+		return DSP_BER_ERR_OK;
+	}
+	ber->bits += n;
+	ber->errors += errors;
+	if(errors)
+		ber->errframes++;
+	return DSP_BER_ERR_OK;
+}
+
+int dsp_ber_pilot(DSP_BER *ber, float correlation)
+{
+	double r2;
+
+	if(!ber || !ber->ref)
+		return DSP_BER_ERR_ARGUMENT;
+
+	if(ber->pilots==0 || correlation<ber->peakmin)
+		ber->peakmin = correlation;
+	ber->peak = correlation;
+	ber->peaksum += correlation;
+	ber->pilots++;
+
+	// the share r^2 of the pilot energy explained by the expected pilot is the signal, the rest the noise
+	r2 = (double)correlation*correlation;
+	if(r2>=1.0)
+		r2 = 1.0-pow(10.0, -DSP_BER_SNR_MAX/10.0);
+	ber->snrsum += r2/(1.0-r2);
+	ber->snr = dsp_ber_db(r2/(1.0-r2));
+	return DSP_BER_ERR_OK;
+}
+
+double dsp_ber_rate(const DSP_BER *ber)
+{
+	if(!ber || ber->bits==0)
+		return 0.0;
+	return (double)ber->errors/(double)ber->bits;
+}
+
+float dsp_ber_meansnr(const DSP_BER *ber)
+{
+	if(!ber || ber->pilots==0)
+		return 0.0f;
+	return dsp_ber_db(ber->snrsum/ber->pilots);
+}
+
+void dsp_ber_reset(DSP_BER *ber)
+{
+	unsigned char *ref;
+	unsigned int refbits;
+
+	if(!ber)
+		return;
+	ref = ber->ref;
+	refbits = ber->refbits;
+	memset(ber, 0, sizeof(DSP_BER));
+	ber->ref = ref;
+	ber->refbits = refbits;
+}
+
+void dsp_ber_free(DSP_BER *ber)
+{
+	if(!ber)
+		return;
+	dsp_free(ber->ref);
+	memset(ber, 0, sizeof(DSP_BER));
+}
@@ -0,0 +1,119 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_cond.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_cond module conditions the 16 bit ADC samples of a channel (implementation)
+///
+/// Native version of the frame*-1 polarity correction and the double() conversion of
+/// demodRxTimer.m, with a gain and a DC offset calibration per channel. Each sample becomes
+/// gain*(+-x-offset), rounded to the nearest integer and saturated to 16 bits, in place, and
+/// optionally converted to volts into a float frame during the same pass. The samples are
+/// converted to floats 16 at a time with AVX2 or 8 at a time with SSE2, so that the plain C
+/// loop, the SSE2 and the AVX2 kernels give the same results. A conditioner is read only once
+/// initialized, the channels may share it.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "dsp_simd.h"
+#include "dsp_cond.h"
+
+
+/**
+ * Conditioned value rounded to the nearest integer, ties to even as the vector conversions, and saturated.
+ */
+static inline short dsp_cond_round(float y)
+{
+	if(y>32767.0f)
+		y = 32767.0f;
+	else if(y<-32768.0f)
+		y = -32768.0f;
+#if defined(DSP_SIMD_SSE2)
+	return (short)_mm_cvtss_si32(_mm_set_ss(y));
+#else
+	{
+		float r = floorf(y+0.5f);
+		// halfway values go to the even neighbour
+		if(r-y==0.5f && fmodf(r, 2.0f)!=0.0f)
+			r -= 1.0f;
+		return (short)r;
+	}
+#endif
+}
+
+int dsp_cond_init(DSP_COND *cond, int invert, float gain, float offset, float lsb)
+{
+	if(!cond)
+		return DSP_COND_ERR_ARGUMENT;
+	memset(cond, 0, sizeof(DSP_COND));
+	if(!(gain>0.0f && gain<=FLT_MAX) || !(lsb>0.0f && lsb<=FLT_MAX) || !(offset>=-FLT_MAX && offset<=FLT_MAX))
+		return DSP_COND_ERR_GAIN;
+
+	cond->invert = invert ? 1 : 0;
+	cond->gain = gain;
+	cond->offset = offset;
+	cond->lsb = lsb;
+	// gain*(+-x-offset) as a single multiply and add
+	cond->scale = invert ? -gain : gain;
+	cond->bias = -gain*offset;
+	return DSP_COND_ERR_OK;
+}
+
+int dsp_cond_apply16(const DSP_COND *cond, short *sig, unsigned int len, float *volts)
+{
+	unsigned int i = 0;
+	float y;
+
+	if(!cond || (!sig && len))
+		return DSP_COND_ERR_ARGUMENT;
+
+#if defined(DSP_SIMD_AVX2)
+	{
+		const __m256 scale = _mm256_set1_ps(cond->scale), bias = _mm256_set1_ps(cond->bias), lsb = _mm256_set1_ps(cond->lsb);
+		const __m256 lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+		__m256i x;
+		__m256 a, b;
+
+		for(; i+16 <= len; i += 16) {
+			x = _mm256_loadu_si256((const __m256i *)(sig+i));
+			a = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(x))), scale), bias);
+			b = _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1))), scale), bias);
+			if(volts) {
+				_mm256_storeu_ps(volts+i, _mm256_mul_ps(a, lsb));
+				_mm256_storeu_ps(volts+i+8, _mm256_mul_ps(b, lsb));
+			}
+			// the packing works per 128 bit lane, the 64 bit quarters are put back in order
+			x = _mm256_packs_epi32(_mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(a, lo), hi)), _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(b, lo), hi)));
+			_mm256_storeu_si256((__m256i *)(sig+i), _mm256_permute4x64_epi64(x, 0xD8));
+		}
+	}
+#endif
+#if defined(DSP_SIMD_SSE2)
+	{
+		const __m128 scale = _mm_set1_ps(cond->scale), bias = _mm_set1_ps(cond->bias), lsb = _mm_set1_ps(cond->lsb);
+		const __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+		__m128i x;
+		__m128 a, b;
+
+		for(; i+8 <= len; i += 8) {
+			x = _mm_loadu_si128((const __m128i *)(sig+i));
+			// sign extension of the shorts, each one lands in the upper half of a 32 bit word
+			a = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), scale), bias);
+			b = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), scale), bias);
+			if(volts) {
+				_mm_storeu_ps(volts+i, _mm_mul_ps(a, lsb));
+				_mm_storeu_ps(volts+i+4, _mm_mul_ps(b, lsb));
+			}
+			x = _mm_packs_epi32(_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(a, lo), hi)), _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(b, lo), hi)));
+			_mm_storeu_si128((__m128i *)(sig+i), x);
+		}
+	}
+#endif
+	for(; i < len; i++) {
+		y = (float)sig[i]*cond->scale+cond->bias;
+		if(volts)
+			volts[i] = y*cond->lsb;
+		sig[i] = dsp_cond_round(y);
+	}
+	return DSP_COND_ERR_OK;
+}
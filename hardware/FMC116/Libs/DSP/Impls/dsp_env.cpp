@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_env.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_env module reduces a frame to its min/max envelope for display (implementation)
+///
+/// Stands for the plot(1:demo.frmRxNSmp16, frame) of every capture in demoRxTimer.m. A display
+/// a few hundred pixels wide only shows, per pixel column, the smallest and largest sample of
+/// the samples it covers: the frame is split into POINTS buckets of consecutive samples and
+/// each bucket reduced to its minimum, its maximum and optionally its mean. The buckets are
+/// reduced 16 samples at a time with AVX2 or 8 at a time with SSE2, the sums of the means on 32
+/// bit lanes that are moved to 64 bits before they could overflow.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include "dsp_simd.h"
+#include "dsp_env.h"
+
+#define DSP_ENV_FLUSH				16384			/*!< Vectors summed on 32 bit lanes at most, 2*32768 per lane and vector */
+
+
+/**
+ * Smallest, largest and sum of n samples, n>0.
+ */
+static void dsp_env_bucket(const short *sig, unsigned int n, int *lo, int *hi, long long *sum)
+{
+	unsigned int i = 0;
+	int mn = 32767, mx = -32768;
+	long long s = 0;
+
+#if defined(DSP_SIMD_AVX2)
+	if(n>=16) {
+		__m256i vmin = _mm256_set1_epi16(32767), vmax = _mm256_set1_epi16(-32768), acc = _mm256_setzero_si256(), x;
+		const __m256i ones = _mm256_set1_epi16(1);
+		short lanes[16];
+		int acc32[8];
+		unsigned int count = 0;
+
+		for(; i+16 <= n; i += 16) {
+			x = _mm256_loadu_si256((const __m256i *)(sig+i));
+			vmin = _mm256_min_epi16(vmin, x);
+			vmax = _mm256_max_epi16(vmax, x);
+			// pairs of samples summed into 32 bit lanes
+			acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, ones));
+			if(++count==DSP_ENV_FLUSH) {
+				_mm256_storeu_si256((__m256i *)acc32, acc);
+				for(int j = 0; j < 8; j++)
+					s += acc32[j];
+				acc = _mm256_setzero_si256();
+				count = 0;
+			}
+		}
+		_mm256_storeu_si256((__m256i *)acc32, acc);
+		for(int j = 0; j < 8; j++)
+			s += acc32[j];
+		_mm256_storeu_si256((__m256i *)lanes, vmin);
+		for(int j = 0; j < 16; j++)
+			mn = lanes[j]<mn ? lanes[j] : mn;
+		_mm256_storeu_si256((__m256i *)lanes, vmax);
+		for(int j = 0; j < 16; j++)
+			mx = lanes[j]>mx ? lanes[j] : mx;
+	}
+#endif
+#if defined(DSP_SIMD_SSE2)
+	if(n-i>=8) {
+		__m128i vmin = _mm_set1_epi16(32767), vmax = _mm_set1_epi16(-32768), acc = _mm_setzero_si128(), x;
+		const __m128i ones = _mm_set1_epi16(1);
+		short lanes[8];
+		int acc32[4];
+		unsigned int count = 0;
+
+		for(; i+8 <= n; i += 8) {
+			x = _mm_loadu_si128((const __m128i *)(sig+i));
+			vmin = _mm_min_epi16(vmin, x);
+			vmax = _mm_max_epi16(vmax, x);
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(x, ones));
+			if(++count==DSP_ENV_FLUSH) {
+				_mm_storeu_si128((__m128i *)acc32, acc);
+				for(int j = 0; j < 4; j++)
+					s += acc32[j];
+				acc = _mm_setzero_si128();
+				count = 0;
+			}
+		}
+		_mm_storeu_si128((__m128i *)acc32, acc);
+		for(int j = 0; j < 4; j++)
+			s += acc32[j];
+		_mm_storeu_si128((__m128i *)lanes, vmin);
+		for(int j = 0; j < 8; j++)
+			mn = lanes[j]<mn ? lanes[j] : mn;
+		_mm_storeu_si128((__m128i *)lanes, vmax);
+		for(int j = 0; j < 8; j++)
+			mx = lanes[j]>mx ? lanes[j] : mx;
+	}
+#endif
+	for(; i < n; i++) {
+		mn = sig[i]<mn ? sig[i] : mn;
+		mx = sig[i]>mx ? sig[i] : mx;
+		s += sig[i];
+	}
+	*lo = mn;
+	*hi = mx;
+	*sum = s;
+}
+
+int dsp_env_minmax16(const short *sig, unsigned int len, unsigned int points, short *lo, short *hi, float *mean)
+{
+	unsigned int first, next;
+	int mn, mx;
+	long long sum;
+
+	if(!sig || !lo || !hi)
+		return DSP_ENV_ERR_ARGUMENT;
+	if(points==0 || points>len)
+		return DSP_ENV_ERR_POINTS;
+
+	// every bucket holds len/points samples, one more for some of them
+	for(unsigned int k = 0; k < points; k++) {
+		first = DSP_ENV_FIRST(k, len, points);
+		next = DSP_ENV_FIRST(k+1, len, points);
+		dsp_env_bucket(sig+first, next-first, &mn, &mx, &sum);
+		lo[k] = (short)mn;
+		hi[k] = (short)mx;
+		if(mean)
+			mean[k] = (float)((double)sum/(next-first));
+	}
+	return DSP_ENV_ERR_OK;
+}
@@ -0,0 +1,478 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_fft.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_fft module computes complex and real fast Fourier transforms (implementation)
+///
+/// Decimation in time transform of single precision complex data. After the bit reversal, the
+/// stages are run two at a time as radix-4 passes, with one radix-2 pass first when log2(n) is
+/// odd. The butterflies of a pass are computed with the vector instructions selected by
+/// dsp_simd.h, 4 ( AVX ) or 2 ( SSE ) complex values at a time, plain C otherwise. A plan holds
+/// the twiddle factors of every pass, contiguous so that the vector loops read them in order, and
+/// the bit reversal table of one transform size. The forward transform is not scaled, the inverse
+/// transform is scaled by 1/n ( same convention as MATLAB fft/ifft ). The inverse transform runs
+/// the forward passes on the conjugate data, one set of tables serves both directions.
+///
+/// A plan of n values also transforms 2n real values, as n complex values whose spectrum is then
+/// split into the n+1 bins of the real signal, half the work of a complex transform of 2n values.
+///
+/// A plan is read only once built, several threads may execute the same plan on their own data.
+/// dsp_fft_getplan() keeps one plan per size for the whole process, built on the first request
+/// under a lock, so that every DSP stage of the servers shares the same tables.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef WIN32
+ #include <windows.h>
+#else
+ #include <pthread.h>
+#endif
+#include "dsp_simd.h"
+#include "dsp_fft.h"
+
+#define DSP_FFT_PI			3.14159265358979323846
+
+static DSP_FFT_PLAN *g_plans[DSP_FFT_MAX_LOG2+1];	/*!< Shared plans, indexed by log2 of their size */
+#ifdef WIN32
+static CRITICAL_SECTION g_lock;						/*!< Serializes the construction of the shared plans */
+static volatile LONG g_lockstate = 0;				/*!< 0, 1 while g_lock is initialized, 2 once initialized */
+#else
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;	/*!< Serializes the construction of the shared plans */
+#endif
+
+
+/**
+ * Take the lock of the shared plans, initialized by the first caller.
+ */
+static void dsp_fft_lock(void)
+{
+#ifdef WIN32
+	if(g_lockstate!=2) {
+		if(InterlockedCompareExchange(&g_lockstate, 1, 0)==0) {
+			InitializeCriticalSection(&g_lock);
+			InterlockedExchange(&g_lockstate, 2);
+		}
+		else {
+			while(g_lockstate!=2)
+				Sleep(0);
+		}
+	}
+	EnterCriticalSection(&g_lock);
+#else
+	pthread_mutex_lock(&g_lock);
+#endif
+}
+
+/**
+ * Release the lock of the shared plans.
+ */
+static void dsp_fft_unlock(void)
+{
+#ifdef WIN32
+	LeaveCriticalSection(&g_lock);
+#else
+	pthread_mutex_unlock(&g_lock);
+#endif
+}
+
+#if defined(DSP_SIMD_AVX)
+/**
+ * Products of 4 complex values by 4 twiddles.
+ */
+static inline __m256 dsp_fft_mul4(__m256 a, __m256 w)
+{
+	__m256 as = _mm256_permute_ps(a, 0xB1);
+	return _mm256_addsub_ps(_mm256_mul_ps(a, _mm256_moveldup_ps(w)), _mm256_mul_ps(as, _mm256_movehdup_ps(w)));
+}
+#endif
+
+#if defined(DSP_SIMD_AVX) || defined(DSP_SIMD_SSE)
+/**
+ * Products of 2 complex values by 2 twiddles, SSE only ( no addsub ).
+ */
+static inline __m128 dsp_fft_mul2(__m128 a, __m128 w)
+{
+	const __m128 neg = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+	__m128 as = _mm_shuffle_ps(a, a, 0xB1);
+	__m128 wr = _mm_shuffle_ps(w, w, 0xA0);
+	__m128 wi = _mm_shuffle_ps(w, w, 0xF5);
+	return _mm_add_ps(_mm_mul_ps(a, wr), _mm_xor_ps(_mm_mul_ps(as, wi), neg));
+}
+#endif
+
+/**
+ * Radix-2 pass of groups of 2 values, the twiddle is 1.
+ */
+static void dsp_fft_pass2(DSP_COMPLEX *x, unsigned int n)
+{
+	unsigned int i = 0;
+	DSP_COMPLEX a, b;
+
+#if defined(DSP_SIMD_AVX)
+	const __m256 neg = _mm256_set_ps(-0.0f, -0.0f, 0.0f, 0.0f, -0.0f, -0.0f, 0.0f, 0.0f);
+	for(; i+4<=n; i += 4) {
+		// [a b] + [b -a] per 128 bit lane gives [a+b a-b]
+		__m256 v = _mm256_loadu_ps((float *)(x+i));
+		_mm256_storeu_ps((float *)(x+i), _mm256_add_ps(_mm256_xor_ps(v, neg), _mm256_permute_ps(v, 0x4E)));
+	}
+#elif defined(DSP_SIMD_SSE)
+	const __m128 neg = _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f);
+	for(; i+2<=n; i += 2) {
+		__m128 v = _mm_loadu_ps((float *)(x+i));
+		_mm_storeu_ps((float *)(x+i), _mm_add_ps(_mm_xor_ps(v, neg), _mm_shuffle_ps(v, v, 0x4E)));
+	}
+#endif
+	for(; i < n; i += 2) {
+		a = x[i];
+		b = x[i+1];
+		x[i].re = a.re+b.re;
+		x[i].im = a.im+b.im;
+		x[i+1].re = a.re-b.re;
+		x[i+1].im = a.im-b.im;
+	}
+}
+
+/**
+ * Radix-4 pass of groups of 4m values, two radix-2 stages: the stage of groups of 2m values ( twiddles w1 = w(2m)^k )
+ * and the stage of groups of 4m values ( twiddles w2 = w(4m)^k and -j*w2 ).
+ */
+static void dsp_fft_pass4(DSP_COMPLEX *x, unsigned int n, unsigned int m, const DSP_COMPLEX *tw)
+{
+	const DSP_COMPLEX *w2 = tw, *w1 = tw+m;
+	unsigned int g, k;
+	DSP_COMPLEX *a0, *a1, *a2, *a3, t, b0, b1, b2, b3;
+
+	for(g = 0; g < n; g += 4*m) {
+		a0 = x+g;
+		a1 = a0+m;
+		a2 = a1+m;
+		a3 = a2+m;
+		k = 0;
+#if defined(DSP_SIMD_AVX)
+		{
+			const __m256 negim = _mm256_set_ps(-0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f, -0.0f, 0.0f);
+			__m256 v0, v1, v2, v3, t1, t3, wv1, wv2;
+			for(; k+4<=m; k += 4) {
+				wv1 = _mm256_loadu_ps((const float *)(w1+k));
+				wv2 = _mm256_loadu_ps((const float *)(w2+k));
+				v0 = _mm256_loadu_ps((const float *)(a0+k));
+				v1 = dsp_fft_mul4(_mm256_loadu_ps((const float *)(a1+k)), wv1);
+				v2 = _mm256_loadu_ps((const float *)(a2+k));
+				v3 = dsp_fft_mul4(_mm256_loadu_ps((const float *)(a3+k)), wv1);
+				t1 = _mm256_sub_ps(v0, v1);
+				v0 = _mm256_add_ps(v0, v1);
+				t3 = _mm256_sub_ps(v2, v3);
+				v2 = _mm256_add_ps(v2, v3);
+				v2 = dsp_fft_mul4(v2, wv2);
+				// -j*w2*b3, (re, im) becomes (im, -re)
+				t3 = _mm256_xor_ps(_mm256_permute_ps(dsp_fft_mul4(t3, wv2), 0xB1), negim);
+				_mm256_storeu_ps((float *)(a0+k), _mm256_add_ps(v0, v2));
+				_mm256_storeu_ps((float *)(a2+k), _mm256_sub_ps(v0, v2));
+				_mm256_storeu_ps((float *)(a1+k), _mm256_add_ps(t1, t3));
+				_mm256_storeu_ps((float *)(a3+k), _mm256_sub_ps(t1, t3));
+			}
+		}
+#endif
+#if defined(DSP_SIMD_AVX) || defined(DSP_SIMD_SSE)
+		{
+			const __m128 negim = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+			__m128 v0, v1, v2, v3, t1, t3, wv1, wv2;
+			for(; k+2<=m; k += 2) {
+				wv1 = _mm_loadu_ps((const float *)(w1+k));
+				wv2 = _mm_loadu_ps((const float *)(w2+k));
+				v0 = _mm_loadu_ps((const float *)(a0+k));
+				v1 = dsp_fft_mul2(_mm_loadu_ps((const float *)(a1+k)), wv1);
+				v2 = _mm_loadu_ps((const float *)(a2+k));
+				v3 = dsp_fft_mul2(_mm_loadu_ps((const float *)(a3+k)), wv1);
+				t1 = _mm_sub_ps(v0, v1);
+				v0 = _mm_add_ps(v0, v1);
+				t3 = _mm_sub_ps(v2, v3);
+				v2 = _mm_add_ps(v2, v3);
+				v2 = dsp_fft_mul2(v2, wv2);
+				t3 = dsp_fft_mul2(t3, wv2);
+				t3 = _mm_xor_ps(_mm_shuffle_ps(t3, t3, 0xB1), negim);
+				_mm_storeu_ps((float *)(a0+k), _mm_add_ps(v0, v2));
+				_mm_storeu_ps((float *)(a2+k), _mm_sub_ps(v0, v2));
+				_mm_storeu_ps((float *)(a1+k), _mm_add_ps(t1, t3));
+				_mm_storeu_ps((float *)(a3+k), _mm_sub_ps(t1, t3));
+			}
+		}
+#endif
+		for(; k < m; k++) {
+			t.re = a1[k].re*w1[k].re-a1[k].im*w1[k].im;
+			t.im = a1[k].re*w1[k].im+a1[k].im*w1[k].re;
+			b0.re = a0[k].re+t.re;
+			b0.im = a0[k].im+t.im;
+			b1.re = a0[k].re-t.re;
+			b1.im = a0[k].im-t.im;
+			t.re = a3[k].re*w1[k].re-a3[k].im*w1[k].im;
+			t.im = a3[k].re*w1[k].im+a3[k].im*w1[k].re;
+			b2.re = a2[k].re+t.re;
+			b2.im = a2[k].im+t.im;
+			b3.re = a2[k].re-t.re;
+			b3.im = a2[k].im-t.im;
+			t.re = b2.re*w2[k].re-b2.im*w2[k].im;
+			t.im = b2.re*w2[k].im+b2.im*w2[k].re;
+			a0[k].re = b0.re+t.re;
+			a0[k].im = b0.im+t.im;
+			a2[k].re = b0.re-t.re;
+			a2[k].im = b0.im-t.im;
+			// -j*w2*b3
+			t.re = b3.re*w2[k].im+b3.im*w2[k].re;
+			t.im = -(b3.re*w2[k].re-b3.im*w2[k].im);
+			a1[k].re = b1.re+t.re;
+			a1[k].im = b1.im+t.im;
+			a3[k].re = b1.re-t.re;
+			a3[k].im = b1.im-t.im;
+		}
+	}
+}
+
+/**
+ * Multiply n complex values by (s, sign*s), sign -1 conjugates them.
+ */
+static void dsp_fft_scale(DSP_COMPLEX *x, unsigned int n, float s, float sign)
+{
+	unsigned int i = 0;
+
+#if defined(DSP_SIMD_AVX)
+	const __m256 f = _mm256_set_ps(sign*s, s, sign*s, s, sign*s, s, sign*s, s);
+	for(; i+4<=n; i += 4)
+		_mm256_storeu_ps((float *)(x+i), _mm256_mul_ps(_mm256_loadu_ps((const float *)(x+i)), f));
+#elif defined(DSP_SIMD_SSE)
+	const __m128 f = _mm_set_ps(sign*s, s, sign*s, s);
+	for(; i+2<=n; i += 2)
+		_mm_storeu_ps((float *)(x+i), _mm_mul_ps(_mm_loadu_ps((const float *)(x+i)), f));
+#endif
+	for(; i < n; i++) {
+		x[i].re *= s;
+		x[i].im *= sign*s;
+	}
+}
+
+/**
+ * Transform of one set of values, the plan and the data are valid.
+ */
+static void dsp_fft_run(const DSP_FFT_PLAN *plan, DSP_COMPLEX *data, int direction)
+{
+	unsigned int n = plan->n, i, m;
+	const DSP_COMPLEX *tw = plan->twiddle;
+
+	for(i = 0; i < n; i++) {
+		unsigned int r = plan->bitrev[i];
+		if(r>i) {
+			DSP_COMPLEX t = data[i];
+			data[i] = data[r];
+			data[r] = t;
+		}
+	}
+
+	// ifft(x) = conj(fft(conj(x)))/n
+	if(direction==DSP_FFT_INVERSE)
+		dsp_fft_scale(data, n, 1.0f, -1.0f);
+
+	m = 1;
+	if(plan->log2n&1) {
+		dsp_fft_pass2(data, n);
+		m = 2;
+	}
+	for(; 4*m <= n; m *= 4) {
+		dsp_fft_pass4(data, n, m, tw);
+		tw += 2*m;
+	}
+
+	if(direction==DSP_FFT_INVERSE)
+		dsp_fft_scale(data, n, 1.0f/n, -1.0f);
+}
+
+unsigned int dsp_fft_nextpow2(unsigned int n)
+{
+	unsigned int p = 1;
+
+	if(n==0 || n>DSP_FFT_MAX_SIZE)
+		return 0;
+	while(p<n)
+		p <<= 1;
+	return p;
+}
+
+int dsp_fft_init(DSP_FFT_PLAN *plan, unsigned int n)
+{
+	unsigned int log2n, i, j, m;
+	DSP_COMPLEX *tw;
+
+	if(!plan)
+		return DSP_FFT_ERR_ARGUMENT;
+	if(n==0 || n>DSP_FFT_MAX_SIZE || (n&(n-1))!=0)
+		return DSP_FFT_ERR_SIZE;
+
+	for(log2n = 0; (1u<<log2n)<n; log2n++)
+		;
+
+	memset(plan, 0, sizeof(DSP_FFT_PLAN));
+	plan->n = n;
+	plan->log2n = log2n;
+	plan->twiddle = (DSP_COMPLEX *)malloc(n*sizeof(DSP_COMPLEX));
+	plan->rtwiddle = (DSP_COMPLEX *)malloc((n+1)*sizeof(DSP_COMPLEX));
+	plan->bitrev = (unsigned int *)malloc(n*sizeof(unsigned int));
+	if(!plan->twiddle || !plan->rtwiddle || !plan->bitrev) {
+		dsp_fft_free(plan);
+		return DSP_FFT_ERR_ALLOC;
+	}
+
+	// twiddles are computed one by one in double precision, a recurrence would accumulate errors over large sizes
+	tw = plan->twiddle;
+	for(m = (log2n&1) ? 2 : 1; 4*m <= n; m *= 4) {
+		for(i = 0; i < m; i++) {
+			tw[i].re = (float)cos(2.0*DSP_FFT_PI*i/(4*m));
+			tw[i].im = (float)-sin(2.0*DSP_FFT_PI*i/(4*m));
+			tw[m+i].re = (float)cos(2.0*DSP_FFT_PI*i/(2*m));
+			tw[m+i].im = (float)-sin(2.0*DSP_FFT_PI*i/(2*m));
+		}
+		tw += 2*m;
+	}
+	for(i = 0; i <= n; i++) {
+		plan->rtwiddle[i].re = (float)cos(DSP_FFT_PI*i/n);
+		plan->rtwiddle[i].im = (float)-sin(DSP_FFT_PI*i/n);
+	}
+
+	for(i = 0; i < n; i++) {
+		unsigned int r = 0;
+		for(j = 0; j < log2n; j++)
+			r |= ((i>>j)&1)<<(log2n-1-j);
+		plan->bitrev[i] = r;
+	}
+
+	return DSP_FFT_ERR_OK;
+}
+
+const DSP_FFT_PLAN *dsp_fft_getplan(unsigned int n)
+{
+	DSP_FFT_PLAN *plan;
+	unsigned int log2n;
+
+	if(n==0 || n>DSP_FFT_MAX_SIZE || (n&(n-1))!=0)
+		return NULL;
+	for(log2n = 0; (1u<<log2n)<n; log2n++)
+		;
+
+	// the plan is published once complete, it is never modified afterwards
+	dsp_fft_lock();
+	if(!g_plans[log2n]) {
+		plan = (DSP_FFT_PLAN *)malloc(sizeof(DSP_FFT_PLAN));
+		if(plan && dsp_fft_init(plan, n)!=DSP_FFT_ERR_OK) {
+			free(plan);
+			plan = NULL;
+		}
+		g_plans[log2n] = plan;
+	}
+	plan = g_plans[log2n];
+	dsp_fft_unlock();
+	return plan;
+}
+
+int dsp_fft_execute(const DSP_FFT_PLAN *plan, DSP_COMPLEX *data, int direction)
+{
+	if(!plan || !data || !plan->twiddle || !plan->bitrev)
+		return DSP_FFT_ERR_ARGUMENT;
+	dsp_fft_run(plan, data, direction);
+	return DSP_FFT_ERR_OK;
+}
+
+int dsp_fft_batch(const DSP_FFT_PLAN *plan, DSP_COMPLEX *data, unsigned int count, unsigned int stride, int direction)
+{
+	unsigned int i;
+
+	if(!plan || !data || !plan->twiddle || !plan->bitrev || stride<plan->n)
+		return DSP_FFT_ERR_ARGUMENT;
+	for(i = 0; i < count; i++)
+		dsp_fft_run(plan, data+(size_t)i*stride, direction);
+	return DSP_FFT_ERR_OK;
+}
+
+int dsp_fft_execute_real(const DSP_FFT_PLAN *plan, DSP_COMPLEX *data, int direction)
+{
+	unsigned int n, k;
+	DSP_COMPLEX a, b, e, o, w, t;
+
+	if(!plan || !data || !plan->twiddle || !plan->rtwiddle || !plan->bitrev)
+		return DSP_FFT_ERR_ARGUMENT;
+	n = plan->n;
+
+	if(direction==DSP_FFT_INVERSE) {
+		// Z(k) = E(k)+j*O(k), E = (X(k)+conj(X(n-k)))/2 and O = (X(k)-conj(X(n-k)))/2*conj(w^k), Z(n-k) from the conjugates
+		a = data[0];
+		b = data[n];
+		data[0].re = 0.5f*(a.re+b.re);
+		data[0].im = 0.5f*(a.re-b.re);
+		for(k = 1; k <= n/2; k++) {
+			a = data[k];
+			b = data[n-k];
+			w = plan->rtwiddle[k];
+			e.re = 0.5f*(a.re+b.re);
+			e.im = 0.5f*(a.im-b.im);
+			t.re = 0.5f*(a.re-b.re);
+			t.im = 0.5f*(a.im+b.im);
+			o.re = t.re*w.re+t.im*w.im;
+			o.im = t.im*w.re-t.re*w.im;
+			data[k].re = e.re-o.im;
+			data[k].im = e.im+o.re;
+			data[n-k].re = e.re+o.im;
+			data[n-k].im = o.re-e.im;
+		}
+		dsp_fft_run(plan, data, DSP_FFT_INVERSE);
+		return DSP_FFT_ERR_OK;
+	}
+
+	dsp_fft_run(plan, data, DSP_FFT_FORWARD);
+	// X(k) = E(k)+w^k*O(k), E = (Z(k)+conj(Z(n-k)))/2 and O = (Z(k)-conj(Z(n-k)))/2j, X(n-k) = conj(E(k)-w^k*O(k))
+	a = data[0];
+	data[0].re = a.re+a.im;
+	data[0].im = 0.0f;
+	data[n].re = a.re-a.im;
+	data[n].im = 0.0f;
+	for(k = 1; k <= n/2; k++) {
+		a = data[k];
+		b = data[n-k];
+		w = plan->rtwiddle[k];
+		e.re = 0.5f*(a.re+b.re);
+		e.im = 0.5f*(a.im-b.im);
+		o.re = 0.5f*(a.im+b.im);
+		o.im = -0.5f*(a.re-b.re);
+		t.re = w.re*o.re-w.im*o.im;
+		t.im = w.re*o.im+w.im*o.re;
+		data[k].re = e.re+t.re;
+		data[k].im = e.im+t.im;
+		data[n-k].re = e.re-t.re;
+		data[n-k].im = t.im-e.im;
+	}
+	return DSP_FFT_ERR_OK;
+}
+
+void dsp_fft_free(DSP_FFT_PLAN *plan)
+{
+	if(!plan)
+		return;
+	free(plan->twiddle);
+	free(plan->rtwiddle);
+	free(plan->bitrev);
+	plan->twiddle = NULL;
+	plan->rtwiddle = NULL;
+	plan->bitrev = NULL;
+	plan->n = 0;
+}
+
+void dsp_fft_releaseplans(void)
+{
+	unsigned int i;
+
+	dsp_fft_lock();
+	for(i = 0; i <= DSP_FFT_MAX_LOG2; i++) {
+		if(g_plans[i]) {
+			dsp_fft_free(g_plans[i]);
+			free(g_plans[i]);
+			g_plans[i] = NULL;
+		}
+	}
+	dsp_fft_unlock();
+}
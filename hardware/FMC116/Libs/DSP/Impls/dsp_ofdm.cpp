@@ -0,0 +1,456 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ofdm.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ofdm module demodulates the optical OFDM symbols of an aligned frame (implementation)
+///
+/// Native version of cDemodOFDM.demodulate(). The symbols of a frame, NPSYM samples each, are
+/// brought to the signal clock in one piece by the polyphase resampler of dsp_resample.h, so that
+/// the filter does not see the edges of every symbol, and transformed with the shared FFT plan
+/// of dsp_fft_getplan(), two real symbols per complex transform, all of them in one batch. The
+/// data subcarriers, 1..NSC/2-1 for 'DCOOFDM' and 'DMT' and the odd ones below NSC/2 for
+/// 'ACOOFDM', are equalized with the gains estimated on the pilot of the frame and sliced to the
+/// nearest point of the constellation with the vector instructions selected by dsp_simd.h, all
+/// the points of the frame at once. The index of the point is sent MSB first on log2(MSC) bits
+/// as dec2binMat() does.
+///
+/// The time signal of a symbol is taken as the unitary inverse transform of its subcarriers,
+/// x = sqrt(NSC)*ifft(X), the ACO-OFDM subcarriers being halved by the clipping. The pilot of
+/// the frame gives the gain from the OFDM signal to the ADC counts, either one gain for the
+/// whole band, the least squares fit of cPilot.getScale(), or one complex gain per subcarrier,
+/// the ratio of the received and expected pilot spectra at the subcarrier frequency, pulled
+/// towards the whole band gain where the pilot has little energy. The response of the resampler
+/// at each subcarrier is divided out in both cases.
+///
+/// The resampler and the pilot spectra are built once per engine, a frame only runs the
+/// transforms. An engine is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "dsp_simd.h"
+#include "dsp_fft.h"
+#include "dsp_resample.h"
+#include "dsp_ofdm.h"
+
+#define DSP_OFDM_PI					3.14159265358979323846
+#define DSP_OFDM_MAX_NPSYM			(1<<24)				/*!< Most samples per symbol */
+
+
+/**
+ * Release the pilot tables, dsp_ofdm_setpilot() builds them again.
+ */
+static void dsp_ofdm_releasepilot(DSP_OFDM *ofdm)
+{
+	free(ofdm->pltref);
+	free(ofdm->pltrx);
+	free(ofdm->pltcos);
+	free(ofdm->pltsin);
+	free(ofdm->pltspec);
+	ofdm->pltref = NULL;
+	ofdm->pltrx = NULL;
+	ofdm->pltcos = NULL;
+	ofdm->pltsin = NULL;
+	ofdm->pltspec = NULL;
+	ofdm->pltlen = 0;
+}
+
+/**
+ * Estimate the channel on the pilot of a frame and set the equalizer, from the transform of a symbol to the constellation.
+ */
+static int dsp_ofdm_equalizer(DSP_OFDM *ofdm, const short *sig, unsigned int len, unsigned int pltstart, int invert)
+{
+	unsigned int n, d, pos = pltstart, pltlen = ofdm->pltlen;
+	float *r = ofdm->pltrx, mean = 0.0f, scale, g;
+	double rr, ri, hr, hi, h2, pr, pi;
+
+	for(n = 0; n < pltlen; n++) {
+		r[n] = invert ? -(float)sig[pos] : (float)sig[pos];
+		mean += r[n];
+		if(++pos==len)
+			pos = 0;
+	}
+	mean /= pltlen;
+	for(n = 0; n < pltlen; n++)
+		r[n] -= mean;
+
+	// unitary transform, the clipping of ACO-OFDM halves the data subcarriers
+	scale = (float)((ofdm->type==DSP_OFDM_ACO ? 2.0 : 1.0)/sqrt((double)ofdm->nsc));
+
+	// ADC counts per pilot unit over the whole band, least squares fit of the expected pilot
+	rr = 0.0;
+	for(n = 0; n < pltlen; n++)
+		rr += r[n]*ofdm->pltref[n];
+	g = (float)(rr/ofdm->pltenergy);
+	if(g==0.0f)
+		return DSP_OFDM_ERR_PILOT;
+	if(ofdm->eq==DSP_OFDM_EQ_FLAT) {
+		for(d = 0; d < ofdm->ndata; d++) {
+			ofdm->gain[d].re = scale*ofdm->rsgain[d]*ofdm->pltscale/g;
+			ofdm->gain[d].im = 0.0f;
+		}
+		return DSP_OFDM_ERR_OK;
+	}
+
+	// H = (R*conj(P)+floor*g)/(|P|^2+floor) per subcarrier, the flat gain where the pilot carries no energy
+	for(d = 0; d < ofdm->ndata; d++) {
+		const float *c = ofdm->pltcos+d*pltlen, *s = ofdm->pltsin+d*pltlen;
+		rr = 0.0;
+		ri = 0.0;
+		for(n = 0; n < pltlen; n++) {
+			rr += r[n]*c[n];
+			ri -= r[n]*s[n];
+		}
+		pr = ofdm->pltspec[d].re;
+		pi = ofdm->pltspec[d].im;
+		h2 = (pr*pr+pi*pi+ofdm->pltfloor)*ofdm->pltscale;
+		hr = (rr*pr+ri*pi+ofdm->pltfloor*g)/h2;
+		hi = (ri*pr-rr*pi)/h2;
+		h2 = hr*hr+hi*hi;
+		if(h2==0.0) {
+			ofdm->gain[d].re = 0.0f;
+			ofdm->gain[d].im = 0.0f;
+			continue;
+		}
+		ofdm->gain[d].re = (float)(scale*ofdm->rsgain[d]*hr/h2);
+		ofdm->gain[d].im = (float)(-scale*ofdm->rsgain[d]*hi/h2);
+	}
+	return DSP_OFDM_ERR_OK;
+}
+
+/**
+ * Nearest constellation point of the first n equalized subcarriers, the first point wins a tie.
+ */
+static void dsp_ofdm_slice(DSP_OFDM *ofdm, unsigned int n)
+{
+	unsigned int i = 0, m;
+	float d, best, dr, di;
+
+#if defined(DSP_SIMD_AVX)
+	for(; i+8<=n; i += 8) {
+		__m256 re = _mm256_load_ps(ofdm->yre+i), im = _mm256_load_ps(ofdm->yim+i);
+		__m256 vbest = _mm256_set1_ps(FLT_MAX), vidx = _mm256_setzero_ps(), vdr, vdi, vd;
+		for(m = 0; m < ofdm->msc; m++) {
+			vdr = _mm256_sub_ps(re, _mm256_set1_ps(ofdm->symre[m]));
+			vdi = _mm256_sub_ps(im, _mm256_set1_ps(ofdm->symim[m]));
+			vd = _mm256_add_ps(_mm256_mul_ps(vdr, vdr), _mm256_mul_ps(vdi, vdi));
+			vidx = _mm256_blendv_ps(vidx, _mm256_set1_ps((float)m), _mm256_cmp_ps(vd, vbest, _CMP_LT_OQ));
+			vbest = _mm256_min_ps(vd, vbest);
+		}
+		_mm256_storeu_si256((__m256i *)(ofdm->dec+i), _mm256_cvttps_epi32(vidx));
+	}
+#elif defined(DSP_SIMD_SSE)
+	for(; i+4<=n; i += 4) {
+		__m128 re = _mm_load_ps(ofdm->yre+i), im = _mm_load_ps(ofdm->yim+i);
+		__m128 vbest = _mm_set1_ps(FLT_MAX), vidx = _mm_setzero_ps(), vdr, vdi, vd, lt;
+		float idx[4];
+		for(m = 0; m < ofdm->msc; m++) {
+			vdr = _mm_sub_ps(re, _mm_set1_ps(ofdm->symre[m]));
+			vdi = _mm_sub_ps(im, _mm_set1_ps(ofdm->symim[m]));
+			vd = _mm_add_ps(_mm_mul_ps(vdr, vdr), _mm_mul_ps(vdi, vdi));
+			lt = _mm_cmplt_ps(vd, vbest);
+			vidx = _mm_or_ps(_mm_and_ps(lt, _mm_set1_ps((float)m)), _mm_andnot_ps(lt, vidx));
+			vbest = _mm_min_ps(vd, vbest);
+		}
+		_mm_storeu_ps(idx, vidx);
+		for(m = 0; m < 4; m++)
+			ofdm->dec[i+m] = (unsigned int)idx[m];
+	}
+#endif
+	for(; i < n; i++) {
+		best = FLT_MAX;
+		ofdm->dec[i] = 0;
+		for(m = 0; m < ofdm->msc; m++) {
+			dr = ofdm->yre[i]-ofdm->symre[m];
+			di = ofdm->yim[i]-ofdm->symim[m];
+			d = dr*dr+di*di;
+			if(d<best) {
+				best = d;
+				ofdm->dec[i] = m;
+			}
+		}
+	}
+}
+
+/**
+ * Inverse of the response of the resampler at the data subcarriers, the average of its phases.
+ */
+static void dsp_ofdm_rsgain(DSP_OFDM *ofdm)
+{
+	const DSP_RESAMPLE *rs = &ofdm->rs;
+	unsigned int d, p, i;
+	double w, h, t;
+
+	for(d = 0; d < ofdm->ndata; d++) {
+		// tap i of phase p weighs the input sample (p+(K-i)*USF)/USF samples before the output sample
+		w = 2.0*DSP_OFDM_PI*ofdm->carrier[d]*ofdm->clksig/(ofdm->nsc*ofdm->clksmp);
+		h = 0.0;
+		for(p = 0; p < rs->usf; p++) {
+			for(i = 0; i <= 2*DSP_RESAMPLE_HALFTAPS; i++) {
+				t = (double)p/rs->usf+(double)DSP_RESAMPLE_HALFTAPS-i;
+				h += rs->bank[p*rs->ntaps+i]*cos(w*t);
+			}
+		}
+		h /= rs->usf;
+		ofdm->rsgain[d] = fabs(h)>1e-6 ? (float)(1.0/h) : 0.0f;
+	}
+}
+
+int dsp_ofdm_init(DSP_OFDM *ofdm, int type, unsigned int nsc, const float *symre, const float *symim, unsigned int msc,
+	double clksmp, double clksig, int filter)
+{
+	unsigned int k;
+	int rc;
+
+	if(!ofdm || !symre || !symim)
+		return DSP_OFDM_ERR_ARGUMENT;
+	if(type!=DSP_OFDM_ACO && type!=DSP_OFDM_DCO && type!=DSP_OFDM_DMT)
+		return DSP_OFDM_ERR_TYPE;
+	if(nsc<DSP_OFDM_MIN_NSC || nsc>DSP_OFDM_MAX_NSC || (nsc&(nsc-1))!=0)
+		return DSP_OFDM_ERR_SIZE;
+	if(msc<2 || msc>DSP_OFDM_MAX_MSC || (msc&(msc-1))!=0)
+		return DSP_OFDM_ERR_SIZE;
+	if(clksmp<=0.0 || clksig<=0.0 || nsc*clksmp/clksig>DSP_OFDM_MAX_NPSYM)
+		return DSP_OFDM_ERR_CLOCK;
+
+	memset(ofdm, 0, sizeof(DSP_OFDM));
+	ofdm->type = type;
+	ofdm->eq = DSP_OFDM_EQ_FLAT;
+	ofdm->nsc = nsc;
+	ofdm->msc = msc;
+	for(ofdm->bpsc = 0; (1u<<ofdm->bpsc)<msc; ofdm->bpsc++)
+		;
+	ofdm->ndata = type==DSP_OFDM_ACO ? nsc/4 : nsc/2-1;
+	ofdm->bpsym = ofdm->ndata*ofdm->bpsc;
+	ofdm->npsym = (unsigned int)ceil(nsc*clksmp/clksig);
+	ofdm->clksmp = clksmp;
+	ofdm->clksig = clksig;
+
+	rc = dsp_resample_init(&ofdm->rs, clksmp, clksig, filter);
+	if(rc!=DSP_RESAMPLE_ERR_OK) {
+		dsp_ofdm_free(ofdm);
+		if(rc==DSP_RESAMPLE_ERR_FILTER)
+			return DSP_OFDM_ERR_TYPE;
+		return rc==DSP_RESAMPLE_ERR_RATIO ? DSP_OFDM_ERR_CLOCK : DSP_OFDM_ERR_ALLOC;
+	}
+	ofdm->plan = dsp_fft_getplan(nsc);
+	if(!ofdm->plan) {
+		dsp_ofdm_free(ofdm);
+		return DSP_OFDM_ERR_ALLOC;
+	}
+
+	// the symbols are resampled in one piece with the samples around them, no symbol sees the edges of the filter
+	ofdm->context = ((DSP_RESAMPLE_HALFTAPS+ofdm->rs.dsf-1)/ofdm->rs.dsf)*ofdm->rs.dsf;
+	ofdm->lead = ofdm->context/ofdm->rs.dsf*ofdm->rs.usf;
+
+	ofdm->carrier = (unsigned int *)malloc(ofdm->ndata*sizeof(unsigned int));
+	ofdm->symre = (float *)malloc(msc*sizeof(float));
+	ofdm->symim = (float *)malloc(msc*sizeof(float));
+	ofdm->rsgain = (float *)malloc(ofdm->ndata*sizeof(float));
+	ofdm->gain = (DSP_COMPLEX *)malloc(ofdm->ndata*sizeof(DSP_COMPLEX));
+	if(!ofdm->carrier || !ofdm->symre || !ofdm->symim || !ofdm->rsgain || !ofdm->gain) {
+		dsp_ofdm_free(ofdm);
+		return DSP_OFDM_ERR_ALLOC;
+	}
+
+	for(k = 0; k < ofdm->ndata; k++)
+		ofdm->carrier[k] = type==DSP_OFDM_ACO ? 2*k+1 : k+1;
+	memcpy(ofdm->symre, symre, msc*sizeof(float));
+	memcpy(ofdm->symim, symim, msc*sizeof(float));
+	dsp_ofdm_rsgain(ofdm);
+	return DSP_OFDM_ERR_OK;
+}
+
+int dsp_ofdm_setpilot(DSP_OFDM *ofdm, const float *ref, unsigned int pltlen, float scale, int eq)
+{
+	unsigned int n, d;
+	double mean = 0.0, w, pr, pi, pmax = 0.0;
+
+	if(!ofdm || !ref || !ofdm->carrier)
+		return DSP_OFDM_ERR_ARGUMENT;
+	if(eq!=DSP_OFDM_EQ_FLAT && eq!=DSP_OFDM_EQ_PILOT)
+		return DSP_OFDM_ERR_TYPE;
+	if(pltlen==0 || scale==0.0f)
+		return DSP_OFDM_ERR_PILOT;
+
+	dsp_ofdm_releasepilot(ofdm);
+	ofdm->pltref = (float *)malloc(pltlen*sizeof(float));
+	ofdm->pltrx = (float *)malloc(pltlen*sizeof(float));
+	if(!ofdm->pltref || !ofdm->pltrx) {
+		dsp_ofdm_releasepilot(ofdm);
+		return DSP_OFDM_ERR_ALLOC;
+	}
+
+	// the mean of the pilot carries the DC offset of the link, it is left out of both estimates
+	for(n = 0; n < pltlen; n++)
+		mean += ref[n];
+	mean /= pltlen;
+	ofdm->pltenergy = 0.0f;
+	for(n = 0; n < pltlen; n++) {
+		ofdm->pltref[n] = (float)(ref[n]-mean);
+		ofdm->pltenergy += ofdm->pltref[n]*ofdm->pltref[n];
+	}
+	if(ofdm->pltenergy==0.0f) {
+		dsp_ofdm_releasepilot(ofdm);
+		return DSP_OFDM_ERR_PILOT;
+	}
+
+	if(eq==DSP_OFDM_EQ_PILOT) {
+		ofdm->pltcos = (float *)malloc(ofdm->ndata*pltlen*sizeof(float));
+		ofdm->pltsin = (float *)malloc(ofdm->ndata*pltlen*sizeof(float));
+		ofdm->pltspec = (DSP_COMPLEX *)malloc(ofdm->ndata*sizeof(DSP_COMPLEX));
+		if(!ofdm->pltcos || !ofdm->pltsin || !ofdm->pltspec) {
+			dsp_ofdm_releasepilot(ofdm);
+			return DSP_OFDM_ERR_ALLOC;
+		}
+		// subcarrier k is at k*clksig/nsc Hz, w is its angular frequency at the sample clock
+		for(d = 0; d < ofdm->ndata; d++) {
+			w = 2.0*DSP_OFDM_PI*ofdm->carrier[d]*ofdm->clksig/(ofdm->nsc*ofdm->clksmp);
+			pr = 0.0;
+			pi = 0.0;
+			for(n = 0; n < pltlen; n++) {
+				ofdm->pltcos[d*pltlen+n] = (float)cos(w*n);
+				ofdm->pltsin[d*pltlen+n] = (float)sin(w*n);
+				pr += ofdm->pltref[n]*ofdm->pltcos[d*pltlen+n];
+				pi -= ofdm->pltref[n]*ofdm->pltsin[d*pltlen+n];
+			}
+			ofdm->pltspec[d].re = (float)pr;
+			ofdm->pltspec[d].im = (float)pi;
+			if(pr*pr+pi*pi>pmax)
+				pmax = pr*pr+pi*pi;
+		}
+		ofdm->pltfloor = (float)(DSP_OFDM_EQ_FLOOR*pmax);
+	}
+
+	ofdm->pltlen = pltlen;
+	ofdm->pltscale = scale;
+	ofdm->eq = eq;
+	return DSP_OFDM_ERR_OK;
+}
+
+int dsp_ofdm_demod16(DSP_OFDM *ofdm, const short *sig, unsigned int len, unsigned int pltstart, unsigned int start, unsigned int nsym,
+	int invert, unsigned char *bits)
+{
+	unsigned int ndata, nsc, s, d, k, b, j, n, npts, npairs, nin, nout, size, pos;
+	DSP_COMPLEX a, z, x0, x1, g, *w;
+	const float *y0, *y1;
+	int rc;
+
+	if(!ofdm || !sig || !bits || !ofdm->carrier)
+		return DSP_OFDM_ERR_ARGUMENT;
+	if(ofdm->pltlen==0)
+		return DSP_OFDM_ERR_PILOT;
+	if(start>=len || pltstart>=len || ofdm->pltlen>len || (unsigned long long)nsym*ofdm->npsym>len)
+		return DSP_OFDM_ERR_LENGTH;
+	ndata = ofdm->ndata;
+	nsc = ofdm->nsc;
+	npts = nsym*ndata;
+	npairs = (nsym+1)/2;
+	nin = nsym*ofdm->npsym+2*ofdm->context;
+	size = dsp_resample_maxout(&ofdm->rs, nin)+nsc;
+
+	if(ofdm->capacity<nsym || !ofdm->seg) {
+		free(ofdm->seg);
+		free(ofdm->sig);
+		dsp_free(ofdm->yre);
+		dsp_free(ofdm->yim);
+		free(ofdm->dec);
+		free(ofdm->work);
+		ofdm->seg = (float *)malloc(nin*sizeof(float));
+		ofdm->sig = (float *)malloc(size*sizeof(float));
+		ofdm->yre = (float *)dsp_malloc(DSP_SIMD_ROUNDUP(npts)*sizeof(float));
+		ofdm->yim = (float *)dsp_malloc(DSP_SIMD_ROUNDUP(npts)*sizeof(float));
+		ofdm->dec = (unsigned int *)malloc(DSP_SIMD_ROUNDUP(npts)*sizeof(unsigned int));
+		ofdm->work = (DSP_COMPLEX *)malloc((npairs>0 ? npairs : 1)*nsc*sizeof(DSP_COMPLEX));
+		ofdm->capacity = nsym;
+		if(!ofdm->seg || !ofdm->sig || !ofdm->yre || !ofdm->yim || !ofdm->dec || !ofdm->work) {
+			ofdm->capacity = 0;
+			return DSP_OFDM_ERR_ALLOC;
+		}
+	}
+
+	rc = dsp_ofdm_equalizer(ofdm, sig, len, pltstart, invert);
+	if(rc!=DSP_OFDM_ERR_OK)
+		return rc;
+
+	// symbols of the frame with context samples on both sides, the frame is circular
+	pos = (unsigned int)((start+len-ofdm->context%len)%len);
+	for(n = 0; n < nin; n++) {
+		ofdm->seg[n] = invert ? -(float)sig[pos] : (float)sig[pos];
+		if(++pos==len)
+			pos = 0;
+	}
+	rc = dsp_resample_frame(&ofdm->rs, ofdm->seg, nin, ofdm->sig, size, &nout);
+	if(rc!=DSP_RESAMPLE_ERR_OK)
+		return rc==DSP_RESAMPLE_ERR_ALLOC ? DSP_OFDM_ERR_ALLOC : DSP_OFDM_ERR_ARGUMENT;
+	for(n = nout; n < size; n++)
+		ofdm->sig[n] = 0.0f;
+
+	// two real symbols per transform, x0 in the real part and x1 in the imaginary part
+	for(s = 0; s < nsym; s += 2) {
+		// symbol s starts on the first output sample at or after its first input sample
+		y0 = ofdm->sig+ofdm->lead+((unsigned long long)s*ofdm->npsym*ofdm->rs.usf+ofdm->rs.dsf-1)/ofdm->rs.dsf;
+		y1 = ofdm->sig+ofdm->lead+((unsigned long long)(s+1)*ofdm->npsym*ofdm->rs.usf+ofdm->rs.dsf-1)/ofdm->rs.dsf;
+		w = ofdm->work+(s/2)*nsc;
+		for(k = 0; k < nsc; k++) {
+			w[k].re = y0[k];
+			w[k].im = s+1<nsym ? y1[k] : 0.0f;
+		}
+	}
+	// all the transforms of the frame at once
+	dsp_fft_batch(ofdm->plan, ofdm->work, npairs, nsc, DSP_FFT_FORWARD);
+
+	for(s = 0; s < nsym; s += 2) {
+		w = ofdm->work+(s/2)*nsc;
+		// X0(k) = (Z(k)+conj(Z(n-k)))/2 and X1(k) = (Z(k)-conj(Z(n-k)))/2j
+		for(d = 0; d < ndata; d++) {
+			k = ofdm->carrier[d];
+			a = w[k];
+			z = w[nsc-k];
+			g = ofdm->gain[d];
+			x0.re = 0.5f*(a.re+z.re);
+			x0.im = 0.5f*(a.im-z.im);
+			x1.re = 0.5f*(a.im+z.im);
+			x1.im = -0.5f*(a.re-z.re);
+			ofdm->yre[s*ndata+d] = x0.re*g.re-x0.im*g.im;
+			ofdm->yim[s*ndata+d] = x0.re*g.im+x0.im*g.re;
+			if(s+1<nsym) {
+				ofdm->yre[(s+1)*ndata+d] = x1.re*g.re-x1.im*g.im;
+				ofdm->yim[(s+1)*ndata+d] = x1.re*g.im+x1.im*g.re;
+			}
+		}
+	}
+
+	dsp_ofdm_slice(ofdm, npts);
+
+	// dec2binMat(), MSB first
+	memset(bits, 0, DSP_OFDM_NBYTES(nsym*ofdm->bpsym));
+	b = 0;
+	for(k = 0; k < npts; k++) {
+		for(j = ofdm->bpsc; j-- > 0; b++) {
+			if((ofdm->dec[k]>>j)&1)
+				bits[b>>3] |= (unsigned char)(1<<(b&7));
+		}
+	}
+	return DSP_OFDM_ERR_OK;
+}
+
+void dsp_ofdm_free(DSP_OFDM *ofdm)
+{
+	if(!ofdm)
+		return;
+	dsp_ofdm_releasepilot(ofdm);
+	dsp_resample_free(&ofdm->rs);
+	free(ofdm->carrier);
+	free(ofdm->symre);
+	free(ofdm->symim);
+	free(ofdm->rsgain);
+	free(ofdm->seg);
+	free(ofdm->sig);
+	free(ofdm->work);
+	free(ofdm->gain);
+	dsp_free(ofdm->yre);
+	dsp_free(ofdm->yim);
+	free(ofdm->dec);
+	memset(ofdm, 0, sizeof(DSP_OFDM));
+}
@@ -0,0 +1,217 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ook.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ook module demodulates the OOK symbols of an aligned frame (implementation)
+///
+/// Native version of cDemodOOK.demodulate(). A symbol is NPSYM consecutive samples, each sample
+/// is compared with the threshold (ON+OFF)/2 and the symbol is the majority of the comparisons,
+/// a tie gives 0 as mode() does. The comparisons of the whole frame are packed into a bit mask
+/// with the vector instructions selected by dsp_simd.h, the majority of each symbol is then a
+/// population count of NPSYM bits of the mask instead of a loop over its samples.
+///
+/// The ON and OFF levels are either fixed, in ADC counts, or measured on every frame as the
+/// largest and smallest sample of its symbols, which stands for the min() subtraction and the
+/// pilot gain scaling of the receiver scripts. A demodulator is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dsp_simd.h"
+#include "dsp_ook.h"
+
+#if defined(DSP_SIMD_AVX2)
+ #include <nmmintrin.h>
+#endif
+
+
+/**
+ * Number of bits set in a word.
+ */
+static inline unsigned int dsp_ook_popcount(unsigned int x)
+{
+#if defined(DSP_SIMD_AVX2)
+	return (unsigned int)_mm_popcnt_u32(x);
+#else
+	x = x-((x>>1)&0x55555555);
+	x = (x&0x33333333)+((x>>2)&0x33333333);
+	x = (x+(x>>4))&0x0F0F0F0F;
+	return (x*0x01010101)>>24;
+#endif
+}
+
+/**
+ * Number of bits set among the n bits of the mask starting at bit first, without wrap around. The word following the
+ * last bit is read, the mask holds one padding word.
+ */
+static inline unsigned int dsp_ook_count(const unsigned int *mask, unsigned int first, unsigned int n)
+{
+	unsigned long long win;
+	unsigned int count = 0, m;
+
+	// up to 32 bits at a time, from a 64 bit window starting on the word of the first bit
+	while(n) {
+		m = n<32 ? n : 32;
+		win = (((unsigned long long)mask[(first>>5)+1]<<32)|mask[first>>5])>>(first&31);
+		count += dsp_ook_popcount((unsigned int)win&(0xFFFFFFFFu>>(32-m)));
+		first += m;
+		n -= m;
+	}
+	return count;
+}
+
+/**
+ * Smallest and largest of the n samples starting at sig[first], without wrap around.
+ */
+static void dsp_ook_extent(const short *sig, unsigned int first, unsigned int n, int *lo, int *hi)
+{
+	unsigned int i = 0;
+
+	sig += first;
+#if defined(DSP_SIMD_SSE2)
+	if(n>=8) {
+		__m128i vlo = _mm_loadu_si128((const __m128i *)sig), vhi = vlo, x;
+		short l[8], h[8];
+		for(i = 8; i+8<=n; i += 8) {
+			x = _mm_loadu_si128((const __m128i *)(sig+i));
+			vlo = _mm_min_epi16(vlo, x);
+			vhi = _mm_max_epi16(vhi, x);
+		}
+		_mm_storeu_si128((__m128i *)l, vlo);
+		_mm_storeu_si128((__m128i *)h, vhi);
+		for(int k = 0; k < 8; k++) {
+			if(l[k]<*lo)
+				*lo = l[k];
+			if(h[k]>*hi)
+				*hi = h[k];
+		}
+	}
+#endif
+	for(; i < n; i++) {
+		if(sig[i]<*lo)
+			*lo = sig[i];
+		if(sig[i]>*hi)
+			*hi = sig[i];
+	}
+}
+
+/**
+ * Compare every sample of the frame with c, the bit of a sample is (sig[i]>c) xor flip. c is within the 16 bit range.
+ */
+static void dsp_ook_compare(const short *sig, unsigned int len, int c, unsigned int flip, unsigned int *mask)
+{
+	unsigned int i = 0, w = 0, word, k;
+
+#if defined(DSP_SIMD_AVX2)
+	__m256i vc = _mm256_set1_epi16((short)c), a, b;
+	for(; i+32<=len; i += 32) {
+		a = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i *)(sig+i)), vc);
+		b = _mm256_cmpgt_epi16(_mm256_loadu_si256((const __m256i *)(sig+i+16)), vc);
+		// the packing works per 128 bit lane, the permutation restores the sample order
+		a = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), 0xD8);
+		mask[w++] = (unsigned int)_mm256_movemask_epi8(a)^flip;
+	}
+#elif defined(DSP_SIMD_SSE2)
+	__m128i vc = _mm_set1_epi16((short)c), lo, hi;
+	for(; i+32<=len; i += 32) {
+		lo = _mm_packs_epi16(_mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *)(sig+i)), vc),
+			_mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *)(sig+i+8)), vc));
+		hi = _mm_packs_epi16(_mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *)(sig+i+16)), vc),
+			_mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *)(sig+i+24)), vc));
+		mask[w++] = ((unsigned int)_mm_movemask_epi8(lo)|((unsigned int)_mm_movemask_epi8(hi)<<16))^flip;
+	}
+#endif
+	for(; i < len; i += 32) {
+		word = 0;
+		for(k = 0; k < 32 && i+k<len; k++) {
+			if(sig[i+k]>c)
+				word |= 1u<<k;
+		}
+		mask[w++] = word^flip;
+	}
+}
+
+int dsp_ook_init(DSP_OOK *ook, unsigned int npsym, float on, float off)
+{
+	if(!ook)
+		return DSP_OOK_ERR_ARGUMENT;
+	if(npsym==0)
+		return DSP_OOK_ERR_SYMBOL;
+
+	memset(ook, 0, sizeof(DSP_OOK));
+	ook->npsym = npsym;
+	ook->on = on;
+	ook->off = off;
+	ook->threshold = (on+off)/2;
+	return DSP_OOK_ERR_OK;
+}
+
+int dsp_ook_demod16(DSP_OOK *ook, const short *sig, unsigned int len, unsigned int start, unsigned int nsym, int invert, unsigned char *bits)
+{
+	unsigned int words = (len+31)/32, n, first, count, k, byte;
+	int lo, hi, t, c;
+
+	if(!ook || !sig || !bits || ook->npsym==0)
+		return DSP_OOK_ERR_ARGUMENT;
+	if(start>=len || (unsigned long long)nsym*ook->npsym>len)
+		return DSP_OOK_ERR_LENGTH;
+
+	if(ook->masksize<words+1) {
+		dsp_free(ook->mask);
+		ook->mask = (unsigned int *)dsp_malloc((words+1)*sizeof(unsigned int));
+		ook->masksize = ook->mask ? words+1 : 0;
+		if(!ook->mask)
+			return DSP_OOK_ERR_ALLOC;
+	}
+	ook->mask[words] = 0;
+
+	// ON and OFF of this frame, the largest and smallest sample of its symbols after the polarity correction
+	n = nsym*ook->npsym;
+	if(ook->on==ook->off && n>0) {
+		lo = 32767;
+		hi = -32768;
+		first = len-start<n ? len-start : n;
+		dsp_ook_extent(sig, start, first, &lo, &hi);
+		dsp_ook_extent(sig, 0, n-first, &lo, &hi);
+		ook->threshold = invert ? -(lo+hi)/2.0f : (lo+hi)/2.0f;
+	}
+	else
+		ook->threshold = (ook->on+ook->off)/2;
+
+	// s > threshold with integer samples is s > t, and -s > t is the complement of s > -t-1
+	t = (int)floor(ook->threshold);
+	c = invert ? -t-1 : t;
+	if(c>=32767 || c<-32768)
+		memset(ook->mask, (c<-32768)!=(invert!=0) ? 0xFF : 0x00, words*sizeof(unsigned int));
+	else
+		dsp_ook_compare(sig, len, c, invert ? 0xFFFFFFFF : 0, ook->mask);
+
+	// majority of each symbol, a tie is a 0, the bits of a byte are gathered before being stored
+	first = start;
+	byte = 0;
+	for(k = 0; k < nsym; k++) {
+		if(first+ook->npsym<=len)
+			count = dsp_ook_count(ook->mask, first, ook->npsym);
+		else
+			count = dsp_ook_count(ook->mask, first, len-first)+dsp_ook_count(ook->mask, 0, ook->npsym-(len-first));
+		byte |= (2*count>ook->npsym)<<(k&7);
+		if((k&7)==7) {
+			bits[k>>3] = (unsigned char)byte;
+			byte = 0;
+		}
+		first += ook->npsym;
+		if(first>=len)
+			first -= len;
+	}
+	if(nsym&7)
+		bits[nsym>>3] = (unsigned char)byte;
+	return DSP_OOK_ERR_OK;
+}
+
+void dsp_ook_free(DSP_OOK *ook)
+{
+	if(!ook)
+		return;
+	dsp_free(ook->mask);
+	ook->mask = NULL;
+	ook->masksize = 0;
+}
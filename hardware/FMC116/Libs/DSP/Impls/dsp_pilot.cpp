@@ -0,0 +1,494 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_pilot.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_pilot module finds the Barker pilot in a received frame (implementation)
+///
+/// Native version of cPilotBarker.alignPilot(). The Barker sequence is brought to the sample
+/// clock of the frame by the polyphase resampler of dsp_resample.h. The coarse position is the
+/// peak of the circular cross correlation of the pilot with the frame, computed with real FFTs,
+/// and it is refined by the alignFine() search over +-DSP_PILOT_FINE samples.
+///
+/// The pilot and its spectrum only depend on the sample clock and on the frame length, they
+/// are kept in a small cache of the engine and rebuilt only when a new combination shows up.
+///
+/// In steady state the pilot of consecutive frames of a channel moves by a few samples only. The
+/// tracking functions keep the last offset of each channel ( track ) and only search a window of
+/// +-window samples around it, the full search is run again when the normalized correlation of
+/// the best candidate falls below a threshold or when the best candidate lies on the window edge.
+///
+/// An engine is not thread safe, every thread aligning frames uses its own engine.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dsp_fft.h"
+#include "dsp_resample.h"
+#include "dsp_pilot.h"
+
+static const float g_barker11[11] = { 1, 1, 1, 0, 0, 0, 1, 0, 0, 1, 0 };				/*!< cPilotBarker 'BARKER11' */
+static const float g_barker13[13] = { 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 0, 1 };		/*!< cPilotBarker 'BARKER13' */
+
+
+/**
+ * Bring the Barker chips from the chip clock to the sample clock, see updnClock().
+ *
+ * @param	y	receives a malloc() buffer with the resampled signal.
+ * @param	ylen	receives the number of samples in y.
+ */
+static int dsp_pilot_updnclock(const float *x, unsigned int n, double xfs, double cfs, int filter, float **y, unsigned int *ylen)
+{
+	DSP_RESAMPLE rs;
+	int rc;
+
+	rc = dsp_resample_init(&rs, xfs, cfs, filter);
+	if(rc!=DSP_RESAMPLE_ERR_OK)
+		return rc==DSP_RESAMPLE_ERR_ALLOC ? DSP_PILOT_ERR_ALLOC : DSP_PILOT_ERR_CLOCK;
+
+	*ylen = dsp_resample_maxout(&rs, n);
+	*y = (float *)malloc(*ylen*sizeof(float));
+	if(!*y || dsp_resample_frame(&rs, x, n, *y, *ylen, ylen)!=DSP_RESAMPLE_ERR_OK) {
+		free(*y);
+		*y = NULL;
+		dsp_resample_free(&rs);
+		return DSP_PILOT_ERR_ALLOC;
+	}
+
+	dsp_resample_free(&rs);
+	return DSP_PILOT_ERR_OK;
+}
+
+static void dsp_pilot_release(DSP_PILOT_CACHE *entry)
+{
+	free(entry->pilot);
+	free(entry->frame);
+	free(entry->window);
+	free(entry->spectrum);
+	free(entry->work);
+	memset(entry, 0, sizeof(DSP_PILOT_CACHE));
+}
+
+/**
+ * Build the pilot and the pilot spectrum of a sample clock and frame length.
+ */
+static int dsp_pilot_build(DSP_PILOT *pilot, DSP_PILOT_CACHE *entry, double clksmp, unsigned int len)
+{
+	const float *chips = pilot->type==DSP_PILOT_BARKER11 ? g_barker11 : g_barker13;
+	unsigned int nfft, i;
+	float minval;
+	int rc;
+
+	rc = dsp_pilot_updnclock(chips, pilot->type, pilot->clkin, clksmp, pilot->filter, &entry->pilot, &entry->pltlen);
+	if(rc!=DSP_PILOT_ERR_OK)
+		return rc;
+	if(len<entry->pltlen) {
+		dsp_pilot_release(entry);
+		return DSP_PILOT_ERR_LENGTH;
+	}
+	minval = entry->pilot[0];
+	for(i = 1; i < entry->pltlen; i++)
+		if(entry->pilot[i]<minval)
+			minval = entry->pilot[i];
+	for(i = 0; i < entry->pltlen; i++)
+		entry->pilot[i] -= minval;
+	entry->pltmean = 0.0f;
+	for(i = 0; i < entry->pltlen; i++)
+		entry->pltmean += entry->pilot[i];
+	entry->pltmean /= entry->pltlen;
+	entry->pltnorm = 0.0f;
+	for(i = 0; i < entry->pltlen; i++)
+		entry->pltnorm += (entry->pilot[i]-entry->pltmean)*(entry->pilot[i]-entry->pltmean);
+	entry->pltnorm = (float)sqrt(entry->pltnorm);
+
+	// linear correlation against the frame extended by pltlen-1 samples, nfft avoids any wrap around
+	nfft = dsp_fft_nextpow2(len+entry->pltlen-1);
+	if(nfft==0 || nfft>DSP_FFT_MAX_SIZE/2) {
+		dsp_pilot_release(entry);
+		return DSP_PILOT_ERR_LENGTH;
+	}
+	// real transforms of nfft values, with the shared plan of nfft/2 values
+	if(nfft<2)
+		nfft = 2;
+	entry->frame = (float *)malloc(len*sizeof(float));
+	entry->window = (float *)malloc((len+entry->pltlen)*sizeof(float));
+	entry->spectrum = (DSP_COMPLEX *)calloc(nfft/2+1, sizeof(DSP_COMPLEX));
+	entry->work = (DSP_COMPLEX *)malloc((nfft/2+1)*sizeof(DSP_COMPLEX));
+	entry->plan = dsp_fft_getplan(nfft/2);
+	if(!entry->frame || !entry->window || !entry->spectrum || !entry->work || !entry->plan) {
+		dsp_pilot_release(entry);
+		return DSP_PILOT_ERR_ALLOC;
+	}
+
+	for(i = 0; i < entry->pltlen; i++)
+		((float *)entry->spectrum)[i] = entry->pilot[i];
+	dsp_fft_execute_real(entry->plan, entry->spectrum, DSP_FFT_FORWARD);
+	for(i = 0; i <= nfft/2; i++)
+		entry->spectrum[i].im = -entry->spectrum[i].im;
+
+	entry->clksmp = clksmp;
+	entry->len = len;
+	return DSP_PILOT_ERR_OK;
+}
+
+/**
+ * Obtain the cache entry of a sample clock and frame length, the least recently used entry is rebuilt when none matches.
+ */
+static int dsp_pilot_lookup(DSP_PILOT *pilot, double clksmp, unsigned int len, DSP_PILOT_CACHE **entry)
+{
+	DSP_PILOT_CACHE *victim = &pilot->cache[0];
+	int i, rc;
+
+	if(clksmp<=0.0)
+		return DSP_PILOT_ERR_CLOCK;
+
+	for(i = 0; i < DSP_PILOT_NB_CACHE; i++) {
+		if(pilot->cache[i].clksmp==clksmp && pilot->cache[i].len==len) {
+			*entry = &pilot->cache[i];
+			(*entry)->used = ++pilot->uses;
+			return DSP_PILOT_ERR_OK;
+		}
+		if(pilot->cache[i].used<victim->used)
+			victim = &pilot->cache[i];
+	}
+
+	dsp_pilot_release(victim);
+	rc = dsp_pilot_build(pilot, victim, clksmp, len);
+	if(rc!=DSP_PILOT_ERR_OK)
+		return rc;
+	victim->used = ++pilot->uses;
+	*entry = victim;
+	return DSP_PILOT_ERR_OK;
+}
+
+/**
+ * Align entry->frame, already filled and minimum subtracted.
+ */
+static unsigned int dsp_pilot_search(DSP_PILOT_CACHE *entry)
+{
+	const float *sig = entry->frame;
+	const float *plt = entry->pilot;
+	unsigned int len = entry->len, pltlen = entry->pltlen, nfft = 2*entry->plan->n;
+	float *work = (float *)entry->work;
+	unsigned int i, k, d, best;
+	float peak;
+	double score, bestscore;
+
+	// circular extension, [sig(:); sig(1:pltlen)] in alignPilot()
+	memcpy(work, sig, len*sizeof(float));
+	memcpy(work+len, sig, (pltlen-1)*sizeof(float));
+	memset(work+len+pltlen-1, 0, (nfft-len-pltlen+1)*sizeof(float));
+
+	// the correlation is real, only the bins 0..nfft/2 are computed
+	dsp_fft_execute_real(entry->plan, entry->work, DSP_FFT_FORWARD);
+	for(i = 0; i <= nfft/2; i++) {
+		float re = entry->work[i].re*entry->spectrum[i].re - entry->work[i].im*entry->spectrum[i].im;
+		float im = entry->work[i].re*entry->spectrum[i].im + entry->work[i].im*entry->spectrum[i].re;
+		entry->work[i].re = re;
+		entry->work[i].im = im;
+	}
+	dsp_fft_execute_real(entry->plan, entry->work, DSP_FFT_INVERSE);
+
+	// xcorr() lists the lags from the last one, max() keeps the last of equal peaks
+	best = 0;
+	peak = work[0];
+	for(d = 1; d < len; d++) {
+		if(work[d]>=peak) {
+			peak = work[d];
+			best = d;
+		}
+	}
+
+	// alignFine(), exact sums around the coarse peak, the first of equal scores wins
+	bestscore = 0.0;
+	d = best;
+	for(i = 0; i < 2*DSP_PILOT_FINE+1; i++) {
+		unsigned int start = (unsigned int)(((long long)best-DSP_PILOT_FINE+i+(long long)len*(DSP_PILOT_FINE+1))%len);
+		unsigned int idx = start;
+		score = 0.0;
+		for(k = 0; k < pltlen; k++) {
+			score += (double)plt[k]*sig[idx];
+			if(++idx==len)
+				idx = 0;
+		}
+		if(i==0 || score>bestscore) {
+			bestscore = score;
+			d = start;
+		}
+	}
+
+	return d;
+}
+
+/**
+ * Normalized cross correlation of the pilot with the pltlen samples of a circular signal starting at start.
+ *
+ * @return the correlation coefficient, -1.0 to 1.0, 0.0 for a flat signal.
+ */
+static float dsp_pilot_confidence(const DSP_PILOT_CACHE *entry, const float *sig, unsigned int len, unsigned int start)
+{
+	double sp = 0.0, ss = 0.0, s2 = 0.0, var;
+	unsigned int k, idx = start;
+
+	for(k = 0; k < entry->pltlen; k++) {
+		sp += (double)entry->pilot[k]*sig[idx];
+		ss += sig[idx];
+		s2 += (double)sig[idx]*sig[idx];
+		if(++idx==len)
+			idx = 0;
+	}
+	var = s2-ss*ss/entry->pltlen;
+	if(var<=0.0 || entry->pltnorm<=0.0f)
+		return 0.0f;
+	return (float)((sp-entry->pltmean*ss)/(entry->pltnorm*sqrt(var)));
+}
+
+/**
+ * Fill entry->frame from float or 16 bit samples, minimum subtracted.
+ */
+static void dsp_pilot_fill(DSP_PILOT_CACHE *entry, const float *sigf, const short *sig16, int invert)
+{
+	unsigned int i, len = entry->len;
+	float minval;
+
+	for(i = 0; i < len; i++)
+		entry->frame[i] = sigf ? sigf[i] : (invert ? -(float)sig16[i] : (float)sig16[i]);
+	minval = entry->frame[0];
+	for(i = 1; i < len; i++)
+		if(entry->frame[i]<minval)
+			minval = entry->frame[i];
+	for(i = 0; i < len; i++)
+		entry->frame[i] -= minval;
+}
+
+/**
+ * Search the window of +-pilot->window samples around the last offset of a track. The minimum of the frame is not needed,
+ * removing a constant changes neither the position of the peak nor the correlation coefficient.
+ *
+ * @return 1 when the peak lies inside the window with a confidence of at least pilot->threshold, 0 for a full search.
+ */
+static int dsp_pilot_window(DSP_PILOT *pilot, DSP_PILOT_CACHE *entry, DSP_PILOT_TRACK *track, const float *sigf, const short *sig16,
+	int invert, unsigned int *offset, float *confidence)
+{
+	unsigned int len = entry->len, pltlen = entry->pltlen, w = pilot->window;
+	unsigned int start, nwin, i, k, idx, best;
+	double score, bestscore;
+
+	if(!track->valid || track->clksmp!=entry->clksmp || track->len!=len || w==0 || 2*w+1>=len)
+		return 0;
+
+	start = (unsigned int)((track->offset+(unsigned long long)len-w)%len);
+	nwin = 2*w+pltlen;
+	for(i = 0, idx = start; i < nwin; i++) {
+		entry->window[i] = sigf ? sigf[idx] : (invert ? -(float)sig16[idx] : (float)sig16[idx]);
+		if(++idx==len)
+			idx = 0;
+	}
+
+	best = 0;
+	bestscore = 0.0;
+	for(i = 0; i <= 2*w; i++) {
+		score = 0.0;
+		for(k = 0; k < pltlen; k++)
+			score += (double)entry->pilot[k]*entry->window[i+k];
+		if(i==0 || score>bestscore) {
+			bestscore = score;
+			best = i;
+		}
+	}
+
+	// a peak on the edge of the window may belong to a larger one outside of it
+	if(best==0 || best==2*w)
+		return 0;
+	*confidence = dsp_pilot_confidence(entry, entry->window, nwin, best);
+	if(*confidence<pilot->threshold)
+		return 0;
+	*offset = (start+best)%len;
+	return 1;
+}
+
+/**
+ * dsp_pilot_track() and dsp_pilot_track16(), sigf or sig16 holds the frame.
+ */
+static int dsp_pilot_follow(DSP_PILOT *pilot, unsigned int ntrack, double clksmp, const float *sigf, const short *sig16, int invert,
+	unsigned int len, unsigned int *offset)
+{
+	DSP_PILOT_CACHE *entry;
+	DSP_PILOT_TRACK *track;
+	float confidence;
+	int rc;
+
+	if(!pilot || (!sigf && !sig16) || !offset || ntrack>=DSP_PILOT_NB_TRACKS)
+		return DSP_PILOT_ERR_ARGUMENT;
+	rc = dsp_pilot_lookup(pilot, clksmp, len, &entry);
+	if(rc!=DSP_PILOT_ERR_OK)
+		return rc;
+	track = &pilot->track[ntrack];
+
+	if(dsp_pilot_window(pilot, entry, track, sigf, sig16, invert, offset, &confidence)) {
+		track->tracked++;
+	} else {
+		dsp_pilot_fill(entry, sigf, sig16, invert);
+		*offset = dsp_pilot_search(entry);
+		confidence = dsp_pilot_confidence(entry, entry->frame, len, *offset);
+		track->searched++;
+	}
+
+	track->valid = 1;
+	track->clksmp = clksmp;
+	track->len = len;
+	track->offset = *offset;
+	track->confidence = confidence;
+	return DSP_PILOT_ERR_OK;
+}
+
+int dsp_pilot_init(DSP_PILOT *pilot, int type, int filter, double clkin)
+{
+	if(!pilot)
+		return DSP_PILOT_ERR_ARGUMENT;
+	if(type!=DSP_PILOT_BARKER11 && type!=DSP_PILOT_BARKER13)
+		return DSP_PILOT_ERR_TYPE;
+	if(filter!=DSP_PILOT_RAISEDCOSINE && filter!=DSP_PILOT_IDEALRECT)
+		return DSP_PILOT_ERR_TYPE;
+	if(clkin<=0.0)
+		return DSP_PILOT_ERR_CLOCK;
+
+	memset(pilot, 0, sizeof(DSP_PILOT));
+	pilot->type = type;
+	pilot->filter = filter;
+	pilot->clkin = clkin;
+	pilot->window = DSP_PILOT_TRACK_WINDOW;
+	pilot->threshold = DSP_PILOT_TRACK_THRESHOLD;
+	return DSP_PILOT_ERR_OK;
+}
+
+int dsp_pilot_align(DSP_PILOT *pilot, double clksmp, const float *sig, unsigned int len, unsigned int *offset)
+{
+	DSP_PILOT_CACHE *entry;
+	int rc;
+
+	if(!pilot || !sig || !offset)
+		return DSP_PILOT_ERR_ARGUMENT;
+	rc = dsp_pilot_lookup(pilot, clksmp, len, &entry);
+	if(rc!=DSP_PILOT_ERR_OK)
+		return rc;
+
+	dsp_pilot_fill(entry, sig, NULL, 0);
+	*offset = dsp_pilot_search(entry);
+	return DSP_PILOT_ERR_OK;
+}
+
+int dsp_pilot_align16(DSP_PILOT *pilot, double clksmp, const short *sig, unsigned int len, int invert, unsigned int *offset)
+{
+	DSP_PILOT_CACHE *entry;
+	int rc;
+
+	if(!pilot || !sig || !offset)
+		return DSP_PILOT_ERR_ARGUMENT;
+	rc = dsp_pilot_lookup(pilot, clksmp, len, &entry);
+	if(rc!=DSP_PILOT_ERR_OK)
+		return rc;
+
+	dsp_pilot_fill(entry, NULL, sig, invert);
+	*offset = dsp_pilot_search(entry);
+	return DSP_PILOT_ERR_OK;
+}
+
+int dsp_pilot_settracking(DSP_PILOT *pilot, unsigned int window, float threshold)
+{
+	if(!pilot)
+		return DSP_PILOT_ERR_ARGUMENT;
+	pilot->window = window;
+	pilot->threshold = threshold;
+	return DSP_PILOT_ERR_OK;
+}
+
+int dsp_pilot_track(DSP_PILOT *pilot, unsigned int track, double clksmp, const float *sig, unsigned int len, unsigned int *offset)
+{
+	if(!sig)
+		return DSP_PILOT_ERR_ARGUMENT;
+	return dsp_pilot_follow(pilot, track, clksmp, sig, NULL, 0, len, offset);
+}
+
+int dsp_pilot_track16(DSP_PILOT *pilot, unsigned int track, double clksmp, const short *sig, unsigned int len, int invert, unsigned int *offset)
+{
+	if(!sig)
+		return DSP_PILOT_ERR_ARGUMENT;
+	return dsp_pilot_follow(pilot, track, clksmp, NULL, sig, invert, len, offset);
+}
+
+int dsp_pilot_length(DSP_PILOT *pilot, double clksmp, unsigned int len, unsigned int *pltlen)
+{
+	DSP_PILOT_CACHE *entry;
+	int rc;
+
+	if(!pilot || !pltlen)
+		return DSP_PILOT_ERR_ARGUMENT;
+	rc = dsp_pilot_lookup(pilot, clksmp, len, &entry);
+	if(rc!=DSP_PILOT_ERR_OK)
+		return rc;
+
+	*pltlen = entry->pltlen;
+	return DSP_PILOT_ERR_OK;
+}
+
+int dsp_pilot_reference(DSP_PILOT *pilot, double clksmp, unsigned int len, const float **ref, unsigned int *pltlen)
+{
+	DSP_PILOT_CACHE *entry;
+	int rc;
+
+	if(!pilot || !ref || !pltlen)
+		return DSP_PILOT_ERR_ARGUMENT;
+	rc = dsp_pilot_lookup(pilot, clksmp, len, &entry);
+	if(rc!=DSP_PILOT_ERR_OK)
+		return rc;
+
+	*ref = entry->pilot;
+	*pltlen = entry->pltlen;
+	return DSP_PILOT_ERR_OK;
+}
+
+void dsp_pilot_resettrack(DSP_PILOT *pilot, unsigned int track)
+{
+	if(!pilot || track>=DSP_PILOT_NB_TRACKS)
+		return;
+	memset(&pilot->track[track], 0, sizeof(DSP_PILOT_TRACK));
+}
+
+/**
+ * Reverse sig[first..last-1] in place.
+ */
+static void dsp_pilot_reverse16(short *sig, unsigned int first, unsigned int last)
+{
+	short t;
+
+	while(first+1<last) {
+		last--;
+		t = sig[first];
+		sig[first] = sig[last];
+		sig[last] = t;
+		first++;
+	}
+}
+
+void dsp_pilot_rotate16(short *sig, unsigned int len, unsigned int offset)
+{
+	if(!sig || len==0 || offset%len==0)
+		return;
+	offset %= len;
+
+	// three reversals rotate without a second buffer
+	dsp_pilot_reverse16(sig, 0, offset);
+	dsp_pilot_reverse16(sig, offset, len);
+	dsp_pilot_reverse16(sig, 0, len);
+}
+
+void dsp_pilot_free(DSP_PILOT *pilot)
+{
+	int i;
+
+	if(!pilot)
+		return;
+	for(i = 0; i < DSP_PILOT_NB_CACHE; i++)
+		dsp_pilot_release(&pilot->cache[i]);
+	memset(pilot->track, 0, sizeof(pilot->track));
+	pilot->uses = 0;
+}
@@ -0,0 +1,264 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_psd.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_psd module estimates the power spectral density of a channel with Welch's method (implementation)
+///
+/// Server side version of plotFreq.m, which transforms a whole frame padded to a power of 2. The
+/// frame is cut into segments of NFFT samples overlapping by NFFT-STEP samples, each one is
+/// windowed and transformed, and the squared magnitudes are averaged over the segments of the
+/// frame, then over the frames: a running mean of the first AVERAGES frames, an exponential
+/// mean with the weight 1/AVERAGES afterwards. A frame shorter than NFFT is padded with zeros.
+///
+/// Two real segments are transformed as one complex segment, x1+j*x2, with the shared plan of
+/// dsp_fft_getplan(), DSP_PSD_BATCH pairs per dsp_fft_batch(). The spectrum of the pair is not
+/// split: |X1(k)|^2+|X2(k)|^2 = (|Z(k)|^2+|Z(n-k)|^2)/2, the squares of the real and imaginary
+/// parts of Z are summed over the frame with the vector instructions selected by dsp_simd.h and
+/// folded once per frame. The densities are in V^2/Hz, the window normalized by its power.
+///
+/// dsp_psd_get() gives the one-sided spectrum, bins 0..NFFT/2, or the two-sided one, bins
+/// -NFFT/2+1..NFFT/2 as the 'whole' spectrum of plotFreq.m, reduced to fewer points by the mean
+/// or the largest of consecutive bins. An engine is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dsp_simd.h"
+#include "dsp_psd.h"
+
+#define DSP_PSD_PI					3.14159265358979323846
+
+
+/**
+ * Window a pair of segments into the complex values of one transform, x1 in the real parts and x2 in the imaginary
+ * parts. A segment of fewer than nfft samples is padded with zeros, b may be NULL for a lone segment.
+ */
+static void dsp_psd_load(const DSP_PSD *psd, const short *a, unsigned int na, const short *b, unsigned int nb, DSP_COMPLEX *z)
+{
+	unsigned int i = 0, n = psd->nfft;
+	const float *w = psd->win;
+
+	if(na==n && nb==n) {
+#if defined(DSP_SIMD_AVX2)
+		__m256 xa, xb, lo, hi;
+
+		for(; i+8 <= n; i += 8) {
+			xa = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(a+i)))), _mm256_load_ps(w+i));
+			xb = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(b+i)))), _mm256_load_ps(w+i));
+			// the interleaving works per 128 bit lane, the halves are put back in order
+			lo = _mm256_unpacklo_ps(xa, xb);
+			hi = _mm256_unpackhi_ps(xa, xb);
+			_mm256_store_ps((float *)(z+i), _mm256_permute2f128_ps(lo, hi, 0x20));
+			_mm256_store_ps((float *)(z+i+4), _mm256_permute2f128_ps(lo, hi, 0x31));
+		}
+#elif defined(DSP_SIMD_SSE2)
+		__m128i x;
+		__m128 xa, xb;
+
+		for(; i+4 <= n; i += 4) {
+			// sign extension of the shorts, each one lands in the upper half of a 32 bit word
+			x = _mm_loadl_epi64((const __m128i *)(a+i));
+			xa = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), _mm_load_ps(w+i));
+			x = _mm_loadl_epi64((const __m128i *)(b+i));
+			xb = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), _mm_load_ps(w+i));
+			_mm_store_ps((float *)(z+i), _mm_unpacklo_ps(xa, xb));
+			_mm_store_ps((float *)(z+i+2), _mm_unpackhi_ps(xa, xb));
+		}
+#endif
+	}
+	for(; i < n; i++) {
+		z[i].re = i<na ? a[i]*w[i] : 0.0f;
+		z[i].im = i<nb ? b[i]*w[i] : 0.0f;
+	}
+}
+
+/**
+ * Add the squares of the real and imaginary parts of count transforms to psd->sq.
+ */
+static void dsp_psd_square(DSP_PSD *psd, unsigned int count)
+{
+	unsigned int n = 2*psd->nfft;
+	float *sq = psd->sq;
+
+	for(unsigned int c = 0; c < count; c++) {
+		const float *z = (const float *)(psd->work+(size_t)c*psd->nfft);
+		unsigned int i = 0;
+#if defined(DSP_SIMD_AVX)
+		__m256 x;
+		for(; i+8 <= n; i += 8) {
+			x = _mm256_load_ps(z+i);
+			_mm256_store_ps(sq+i, _mm256_add_ps(_mm256_load_ps(sq+i), _mm256_mul_ps(x, x)));
+		}
+#elif defined(DSP_SIMD_SSE)
+		__m128 x;
+		for(; i+4 <= n; i += 4) {
+			x = _mm_load_ps(z+i);
+			_mm_store_ps(sq+i, _mm_add_ps(_mm_load_ps(sq+i), _mm_mul_ps(x, x)));
+		}
+#endif
+		for(; i < n; i++)
+			sq[i] += z[i]*z[i];
+	}
+}
+
+int dsp_psd_init(DSP_PSD *psd, unsigned int nfft, unsigned int overlap, int window, unsigned int averages, float fs, float lsb)
+{
+	double w, sum = 0.0;
+
+	if(!psd)
+		return DSP_PSD_ERR_ARGUMENT;
+	memset(psd, 0, sizeof(DSP_PSD));
+	if(nfft<DSP_PSD_MIN_NFFT || nfft>DSP_PSD_MAX_NFFT || (nfft&(nfft-1))!=0 || overlap>=nfft)
+		return DSP_PSD_ERR_SIZE;
+	if(window!=DSP_PSD_WIN_RECT && window!=DSP_PSD_WIN_HANN && window!=DSP_PSD_WIN_BLACKMAN)
+		return DSP_PSD_ERR_WINDOW;
+	if(!(fs>0.0f) || !(lsb>0.0f))
+		return DSP_PSD_ERR_ARGUMENT;
+
+	psd->nfft = nfft;
+	psd->step = nfft-overlap;
+	psd->window = window;
+	psd->averages = averages;
+	psd->fs = fs;
+	psd->plan = dsp_fft_getplan(nfft);
+	psd->win = (float *)dsp_malloc(nfft*sizeof(float));
+	psd->work = (DSP_COMPLEX *)dsp_malloc((size_t)DSP_PSD_BATCH*nfft*sizeof(DSP_COMPLEX));
+	psd->sq = (float *)dsp_malloc(2*nfft*sizeof(float));
+	psd->avg = (double *)dsp_malloc((nfft/2+1)*sizeof(double));
+	if(!psd->plan || !psd->win || !psd->work || !psd->sq || !psd->avg) {
+		dsp_psd_free(psd);
+		return DSP_PSD_ERR_ALLOC;
+	}
+
+	// symmetric windows, as hann(nfft) and blackman(nfft)
+	for(unsigned int i = 0; i < nfft; i++) {
+		switch(window) {
+		case DSP_PSD_WIN_HANN:
+			w = 0.5-0.5*cos(2.0*DSP_PSD_PI*i/(nfft-1));
+			break;
+		case DSP_PSD_WIN_BLACKMAN:
+			w = 0.42-0.5*cos(2.0*DSP_PSD_PI*i/(nfft-1))+0.08*cos(4.0*DSP_PSD_PI*i/(nfft-1));
+			break;
+		default:
+			w = 1.0;
+			break;
+		}
+		sum += w*w;
+		// the samples come out in volts of the window
+		psd->win[i] = (float)(w*lsb);
+	}
+	psd->norm = 1.0/(fs*sum);
+	dsp_psd_reset(psd);
+	return DSP_PSD_ERR_OK;
+}
+
+int dsp_psd_frame16(DSP_PSD *psd, const short *sig, unsigned int len)
+{
+	unsigned int n, nseg, first, npairs = 0;
+	double p, a;
+
+	if(!psd || !psd->plan || !sig || len==0)
+		return DSP_PSD_ERR_ARGUMENT;
+	n = psd->nfft;
+
+	nseg = len<n ? 1 : (len-n)/psd->step+1;
+	memset(psd->sq, 0, 2*n*sizeof(float));
+	for(unsigned int s = 0; s < nseg; s += 2) {
+		first = s*psd->step;
+		// every segment but a lone one is complete
+		if(s+1<nseg)
+			dsp_psd_load(psd, sig+first, n, sig+first+psd->step, n, psd->work+(size_t)npairs*n);
+		else
+			dsp_psd_load(psd, sig+first, len-first<n ? len-first : n, NULL, 0, psd->work+(size_t)npairs*n);
+		if(++npairs==DSP_PSD_BATCH || s+2>=nseg) {
+			dsp_fft_batch(psd->plan, psd->work, npairs, n, DSP_FFT_FORWARD);
+			dsp_psd_square(psd, npairs);
+			npairs = 0;
+		}
+	}
+
+	// running mean, exponential once the frames of the mean are reached
+	psd->frames++;
+	a = psd->averages && psd->frames>psd->averages ? 1.0/psd->averages : 1.0/psd->frames;
+	for(unsigned int k = 0; k <= n/2; k++) {
+		unsigned int m = (n-k)&(n-1);
+		p = 0.5*((double)psd->sq[2*k]+psd->sq[2*k+1]+psd->sq[2*m]+psd->sq[2*m+1])*psd->norm/nseg;
+		psd->avg[k] += a*(p-psd->avg[k]);
+	}
+	psd->segments = nseg;
+	return DSP_PSD_ERR_OK;
+}
+
+unsigned int dsp_psd_points(const DSP_PSD *psd, unsigned int points, int mode)
+{
+	unsigned int bins, dec;
+
+	if(!psd || !psd->avg)
+		return 0;
+	bins = (mode&DSP_PSD_WHOLE) ? psd->nfft : psd->nfft/2+1;
+	dec = points==0 || points>=bins ? 1 : (bins+points-1)/points;
+	return (bins+dec-1)/dec;
+}
+
+int dsp_psd_get(const DSP_PSD *psd, unsigned int points, int mode, float *out, float *first, float *step)
+{
+	unsigned int n, bins, dec, count, lo, hi;
+	int k, origin;
+	double d, v, df;
+
+	if(!psd || !psd->avg || !out || !first || !step)
+		return DSP_PSD_ERR_ARGUMENT;
+	n = psd->nfft;
+	bins = (mode&DSP_PSD_WHOLE) ? n : n/2+1;
+	count = dsp_psd_points(psd, points, mode);
+	dec = (bins+count-1)/count;
+	// first bin of the two-sided spectrum, the 'whole' spectrum of plotFreq.m
+	origin = (mode&DSP_PSD_WHOLE) ? -(int)(n/2-1) : 0;
+	df = (double)psd->fs/n;
+
+	for(unsigned int p = 0; p < count; p++) {
+		lo = p*dec;
+		hi = lo+dec<bins ? lo+dec : bins;
+		v = 0.0;
+		for(unsigned int j = lo; j < hi; j++) {
+			k = origin+(int)j;
+			if(mode&DSP_PSD_WHOLE)
+				d = psd->avg[k<0 ? -k : k];
+			else
+				d = k==0 || k==(int)(n/2) ? psd->avg[k] : 2.0*psd->avg[k];
+			if(mode&DSP_PSD_PEAK)
+				v = d>v ? d : v;
+			else
+				v += d;
+		}
+		if(!(mode&DSP_PSD_PEAK))
+			v /= hi-lo;
+		if(mode&DSP_PSD_DB)
+			out[p] = v>0.0 ? (float)(10.0*log10(v)) : DSP_PSD_DB_FLOOR;
+		else
+			out[p] = (float)v;
+	}
+	*first = (float)((origin+0.5*(dec-1))*df);
+	*step = (float)(dec*df);
+	return DSP_PSD_ERR_OK;
+}
+
+void dsp_psd_reset(DSP_PSD *psd)
+{
+	if(!psd || !psd->avg)
+		return;
+	memset(psd->avg, 0, (psd->nfft/2+1)*sizeof(double));
+	psd->frames = 0;
+	psd->segments = 0;
+}
+
+void dsp_psd_free(DSP_PSD *psd)
+{
+	if(!psd)
+		return;
+	// the plan is shared, released by dsp_fft_releaseplans()
+	dsp_free(psd->win);
+	dsp_free(psd->work);
+	dsp_free(psd->sq);
+	dsp_free(psd->avg);
+	memset(psd, 0, sizeof(DSP_PSD));
+}
@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ber.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ber module measures the bit error rate and the link quality of a channel (header)
+///
+/// Native version of the BERs and CHNLRDCNT bookkeeping of demodRxTimer.m. The demodulated bits
+/// of every frame are compared with a known reference payload, 32 bytes at a time with AVX2 or
+/// 16 bytes at a time with SSE2: the bytes are XORed and the bits set in the result counted
+/// per byte ( nibble table or shifts and masks ), then summed with a sum of absolute differences.
+/// A frame without bits, its pilot could not be aligned, or with more than DSP_BER_SYNC_RATE of
+/// its bits in error, the payload is not where it is expected, counts as a loss of the frame
+/// synchronization and not as bit errors.
+///
+/// The link quality is taken from the normalized correlation r of the pilot with the expected
+/// one: the signal to noise ratio of the pilot is estimated as r^2/(1-r^2), which holds for
+/// white noise on an otherwise undistorted pilot and underestimates it otherwise. The counters
+/// run until dsp_ber_reset(). A statistics engine is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_BER_H_
+#define _DSP_BER_H_
+
+/* defines */
+#define DSP_BER_NBYTES(nbits)		(((nbits)+7)/8)	/*!< Bytes of nbits packed bits */
+#define DSP_BER_SYNC_RATE			0.25f			/*!< Error rate of a frame above which it counts as a synchronization loss */
+#define DSP_BER_SNR_MAX				60.0f			/*!< SNR reported for a perfect correlation, dB */
+
+/**
+ * Statistics of one channel, see dsp_ber_init().
+ */
+typedef struct {
+	unsigned char *ref;								/*!< reference payload, bit k in bit k%8 of ref[k/8] */
+	unsigned int refbits;							/*!< bits in ref */
+	unsigned long frames;							/*!< frames given to dsp_ber_frame() */
+	unsigned long synclosses;						/*!< frames without bits or with more than DSP_BER_SYNC_RATE errors */
+	unsigned long errframes;						/*!< frames compared with at least one error */
+	unsigned long long bits;						/*!< bits compared */
+	unsigned long long errors;						/*!< bits compared that differ from the reference */
+	unsigned int lasterrors;						/*!< errors of the last frame */
+	unsigned long pilots;							/*!< correlations given to dsp_ber_pilot() */
+	float peak;										/*!< last correlation */
+	float peakmin;									/*!< lowest correlation */
+	double peaksum;									/*!< sum of the correlations */
+	float snr;										/*!< last SNR estimate, dB */
+	double snrsum;									/*!< sum of the linear SNR estimates */
+} DSP_BER;
+
+/* error codes */
+#define DSP_BER_ERR_OK				0				/*!< No error encountered during execution. */
+#define DSP_BER_ERR_LENGTH			-1				/*!< The reference payload is empty. */
+#define DSP_BER_ERR_ALLOC			-2				/*!< The reference payload could not be allocated. */
+#define DSP_BER_ERR_ARGUMENT		-3				/*!< An argument is NULL, or the engine has no reference payload. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize the statistics of a channel with the payload expected in every frame, the counters are cleared.
+ *
+ * @param	ber	statistics to be initialized, released with dsp_ber_free().
+ * @param	ref	reference payload, bit k in bit k%8 of ref[k/8], copied.
+ * @param	refbits	bits of the reference payload.
+ * @return  - DSP_BER_ERR_OK
+ *			- DSP_BER_ERR_LENGTH
+ *			- DSP_BER_ERR_ALLOC
+ *			- DSP_BER_ERR_ARGUMENT
+ */
+int dsp_ber_init(DSP_BER *ber, const unsigned char *ref, unsigned int refbits);
+
+/**
+ * Compare the demodulated bits of a frame with the reference payload. The first min(nbits,refbits) bits are compared,
+ * the others are ignored.
+ *
+ * @param	ber	statistics initialized by dsp_ber_init().
+ * @param	bits	demodulated bits, packed as the reference, may be NULL when nbits is 0.
+ * @param	nbits	bits demodulated, 0 when the frame could not be demodulated.
+ * @return  - DSP_BER_ERR_OK
+ *			- DSP_BER_ERR_ARGUMENT
+ */
+int dsp_ber_frame(DSP_BER *ber, const unsigned char *bits, unsigned int nbits);
+
+/**
+ * Record the correlation of the pilot of a frame and the SNR estimated from it.
+ *
+ * @param	ber	statistics initialized by dsp_ber_init().
+ * @param	correlation	normalized correlation of the pilot, DSP_PILOT_TRACK.confidence.
+ * @return  - DSP_BER_ERR_OK
+ *			- DSP_BER_ERR_ARGUMENT
+ */
+int dsp_ber_pilot(DSP_BER *ber, float correlation);
+
+/**
+ * Obtain the bit error rate, 0 before any bit has been compared.
+ */
+double dsp_ber_rate(const DSP_BER *ber);
+
+/**
+ * Obtain the SNR of the mean linear estimate in dB, 0 before any pilot has been recorded.
+ */
+float dsp_ber_meansnr(const DSP_BER *ber);
+
+/**
+ * Clear the counters, the reference payload is kept.
+ *
+ * @param	ber	statistics initialized by dsp_ber_init().
+ */
+void dsp_ber_reset(DSP_BER *ber);
+
+/**
+ * Release the reference payload.
+ *
+ * @param	ber	statistics initialized by dsp_ber_init(), or cleared with memset().
+ */
+void dsp_ber_free(DSP_BER *ber);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_BER_H_
@@ -0,0 +1,75 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_cond.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_cond module conditions the 16 bit ADC samples of a channel (header)
+///
+/// Native version of the frame*-1 polarity correction and the double() conversion of
+/// demodRxTimer.m, with a gain and a DC offset calibration per channel. Each sample becomes
+/// gain*(+-x-offset), rounded to the nearest integer and saturated to 16 bits, in place, and
+/// optionally converted to volts into a float frame during the same pass. The samples are
+/// converted to floats 16 at a time with AVX2 or 8 at a time with SSE2, so that the plain C
+/// loop, the SSE2 and the AVX2 kernels give the same results. A conditioner is read only once
+/// initialized, the channels may share it.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_COND_H_
+#define _DSP_COND_H_
+
+/* defines */
+#define DSP_COND_LSB(vpp, bits)		((float)(vpp)/(float)(1<<(bits)))	/*!< Volts per count of a bits ADC with a vpp V peak to peak range */
+#define DSP_COND_ADC_LSB			DSP_COND_LSB(2.0, 14)			/*!< Volts per count of the FMC116 ADCs, 14 bits, 2 Vpp */
+
+/**
+ * Calibration of one channel, see dsp_cond_init().
+ */
+typedef struct {
+	int invert;										/*!< 1 to negate the samples first */
+	float gain;										/*!< gain applied after the offset */
+	float offset;									/*!< DC level after the polarity correction, ADC counts */
+	float lsb;										/*!< volts per count of the float frames */
+	float scale;									/*!< gain, negated to invert */
+	float bias;										/*!< -gain*offset */
+} DSP_COND;
+
+/* error codes */
+#define DSP_COND_ERR_OK				0				/*!< No error encountered during execution. */
+#define DSP_COND_ERR_GAIN			-1				/*!< The gain or the volts per count are not finite or not positive. */
+#define DSP_COND_ERR_ARGUMENT		-2				/*!< An argument is NULL. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize the calibration of a channel.
+ *
+ * @param	cond	conditioner to be initialized, nothing to release.
+ * @param	invert	1 for a channel wired with an inverted polarity.
+ * @param	gain	gain, 1.0 for none.
+ * @param	offset	DC level of the channel after the polarity correction in ADC counts, 0.0 for none.
+ * @param	lsb	volts per count of the float frames, DSP_COND_ADC_LSB for the FMC116 ADCs.
+ * @return  - DSP_COND_ERR_OK
+ *			- DSP_COND_ERR_GAIN
+ *			- DSP_COND_ERR_ARGUMENT
+ */
+int dsp_cond_init(DSP_COND *cond, int invert, float gain, float offset, float lsb);
+
+/**
+ * Condition a frame in place.
+ *
+ * @param	cond	conditioner initialized by dsp_cond_init().
+ * @param	sig	16 bit ADC samples, replaced by the conditioned samples, saturated.
+ * @param	len	number of samples.
+ * @param	volts	receives len conditioned samples in volts, not saturated, NULL for none.
+ * @return  - DSP_COND_ERR_OK
+ *			- DSP_COND_ERR_ARGUMENT
+ */
+int dsp_cond_apply16(const DSP_COND *cond, short *sig, unsigned int len, float *volts);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_COND_H_
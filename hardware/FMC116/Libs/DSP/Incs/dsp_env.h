@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_env.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_env module reduces a frame to its min/max envelope for display (header)
+///
+/// Stands for the plot(1:demo.frmRxNSmp16, frame) of every capture in demoRxTimer.m. A display
+/// a few hundred pixels wide only shows, per pixel column, the smallest and largest sample of
+/// the samples it covers: the frame is split into POINTS buckets of consecutive samples and
+/// each bucket reduced to its minimum, its maximum and optionally its mean. The buckets are
+/// reduced 16 samples at a time with AVX2 or 8 at a time with SSE2, the sums of the means on 32
+/// bit lanes that are moved to 64 bits before they could overflow.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_ENV_H_
+#define _DSP_ENV_H_
+
+/* defines */
+#define DSP_ENV_FIRST(k, len, points)	((unsigned int)((unsigned long long)(k)*(len)/(points)))	/*!< First sample of bucket k */
+
+/* error codes */
+#define DSP_ENV_ERR_OK				0				/*!< No error encountered during execution. */
+#define DSP_ENV_ERR_POINTS			-1				/*!< The number of buckets is 0 or larger than the frame. */
+#define DSP_ENV_ERR_ARGUMENT		-2				/*!< An argument is NULL. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reduce a frame of 16 bit samples to its envelope. Bucket k holds the samples DSP_ENV_FIRST(k) to DSP_ENV_FIRST(k+1)-1.
+ *
+ * @param	sig	16 bit samples of the frame.
+ * @param	len	number of samples.
+ * @param	points	number of buckets, 1..len.
+ * @param	lo	receives the smallest sample of each bucket.
+ * @param	hi	receives the largest sample of each bucket.
+ * @param	mean	receives the mean of each bucket, NULL for none.
+ * @return  - DSP_ENV_ERR_OK
+ *			- DSP_ENV_ERR_POINTS
+ *			- DSP_ENV_ERR_ARGUMENT
+ */
+int dsp_env_minmax16(const short *sig, unsigned int len, unsigned int points, short *lo, short *hi, float *mean);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_ENV_H_
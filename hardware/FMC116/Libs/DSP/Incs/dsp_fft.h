@@ -0,0 +1,146 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_fft.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_fft module computes complex and real fast Fourier transforms (header)
+///
+/// Decimation in time transform of single precision complex data. After the bit reversal, the
+/// stages are run two at a time as radix-4 passes, with one radix-2 pass first when log2(n) is
+/// odd. The butterflies of a pass are computed with the vector instructions selected by
+/// dsp_simd.h, 4 ( AVX ) or 2 ( SSE ) complex values at a time, plain C otherwise. A plan holds
+/// the twiddle factors of every pass, contiguous so that the vector loops read them in order, and
+/// the bit reversal table of one transform size. The forward transform is not scaled, the inverse
+/// transform is scaled by 1/n ( same convention as MATLAB fft/ifft ). The inverse transform runs
+/// the forward passes on the conjugate data, one set of tables serves both directions.
+///
+/// A plan of n values also transforms 2n real values, as n complex values whose spectrum is then
+/// split into the n+1 bins of the real signal, half the work of a complex transform of 2n values.
+///
+/// A plan is read only once built, several threads may execute the same plan on their own data.
+/// dsp_fft_getplan() keeps one plan per size for the whole process, built on the first request
+/// under a lock, so that every DSP stage of the servers shares the same tables.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_FFT_H_
+#define _DSP_FFT_H_
+
+/* defines */
+#define DSP_FFT_FORWARD			0					/*!< dsp_fft_execute() direction, e^-j */
+#define DSP_FFT_INVERSE			1					/*!< dsp_fft_execute() direction, e^+j and 1/n scaling */
+#define DSP_FFT_MAX_LOG2		24					/*!< log2 of the largest transform size */
+#define DSP_FFT_MAX_SIZE		(1<<DSP_FFT_MAX_LOG2)	/*!< Largest transform size supported */
+
+/**
+ * Single precision complex value, interleaved real and imaginary parts.
+ */
+typedef struct {
+	float re;										/*!< real part */
+	float im;										/*!< imaginary part */
+} DSP_COMPLEX;
+
+/**
+ * Transform plan of one size, see dsp_fft_init().
+ */
+typedef struct {
+	unsigned int n;									/*!< transform size, power of 2 */
+	unsigned int log2n;								/*!< log2(n) */
+	DSP_COMPLEX *twiddle;							/*!< w(4m)^k then w(2m)^k, k = 0..m-1, for each radix-4 pass of groups of 4m values */
+	DSP_COMPLEX *rtwiddle;							/*!< e^(-j*pi*k/n), k = 0..n, split of the real transforms of 2n values */
+	unsigned int *bitrev;							/*!< bit reversed index of 0..n-1 */
+} DSP_FFT_PLAN;
+
+/* error codes */
+#define DSP_FFT_ERR_OK			0					/*!< No error encountered during execution. */
+#define DSP_FFT_ERR_SIZE		-1					/*!< The transform size is not a power of 2 or is out of range. */
+#define DSP_FFT_ERR_ALLOC		-2					/*!< The plan tables could not be allocated. */
+#define DSP_FFT_ERR_ARGUMENT	-3					/*!< An argument is NULL or the plan has not been built. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Obtain the smallest power of 2 greater or equal to a value.
+ *
+ * @param	n	value, 1..DSP_FFT_MAX_SIZE.
+ * @return  the power of 2, 0 when n is out of range.
+ */
+unsigned int dsp_fft_nextpow2(unsigned int n);
+
+/**
+ * Build the plan of a transform size.
+ *
+ * @param	plan	plan to be built, released with dsp_fft_free().
+ * @param	n	transform size, power of 2 from 1 to DSP_FFT_MAX_SIZE.
+ * @return  - DSP_FFT_ERR_OK
+ *			- DSP_FFT_ERR_SIZE
+ *			- DSP_FFT_ERR_ALLOC
+ *			- DSP_FFT_ERR_ARGUMENT
+ */
+int dsp_fft_init(DSP_FFT_PLAN *plan, unsigned int n);
+
+/**
+ * Obtain the shared plan of a transform size, built on the first request. The plan must not be released by the caller,
+ * it is valid until dsp_fft_releaseplans(). Thread safe.
+ *
+ * @param	n	transform size, power of 2 from 1 to DSP_FFT_MAX_SIZE.
+ * @return  the plan, NULL when n is not supported or out of memory.
+ */
+const DSP_FFT_PLAN *dsp_fft_getplan(unsigned int n);
+
+/**
+ * Transform plan->n values in place.
+ *
+ * @param	plan	plan built by dsp_fft_init() or obtained from dsp_fft_getplan().
+ * @param	data	plan->n complex values.
+ * @param	direction	DSP_FFT_FORWARD or DSP_FFT_INVERSE.
+ * @return  - DSP_FFT_ERR_OK
+ *			- DSP_FFT_ERR_ARGUMENT
+ */
+int dsp_fft_execute(const DSP_FFT_PLAN *plan, DSP_COMPLEX *data, int direction);
+
+/**
+ * Transform count sets of plan->n values in place, set i starting at data+i*stride.
+ *
+ * @param	plan	plan built by dsp_fft_init() or obtained from dsp_fft_getplan().
+ * @param	data	first set of complex values.
+ * @param	count	number of sets.
+ * @param	stride	distance between the first values of two sets, plan->n at least.
+ * @param	direction	DSP_FFT_FORWARD or DSP_FFT_INVERSE.
+ * @return  - DSP_FFT_ERR_OK
+ *			- DSP_FFT_ERR_ARGUMENT
+ */
+int dsp_fft_batch(const DSP_FFT_PLAN *plan, DSP_COMPLEX *data, unsigned int count, unsigned int stride, int direction);
+
+/**
+ * Transform 2*plan->n real values in place. The forward transform reads the real values from data, as plan->n complex
+ * values ( x[2k] in data[k].re and x[2k+1] in data[k].im ), and writes the bins 0..plan->n of their spectrum, the other
+ * bins are the conjugates of these. The inverse transform reads the bins 0..plan->n and writes the 2*plan->n real values
+ * scaled by 1/(2*plan->n), the imaginary parts of the bins 0 and plan->n are ignored.
+ *
+ * @param	plan	plan built by dsp_fft_init() or obtained from dsp_fft_getplan().
+ * @param	data	plan->n+1 complex values.
+ * @param	direction	DSP_FFT_FORWARD or DSP_FFT_INVERSE.
+ * @return  - DSP_FFT_ERR_OK
+ *			- DSP_FFT_ERR_ARGUMENT
+ */
+int dsp_fft_execute_real(const DSP_FFT_PLAN *plan, DSP_COMPLEX *data, int direction);
+
+/**
+ * Release the tables of a plan, the plan may be built again afterwards.
+ *
+ * @param	plan	plan built by dsp_fft_init(), or cleared with memset().
+ */
+void dsp_fft_free(DSP_FFT_PLAN *plan);
+
+/**
+ * Release the plans of dsp_fft_getplan(), when no thread uses them any more.
+ */
+void dsp_fft_releaseplans(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_FFT_H_
@@ -0,0 +1,172 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ofdm.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ofdm module demodulates the optical OFDM symbols of an aligned frame (header)
+///
+/// Native version of cDemodOFDM.demodulate(). The symbols of a frame, NPSYM samples each, are
+/// brought to the signal clock in one piece by the polyphase resampler of dsp_resample.h, so that
+/// the filter does not see the edges of every symbol, and transformed with the shared FFT plan
+/// of dsp_fft_getplan(), two real symbols per complex transform, all of them in one batch. The
+/// data subcarriers, 1..NSC/2-1 for 'DCOOFDM' and 'DMT' and the odd ones below NSC/2 for
+/// 'ACOOFDM', are equalized with the gains estimated on the pilot of the frame and sliced to the
+/// nearest point of the constellation with the vector instructions selected by dsp_simd.h, all
+/// the points of the frame at once. The index of the point is sent MSB first on log2(MSC) bits
+/// as dec2binMat() does.
+///
+/// The time signal of a symbol is taken as the unitary inverse transform of its subcarriers,
+/// x = sqrt(NSC)*ifft(X), the ACO-OFDM subcarriers being halved by the clipping. The pilot of
+/// the frame gives the gain from the OFDM signal to the ADC counts, either one gain for the
+/// whole band, the least squares fit of cPilot.getScale(), or one complex gain per subcarrier,
+/// the ratio of the received and expected pilot spectra at the subcarrier frequency, pulled
+/// towards the whole band gain where the pilot has little energy. The response of the resampler
+/// at each subcarrier is divided out in both cases.
+///
+/// The resampler and the pilot spectra are built once per engine, a frame only runs the
+/// transforms. An engine is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_OFDM_H_
+#define _DSP_OFDM_H_
+
+#include "dsp_fft.h"
+#include "dsp_resample.h"
+
+/* defines */
+#define DSP_OFDM_ACO				0				/*!< cModOFDM 'ACOOFDM', data on the odd subcarriers below NSC/2 */
+#define DSP_OFDM_DCO				1				/*!< cModOFDM 'DCOOFDM', data on the subcarriers 1..NSC/2-1 */
+#define DSP_OFDM_DMT				2				/*!< cModOFDM 'DMT', same subcarriers as 'DCOOFDM' */
+#define DSP_OFDM_EQ_FLAT			0				/*!< one real gain for all the subcarriers, cPilot.getScale() */
+#define DSP_OFDM_EQ_PILOT			1				/*!< one complex gain per subcarrier, from the pilot spectrum */
+#define DSP_OFDM_MIN_NSC			4				/*!< Fewest subcarriers */
+#define DSP_OFDM_MAX_NSC			4096			/*!< Most subcarriers */
+#define DSP_OFDM_MAX_MSC			256				/*!< Largest constellation */
+#define DSP_OFDM_EQ_FLOOR			1e-2f			/*!< Weight of the flat gain in the per subcarrier gains, relative to the strongest pilot component */
+#define DSP_OFDM_NBYTES(nbits)		(((nbits)+7)/8)	/*!< Bytes of nbits packed bits */
+
+/**
+ * Demodulation engine, see dsp_ofdm_init().
+ */
+typedef struct {
+	int type;										/*!< DSP_OFDM_ACO, DSP_OFDM_DCO or DSP_OFDM_DMT */
+	int eq;											/*!< DSP_OFDM_EQ_FLAT or DSP_OFDM_EQ_PILOT */
+	unsigned int nsc;								/*!< subcarriers, transform size */
+	unsigned int msc;								/*!< constellation points */
+	unsigned int bpsc;								/*!< bits per subcarrier, log2(msc) */
+	unsigned int ndata;								/*!< data subcarriers per symbol */
+	unsigned int bpsym;								/*!< bits per symbol, ndata*bpsc ( cDemodOFDM.BPSYM ) */
+	unsigned int npsym;								/*!< samples per symbol at clksmp ( cDemodOFDM.NPSYM ) */
+	double clksmp;									/*!< sample clock of the frames, Hz */
+	double clksig;									/*!< signal clock of the symbols, Hz */
+	unsigned int *carrier;							/*!< index of the data subcarriers, ndata */
+	float *symre;									/*!< constellation, real parts */
+	float *symim;									/*!< constellation, imaginary parts */
+	DSP_RESAMPLE rs;								/*!< clksmp to clksig */
+	const DSP_FFT_PLAN *plan;						/*!< shared plan of nsc values */
+	unsigned int context;							/*!< samples resampled before and after the symbols, a multiple of the decimation */
+	unsigned int lead;								/*!< samples of the context at clksig */
+	float *rsgain;									/*!< inverse of the resampler response at each data subcarrier */
+	float *seg;										/*!< symbols of the frame and their context at clksmp */
+	float *sig;										/*!< symbols of the frame and their context at clksig */
+	DSP_COMPLEX *work;								/*!< transforms of the symbol pairs of the frame */
+	float *yre;										/*!< equalized data subcarriers of the frame, real parts */
+	float *yim;										/*!< equalized data subcarriers of the frame, imaginary parts */
+	unsigned int *dec;								/*!< constellation point of each data subcarrier of the frame */
+	unsigned int capacity;							/*!< symbols held by seg, sig, work, yre, yim and dec */
+	unsigned int pltlen;							/*!< pilot samples, 0 until dsp_ofdm_setpilot() */
+	float pltscale;									/*!< amplitude of a pilot chip in OFDM signal units */
+	float *pltref;									/*!< expected pilot, mean subtracted */
+	float pltenergy;								/*!< energy of pltref */
+	float *pltrx;									/*!< received pilot of the last frame, mean subtracted */
+	float *pltcos;									/*!< cos(w*n) of each data subcarrier, ndata rows of pltlen */
+	float *pltsin;									/*!< sin(w*n) of each data subcarrier, ndata rows of pltlen */
+	DSP_COMPLEX *pltspec;							/*!< spectrum of pltref at each data subcarrier */
+	float pltfloor;									/*!< DSP_OFDM_EQ_FLOOR times the largest |pltspec|^2 */
+	DSP_COMPLEX *gain;								/*!< equalizer of the last frame, from the transform to the constellation */
+} DSP_OFDM;
+
+/* error codes */
+#define DSP_OFDM_ERR_OK				0				/*!< No error encountered during execution. */
+#define DSP_OFDM_ERR_TYPE			-1				/*!< Unknown OFDM type, equalizer or resampling filter. */
+#define DSP_OFDM_ERR_SIZE			-2				/*!< The subcarriers or the constellation points are not a power of 2 or out of range. */
+#define DSP_OFDM_ERR_CLOCK			-3				/*!< The clocks are not positive or their ratio needs too large an upsampling. */
+#define DSP_OFDM_ERR_LENGTH			-4				/*!< The symbols or the pilot do not fit in the frame. */
+#define DSP_OFDM_ERR_PILOT			-5				/*!< No pilot has been given, or its gain is 0. */
+#define DSP_OFDM_ERR_ALLOC			-6				/*!< The engine buffers could not be allocated. */
+#define DSP_OFDM_ERR_ARGUMENT		-7				/*!< An argument is NULL. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a demodulation engine, the pilot is given afterwards with dsp_ofdm_setpilot().
+ *
+ * @param	ofdm	engine to be initialized, released with dsp_ofdm_free().
+ * @param	type	DSP_OFDM_ACO, DSP_OFDM_DCO or DSP_OFDM_DMT ( cModOFDM.OFDMTYP ).
+ * @param	nsc	number of subcarriers, power of 2 from DSP_OFDM_MIN_NSC to DSP_OFDM_MAX_NSC ( cModOFDM.NSC ).
+ * @param	symre	real parts of the constellation points ( cModOFDM.SYMSC ).
+ * @param	symim	imaginary parts of the constellation points.
+ * @param	msc	number of constellation points, power of 2 from 2 to DSP_OFDM_MAX_MSC ( cModOFDM.MSC ).
+ * @param	clksmp	sample clock of the frames in Hz.
+ * @param	clksig	signal clock of the symbols in Hz.
+ * @param	filter	DSP_RESAMPLE_RAISEDCOSINE or DSP_RESAMPLE_IDEALRECT ( cDemodOFDM.FILTER ).
+ * @return  - DSP_OFDM_ERR_OK
+ *			- DSP_OFDM_ERR_TYPE
+ *			- DSP_OFDM_ERR_SIZE
+ *			- DSP_OFDM_ERR_CLOCK
+ *			- DSP_OFDM_ERR_ALLOC
+ *			- DSP_OFDM_ERR_ARGUMENT
+ */
+int dsp_ofdm_init(DSP_OFDM *ofdm, int type, unsigned int nsc, const float *symre, const float *symim, unsigned int msc,
+	double clksmp, double clksig, int filter);
+
+/**
+ * Give the pilot expected in the frames and build its spectrum at the data subcarriers.
+ *
+ * @param	ofdm	engine initialized by dsp_ofdm_init().
+ * @param	ref	pilot samples at the sample clock, for instance from dsp_pilot_reference().
+ * @param	pltlen	number of pilot samples.
+ * @param	scale	amplitude of a pilot chip in OFDM signal units, SIGMAX-SIGMIN of cDemoOFDM.
+ * @param	eq	DSP_OFDM_EQ_FLAT or DSP_OFDM_EQ_PILOT.
+ * @return  - DSP_OFDM_ERR_OK
+ *			- DSP_OFDM_ERR_TYPE
+ *			- DSP_OFDM_ERR_PILOT
+ *			- DSP_OFDM_ERR_ALLOC
+ *			- DSP_OFDM_ERR_ARGUMENT
+ */
+int dsp_ofdm_setpilot(DSP_OFDM *ofdm, const float *ref, unsigned int pltlen, float scale, int eq);
+
+/**
+ * Demodulate the symbols of a frame. The frame is treated as circular, the pilot and the symbols may wrap around its end.
+ *
+ * @param	ofdm	engine initialized by dsp_ofdm_init() and dsp_ofdm_setpilot().
+ * @param	sig	16 bit ADC samples of the frame.
+ * @param	len	number of samples in the frame.
+ * @param	pltstart	index of the first pilot sample, 0..len-1.
+ * @param	start	index of the first sample of the first symbol, 0..len-1, usually the sample following the pilot.
+ * @param	nsym	number of symbols, nsym*npsym must not exceed len.
+ * @param	invert	1 to negate the samples first, for the channels wired with an inverted polarity.
+ * @param	bits	receives DSP_OFDM_NBYTES(nsym*bpsym) bytes, bit k of the stream in bit k%8 of bits[k/8].
+ * @return  - DSP_OFDM_ERR_OK
+ *			- DSP_OFDM_ERR_LENGTH
+ *			- DSP_OFDM_ERR_PILOT
+ *			- DSP_OFDM_ERR_ALLOC
+ *			- DSP_OFDM_ERR_ARGUMENT
+ */
+int dsp_ofdm_demod16(DSP_OFDM *ofdm, const short *sig, unsigned int len, unsigned int pltstart, unsigned int start, unsigned int nsym,
+	int invert, unsigned char *bits);
+
+/**
+ * Release the resampler and the buffers of an engine.
+ *
+ * @param	ofdm	engine initialized by dsp_ofdm_init(), or cleared with memset().
+ */
+void dsp_ofdm_free(DSP_OFDM *ofdm);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_OFDM_H_
@@ -0,0 +1,89 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ook.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ook module demodulates the OOK symbols of an aligned frame (header)
+///
+/// Native version of cDemodOOK.demodulate(). A symbol is NPSYM consecutive samples, each sample
+/// is compared with the threshold (ON+OFF)/2 and the symbol is the majority of the comparisons,
+/// a tie gives 0 as mode() does. The comparisons of the whole frame are packed into a bit mask
+/// with the vector instructions selected by dsp_simd.h, the majority of each symbol is then a
+/// population count of NPSYM bits of the mask instead of a loop over its samples.
+///
+/// The ON and OFF levels are either fixed, in ADC counts, or measured on every frame as the
+/// largest and smallest sample of its symbols, which stands for the min() subtraction and the
+/// pilot gain scaling of the receiver scripts. A demodulator is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_OOK_H_
+#define _DSP_OOK_H_
+
+/* defines */
+#define DSP_OOK_NBYTES(nsym)		(((nsym)+7)/8)		/*!< Bytes of nsym packed bits */
+
+/**
+ * Demodulator, see dsp_ook_init().
+ */
+typedef struct {
+	unsigned int npsym;								/*!< samples per symbol */
+	float on;										/*!< signal level of a 1, equal to off for levels measured on each frame */
+	float off;										/*!< signal level of a 0 */
+	float threshold;								/*!< threshold used for the last frame */
+	unsigned int *mask;								/*!< comparisons of the frame, sample i in bit i%32 of mask[i/32], one padding word */
+	unsigned int masksize;							/*!< capacity of mask, words */
+} DSP_OOK;
+
+/* error codes */
+#define DSP_OOK_ERR_OK				0				/*!< No error encountered during execution. */
+#define DSP_OOK_ERR_SYMBOL			-1				/*!< The symbol length is 0. */
+#define DSP_OOK_ERR_LENGTH			-2				/*!< The symbols do not fit in the frame or start past its end. */
+#define DSP_OOK_ERR_ALLOC			-3				/*!< The bit mask could not be allocated. */
+#define DSP_OOK_ERR_ARGUMENT		-4				/*!< An argument is NULL. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a demodulator.
+ *
+ * @param	ook	demodulator to be initialized, released with dsp_ook_free().
+ * @param	npsym	samples per symbol ( cDemodOOK.NPSYM, ceil(ADC clock/symbol clock) ).
+ * @param	on	signal level of a 1 in ADC counts, after the polarity correction.
+ * @param	off	signal level of a 0 in ADC counts, equal to on to measure both levels on every frame.
+ * @return  - DSP_OOK_ERR_OK
+ *			- DSP_OOK_ERR_SYMBOL
+ *			- DSP_OOK_ERR_ARGUMENT
+ */
+int dsp_ook_init(DSP_OOK *ook, unsigned int npsym, float on, float off);
+
+/**
+ * Demodulate the symbols of a frame. The frame is treated as circular, the symbols may wrap around its end.
+ *
+ * @param	ook	demodulator initialized by dsp_ook_init().
+ * @param	sig	16 bit ADC samples of the frame.
+ * @param	len	number of samples in the frame.
+ * @param	start	index of the first sample of the first symbol, 0..len-1, usually the sample following the pilot.
+ * @param	nsym	number of symbols, nsym*npsym must not exceed len.
+ * @param	invert	1 to negate the samples first, for the channels wired with an inverted polarity.
+ * @param	bits	receives DSP_OOK_NBYTES(nsym) bytes, symbol k in bit k%8 of bits[k/8], unused bits cleared.
+ * @return  - DSP_OOK_ERR_OK
+ *			- DSP_OOK_ERR_LENGTH
+ *			- DSP_OOK_ERR_ALLOC
+ *			- DSP_OOK_ERR_ARGUMENT
+ */
+int dsp_ook_demod16(DSP_OOK *ook, const short *sig, unsigned int len, unsigned int start, unsigned int nsym, int invert, unsigned char *bits);
+
+/**
+ * Release the bit mask of a demodulator.
+ *
+ * @param	ook	demodulator initialized by dsp_ook_init(), or cleared with memset().
+ */
+void dsp_ook_free(DSP_OOK *ook);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_OOK_H_
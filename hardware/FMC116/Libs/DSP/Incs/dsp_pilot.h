@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_pilot.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_pilot module finds the Barker pilot in a received frame (header)
+///
+/// Native version of cPilotBarker.alignPilot(). The Barker sequence is brought to the sample
+/// clock of the frame by the polyphase resampler of dsp_resample.h. The coarse position is the
+/// peak of the circular cross correlation of the pilot with the frame, computed with real FFTs,
+/// and it is refined by the alignFine() search over +-DSP_PILOT_FINE samples.
+///
+/// The pilot and its spectrum only depend on the sample clock and on the frame length, they
+/// are kept in a small cache of the engine and rebuilt only when a new combination shows up.
+///
+/// In steady state the pilot of consecutive frames of a channel moves by a few samples only. The
+/// tracking functions keep the last offset of each channel ( track ) and only search a window of
+/// +-window samples around it, the full search is run again when the normalized correlation of
+/// the best candidate falls below a threshold or when the best candidate lies on the window edge.
+///
+/// An engine is not thread safe, every thread aligning frames uses its own engine.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_PILOT_H_
+#define _DSP_PILOT_H_
+
+#include "dsp_fft.h"
+#include "dsp_resample.h"
+
+/* defines */
+#define DSP_PILOT_BARKER11			11				/*!< 11 chips Barker sequence */
+#define DSP_PILOT_BARKER13			13				/*!< 13 chips Barker sequence */
+#define DSP_PILOT_RAISEDCOSINE		DSP_RESAMPLE_RAISEDCOSINE	/*!< updnClock() 'RAISEDCOSINE' filter, cPilotBarker default */
+#define DSP_PILOT_IDEALRECT			DSP_RESAMPLE_IDEALRECT		/*!< updnClock() 'IDEALRECT' filter */
+#define DSP_PILOT_NB_CACHE			4				/*!< Combinations of sample clock and frame length kept by an engine */
+#define DSP_PILOT_FINE				3				/*!< Half width of the fine search, in samples */
+#define DSP_PILOT_NB_TRACKS			16				/*!< Channels followed by the tracking functions */
+#define DSP_PILOT_TRACK_WINDOW		8				/*!< Default half width of the tracking window, in samples */
+#define DSP_PILOT_TRACK_THRESHOLD	0.5f			/*!< Default normalized correlation below which a full search is run */
+
+/**
+ * Pilot and pilot spectrum of one sample clock and frame length.
+ */
+typedef struct {
+	double clksmp;									/*!< sample clock of the frames, Hz, 0 for an empty entry */
+	unsigned int len;								/*!< frame length, samples */
+	unsigned int pltlen;							/*!< pilot length at clksmp, samples */
+	float *pilot;									/*!< pilot at clksmp, minimum subtracted */
+	float *frame;									/*!< frame being aligned, minimum subtracted */
+	float *window;									/*!< samples of the tracking window, len+pltlen at most */
+	float pltmean;									/*!< mean of the pilot */
+	float pltnorm;									/*!< norm of the pilot, mean subtracted */
+	const DSP_FFT_PLAN *plan;						/*!< shared plan of nfft/2 values, real transforms of nfft = dsp_fft_nextpow2(len+pltlen-1) values */
+	DSP_COMPLEX *spectrum;							/*!< conjugate spectrum of the zero padded pilot, bins 0..nfft/2 */
+	DSP_COMPLEX *work;								/*!< spectrum of the frame, then the cross correlation as nfft real values */
+	unsigned long used;								/*!< last use, replaces the least recently used entry */
+} DSP_PILOT_CACHE;
+
+/**
+ * Alignment state of one channel, see dsp_pilot_track().
+ */
+typedef struct {
+	int valid;										/*!< 1 once a frame has been aligned */
+	double clksmp;									/*!< sample clock of the last frame, Hz */
+	unsigned int len;								/*!< length of the last frame, samples */
+	unsigned int offset;							/*!< pilot offset in the last frame */
+	float confidence;								/*!< normalized correlation of the pilot at offset, -1.0 to 1.0 */
+	unsigned long tracked;							/*!< frames aligned within the window */
+	unsigned long searched;							/*!< frames aligned by a full search */
+} DSP_PILOT_TRACK;
+
+/**
+ * Alignment engine, see dsp_pilot_init().
+ */
+typedef struct {
+	int type;										/*!< DSP_PILOT_BARKER11 or DSP_PILOT_BARKER13 */
+	int filter;										/*!< DSP_PILOT_RAISEDCOSINE or DSP_PILOT_IDEALRECT */
+	double clkin;									/*!< chip clock of the pilot, Hz */
+	unsigned long uses;								/*!< frames aligned so far */
+	unsigned int window;							/*!< half width of the tracking window, 0 disables the tracking */
+	float threshold;								/*!< normalized correlation below which a full search is run */
+	DSP_PILOT_CACHE cache[DSP_PILOT_NB_CACHE];		/*!< pilots per sample clock and frame length */
+	DSP_PILOT_TRACK track[DSP_PILOT_NB_TRACKS];		/*!< state of the tracking functions per channel */
+} DSP_PILOT;
+
+/* error codes */
+#define DSP_PILOT_ERR_OK			0				/*!< No error encountered during execution. */
+#define DSP_PILOT_ERR_TYPE			-1				/*!< Unknown pilot type or filter. */
+#define DSP_PILOT_ERR_CLOCK			-2				/*!< The clocks are not positive or their ratio needs too large an upsampling. */
+#define DSP_PILOT_ERR_LENGTH		-3				/*!< The frame is shorter than the pilot ( the pilot cannot be aligned ) or too long for the transform. */
+#define DSP_PILOT_ERR_ALLOC			-4				/*!< The pilot or the transform buffers could not be allocated. */
+#define DSP_PILOT_ERR_ARGUMENT		-5				/*!< An argument is NULL. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize an alignment engine, the pilots are built on the first frame of each sample clock. The tracking uses
+ * DSP_PILOT_TRACK_WINDOW and DSP_PILOT_TRACK_THRESHOLD until dsp_pilot_settracking() is called.
+ *
+ * @param	pilot	engine to be initialized, released with dsp_pilot_free().
+ * @param	type	DSP_PILOT_BARKER11 or DSP_PILOT_BARKER13.
+ * @param	filter	DSP_PILOT_RAISEDCOSINE or DSP_PILOT_IDEALRECT.
+ * @param	clkin	chip clock of the pilot in Hz ( cPilot.CLKIN ).
+ * @return  - DSP_PILOT_ERR_OK
+ *			- DSP_PILOT_ERR_TYPE
+ *			- DSP_PILOT_ERR_CLOCK
+ *			- DSP_PILOT_ERR_ARGUMENT
+ */
+int dsp_pilot_init(DSP_PILOT *pilot, int type, int filter, double clkin);
+
+/**
+ * Find the first sample of the pilot in a frame. The frame is treated as circular, the pilot may wrap around its end.
+ *
+ * @param	pilot	engine initialized by dsp_pilot_init().
+ * @param	clksmp	sample clock of the frame in Hz.
+ * @param	sig	frame samples.
+ * @param	len	number of samples in the frame.
+ * @param	offset	receives the index of the first pilot sample, 0..len-1 ( alignPilot() returns offset+1 ).
+ * @return  - DSP_PILOT_ERR_OK
+ *			- DSP_PILOT_ERR_CLOCK
+ *			- DSP_PILOT_ERR_LENGTH
+ *			- DSP_PILOT_ERR_ALLOC
+ *			- DSP_PILOT_ERR_ARGUMENT
+ */
+int dsp_pilot_align(DSP_PILOT *pilot, double clksmp, const float *sig, unsigned int len, unsigned int *offset);
+
+/**
+ * Same as dsp_pilot_align() for 16 bit ADC samples.
+ *
+ * @param	invert	1 to negate the samples first, for the channels wired with an inverted polarity.
+ */
+int dsp_pilot_align16(DSP_PILOT *pilot, double clksmp, const short *sig, unsigned int len, int invert, unsigned int *offset);
+
+/**
+ * Configure the tracking functions, the state of the tracks is kept.
+ *
+ * @param	pilot	engine initialized by dsp_pilot_init().
+ * @param	window	half width of the window searched around the last offset, 0 runs a full search for every frame.
+ * @param	threshold	normalized correlation ( -1.0 to 1.0 ) below which the window result is discarded.
+ * @return  - DSP_PILOT_ERR_OK
+ *			- DSP_PILOT_ERR_ARGUMENT
+ */
+int dsp_pilot_settracking(DSP_PILOT *pilot, unsigned int window, float threshold);
+
+/**
+ * Same as dsp_pilot_align() for frames of a channel followed over time. The window around the last offset of the track
+ * is searched first, the whole frame only when the window does not hold a confident peak, for the first frame and
+ * after a change of sample clock or frame length. pilot->track[track] receives the offset and its confidence.
+ *
+ * @param	track	channel, 0..DSP_PILOT_NB_TRACKS-1.
+ */
+int dsp_pilot_track(DSP_PILOT *pilot, unsigned int track, double clksmp, const float *sig, unsigned int len, unsigned int *offset);
+
+/**
+ * Same as dsp_pilot_track() for 16 bit ADC samples, see dsp_pilot_align16().
+ */
+int dsp_pilot_track16(DSP_PILOT *pilot, unsigned int track, double clksmp, const short *sig, unsigned int len, int invert, unsigned int *offset);
+
+/**
+ * Obtain the length of the pilot in a frame, the samples following the pilot start pltlen samples after its offset.
+ *
+ * @param	pilot	engine initialized by dsp_pilot_init().
+ * @param	clksmp	sample clock of the frame in Hz.
+ * @param	len	number of samples in the frame.
+ * @param	pltlen	receives the number of pilot samples.
+ * @return  - DSP_PILOT_ERR_OK
+ *			- DSP_PILOT_ERR_CLOCK
+ *			- DSP_PILOT_ERR_LENGTH
+ *			- DSP_PILOT_ERR_ALLOC
+ *			- DSP_PILOT_ERR_ARGUMENT
+ */
+int dsp_pilot_length(DSP_PILOT *pilot, double clksmp, unsigned int len, unsigned int *pltlen);
+
+/**
+ * Obtain the pilot expected in a frame, to estimate the channel from the received pilot.
+ *
+ * @param	pilot	engine initialized by dsp_pilot_init().
+ * @param	clksmp	sample clock of the frame in Hz.
+ * @param	len	number of samples in the frame.
+ * @param	ref	receives the pilot samples at clksmp, minimum subtracted, valid until the engine is used again.
+ * @param	pltlen	receives the number of pilot samples.
+ * @return  - DSP_PILOT_ERR_OK
+ *			- DSP_PILOT_ERR_CLOCK
+ *			- DSP_PILOT_ERR_LENGTH
+ *			- DSP_PILOT_ERR_ALLOC
+ *			- DSP_PILOT_ERR_ARGUMENT
+ */
+int dsp_pilot_reference(DSP_PILOT *pilot, double clksmp, unsigned int len, const float **ref, unsigned int *pltlen);
+
+/**
+ * Forget the last offset of a track, its next frame is aligned by a full search.
+ *
+ * @param	pilot	engine initialized by dsp_pilot_init().
+ * @param	track	channel, 0..DSP_PILOT_NB_TRACKS-1.
+ */
+void dsp_pilot_resettrack(DSP_PILOT *pilot, unsigned int track);
+
+/**
+ * Rotate a frame in place so that the sample at offset comes first.
+ *
+ * @param	sig	frame samples.
+ * @param	len	number of samples in the frame.
+ * @param	offset	index of the sample moved to the beginning, 0..len-1.
+ */
+void dsp_pilot_rotate16(short *sig, unsigned int len, unsigned int offset);
+
+/**
+ * Release the pilots and buffers of an engine.
+ *
+ * @param	pilot	engine initialized by dsp_pilot_init().
+ */
+void dsp_pilot_free(DSP_PILOT *pilot);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_PILOT_H_
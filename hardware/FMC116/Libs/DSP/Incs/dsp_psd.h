@@ -0,0 +1,144 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_psd.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_psd module estimates the power spectral density of a channel with Welch's method (header)
+///
+/// Server side version of plotFreq.m, which transforms a whole frame padded to a power of 2. The
+/// frame is cut into segments of NFFT samples overlapping by NFFT-STEP samples, each one is
+/// windowed and transformed, and the squared magnitudes are averaged over the segments of the
+/// frame, then over the frames: a running mean of the first AVERAGES frames, an exponential
+/// mean with the weight 1/AVERAGES afterwards. A frame shorter than NFFT is padded with zeros.
+///
+/// Two real segments are transformed as one complex segment, x1+j*x2, with the shared plan of
+/// dsp_fft_getplan(), DSP_PSD_BATCH pairs per dsp_fft_batch(). The spectrum of the pair is not
+/// split: |X1(k)|^2+|X2(k)|^2 = (|Z(k)|^2+|Z(n-k)|^2)/2, the squares of the real and imaginary
+/// parts of Z are summed over the frame with the vector instructions selected by dsp_simd.h and
+/// folded once per frame. The densities are in V^2/Hz, the window normalized by its power.
+///
+/// dsp_psd_get() gives the one-sided spectrum, bins 0..NFFT/2, or the two-sided one, bins
+/// -NFFT/2+1..NFFT/2 as the 'whole' spectrum of plotFreq.m, reduced to fewer points by the mean
+/// or the largest of consecutive bins. An engine is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_PSD_H_
+#define _DSP_PSD_H_
+
+#include "dsp_fft.h"
+
+/* defines */
+#define DSP_PSD_WIN_RECT			0				/*!< rectangular window */
+#define DSP_PSD_WIN_HANN			1				/*!< Hann window, hann(NFFT) */
+#define DSP_PSD_WIN_BLACKMAN		2				/*!< Blackman window, blackman(NFFT) */
+#define DSP_PSD_MIN_NFFT			16				/*!< Shortest segment */
+#define DSP_PSD_MAX_NFFT			65536			/*!< Longest segment */
+#define DSP_PSD_BATCH				8				/*!< Segment pairs transformed per dsp_fft_batch() */
+#define DSP_PSD_WHOLE				0x01			/*!< dsp_psd_get() mode, two-sided spectrum */
+#define DSP_PSD_PEAK				0x02			/*!< dsp_psd_get() mode, largest bin of each point instead of the mean */
+#define DSP_PSD_DB					0x04			/*!< dsp_psd_get() mode, 10*log10 of the density */
+#define DSP_PSD_DB_FLOOR			-300.0f			/*!< dB given for a null density */
+
+/**
+ * Spectrum estimator of one channel, see dsp_psd_init().
+ */
+typedef struct {
+	unsigned int nfft;								/*!< samples per segment, transform size */
+	unsigned int step;								/*!< samples between the first samples of two segments */
+	int window;										/*!< DSP_PSD_WIN_x */
+	unsigned int averages;							/*!< frames of the running mean, 0 to average all the frames */
+	float fs;										/*!< sample clock, Hz */
+	const DSP_FFT_PLAN *plan;						/*!< shared plan of nfft values */
+	float *win;										/*!< window scaled by the volts per count, nfft values */
+	double norm;									/*!< 1/(fs*sum(w^2)), two-sided density of a squared magnitude */
+	DSP_COMPLEX *work;								/*!< DSP_PSD_BATCH segment pairs */
+	float *sq;										/*!< squares of the real and imaginary parts of the transforms of the frame, 2*nfft values */
+	double *avg;									/*!< averaged two-sided density of the bins 0..nfft/2, V^2/Hz */
+	unsigned long frames;							/*!< frames averaged */
+	unsigned int segments;							/*!< segments of the last frame */
+} DSP_PSD;
+
+/* error codes */
+#define DSP_PSD_ERR_OK				0				/*!< No error encountered during execution. */
+#define DSP_PSD_ERR_SIZE			-1				/*!< The segment length is not a power of 2, out of range, or the overlap not below it. */
+#define DSP_PSD_ERR_WINDOW			-2				/*!< The window is unknown. */
+#define DSP_PSD_ERR_ALLOC			-3				/*!< The plan or the buffers could not be allocated. */
+#define DSP_PSD_ERR_ARGUMENT		-4				/*!< An argument is NULL or out of range, or the engine has not been initialized. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize a spectrum estimator, no frame averaged.
+ *
+ * @param	psd	estimator to be initialized, released with dsp_psd_free().
+ * @param	nfft	samples per segment, power of 2 from DSP_PSD_MIN_NFFT to DSP_PSD_MAX_NFFT.
+ * @param	overlap	samples shared by two consecutive segments, 0..nfft-1.
+ * @param	window	DSP_PSD_WIN_RECT, DSP_PSD_WIN_HANN or DSP_PSD_WIN_BLACKMAN.
+ * @param	averages	frames of the running mean, 0 to average all the frames until dsp_psd_reset().
+ * @param	fs	sample clock, Hz.
+ * @param	lsb	volts per count of the samples.
+ * @return  - DSP_PSD_ERR_OK
+ *			- DSP_PSD_ERR_SIZE
+ *			- DSP_PSD_ERR_WINDOW
+ *			- DSP_PSD_ERR_ALLOC
+ *			- DSP_PSD_ERR_ARGUMENT
+ */
+int dsp_psd_init(DSP_PSD *psd, unsigned int nfft, unsigned int overlap, int window, unsigned int averages, float fs, float lsb);
+
+/**
+ * Estimate the spectrum of a frame of 16 bit samples and add it to the average.
+ *
+ * @param	psd	estimator initialized by dsp_psd_init().
+ * @param	sig	16 bit samples of the frame.
+ * @param	len	number of samples, at least 1.
+ * @return  - DSP_PSD_ERR_OK
+ *			- DSP_PSD_ERR_ARGUMENT
+ */
+int dsp_psd_frame16(DSP_PSD *psd, const short *sig, unsigned int len);
+
+/**
+ * Obtain the number of points dsp_psd_get() gives for a requested number of points. Every point but the last one
+ * covers the same number of bins, the smallest that brings the bins down to the points requested.
+ *
+ * @param	psd	estimator initialized by dsp_psd_init().
+ * @param	points	points requested, 0 for one per bin.
+ * @param	mode	DSP_PSD_WHOLE or 0.
+ * @return  the number of points, 0 when the estimator has not been initialized.
+ */
+unsigned int dsp_psd_points(const DSP_PSD *psd, unsigned int points, int mode);
+
+/**
+ * Obtain the averaged spectrum reduced to a number of points, all null before the first frame.
+ *
+ * @param	psd	estimator initialized by dsp_psd_init().
+ * @param	points	points requested, 0 for one per bin.
+ * @param	mode	DSP_PSD_WHOLE, DSP_PSD_PEAK and DSP_PSD_DB combined, 0 for the one-sided mean densities.
+ * @param	out	receives the dsp_psd_points() densities, V^2/Hz or dB.
+ * @param	first	receives the frequency of the first point, center of its bins, Hz.
+ * @param	step	receives the frequency between two points, Hz.
+ * @return  - DSP_PSD_ERR_OK
+ *			- DSP_PSD_ERR_ARGUMENT
+ */
+int dsp_psd_get(const DSP_PSD *psd, unsigned int points, int mode, float *out, float *first, float *step);
+
+/**
+ * Forget the frames averaged.
+ *
+ * @param	psd	estimator initialized by dsp_psd_init().
+ */
+void dsp_psd_reset(DSP_PSD *psd);
+
+/**
+ * Release the buffers of an estimator, it may be initialized again afterwards.
+ *
+ * @param	psd	estimator initialized by dsp_psd_init(), or cleared with memset().
+ */
+void dsp_psd_free(DSP_PSD *psd);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_PSD_H_
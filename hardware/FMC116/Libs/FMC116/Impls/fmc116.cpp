@@ -9,13 +9,18 @@
 ///////////////////////////////////////////////////////////////////////////////////
 #include <windows.h>
 #include <stdlib.h>
+#include <string.h>
 #include "FMC116.h"
 #include "sipif.h"
 #include "cid.h"
 
 int FMC116_init(unsigned long bar_cpld, unsigned long bar_clk, unsigned long bar_adc0, unsigned long bar_adc1, unsigned long bar_adc2, unsigned long bar_adc3,
-				unsigned long bar_adc_phy, unsigned long bar_dac0, unsigned long bar_dac1, unsigned long bar_mon, unsigned int clockmode, unsigned int nbrch)
+				unsigned long bar_adc_phy, unsigned long bar_dac0, unsigned long bar_dac1, unsigned long bar_mon, unsigned int clockmode, unsigned int nbrch,
+				FMC116_ADC_TRAINING *training)
 {
+	FMC116_ADC_TRAINING local;
+	FMC116_CALIB calib;
+	int save = 1;
 
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Initialize CPLD
@@ -35,12 +40,30 @@ int FMC116_init(unsigned long bar_cpld, unsigned long bar_clk, unsigned long bar
 
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Configure ADC
-	if(FMC116_adc_init(bar_adc0, bar_adc1, bar_adc2, bar_adc3, bar_adc_phy, nbrch)!=FMC116_ADC_ERR_OK) {
+	if(training==NULL)
+		training = &local;
+	if(FMC116_adc_init(bar_adc0, bar_adc1, bar_adc2, bar_adc3, bar_adc_phy, nbrch, training)!=FMC116_ADC_ERR_OK) {
 		printf("Could not initialize FMC116.ADC\n");
 		sipif_free();
 		return FMC116_ERR_ADC_INIT;
 	}
 
+	// Compare the IDELAY taps with the snapshot of the previous run, a change points at a marginal link
+	if(FMC116_calib_load(clockmode, &calib)==FMC116_CALIB_ERR_OK) {
+		if(calib.nbregs==training->nbregs && memcmp(calib.taps, training->taps, sizeof(calib.taps))==0) {
+			printf("IDELAY taps match the FMC116 calibration snapshot\n");
+			save = 0;
+		}
+		else
+			printf("IDELAY taps differ from the FMC116 calibration snapshot\n");
+	}
+	if(save) {
+		calib.nbregs = training->nbregs;
+		memcpy(calib.taps, training->taps, sizeof(calib.taps));
+		if(FMC116_calib_save(clockmode, &calib)!=FMC116_CALIB_ERR_OK)
+			printf("Could not save FMC116 calibration snapshot\n");
+	}
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Configure DAC
 	if(FMC116_dac_init(bar_dac0, bar_dac1)!=FMC116_ADC_ERR_OK) {
@@ -10,91 +10,92 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "FMC116_adc.h"
 #include "sipif.h"
-
-
-int FMC116_adc_init(unsigned long bar_adc0, unsigned long bar_adc1, unsigned long bar_adc2, unsigned long bar_adc3, unsigned long bar_adc_phy, unsigned int nbrch) 
+#include "regtable.h"
+
+
+/**
+ * ADC chip setup, the test pattern is enabled for the training ( offsets relative to ADCxSPI )
+ */
+static const REGTABLE_ENTRY g_adc_setup[] = {
+	REG_WR(0x00, 0x80),			//reset
+	REG_DELAY(1),
+	REG_WR(0x01, 0x20),			//two's complement
+	REG_WR(0x02, 0x00),
+	REG_WR(0x03, 0xBF),			//Pattern on, bit 13..8
+	REG_WR(0x04, 0xC0),			//bit 7..0
+};
+
+/**
+ * ADC phy reset and training start ( offsets relative to ADCPHY )
+ */
+static const REGTABLE_ENTRY g_adc_phy_training[] = {
+	REG_WR(0x00, 0x03),			//Reset clock buffer and iDelays first
+	REG_DELAY(10),
+	REG_WR(0x00, 0x04),			//then reset iSerdes, when the clocks are stable
+	REG_DELAY(10),
+	REG_WR(0x00, 0x08),			//Start training
+};
+
+/**
+ * ADC phy training restart, the clocks are stable already ( offsets relative to ADCPHY )
+ */
+static const REGTABLE_ENTRY g_adc_phy_retraining[] = {
+	REG_WR(0x00, 0x02),			//Reset iDelays
+	REG_DELAY(1),
+	REG_WR(0x00, 0x04),			//Reset iSerdes
+	REG_WR(0x00, 0x08),			//Start training
+};
+
+int FMC116_adc_init(unsigned long bar_adc0, unsigned long bar_adc1, unsigned long bar_adc2, unsigned long bar_adc3, unsigned long bar_adc_phy, unsigned int nbrch,
+					FMC116_ADC_TRAINING *training) 
 {
 
-	unsigned long dword;
+	unsigned long bar_adc[4] = { bar_adc0, bar_adc1, bar_adc2, bar_adc3 };
+	SIPIF_REGOP pattern_off[4];
+	FMC116_ADC_TRAINING local;
 	int rc;
 	
-	//ADC0
-	sipif_writesipreg(bar_adc0+0x00, 0x80);	Sleep(2); //reset
-	sipif_writesipreg(bar_adc0+0x01, 0x20);	Sleep(2); //two's complement
-	sipif_writesipreg(bar_adc0+0x02, 0x00);	Sleep(2);
-	sipif_writesipreg(bar_adc0+0x03, 0xBF);	Sleep(2); //Pattern on, bit 13..8
-	sipif_writesipreg(bar_adc0+0x04, 0xC0);	Sleep(2); //bit 7..0
-
-	//ADC1
-	sipif_writesipreg(bar_adc1+0x00, 0x80);	Sleep(2); //reset
-	sipif_writesipreg(bar_adc1+0x01, 0x20);	Sleep(2); //two's complement
-	sipif_writesipreg(bar_adc1+0x02, 0x00);	Sleep(2);
-	sipif_writesipreg(bar_adc1+0x03, 0xBF);	Sleep(2); //Pattern on, bit 13..8
-	sipif_writesipreg(bar_adc1+0x04, 0xC0);	Sleep(2); //bit 7..0
-
-	//ADC2
-	sipif_writesipreg(bar_adc2+0x00, 0x80);	Sleep(2); //reset
-	sipif_writesipreg(bar_adc2+0x01, 0x20);	Sleep(2); //two's complement
-	sipif_writesipreg(bar_adc2+0x02, 0x00);	Sleep(2);
-	sipif_writesipreg(bar_adc2+0x03, 0xBF);	Sleep(2); //Pattern on, bit 13..8
-	sipif_writesipreg(bar_adc2+0x04, 0xC0);	Sleep(2); //bit 7..0
-
-	//ADC3
-	sipif_writesipreg(bar_adc3+0x00, 0x80);	Sleep(2); //reset
-	sipif_writesipreg(bar_adc3+0x01, 0x20);	Sleep(2); //two's complement
-	sipif_writesipreg(bar_adc3+0x02, 0x00);	Sleep(2);
-	sipif_writesipreg(bar_adc3+0x03, 0xBF);	Sleep(2); //Pattern on, bit 13..8
-	sipif_writesipreg(bar_adc3+0x04, 0xC0);	Sleep(2); //bit 7..0
-
-//while (1)
-//{
-
-	//Reset clock buffer and iDelays first
-	rc = sipif_writesipreg(bar_adc_phy+0, 0x03); Sleep(10);
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
+	if(training==NULL)
+		training = &local;
+	memset(training, 0, sizeof(*training));
+
+	//ADC0..ADC3
+	for (int i = 0; i < 4; i++) {
+		rc = regtable_run(bar_adc[i], g_adc_setup, REGTABLE_SIZE(g_adc_setup));
+		if(rc!=REGTABLE_ERR_OK)
+			return rc;
+	}
 
-	//then reset iSerdes, when the clocks are stable
-	rc = sipif_writesipreg(bar_adc_phy+0, 0x04); Sleep(10);
-	if(rc!=SIPIF_ERR_OK)
+	//Reset phy and start training, restart with the iDelays reset until the phy reports ready
+	rc = regtable_run(bar_adc_phy, g_adc_phy_training, REGTABLE_SIZE(g_adc_phy_training));
+	for(training->attempts = 1; ; training->attempts++) {
+		if(rc!=REGTABLE_ERR_OK)
+			return rc;
+		rc = regtable_wait(bar_adc_phy+0, 0x1, 0x1, FMC116_ADC_TRAINING_TIMEOUT_MS, &training->trainus);
+		if(rc!=REGTABLE_ERR_WAIT_TIMEOUT)
+			break;
+		if(training->attempts==FMC116_ADC_TRAINING_ATTEMPTS)
+			return FMC116_ADC_ERR_TRAINING_TIMEOUT;
+		rc = regtable_run(bar_adc_phy, g_adc_phy_retraining, REGTABLE_SIZE(g_adc_phy_retraining));
+	}
+	if(rc!=REGTABLE_ERR_OK)
 		return rc;
 
-	//Start training
-	printf("Training status : ");
-	rc = sipif_writesipreg(bar_adc_phy+0, 0x08); Sleep(10);
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_readsipreg(bar_adc_phy+0, &dword);
+	//Pattern off
+	for (int i = 0; i < 4; i++) {
+		pattern_off[i].op = SIPIF_OP_WRITE;
+		pattern_off[i].addr = bar_adc[i]+0x03;
+		pattern_off[i].value = 0x00;
+	}
+	rc = sipif_transact(pattern_off, 4);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
-	if((dword&0x1)==0x1)
-		printf("Ready\n");
-	else 
-		printf("Busy\n");
-	
-/*	while ((dword&0x1)!=0x1)
-	{
-		rc = sipif_writesipreg(bar_adc_phy+0, 0x02); Sleep(10);
-		rc = sipif_readsipreg(bar_adc_phy+0, &dword);
-		if((dword&0x1)==0x1)
-			printf("_Ready\n");
-		else
-			printf("_Busy\n");
-	} */
-		
-	Sleep (1000);
-//}
-
-	sipif_writesipreg(bar_adc0+0x03, 0x00);	Sleep(2); //Pattern off
-	sipif_writesipreg(bar_adc1+0x03, 0x00);	Sleep(2); //Pattern off
-	sipif_writesipreg(bar_adc2+0x03, 0x00);	Sleep(2); //Pattern off
-	sipif_writesipreg(bar_adc3+0x03, 0x00);	Sleep(2); //Pattern off
-
-	// Print IDELAY state
-	printf("--------------------------------------\n");
-	rc = fmc116_idelay_state(bar_adc_phy, nbrch);
+
+	// Read IDELAY state
+	rc = fmc116_idelay_state(bar_adc_phy, nbrch, training);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
 
@@ -131,25 +132,30 @@ int FMC116_dac_init(unsigned long bar_dac0, unsigned long bar_dac1)
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Function for IDELAY state printing
-int fmc116_idelay_state(unsigned long bar_adc_phy, unsigned int nbrch)
+// Function for IDELAY state reading
+int fmc116_idelay_state(unsigned long bar_adc_phy, unsigned int nbrch, FMC116_ADC_TRAINING *training)
 {
-	unsigned long dword;
+	unsigned long dword[FMC116_ADC_IDELAY_REGS];
 	int rc;
-	int nbregs = 8;
+	int nbregs = FMC116_ADC_IDELAY_REGS;
 	
+	if(training==NULL)
+		return FMC116_ADC_ERR_NULL_ARGUMENT;
+
 	if (nbrch == 12)
       nbregs = 6;
 
+	rc = sipif_readsipregs(bar_adc_phy+8, nbregs, dword);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
 	for (int i=0; i<nbregs; i++)
 	{
-		//printf("IDELAY Ch %d: ", i);
-		rc = sipif_readsipreg(bar_adc_phy+8+i, &dword);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		printf("%2d | %2d | %2d | %2d | ", (dword>>0)&0xFF, (dword>>8)&0xFF, (dword>>16)&0xFF, (dword>>24)&0xFF );
-
+		training->taps[i][0] = (unsigned char)((dword[i]>>0)&0xFF);
+		training->taps[i][1] = (unsigned char)((dword[i]>>8)&0xFF);
+		training->taps[i][2] = (unsigned char)((dword[i]>>16)&0xFF);
+		training->taps[i][3] = (unsigned char)((dword[i]>>24)&0xFF);
 	}
+	training->nbregs = nbregs;
 
 	return FMC116_ADC_ERR_OK;
 }
@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc116_calib.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief FMC116_calib module to keep the FMC116 calibration between runs (implementation)
+///
+/// This module saves the IDELAY taps found by the ADC training to a snapshot
+/// file and reads them back on the next start. A snapshot is only valid for the
+/// firmware build, the constellation and the clock mode it was taken with, these
+/// are part of the file name and are checked again when loading.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <stdio.h>
+#include "fmc116_calib.h"
+#include "cid.h"
+
+/**
+ * Build the snapshot file name, one file per firmware build, constellation and clock mode.
+ */
+static void FMC116_calib_filename(unsigned int clockmode, char *filename)
+{
+	sprintf(filename, "fmc116_calib_%08lX_%04X_%u.bin", cid_getfwbuildcode(), cid_getconstellationid(), clockmode);
+}
+
+int FMC116_calib_load(unsigned int clockmode, FMC116_CALIB *calib)
+{
+	char filename[64];
+	FILE *file;
+	size_t n;
+
+	// check if arguments are valid
+	if(calib==NULL)
+		return FMC116_CALIB_ERR_NULL_ARGUMENT;
+
+	FMC116_calib_filename(clockmode, filename);
+	file = fopen(filename, "rb");
+	if(file==NULL)
+		return FMC116_CALIB_ERR_NOT_FOUND;
+	n = fread(calib, sizeof(*calib), 1, file);
+	fclose(file);
+
+	// the file name could have been reused by hand, trust the content only
+	if(n!=1 || calib->magic!=FMC116_CALIB_MAGIC || calib->fwbuild!=cid_getfwbuildcode() ||
+		calib->constellationid!=cid_getconstellationid() || calib->clockmode!=clockmode)
+		return FMC116_CALIB_ERR_NOT_FOUND;
+
+	return FMC116_CALIB_ERR_OK;
+}
+
+int FMC116_calib_save(unsigned int clockmode, FMC116_CALIB *calib)
+{
+	char filename[64];
+	FILE *file;
+	size_t n;
+
+	// check if arguments are valid
+	if(calib==NULL)
+		return FMC116_CALIB_ERR_NULL_ARGUMENT;
+
+	calib->magic = FMC116_CALIB_MAGIC;
+	calib->fwbuild = cid_getfwbuildcode();
+	calib->constellationid = cid_getconstellationid();
+	calib->clockmode = clockmode;
+
+	FMC116_calib_filename(clockmode, filename);
+	file = fopen(filename, "wb");
+	if(file==NULL)
+		return FMC116_CALIB_ERR_FILE;
+	n = fwrite(calib, sizeof(*calib), 1, file);
+	if(fclose(file)!=0 || n!=1)
+		return FMC116_CALIB_ERR_FILE;
+
+	return FMC116_CALIB_ERR_OK;
+}
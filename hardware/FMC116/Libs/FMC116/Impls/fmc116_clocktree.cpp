@@ -12,13 +12,194 @@
 #include <windows.h>
 #include "FMC116_clocktree.h"
 #include "sipif.h"
+#include "regtable.h"
 #include "cid.h"
 
 #define CONSTELLATION_ID_ML605_FMC116		0xFF			/*!< firmware(constellation) ID for FMC116 is 131 */
 
+static unsigned long g_vcocalus = 0;		/*!< time it took for the VCO calibration to finish during the last FMC116_clocktree_init() */
+static unsigned long g_lockus = 0;			/*!< time it took for the PLL to lock during the last FMC116_clocktree_init() */
+
+/**
+ * Internal clock with internal reference. Onboard reference is 100MHz
+ */
+static const REGTABLE_ENTRY g_clocktree_intclk_intref[] = {
+	REG_WR(0x010, 0x7C),		//CP 4.8mA, normal op.
+	REG_WR(0x011, 10),			//R lo
+	REG_WR(0x012, 0),			//R hi
+	REG_WR(0x013, 8),			//A
+	REG_WR(0x014, 12),			//B lo
+	REG_WR(0x015, 0),			//B hi
+	REG_WR(0x016, 0x05),		//presc. DM16
+	REG_WR(0x017, 0xB4),		//STATUS = DLD
+	REG_WR(0x018, 0x00),		//VCO Cal. off, started at the end of the table
+
+	REG_WR(0x019, 0x00),
+	REG_WR(0x01A, 0x00),		//LD = DLD
+	REG_WR(0x01B, 0x00),		//REFMON = GND
+	REG_WR(0x01C, 0x87),		//Diff ref input
+	REG_WR(0x01D, 0x00),
+
+	REG_WR(0x0F0, 0x0C),		//out0, adc1, lvpecl 960mW
+	REG_WR(0x0F1, 0x0C),		//out1, adc2, lvpecl 960mW
+
+	REG_WR(0x0F4, 0x0C),		//out2, adc3, lvpecl 960mW
+	REG_WR(0x0F5, 0x0C),		//out3, adc0, lvpecl 960mW
+
+	REG_WR(0x140, 0x00),		//out4, external clock output
+	REG_WR(0x141, 0x01),		//out5, unused, pd
+	REG_WR(0x142, 0x00),		//out6, clock to FPGA
+	REG_WR(0x143, 0x01),		//out7, unused, pd
+
+	REG_WR(0x190, 0x33),		//div0, clock to ADCs, /8
+	REG_WR(0x191, 0x00),		//div0, clock to ADCs, divider used
+	REG_WR(0x192, 0x00),		//div0, clock to ADCs, divider to output
+
+	REG_WR(0x196, 0x33),		//div1, clock to ADCs, /8
+	REG_WR(0x197, 0x00),		//div1, clock to ADCs, divider used
+	REG_WR(0x198, 0x00),		//div1, clock to ADCs, divider to output
+
+	REG_WR(0x199, 0x33),		//div2.1, /8
+	REG_WR(0x19A, 0x00),		//phase
+	REG_WR(0x19B, 0x00),		//div2.2, /2
+	REG_WR(0x19C, 0x20),		//div2.1 on, div2.2 bypassed
+	REG_WR(0x19D, 0x00),		//div2 dcc on
+
+	REG_WR(0x19E, 0x33),		//div3.1, /8
+	REG_WR(0x19F, 0x00),		//phase
+	REG_WR(0x1A0, 0x00),		//div3.2, /2
+	REG_WR(0x1A1, 0x20),		//div3.1 on, div3.2 bypassed
+	REG_WR(0x1A2, 0x00),		//div3 dcc on
+
+	REG_WR(0x1E0, 0x00),		//vco div /2
+	REG_WR(0x1E1, 0x02),		//use internal vco with vco divider
+
+	REG_WR(0x230, 0x00),		//no pwd, no sync
+	REG_WR(0x232, 0x01),		//update
+
+	REG_WR(0x018, 0x01),		//VCO Cal., starts on the 0 to 1 transition
+	REG_WR(0x232, 0x01),		//update
+};
+
+/**
+ * Internal clock with external reference. Expecting 10MHz external reference
+ */
+static const REGTABLE_ENTRY g_clocktree_intclk_extref[] = {
+	REG_WR(0x010, 0x7C),		//CP 4.8mA, normal op.
+	REG_WR(0x011, 1),			//R lo,
+	REG_WR(0x012, 0),			//R hi
+	REG_WR(0x013, 8),			//A
+	REG_WR(0x014, 12),			//B lo
+	REG_WR(0x015, 0),			//B hi
+	REG_WR(0x016, 0x05),		//presc. DM16
+	REG_WR(0x017, 0xB4),		//STATUS = DLD
+	REG_WR(0x018, 0x00),		//VCO Cal. off, started at the end of the table
+
+	REG_WR(0x019, 0x00),
+	REG_WR(0x01A, 0x00),		//LD = DLD
+	REG_WR(0x01B, 0x00),		//REFMON = GND
+	REG_WR(0x01C, 0x87),		//Diff ref input
+	REG_WR(0x01D, 0x00),
+
+	REG_WR(0x0F0, 0x0C),		//out0, adc1, lvpecl 960mW
+	REG_WR(0x0F1, 0x0C),		//out1, adc2, lvpecl 960mW
+
+	REG_WR(0x0F4, 0x0C),		//out2, adc3, lvpecl 960mW
+	REG_WR(0x0F5, 0x0C),		//out3, adc0, lvpecl 960mW
+
+	REG_WR(0x140, 0x00),		//out4, external clock output
+	REG_WR(0x141, 0x01),		//out5, unused, pd
+	REG_WR(0x142, 0x00),		//out6, clock to FPGA
+	REG_WR(0x143, 0x01),		//out7, unused, pd
+
+	REG_WR(0x190, 0x33),		//div0, clock to ADCs, /8
+	REG_WR(0x191, 0x00),		//div0, clock to ADCs, divider used
+	REG_WR(0x192, 0x00),		//div0, clock to ADCs, divider to output
+
+	REG_WR(0x196, 0x33),		//div1, clock to ADCs, /8
+	REG_WR(0x197, 0x00),		//div1, clock to ADCs, divider used
+	REG_WR(0x198, 0x00),		//div1, clock to ADCs, divider to output
+
+	REG_WR(0x199, 0x33),		//div2.1, /8
+	REG_WR(0x19A, 0x00),		//phase
+	REG_WR(0x19B, 0x00),		//div2.2, /2
+	REG_WR(0x19C, 0x20),		//div2.1 on, div2.2 bypassed
+	REG_WR(0x19D, 0x00),		//div2 dcc on
+
+	REG_WR(0x19E, 0x33),		//div3.1, /8
+	REG_WR(0x19F, 0x00),		//phase
+	REG_WR(0x1A0, 0x00),		//div3.2, /2
+	REG_WR(0x1A1, 0x20),		//div3.1 on, div3.2 bypassed
+	REG_WR(0x1A2, 0x00),		//div3 dcc on
+
+	REG_WR(0x1E0, 0x00),		//vco div /2
+	REG_WR(0x1E1, 0x02),		//use internal vco with vco divider
+
+	REG_WR(0x230, 0x00),		//no pwd, no sync
+	REG_WR(0x232, 0x01),		//update
+
+	REG_WR(0x018, 0x01),		//VCO Cal., starts on the 0 to 1 transition
+	REG_WR(0x232, 0x01),		//update
+};
+
+/**
+ * External clock, the PLL is powered down and the clock goes straight to the dividers
+ */
+static const REGTABLE_ENTRY g_clocktree_extclk[] = {
+	REG_WR(0x010, 0x7D),		//CP 4.8mA, PLL power down
+
+	REG_WR(0x017, 0xB4),		//STATUS = DLD
+
+	REG_WR(0x019, 0x00),
+	REG_WR(0x01A, 0x00),		//LD = DLD
+	REG_WR(0x01B, 0x00),		//REFMON = GND
+	REG_WR(0x01C, 0x87),		//Diff ref input
+	REG_WR(0x01D, 0x00),
+
+	REG_WR(0x0F0, 0x0C),		//out0, adc1, lvpecl 960mW
+	REG_WR(0x0F1, 0x0C),		//out1, adc2, lvpecl 960mW
+
+	REG_WR(0x0F4, 0x0C),		//out2, adc3, lvpecl 960mW
+	REG_WR(0x0F5, 0x0C),		//out3, adc0, lvpecl 960mW
+
+	REG_WR(0x140, 0x00),		//out4, external clock output
+	REG_WR(0x141, 0x01),		//out5, unused, pd
+	REG_WR(0x142, 0x00),		//out6, clock to FPGA
+	REG_WR(0x143, 0x01),		//out7, unused, pd
+
+	REG_WR(0x190, 0x00),		//div0, clock to ADCs, /2
+	REG_WR(0x191, 0x80),		//div0, clock to ADCs, divider bypased
+	REG_WR(0x192, 0x02),		//div0, clock to ADCs, direct to output
+
+	REG_WR(0x196, 0x00),		//div1, clock to ADCs, /2
+	REG_WR(0x197, 0x80),		//div1, clock to ADCs, divider bypassed
+	REG_WR(0x198, 0x02),		//div1, clock to ADCs, direct to output
+
+	REG_WR(0x199, 0x00),		//div2.1, /2
+	REG_WR(0x19A, 0x00),		//phase
+	REG_WR(0x19B, 0x00),		//div2.2, /2
+	REG_WR(0x19C, 0x30),		//div2.1 bypassed, div2.2 bypassed
+	REG_WR(0x19D, 0x00),		//div2 dcc on
+
+	REG_WR(0x19E, 0x00),		//div3.1, /2
+	REG_WR(0x19F, 0x00),		//phase
+	REG_WR(0x1A0, 0x00),		//div3.2, /2
+	REG_WR(0x1A1, 0x30),		//div3.1 bypassed, div3.2 bypassed
+	REG_WR(0x1A2, 0x00),		//div3 dcc on
+
+	REG_WR(0x1E0, 0x00),		//vco div /2
+	REG_WR(0x1E1, 0x01),		//use external clock with divider bypassed
+
+	REG_WR(0x230, 0x00),		//no pwd, no sync
+	REG_WR(0x232, 0x01),		//update
+};
+
+
 int FMC116_clocktree_init(unsigned long bar, unsigned int clockmode) 
 {
 
+	unsigned long long start;
+	unsigned int elapsedms;
 	unsigned long dword;
 	int rc;
 
@@ -29,445 +210,59 @@ int FMC116_clocktree_init(unsigned long bar, unsigned int clockmode)
 	if ((dword&0xFF)!=FMC116_CLOCKTREE_PART_ID_3)
 		return FMC116_CLOCKTREE_ERR_WRONG_PART_ID;
 		
-	///////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Internal clock with External Reference
-	// Onboard reference is 100MHz
 	if(clockmode==CLOCKTREE_INTCLK_INTREF) {
-		
 		printf("Clock tree uses internal clock with internal reference.\n");
-		rc = sipif_writesipreg(bar+0x010, 0x7C); Sleep(2); //CP 4.8mA, normal op.
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x011,   10); Sleep(2); //R lo
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x012,    0); Sleep(2); //R hi
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x013,    8); Sleep(2); //A
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x014,   12); Sleep(2); //B lo
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x015,    0); Sleep(2); //B hi
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x016, 0x05); Sleep(2); //presc. DM16
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x017, 0xB4); Sleep(2); //STATUS = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x018, 0x01); Sleep(2); //VCO Cal.
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x019, 0x00); Sleep(2);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01A, 0x00); Sleep(2); //LD = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01B, 0x00); Sleep(2); //REFMON = GND
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01C, 0x87); Sleep(2); //Diff ref input
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01D, 0x00); Sleep(2);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F0, 0x0C); Sleep(2); //out0, adc1, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F1, 0x0C); Sleep(2); //out1, adc2, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F4, 0x0C); Sleep(2); //out2, adc3, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F5, 0x0C); Sleep(2); //out3, adc0, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x140, 0x00); Sleep(2); //out4, external clock output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x141, 0x01); Sleep(2); //out5, unused, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x142, 0x00); Sleep(2); //out6, clock to FPGA
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x143, 0x01); Sleep(2); //out7, unused, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x190, 0x33); Sleep(2); //div0, clock to ADCs, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x191, 0x00); Sleep(2); //div0, clock to ADCs, divider used
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x192, 0x00); Sleep(2); //div0, clock to ADCs, divider to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x196, 0x33); Sleep(2); //div1, clock to ADCs, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x197, 0x00); Sleep(2); //div1, clock to ADCs, divider used
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x198, 0x00); Sleep(2); //div1, clock to ADCs, divider to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x199, 0x33); Sleep(2); //div2.1, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19A, 0x00); Sleep(2); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19B, 0x00); Sleep(2); //div2.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19C, 0x20); Sleep(2); //div2.1 on, div2.2 bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19D, 0x00); Sleep(2); //div2 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x19E, 0x33); Sleep(2); //div3.1, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19F, 0x00); Sleep(2); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A0, 0x00); Sleep(2); //div3.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A1, 0x20); Sleep(2); //div3.1 on, div3.2 bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A2, 0x00); Sleep(2); //div3 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x1E0, 0x00); Sleep(2); //vco div /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1E1, 0x02); Sleep(2); //use internal vco with vco divider
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x230, 0x00); Sleep(2); //no pwd, no sync
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x232, 0x01); Sleep(2); //update 
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		Sleep(20);
-
-		// verify PLL status
-		rc = sipif_readsipreg(bar+0x1F, &dword);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		if((dword&0x01)!=0x01){
-			printf("PLL not locked!!!\n");
-			return FMC116_CLOCKTREE_ERR_CLK0_PLL_NOT_LOCKED;
-		} else {
-			printf("PLL locked!!!\n");
-		}
-
+		rc = regtable_run(bar, g_clocktree_intclk_intref, REGTABLE_SIZE(g_clocktree_intclk_intref));
 	}
-	///////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Internal clock with External Reference
-	// Expecting 10MHz external reference
 	else if(clockmode==CLOCKTREE_INTCLK_EXTREF) {
-
 		printf("Clock tree uses internal clock with external reference.\n");
-
-		rc = sipif_writesipreg(bar+0x010, 0x7C); Sleep(2); //CP 4.8mA, normal op.
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x011,    1); Sleep(2); //R lo,
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x012,    0); Sleep(2); //R hi
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x013,    8); Sleep(2); //A
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x014,   12); Sleep(2); //B lo
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x015,    0); Sleep(2); //B hi
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x016, 0x05); Sleep(2); //presc. DM16
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x017, 0xB4); Sleep(2); //STATUS = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x018, 0x01); Sleep(2); //VCO Cal.
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x019, 0x00); Sleep(2);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01A, 0x00); Sleep(2); //LD = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01B, 0x00); Sleep(2); //REFMON = GND
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01C, 0x87); Sleep(2); //Diff ref input
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01D, 0x00); Sleep(2);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F0, 0x0C); Sleep(2); //out0, adc1, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F1, 0x0C); Sleep(2); //out1, adc2, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F4, 0x0C); Sleep(2); //out2, adc3, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F5, 0x0C); Sleep(2); //out3, adc0, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x140, 0x00); Sleep(2); //out4, external clock output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x141, 0x01); Sleep(2); //out5, unused, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x142, 0x00); Sleep(2); //out6, clock to FPGA
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x143, 0x01); Sleep(2); //out7, unused, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x190, 0x33); Sleep(2); //div0, clock to ADCs, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x191, 0x00); Sleep(2); //div0, clock to ADCs, divider used
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x192, 0x00); Sleep(2); //div0, clock to ADCs, divider to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x196, 0x33); Sleep(2); //div1, clock to ADCs, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x197, 0x00); Sleep(2); //div1, clock to ADCs, divider used
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x198, 0x00); Sleep(2); //div1, clock to ADCs, divider to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x199, 0x33); Sleep(2); //div2.1, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19A, 0x00); Sleep(2); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19B, 0x00); Sleep(2); //div2.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19C, 0x20); Sleep(2); //div2.1 on, div2.2 bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19D, 0x00); Sleep(2); //div2 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x19E, 0x33); Sleep(2); //div3.1, /8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19F, 0x00); Sleep(2); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A0, 0x00); Sleep(2); //div3.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A1, 0x20); Sleep(2); //div3.1 on, div3.2 bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A2, 0x00); Sleep(2); //div3 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x1E0, 0x00); Sleep(2); //vco div /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1E1, 0x02); Sleep(2); //use internal vco with vco divider
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x230, 0x00); Sleep(2); //no pwd, no sync
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x232, 0x01); Sleep(2); //update 
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		Sleep(20);
-
-		// verify PLL status
-		rc = sipif_readsipreg(bar+0x1F, &dword);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		if((dword&0x01)!=0x01){
-			printf("PLL not locked!!!\n");
-			return FMC116_CLOCKTREE_ERR_CLK0_PLL_NOT_LOCKED;
-		} else {
-			printf("PLL locked!!!\n");
-		}
-
+		rc = regtable_run(bar, g_clocktree_intclk_extref, REGTABLE_SIZE(g_clocktree_intclk_extref));
 	}
-	///////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// External clock
 	else {
-
 		printf("Clock tree uses external clock.\n");
+		rc = regtable_run(bar, g_clocktree_extclk, REGTABLE_SIZE(g_clocktree_extclk));
+	}
+	if(rc!=REGTABLE_ERR_OK)
+		return rc;
 
-		rc = sipif_writesipreg(bar+0x010, 0x7D); Sleep(2); //CP 4.8mA, PLL power down
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x017, 0xB4); Sleep(2); //STATUS = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x019, 0x00); Sleep(2);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01A, 0x00); Sleep(2); //LD = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01B, 0x00); Sleep(2); //REFMON = GND
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01C, 0x87); Sleep(2); //Diff ref input
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01D, 0x00); Sleep(2);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F0, 0x0C); Sleep(2); //out0, adc1, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F1, 0x0C); Sleep(2); //out1, adc2, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F4, 0x0C); Sleep(2); //out2, adc3, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F5, 0x0C); Sleep(2); //out3, adc0, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x140, 0x00); Sleep(2); //out4, external clock output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x141, 0x01); Sleep(2); //out5, unused, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x142, 0x00); Sleep(2); //out6, clock to FPGA
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x143, 0x01); Sleep(2); //out7, unused, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x190, 0x00); Sleep(2); //div0, clock to ADCs, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x191, 0x80); Sleep(2); //div0, clock to ADCs, divider bypased
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x192, 0x02); Sleep(2); //div0, clock to ADCs, direct to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x196, 0x00); Sleep(2); //div1, clock to ADCs, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x197, 0x80); Sleep(2); //div1, clock to ADCs, divider bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x198, 0x02); Sleep(2); //div1, clock to ADCs, direct to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x199, 0x00); Sleep(2); //div2.1, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19A, 0x00); Sleep(2); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19B, 0x00); Sleep(2); //div2.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19C, 0x30); Sleep(2); //div2.1 bypassed, div2.2 bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19D, 0x00); Sleep(2); //div2 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x19E, 0x00); Sleep(2); //div3.1, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19F, 0x00); Sleep(2); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A0, 0x00); Sleep(2); //div3.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A1, 0x30); Sleep(2); //div3.1 bypassed, div3.2 bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A2, 0x00); Sleep(2); //div3 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x1E0, 0x00); Sleep(2); //vco div /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1E1, 0x01); Sleep(2); //use external clock with divider bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x230, 0x00); Sleep(2); //no pwd, no sync
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x232, 0x01); Sleep(2); //update 
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
+	g_vcocalus = 0;
+	g_lockus = 0;
 
+	// the PLL is powered down in external clock mode, nothing to wait for
+	if(clockmode==CLOCKTREE_EXTCLK)
+		return FMC116_CLOCKTREE_ERR_OK;
+
+	// the update starts the VCO calibration, the PLL can only lock once it is finished
+	start = regtable_gettimeus();
+	rc = regtable_wait(bar+0x1F, 0x40, 0x40, FMC116_CLOCKTREE_LOCK_TIMEOUT_MS, &g_vcocalus);
+	if(rc==REGTABLE_ERR_WAIT_TIMEOUT) {
+		printf("VCO calibration not finished!!!\n");
+		return FMC116_CLOCKTREE_ERR_VCO_CAL_TIMEOUT;
 	}
+	if(rc!=REGTABLE_ERR_OK)
+		return rc;
+
+	// wait for digital lock detect with whatever is left of the timeout
+	elapsedms = (unsigned int)((regtable_gettimeus()-start)/1000);
+	rc = regtable_wait(bar+0x1F, 0x01, 0x01, elapsedms<FMC116_CLOCKTREE_LOCK_TIMEOUT_MS ? FMC116_CLOCKTREE_LOCK_TIMEOUT_MS-elapsedms : 0, NULL);
+	if(rc==REGTABLE_ERR_WAIT_TIMEOUT) {
+		printf("PLL not locked!!!\n");
+		return FMC116_CLOCKTREE_ERR_CLK0_PLL_NOT_LOCKED;
+	}
+	if(rc!=REGTABLE_ERR_OK)
+		return rc;
+	g_lockus = (unsigned long)(regtable_gettimeus()-start);
+	printf("PLL locked!!! ( VCO calibration %lu us, lock %lu us )\n", g_vcocalus, g_lockus);
+
+	return FMC116_CLOCKTREE_ERR_OK;
+}
+
+int FMC116_clocktree_getlocktime(unsigned long *vcocalus, unsigned long *lockus)
+{
+	if(vcocalus)
+		*vcocalus = g_vcocalus;
+	if(lockus)
+		*lockus = g_lockus;
 
 	return FMC116_CLOCKTREE_ERR_OK;
-}
\ No newline at end of file
+}
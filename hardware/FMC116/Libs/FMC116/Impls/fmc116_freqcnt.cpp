@@ -10,48 +10,136 @@
 #include <windows.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "FMC116_freqcnt.h"
 #include "sipif.h"
 
+/**
+ * Convert a counter value to MHz, the counter counts the measured clock during 8192 periods of the 125 MHz reference.
+ */
+static float FMC116_freqcnt_tofrequency(unsigned long dword)
+{
+	// compute the frequency
+	float testClkPeriod = 1.0f/125.0f;
+	float tmp = 8192 * testClkPeriod;
+	tmp = (tmp / (dword + 1));
+	return 1.00f/tmp;
+}
+
+/**
+ * Display one measured frequency to the console.
+ */
+static void FMC116_freqcnt_display(unsigned int clksel, float freq)
+{
+	switch (clksel)
+	{
+	case 6	: printf("Trigger to FPGA : %6.2f MHz\n", freq); break;
+	case 5	: printf("Clock to FPGA   : %6.2f MHz\n", freq); break;                    
+	case 4	: printf("Clock ADC 3     : %6.2f MHz\n", freq); break;                    
+	case 3	: printf("Clock ADC 2     : %6.2f MHz\n", freq); break;
+	case 2	: printf("Clock ADC 1     : %6.2f MHz\n", freq); break;
+	case 1	: printf("Clock ADC 0     : %6.2f MHz\n", freq); break;
+	case 0	: printf("Command Clock   : %6.2f MHz\n", freq); break;
+	default	: printf("Frequency(%d)   : %6.2f MHz\n", clksel, freq); break;       
+	}
+}
+
 int FMC116_freqcnt_getfrequency(unsigned long bar, unsigned int clksel, float *freq, int outputconsole) 
 {
-	unsigned long dword;
+	float tmp;
 	int rc;
 
 	// tell the firmware to start a measure on a given clock index
-	rc = sipif_writesipreg(bar+0, clksel); Sleep(10);
+	rc = FMC116_freqcnt_select(bar, clksel); Sleep(FMC116_FREQCNT_MEASURE_MS);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
 
 	// read back the just measured value
-	rc = sipif_readsipreg(bar+1, &dword);
+	rc = FMC116_freqcnt_read(bar, &tmp);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
-
-	// compute the frequency
-	float testClkPeriod = 1.0f/125.0f;
-	float tmp = 8192 * testClkPeriod;
-	tmp = (tmp / (dword + 1));
-	tmp = 1.00f/tmp;
 	
 	// if we were asked to display to console then we do that
-	if(outputconsole) {
-		switch (clksel)
-		{
-		case 6	: printf("Trigger to FPGA : %6.2f MHz\n", tmp); break;
-		case 5	: printf("Clock to FPGA   : %6.2f MHz\n", tmp); break;                    
-		case 4	: printf("Clock ADC 3     : %6.2f MHz\n", tmp); break;                    
-		case 3	: printf("Clock ADC 2     : %6.2f MHz\n", tmp); break;
-		case 2	: printf("Clock ADC 1     : %6.2f MHz\n", tmp); break;
-		case 1	: printf("Clock ADC 0     : %6.2f MHz\n", tmp); break;
-		case 0	: printf("Command Clock   : %6.2f MHz\n", tmp); break;
-		default	: printf("Frequency(%d)   : %6.2f MHz\n", clksel, tmp); break;       
-		}
-	}
+	if(outputconsole)
+		FMC116_freqcnt_display(clksel, tmp);
 
 	// if the pointer passed as argument is not NULL we then update the memory pointed
 	if(freq!=NULL)
 		*freq = tmp;
 
 	return FMC116_FREQCNT_ERR_OK;
-}
\ No newline at end of file
+}
+
+int FMC116_freqcnt_select(unsigned long bar, unsigned int clksel)
+{
+	return sipif_writesipreg(bar+0, clksel);
+}
+
+int FMC116_freqcnt_read(unsigned long bar, float *freq)
+{
+	unsigned long dword;
+	int rc;
+
+	rc = sipif_readsipreg(bar+1, &dword);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
+
+	if(freq!=NULL)
+		*freq = FMC116_freqcnt_tofrequency(dword);
+
+	return FMC116_FREQCNT_ERR_OK;
+}
+
+int FMC116_freqcnt_sweep(unsigned long bar, unsigned int clkmask, FMC116_FREQCNT_SWEEP *sweep, int outputconsole)
+{
+	SIPIF_REGOP ops[2];
+	unsigned int pending = FMC116_FREQCNT_NB_CLOCKS;		// clock being measured, none yet
+	unsigned int n;
+	int rc;
+
+	// check if arguments are valid
+	if(sweep==NULL)
+		return FMC116_FREQCNT_ERR_NULL_ARGUMENT;
+	memset(sweep, 0, sizeof(*sweep));
+
+	// every round trip collects the pending measure and starts the next one, the last one only collects
+	for(unsigned int clksel = 0; clksel <= FMC116_FREQCNT_NB_CLOCKS; clksel++) {
+		if(clksel<FMC116_FREQCNT_NB_CLOCKS && !(clkmask&(1<<clksel)))
+			continue;
+
+		n = 0;
+		if(pending<FMC116_FREQCNT_NB_CLOCKS) {
+			ops[n].op = SIPIF_OP_READ;
+			ops[n].addr = bar+1;
+			ops[n].value = 0;
+			n++;
+		}
+		if(clksel<FMC116_FREQCNT_NB_CLOCKS) {
+			ops[n].op = SIPIF_OP_WRITE;
+			ops[n].addr = bar+0;
+			ops[n].value = clksel;
+			n++;
+		}
+		if(n==0)
+			break;
+		rc = sipif_transact(ops, n);
+		if(rc!=SIPIF_ERR_OK)
+			return rc;
+
+		// a clock that does not toggle leaves the counter at 0
+		if(pending<FMC116_FREQCNT_NB_CLOCKS && ops[0].value!=0) {
+			sweep->valid[pending] = 1;
+			sweep->frequency[pending] = FMC116_freqcnt_tofrequency(ops[0].value);
+			if(outputconsole)
+				FMC116_freqcnt_display(pending, sweep->frequency[pending]);
+		}
+		else if(pending<FMC116_FREQCNT_NB_CLOCKS && outputconsole)
+			printf("Frequency(%d)   : no clock\n", pending);
+
+		if(clksel<FMC116_FREQCNT_NB_CLOCKS)
+			Sleep(FMC116_FREQCNT_MEASURE_MS);
+		pending = clksel;
+	}
+
+	return FMC116_FREQCNT_ERR_OK;
+}
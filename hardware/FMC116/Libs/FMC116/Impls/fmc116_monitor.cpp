@@ -61,112 +61,144 @@ int FMC116_monitor_getDeviceDiags(unsigned long bar_mon, int deviceNum, ULONG* d
 								  float* chipTemp, float* vdd, float* ain1, float* ain2,
 								  float* ain3, float* ain4, float* ain5, float* ain6, float* ain7, float* ain8)
 {
+	ULONG ids[3];
+	float voltage[FMC116_MON_NB_VOLTAGES];
+	int rc;
+
 	// check to make sure device number is correct
 	if(deviceNum != FMC116_ADT_DEV)
 		return -3;
 
-	ULONG lsb, msb, test;
-	float Vref, Vtmp;
-
 	// set the starting register to offset from based on the ADT device
 	unsigned long start_reg = bar_mon-0x10000+0x14800;
 
 	// Read IDs from ADT
-	if(sipif_readsipreg(start_reg+0x4D, dev_id) == SIPIF_ERR_TIMEOUT) {
+	if(sipif_readsipregs(start_reg+0x4D, 3, ids) == SIPIF_ERR_TIMEOUT) {
 		sipif_free();
 		return -3;
 	}
-	if(sipif_readsipreg(start_reg+0x4E, man_id) == SIPIF_ERR_TIMEOUT) {
-		sipif_free(); 
+	*dev_id = ids[0];
+	*man_id = ids[1];
+	*silicon_rev = ids[2];
+
+	rc = FMC116_monitor_start(bar_mon);
+	if(rc == SIPIF_ERR_TIMEOUT) {
+		sipif_free();
 		return -3;
 	}
-	if(sipif_readsipreg(start_reg+0x4F, silicon_rev) == SIPIF_ERR_TIMEOUT) {
+	Sleep(FMC116_MON_FIRST_ROUND_MS);
+
+	rc = FMC116_monitor_read(bar_mon, chipTemp, voltage);
+	if(rc == SIPIF_ERR_TIMEOUT) {
 		sipif_free();
 		return -3;
 	}
+	*vdd  = voltage[0];
+	*ain1 = voltage[1];
+	*ain2 = voltage[2];
+	*ain3 = voltage[3];
+	*ain4 = voltage[4];
+	*ain5 = voltage[5];
+	*ain6 = voltage[6];
+	*ain7 = voltage[7];
+	*ain8 = voltage[8];
+
+	return FMC116_MON_ERR_OK;
+}
+
+int FMC116_monitor_start(unsigned long bar_mon)
+{
+	unsigned long start_reg = bar_mon-0x10000+0x14800;
+	int rc;
 
-	//Control configuration 1
-	sipif_writesipreg(start_reg+0x18, 0x29);
+	//Control configuration 1, the conversions run round robin from now on
+	rc = sipif_writesipreg(start_reg+0x18, 0x29);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
 	Sleep(100);
 	
 	//Control configuration 3	
-	sipif_writesipreg(start_reg+0x1A, 0x11); //Ext VREF
-	//sipif_writesipreg(start_reg+0x1A, 0x01); //Int VREF
-	Sleep(100);
+	rc = sipif_writesipreg(start_reg+0x1A, 0x11); //Ext VREF
+	//rc = sipif_writesipreg(start_reg+0x1A, 0x01); //Int VREF
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
+
+	return FMC116_MON_ERR_OK;
+}
+
+int FMC116_monitor_read(unsigned long bar_mon, float *chipTemp, float *voltage)
+{
+	ULONG regs[13];
+	ULONG lsb, msb;
+	float Vref, Vtmp;
+	int rc;
+
+	if(chipTemp==NULL || voltage==NULL)
+		return FMC116_MON_ERR_NULL_ARGUMENT;
+
+	unsigned long start_reg = bar_mon-0x10000+0x14800;
+
+	// Snapshot of all the conversion results, the LSB registers 0x03..0x05 come first and
+	// hold the MSB registers 0x06..0x0F until they are read
+	rc = sipif_readsipregs(start_reg+0x03, 13, regs);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
+#define ADT_REG(offset)		regs[(offset)-0x03]
 
 	//Onchip TEMP
-	sipif_readsipreg(start_reg+0x03, &test); //LSB
-	lsb = (test >> 0) && 0x3;
-	sipif_readsipreg(start_reg+0x07, &test); //MSB
-	msb = test << 2;
+	lsb = (ADT_REG(0x03) >> 0) & 0x3;
+	msb = ADT_REG(0x07) << 2;
 	*chipTemp = (msb + lsb) / 4.0f;
 
 	//Onchip VDD
-	sipif_readsipreg(start_reg+0x03, &test); //LSB
-	lsb = (test >> 2) && 0x3;
-	sipif_readsipreg(start_reg+0x06, &test); //MSB
-	msb = test << 2;
-	*vdd = (msb + lsb) * 3.11f * 2.197f / 1000.0f;
-	Vref = *vdd;
+	lsb = (ADT_REG(0x03) >> 2) & 0x3;
+	msb = ADT_REG(0x06) << 2;
+	voltage[0] = (msb + lsb) * 3.11f * 2.197f / 1000.0f;
+	Vref = voltage[0];
 	//Vref = 2.25f;
 	//Vref = 3.3f;
 
 	//AIN1
-	sipif_readsipreg(start_reg+0x04, &test); //LSB
-	lsb = (test >> 0) && 0x3;
-	sipif_readsipreg(start_reg+0x08, &test); //MSB
-	msb = test << 2;
-	*ain1 = (msb + lsb) * Vref / 1024.0f;
+	lsb = (ADT_REG(0x04) >> 0) & 0x3;
+	msb = ADT_REG(0x08) << 2;
+	voltage[1] = (msb + lsb) * Vref / 1024.0f;
 
 	//AIN2
-	sipif_readsipreg(start_reg+0x04, &test); //LSB
-	lsb = (test >> 2) && 0x3;
-	sipif_readsipreg(start_reg+0x09, &test); //MSB
-	msb = test << 2;
-	*ain2 = (msb + lsb) * Vref / 1024.0f;
+	lsb = (ADT_REG(0x04) >> 2) & 0x3;
+	msb = ADT_REG(0x09) << 2;
+	voltage[2] = (msb + lsb) * Vref / 1024.0f;
 
 	//AIN3
-	sipif_readsipreg(start_reg+0x04, &test); //LSB
-	lsb = (test >> 4) && 0x3;
-	sipif_readsipreg(start_reg+0x0A, &test); //MSB
-	msb = test << 2;
-	*ain3 = (msb + lsb) * Vref / 1024.0f;
+	lsb = (ADT_REG(0x04) >> 4) & 0x3;
+	msb = ADT_REG(0x0A) << 2;
+	voltage[3] = (msb + lsb) * Vref / 1024.0f;
 
 	//AIN4
-	sipif_readsipreg(start_reg+0x04, &test); //LSB
-	lsb = (test >> 6) && 0x3;
-	sipif_readsipreg(start_reg+0x0B, &test); //MSB
-	msb = test << 2;
+	lsb = (ADT_REG(0x04) >> 6) & 0x3;
+	msb = ADT_REG(0x0B) << 2;
 	Vtmp = (msb + lsb) * Vref / 1024.0f;
-	*ain4 = 5.7f * Vtmp - 4.7f * *vdd;
+	voltage[4] = 5.7f * Vtmp - 4.7f * voltage[0];
 
 	//AIN5
-	sipif_readsipreg(start_reg+0x05, &test); //LSB
-	lsb = (test >> 0) && 0x3;
-	sipif_readsipreg(start_reg+0x0C, &test); //MSB
-	msb = test << 2;
-	*ain5 = (msb + lsb) * Vref / 1024.0f;
+	lsb = (ADT_REG(0x05) >> 0) & 0x3;
+	msb = ADT_REG(0x0C) << 2;
+	voltage[5] = (msb + lsb) * Vref / 1024.0f;
 
 	//AIN6
-	sipif_readsipreg(start_reg+0x05, &test); //LSB
-	lsb = (test >> 2) && 0x3;
-	sipif_readsipreg(start_reg+0x0D, &test); //MSB
-	msb = test << 2;
-	*ain6 = (msb + lsb) * Vref / 1024.0f;
+	lsb = (ADT_REG(0x05) >> 2) & 0x3;
+	msb = ADT_REG(0x0D) << 2;
+	voltage[6] = (msb + lsb) * Vref / 1024.0f;
 
 	//AIN7
-	sipif_readsipreg(start_reg+0x05, &test); //LSB
-	lsb = (test >> 4) && 0x3;
-	sipif_readsipreg(start_reg+0x0E, &test); //MSB
-	msb = test << 2;
-	*ain7 = 2 * (msb + lsb) * Vref / 1024.0f;
+	lsb = (ADT_REG(0x05) >> 4) & 0x3;
+	msb = ADT_REG(0x0E) << 2;
+	voltage[7] = 2 * (msb + lsb) * Vref / 1024.0f;
 
 	//AIN8
-	sipif_readsipreg(start_reg+0x05, &test); //LSB
-	lsb = (test >> 6) && 0x3;
-	sipif_readsipreg(start_reg+0x0F, &test); //MSB
-	msb = test << 2;
-	*ain8 = 2 * (msb + lsb) * Vref / 1024.0f;
+	lsb = (ADT_REG(0x05) >> 6) & 0x3;
+	msb = ADT_REG(0x0F) << 2;
+	voltage[8] = 2 * (msb + lsb) * Vref / 1024.0f;
+#undef ADT_REG
 
 	return FMC116_MON_ERR_OK;
-}
\ No newline at end of file
+}
@@ -18,6 +18,8 @@
 #include "FMC116_adc.h"
 #include "FMC116_freqcnt.h"
 #include "FMC116_monitor.h"
+#include "fmc116_calib.h"
+#include "fmc116_telemetry.h"
 
 
 enum 
@@ -58,12 +60,14 @@ extern "C" {
  *							- FMC116_INTERNAL_CLK
  *							- FMC116_EXTERNAL_CLK
  * @param   nbrch		number of channels on the board
+ * @param   training	pointer to a structure receiving the ADC training outcome ( see FMC116_adc_init() ). Can be NULL.
  * @return  - FMC116_ERR_OK
  *			- FMC116_ERR_CLOCKTREE_INIT
  *			- FMC116_ERR_ADC_INIT
  */
 int FMC116_init(unsigned long bar_cpld, unsigned long bar_clk, unsigned long bar_adc0, unsigned long bar_adc1, unsigned long bar_adc2, unsigned long bar_adc3,
-				unsigned long bar_adc_phy, unsigned long bar_dac0, unsigned long bar_dac1, unsigned long bar_mon, unsigned int clockmode, unsigned int nbrch);
+				unsigned long bar_adc_phy, unsigned long bar_dac0, unsigned long bar_dac1, unsigned long bar_mon, unsigned int clockmode, unsigned int nbrch,
+				FMC116_ADC_TRAINING *training);
 
 // C++ "helper"
 #ifdef __cplusplus
@@ -12,15 +12,29 @@
 
 /* defines */
 #define FMC116_ADC_PART_ID 0x61								/*!< Expected part ID for this particular adc chip */
+#define FMC116_ADC_TRAINING_TIMEOUT_MS 50					/*!< Maximum time given to one training attempt to report ready */
+#define FMC116_ADC_TRAINING_ATTEMPTS 3						/*!< Number of training attempts before FMC116_adc_init() gives up */
+#define FMC116_ADC_IDELAY_REGS 8							/*!< Number of IDELAY tap registers in FMC116.ADCPHY, 4 lanes each */
 enum 
 {	
 };
 
+/**
+ * Outcome of the ADC link training, filled by FMC116_adc_init() and fmc116_idelay_state().
+ */
+typedef struct {
+	unsigned long trainus;							/*!< time from the training start to ready for the successful attempt, in microseconds */
+	unsigned int attempts;							/*!< number of training attempts, 1 when the first one succeeded */
+	unsigned int nbregs;							/*!< number of valid entries in taps, 8 for the FMC116 and 6 for the FMC112 */
+	unsigned char taps[FMC116_ADC_IDELAY_REGS][4];	/*!< IDELAY tap value of each lane, 4 lanes per register */
+} FMC116_ADC_TRAINING;
+
 
 /* error codes */
 #define FMC116_ADC_ERR_OK						0			/*!< No error encountered during execution. */
 #define FMC116_ADC_ERR_SPI_FAULT				-1			/*!< The SPI test fails. */
 #define FMC116_ADC_ERR_NULL_ARGUMENT			-2			/*!< An unexpected NULL argument has been passed to a function. */
+#define FMC116_ADC_ERR_TRAINING_TIMEOUT		-3			/*!< The ADC phy did not report ready after FMC116_ADC_TRAINING_ATTEMPTS training attempts. */
 #define FMC116_DAC_ERR_OK						0			/*!< No error encountered during execution. */
 #define FMC116_DAC_ERR_SPI_FAULT				-1			/*!< The SPI test fails. */
 #define FMC116_DAC_ERR_NULL_ARGUMENT			-2			/*!< An unexpected NULL argument has been passed to a function. */
@@ -41,12 +55,16 @@ extern "C" {
  * @param   bar_adc3	offset where FMC116.ADC3SPI is located in the constellation memory space.
  * @param   bar_adc_phy	offset where FMC116.ADCPHY is located in the constellation memory space.
  * @param   nbrch		number of channels on the board
+ * @param   training	pointer to a structure receiving the training time, the number of attempts and the IDELAY taps. Can be NULL.
+ * @note The training is restarted with an IDELAY reset when the phy does not report ready within FMC116_ADC_TRAINING_TIMEOUT_MS.
  * @return  - FMC116_ADC_ERR_OK
  *			- FMC116_ADC_ERR_SPI_FAULT
  *			- FMC116_ADC_ERR_NULL_ARGUMENT
+ *			- FMC116_ADC_ERR_TRAINING_TIMEOUT
  *			- Any ethapi error codes ( please consult ethapi documentation for more informations ).
  */
-int FMC116_adc_init(unsigned long bar_adc0, unsigned long bar_adc1, unsigned long bar_adc2, unsigned long bar_adc3, unsigned long bar_adc_phy, unsigned int nbrch);
+int FMC116_adc_init(unsigned long bar_adc0, unsigned long bar_adc1, unsigned long bar_adc2, unsigned long bar_adc3, unsigned long bar_adc_phy, unsigned int nbrch,
+					FMC116_ADC_TRAINING *training);
 
 /**
  * \brief Initialize both DAC chips on the FMC116. This function uses settings that should suit a general application but these settings can be changedt to suit your needs.
@@ -62,14 +80,16 @@ int FMC116_adc_init(unsigned long bar_adc0, unsigned long bar_adc1, unsigned lon
 int FMC116_dac_init(unsigned long bar_dac0, unsigned long bar_dac1);
 
 /**
- * \brief Print status of the IDELAYs.
+ * \brief Read the state of the IDELAYs.
  *
  * @param	bar_adc_phy	offset where FMC116.ADCPHY is located in the constellation memory space.
  * @param   nbrch		number of channels on the board
+ * @param   training	pointer to a structure receiving the IDELAY taps ( nbregs and taps members ).
  * @return  - FMC116_ADC_ERR_OK
+ *			- FMC116_ADC_ERR_NULL_ARGUMENT
  *			- Any ethapi error codes ( please consult ethapi documentation for more informations ).
  */
-int fmc116_idelay_state(unsigned long bar_adc_phy, unsigned int nbrch);
+int fmc116_idelay_state(unsigned long bar_adc_phy, unsigned int nbrch, FMC116_ADC_TRAINING *training);
 
 // C++ "helper"
 #ifdef __cplusplus
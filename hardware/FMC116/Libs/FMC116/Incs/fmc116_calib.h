@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc116_calib.h
+///@author Pankil Butala (MCL, BU)
+///\brief FMC116_calib module to keep the FMC116 calibration between runs (header)
+///
+/// This module saves the IDELAY taps found by the ADC training to a snapshot
+/// file and reads them back on the next start. A snapshot is only valid for the
+/// firmware build, the constellation and the clock mode it was taken with, these
+/// are part of the file name and are checked again when loading.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#ifndef _FMC116_CALIB_H_
+#define _FMC116_CALIB_H_
+
+#include "fmc116_adc.h"
+
+/* defines */
+#define FMC116_CALIB_MAGIC				0x43313136	/*!< Marker at the beginning of every snapshot file ( 'C116' ) */
+
+/**
+ * Content of a calibration snapshot.
+ */
+typedef struct {
+	unsigned long magic;				/*!< FMC116_CALIB_MAGIC */
+	unsigned long fwbuild;				/*!< firmware build code ( cid_getfwbuildcode() ) */
+	unsigned long constellationid;		/*!< constellation ID ( cid_getconstellationid() ) */
+	unsigned long clockmode;			/*!< clock mode given to FMC116_init() */
+	unsigned long nbregs;				/*!< number of valid entries in taps */
+	unsigned char taps[FMC116_ADC_IDELAY_REGS][4];	/*!< IDELAY taps of every lane ( FMC116_ADC_TRAINING ) */
+} FMC116_CALIB;
+
+/* error codes */
+#define FMC116_CALIB_ERR_OK				0			/*!< No error encountered during execution. */
+#define FMC116_CALIB_ERR_NOT_FOUND		-1			/*!< There is no valid snapshot for this firmware, constellation and clock mode. */
+#define FMC116_CALIB_ERR_FILE			-2			/*!< The snapshot file could not be written. */
+#define FMC116_CALIB_ERR_NULL_ARGUMENT	-3			/*!< An unexpected NULL argument has been passed to a function. */
+
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Load the calibration snapshot matching the running firmware and the clock mode.
+ *
+ * @warning Calling cid_init() prior calling this function is mandatory.
+ * @note This function does not communicate with the hardware.
+ *
+ * @param   clockmode     clock mode given to FMC116_init().
+ * @param   calib     pointer to a structure receiving the snapshot.
+ * @return  - FMC116_CALIB_ERR_OK
+ *			- FMC116_CALIB_ERR_NOT_FOUND
+ *			- FMC116_CALIB_ERR_NULL_ARGUMENT
+ */
+int FMC116_calib_load(unsigned int clockmode, FMC116_CALIB *calib);
+
+/**
+ * Save a calibration snapshot for the running firmware and the clock mode. The magic and key members of calib
+ * are filled by this function, only nbregs and taps have to be set by the caller.
+ *
+ * @warning Calling cid_init() prior calling this function is mandatory.
+ * @note This function does not communicate with the hardware.
+ *
+ * @param   clockmode     clock mode given to FMC116_init().
+ * @param   calib     pointer to the snapshot.
+ * @return  - FMC116_CALIB_ERR_OK
+ *			- FMC116_CALIB_ERR_FILE
+ *			- FMC116_CALIB_ERR_NULL_ARGUMENT
+ */
+int FMC116_calib_save(unsigned int clockmode, FMC116_CALIB *calib);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_FMC116_CALIB_H_
@@ -12,6 +12,7 @@
 
 
 #define FMC116_CLOCKTREE_PART_ID_3 0x53						/*!< Expected part ID for the AD9517-3 clock tree chip */
+#define FMC116_CLOCKTREE_LOCK_TIMEOUT_MS 100				/*!< Maximum time given to the VCO calibration and the PLL to lock after the update */
 
 enum 
 {
@@ -27,6 +28,7 @@ enum
 #define FMC116_CLOCKTREE_ERR_CLK0_PLL_NOT_LOCKED	-2		/*!< The PLL in the clock tree chip did not lock after a reset */
 #define FMC116_CLOCKTREE_ERR_SPI_FAULT				-3		/*!< Error during SPI communication. */
 #define FMC116_CLOCKTREE_ERR_NO_LOCK				-4		/*!< Internal clock is selected, but the PLL has no lock. */
+#define FMC116_CLOCKTREE_ERR_VCO_CAL_TIMEOUT		-5		/*!< The VCO calibration did not finish within FMC116_CLOCKTREE_LOCK_TIMEOUT_MS. */
 
 // C++ "helper"
 #ifdef __cplusplus
@@ -43,15 +45,28 @@ extern "C" {
  *							- CLOCKTREE_INTCLK_INTREF
  *							- CLOCKTREE_EXTCLK
  *							- CLOCKTREE_INTCLK_EXTREF
+ * @note In internal clock modes the function returns as soon as the VCO calibration is finished and the PLL reports
+ *		 digital lock, or fails after FMC116_CLOCKTREE_LOCK_TIMEOUT_MS. See FMC116_clocktree_getlocktime().
  * @return  - FMC116_CLOCKTREE_ERR_OK
  *			- FMC116_CLOCKTREE_ERR_WRONG_PART_REV
  *			- FMC116_CLOCKTREE_ERR_CLK0_PLL_NOT_LOCKED
  *			- FMC116_CLOCKTREE_ERR_SPI_FAULT
  *			- FMC116_CLOCKTREE_ERR_NO_LOCK
+ *			- FMC116_CLOCKTREE_ERR_VCO_CAL_TIMEOUT
  *			- Any ethapi error codes ( please consult ethapi documentation for more informations ).
  */
 int FMC116_clocktree_init(unsigned long bar,unsigned int clockmode);
 
+/**
+ * Obtain the lock times measured during the last FMC116_clocktree_init(). Both times are counted from the update
+ * of the clock tree registers, they are 0 in external clock mode or when the PLL did not lock.
+ *
+ * @param   vcocalus     pointer receiving the time it took for the VCO calibration to finish in microseconds. Can be NULL.
+ * @param   lockus     pointer receiving the time it took for the PLL to report digital lock in microseconds. Can be NULL.
+ * @return  - FMC116_CLOCKTREE_ERR_OK
+ */
+int FMC116_clocktree_getlocktime(unsigned long *vcocalus, unsigned long *lockus);
+
 
 // C++ "helper"
 #ifdef __cplusplus
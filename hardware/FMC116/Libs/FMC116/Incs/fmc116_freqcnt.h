@@ -18,8 +18,21 @@ enum
 };
 
 
+#define FMC116_FREQCNT_NB_CLOCKS	7											/*!< Number of clocks wired to the frequency counter */
+#define FMC116_FREQCNT_ALL_CLOCKS	((1<<FMC116_FREQCNT_NB_CLOCKS)-1)				/*!< FMC116_freqcnt_sweep() mask selecting every clock */
+
+/**
+ * Result of FMC116_freqcnt_sweep().
+ */
+typedef struct {
+	unsigned char valid[FMC116_FREQCNT_NB_CLOCKS];		/*!< 1 when the clock was measured and toggles, 0 when it was not selected or does not toggle */
+	float frequency[FMC116_FREQCNT_NB_CLOCKS];			/*!< frequency of each clock in MHz, 0 when not valid */
+} FMC116_FREQCNT_SWEEP;
+
 /* error codes */
 #define FMC116_FREQCNT_ERR_OK					0	/*!< No error encountered during execution. */
+#define FMC116_FREQCNT_ERR_NULL_ARGUMENT		-100	/*!< An unexpected NULL argument has been passed to a function. */
+#define FMC116_FREQCNT_MEASURE_MS				10	/*!< Time between FMC116_freqcnt_select() and a valid FMC116_freqcnt_read() */
 
 
 // C++ "helper"
@@ -49,6 +62,43 @@ extern "C" {
  */
 int FMC116_freqcnt_getfrequency(unsigned long bar, unsigned int clksel, float *freq, int outputconsole);
 
+/**
+ * Measure a set of clocks in one pass. The reads of a measure and the selection of the next clock go out in the same
+ * sipif_transact() call, a sweep over n clocks costs n+1 round trips and n measure times instead of 2n round trips.
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar     offset where FMC116.FREQCNT is located in the constellation memory space.
+ * @param   clkmask     bit n set to measure clock n ( see FMC116_freqcnt_getfrequency() ), FMC116_FREQCNT_ALL_CLOCKS for all of them.
+ * @param   sweep     pointer to a structure receiving the frequencies and their validity.
+ * @param	outputconsole	decide if the function displays the frequencies to the console or not. Either FMC116_FREQCNT_DISPLAY_CONSOLE or FMC116_FREQCNT_NO_DISPLAY_CONSOLE
+ *							can be passed as argument.
+ * @return  - FMC116_FREQCNT_ERR_OK
+ *			- FMC116_FREQCNT_ERR_NULL_ARGUMENT
+ *			- any sipif error codes
+ */
+int FMC116_freqcnt_sweep(unsigned long bar, unsigned int clkmask, FMC116_FREQCNT_SWEEP *sweep, int outputconsole);
+
+/**
+ * Start a measure on a given clock, the result is available 10 ms later through FMC116_freqcnt_read(). This is the first half of
+ * FMC116_freqcnt_getfrequency() for callers that do not want to sleep in the middle of a measure.
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar     offset where FMC116.FREQCNT is located in the constellation memory space.
+ * @param   clksel     ID of the clock we want to obtain, see FMC116_freqcnt_getfrequency().
+ * @return  FMC116_FREQCNT_ERR_OK in case of success or any ethapi ( please see ethapi documentation ) error codes.
+ */
+int FMC116_freqcnt_select(unsigned long bar, unsigned int clksel);
+
+/**
+ * Read back the frequency measured on the clock selected by FMC116_freqcnt_select().
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar     offset where FMC116.FREQCNT is located in the constellation memory space.
+ * @param   freq     pointer to a float receiving the frequency in MHz.
+ * @return  FMC116_FREQCNT_ERR_OK in case of success or any ethapi ( please see ethapi documentation ) error codes.
+ */
+int FMC116_freqcnt_read(unsigned long bar, float *freq);
+
 // C++ "helper"
 #ifdef __cplusplus
 }
@@ -21,11 +21,15 @@ enum
 
 #define FMC116_ADT_DEV	1
 
+#define FMC116_MON_NB_VOLTAGES		9						/*!< Voltages returned by FMC116_monitor_read(): VDD then AIN1..AIN8 */
+#define FMC116_MON_FIRST_ROUND_MS	100						/*!< Time for the first conversion round after FMC116_monitor_start() */
+
 /* error codes */
 #define FMC116_MON_ERR_OK						0			/*!< No error encountered during execution. */
 #define FMC116_MON_ERR_WRONG_PART_REVISION		-1			/*!< The part revision obtained from the monitoring device does not match what we expect. */
 #define FMC116_MON_ERR_SPI_FAULT				-2			/*!< The SPI bus test has failed */
 #define FMC116_MON_ERR_VOLTAGE_OUT_OF_RANGE		-3			/*!< One of the voltages on the board is below/above the threshold */
+#define FMC116_MON_ERR_NULL_ARGUMENT			-4			/*!< An unexpected NULL argument has been passed to a function. */
 
 
 // C++ "helper"
@@ -74,6 +78,30 @@ int FMC116_monitor_getDeviceDiags(unsigned long bar_mon, int deviceNum, ULONG* d
 								  float* chipTemp, float* vdd, float* ain1, float* ain2, 
 								  float* ain3, float* ain4, float* ain5, float* ain6, float* ain7, float* ain8);
 
+/**
+ * \brief Configure the monitoring device for continuous conversions. The device converts its inputs round robin from now on,
+ * the first complete round is available FMC116_MON_FIRST_ROUND_MS later.
+ * @note This function communicates with the hardware and waits 100 ms between the two configuration registers.
+ *
+ * @param   bar_mon     offset where FMC116.MONSPI is located in the constellation memory space.
+ * @return  FMC116_MON_ERR_OK in case of success or any sipif error codes.
+ */
+int FMC116_monitor_start(unsigned long bar_mon);
+
+/**
+ * \brief Read the latest conversion results of the monitoring device, started by FMC116_monitor_start(). The results are
+ * read in a single bulk read and the function does not wait, it is cheap enough to be called periodically.
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar_mon     offset where FMC116.MONSPI is located in the constellation memory space.
+ * @param	chipTemp	the on-chip temperature
+ * @param	voltage		FMC116_MON_NB_VOLTAGES floats receiving VDD then AIN1..AIN8.
+ * @return  - FMC116_MON_ERR_OK
+ *			- FMC116_MON_ERR_NULL_ARGUMENT
+ *			- any sipif error codes
+ */
+int FMC116_monitor_read(unsigned long bar_mon, float *chipTemp, float *voltage);
+
 // C++ "helper"
 #ifdef __cplusplus
 }
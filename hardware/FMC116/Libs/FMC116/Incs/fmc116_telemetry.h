@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc116_telemetry.h
+///@author Pankil Butala (MCL, BU)
+///\brief FMC116_telemetry module to sample the FMC116 health in the background (header)
+///
+/// This module samples the temperature and voltages of the monitoring device and
+/// the frequency counters from a low priority thread. The sampler only takes the
+/// transport for one short batch at a time and steps aside while the capture path
+/// holds it ( see sipif_trylock() ). The latest snapshot is published through a
+/// double buffer, FMC116_telemetry_get() never communicates with the hardware.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#ifndef _FMC116_TELEMETRY_H_
+#define _FMC116_TELEMETRY_H_
+
+#include "fmc116_monitor.h"
+
+/* defines */
+#define FMC116_TELEMETRY_NB_CLOCKS		7			/*!< Frequency counter clocks sampled, see FMC116_freqcnt_getfrequency() */
+#define FMC116_TELEMETRY_PERIOD_MS		1000		/*!< Default time between two snapshots */
+#define FMC116_TELEMETRY_BACKOFF_MS		2			/*!< Wait before trying again when the capture path holds the transport */
+#define FMC116_TELEMETRY_SRC_NONE			0			/*!< error source, no error */
+#define FMC116_TELEMETRY_SRC_MONITOR		1			/*!< error source, FMC116_monitor_read() or FMC116_monitor_start() */
+#define FMC116_TELEMETRY_SRC_FREQCNT		2			/*!< error source, FMC116_freqcnt_select() or FMC116_freqcnt_read() */
+
+/**
+ * One telemetry snapshot.
+ */
+typedef struct {
+	unsigned long sequence;							/*!< snapshot number, 0 until the first snapshot is published */
+	unsigned long timestamp;						/*!< GetTickCount() when the snapshot was completed */
+	unsigned long sampleus;							/*!< time spent taking the snapshot, including the waits for the transport */
+	unsigned long deferred;							/*!< batches postponed so far because the capture path held the transport */
+	int error;										/*!< error met while taking the snapshot, code of the source function, 0 when all values are fresh */
+	int source;										/*!< FMC116_TELEMETRY_SRC_x, function that returned error, the codes of the sources overlap */
+	float temperature;								/*!< monitoring device temperature in degree C */
+	float voltage[FMC116_MON_NB_VOLTAGES];			/*!< VDD then AIN1..AIN8 in V, see FMC116_monitor_read() */
+	float frequency[FMC116_TELEMETRY_NB_CLOCKS];	/*!< clocks 0..6 in MHz, 0 for a clock not populated */
+} FMC116_TELEMETRY;
+
+/* error codes */
+#define FMC116_TELEMETRY_ERR_OK				0		/*!< No error encountered during execution. */
+#define FMC116_TELEMETRY_ERR_RUNNING		-1		/*!< FMC116_telemetry_start() has been called already. */
+#define FMC116_TELEMETRY_ERR_NOT_RUNNING	-2		/*!< FMC116_telemetry_start() has not been called. */
+#define FMC116_TELEMETRY_ERR_ALLOC			-3		/*!< The sampler thread could not be created. */
+#define FMC116_TELEMETRY_ERR_NULL_ARGUMENT	-4		/*!< An unexpected NULL argument has been passed to a function. */
+
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Start the sampler thread. The monitoring device is configured once by the thread, after that every snapshot is one bulk
+ * read of the monitoring device plus one select/read pair per frequency counter clock.
+ * @note The sampler communicates with the hardware, always through sipif_trylock().
+ *
+ * @param   bar_mon     offset where FMC116.MONSPI is located in the constellation memory space.
+ * @param   bar_freqcnt     offset where FMC116.FREQCNT is located in the constellation memory space.
+ * @param   nbrch     number of ADC channels ( 12 for a FMC112, clock ADC 3 is not sampled then ).
+ * @param   periodms     time between two snapshots, FMC116_TELEMETRY_PERIOD_MS is a reasonable value.
+ * @return  - FMC116_TELEMETRY_ERR_OK
+ *			- FMC116_TELEMETRY_ERR_RUNNING
+ *			- FMC116_TELEMETRY_ERR_ALLOC
+ */
+int FMC116_telemetry_start(unsigned long bar_mon, unsigned long bar_freqcnt, unsigned int nbrch, unsigned int periodms);
+
+/**
+ * Copy the latest published snapshot. This function does not block the sampler and the sampler does not block it.
+ * @note This function does not communicate with the hardware.
+ *
+ * @param   snapshot     pointer to a structure receiving the snapshot. sequence is 0 when no snapshot has been taken yet.
+ * @return  - FMC116_TELEMETRY_ERR_OK
+ *			- FMC116_TELEMETRY_ERR_NULL_ARGUMENT
+ */
+int FMC116_telemetry_get(FMC116_TELEMETRY *snapshot);
+
+/**
+ * Stop the sampler thread and wait for it to leave.
+ *
+ * @return  - FMC116_TELEMETRY_ERR_OK
+ *			- FMC116_TELEMETRY_ERR_NOT_RUNNING
+ */
+int FMC116_telemetry_stop(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_FMC116_TELEMETRY_H_
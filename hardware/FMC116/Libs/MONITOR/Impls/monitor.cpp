@@ -0,0 +1,444 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file monitor.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief monitor module publishes streams computed from the bursts to monitoring clients (implementation)
+///
+/// The control client drives the captures on its own socket. Monitoring clients ( displays,
+/// loggers ) connect to a second port and subscribe to streams, each one a reduced view of the
+/// bursts such as an envelope or a spectrum, per channel and at most every INTERVAL ms. A
+/// client may subscribe to several streams and change a subscription at any time by sending a
+/// new subscription message, MONITOR_SUB_LEN bytes, for the same stream.
+///
+/// The monitor thread accepts the clients and reads their subscriptions. The pipeline stages
+/// ask monitor_due() which subscriptions want the burst they are processing, build one message
+/// for each and hand it to monitor_send(), which never waits. The client sockets do not block:
+/// what the socket does not take at once is kept, one message per client, and sent by the
+/// monitor thread. The messages of a client never interleave, the subscriptions of a client
+/// holding a message back are not due and a message sent meanwhile is dropped, and a client
+/// that does not take a message within MONITOR_SEND_TIMEOUT is disconnected. A slow display
+/// misses bursts, it never holds the captures back.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "monitor.h"
+
+/**
+ * Subscription of a client to one stream.
+ */
+typedef struct {
+	unsigned int mask;								/*!< channels, 0 when not subscribed */
+	unsigned int flags;								/*!< MONITOR_SUB_FLAGS */
+	unsigned int points;							/*!< MONITOR_SUB_POINTS */
+	unsigned int interval;							/*!< MONITOR_SUB_INTERVAL */
+	unsigned int arg;								/*!< MONITOR_SUB_ARG */
+	int served[MONITOR_MAX_CHANNELS];				/*!< 1 once a message of the channel has been due */
+	DWORD last[MONITOR_MAX_CHANNELS];				/*!< tick count of the last message due per channel */
+} monitor_stream;
+
+/**
+ * One client slot. sock and id change under both send and the monitor lock, the monitor thread alone changes them.
+ */
+typedef struct {
+	SOCKET sock;									/*!< client socket, INVALID_SOCKET for a free slot */
+	unsigned int id;								/*!< connection number, tells a new client from the previous one of the slot */
+	volatile LONG failed;							/*!< 1 once a send failed, the monitor thread disconnects the client */
+	CRITICAL_SECTION send;							/*!< one message at a time, protects the message held back */
+	unsigned char *pending;							/*!< part of a message the socket has not taken yet */
+	unsigned int pendsize;							/*!< bytes allocated for pending */
+	unsigned int pendlen;							/*!< bytes of pending still to be sent, 0 when no message is held back */
+	unsigned int pendoff;							/*!< first byte of pending still to be sent */
+	DWORD since;									/*!< tick count when the message was held back */
+	unsigned char rx[MONITOR_SUB_LEN];				/*!< subscription being received */
+	unsigned int rxcount;							/*!< bytes of rx received */
+	monitor_stream stream[MONITOR_MAX_STREAMS];		/*!< subscriptions, protected by the monitor lock */
+	unsigned long long messages[MONITOR_MAX_STREAMS];	/*!< messages sent, protected by send */
+	unsigned long long bytes[MONITOR_MAX_STREAMS];	/*!< bytes sent, protected by send */
+	unsigned long long skipped[MONITOR_MAX_STREAMS];	/*!< messages dropped while one was held back, protected by send */
+} monitor_client;
+
+/**
+ * Monitor state.
+ */
+typedef struct {
+	int active;										/*!< 1 between monitor_start() and monitor_stop() */
+	volatile LONG stop;								/*!< 1 when the monitor thread has to leave */
+	SOCKET listener;								/*!< monitoring port */
+	HANDLE hthread;									/*!< monitor thread */
+	CRITICAL_SECTION lock;							/*!< protects the subscriptions and the totals */
+	unsigned int nextid;							/*!< last connection number */
+	unsigned long accepted;							/*!< clients accepted */
+	unsigned long refused;							/*!< clients refused, every slot was taken */
+	unsigned long dropped;							/*!< clients disconnected after a failed send */
+	unsigned long long messages[MONITOR_MAX_STREAMS];	/*!< messages sent to the clients gone */
+	unsigned long long bytes[MONITOR_MAX_STREAMS];	/*!< bytes sent to the clients gone */
+	unsigned long long skipped[MONITOR_MAX_STREAMS];	/*!< messages dropped for the clients gone */
+	monitor_client client[MONITOR_MAX_CLIENTS];		/*!< client slots */
+} monitor;
+
+static monitor g_mon;								/*!< The one and only monitor */
+
+
+/**
+ * Disconnect a client and free its slot, called by the monitor thread only.
+ */
+static void monitor_close(monitor_client *client)
+{
+	// monitor_send() never waits, the send lock is only held for a non blocking send
+	EnterCriticalSection(&client->send);
+	EnterCriticalSection(&g_mon.lock);
+	closesocket(client->sock);
+	client->sock = INVALID_SOCKET;
+	if(client->failed)
+		g_mon.dropped++;
+	client->failed = 0;
+	for(unsigned int i = 0; i < MONITOR_MAX_STREAMS; i++) {
+		g_mon.messages[i] += client->messages[i];
+		g_mon.bytes[i] += client->bytes[i];
+		g_mon.skipped[i] += client->skipped[i];
+	}
+	memset(client->stream, 0, sizeof(client->stream));
+	memset(client->messages, 0, sizeof(client->messages));
+	memset(client->bytes, 0, sizeof(client->bytes));
+	memset(client->skipped, 0, sizeof(client->skipped));
+	client->rxcount = 0;
+	client->pendlen = 0;
+	client->pendoff = 0;
+	LeaveCriticalSection(&g_mon.lock);
+	LeaveCriticalSection(&client->send);
+}
+
+/**
+ * Give a new connection a free slot, called by the monitor thread only.
+ */
+static void monitor_accept(void)
+{
+	SOCKET sock = accept(g_mon.listener, NULL, NULL);
+	monitor_client *client = NULL;
+	int sndbuf = MONITOR_SNDBUF;
+	u_long nonblocking = 1;
+
+	if(sock==INVALID_SOCKET)
+		return;
+	for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS && !client; i++) {
+		if(g_mon.client[i].sock==INVALID_SOCKET)
+			client = &g_mon.client[i];
+	}
+	if(!client) {
+		closesocket(sock);
+		g_mon.refused++;
+		return;
+	}
+
+	// a send takes what fits in the send buffer and returns, the monitor thread sends the rest
+	if(ioctlsocket(sock, FIONBIO, &nonblocking)!=0) {
+		closesocket(sock);
+		g_mon.refused++;
+		return;
+	}
+	setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char *)&sndbuf, sizeof(sndbuf));
+	EnterCriticalSection(&client->send);
+	EnterCriticalSection(&g_mon.lock);
+	client->sock = sock;
+	client->id = ++g_mon.nextid;
+	client->failed = 0;
+	client->rxcount = 0;
+	g_mon.accepted++;
+	LeaveCriticalSection(&g_mon.lock);
+	LeaveCriticalSection(&client->send);
+}
+
+/**
+ * Read the subscription of a client, called by the monitor thread only.
+ *
+ * @return 0 when the client has left.
+ */
+static int monitor_receive(monitor_client *client)
+{
+	monitor_stream *stream;
+	unsigned int id;
+	int n;
+
+	n = recv(client->sock, (char *)client->rx+client->rxcount, MONITOR_SUB_LEN-client->rxcount, 0);
+	if(n==SOCKET_ERROR && WSAGetLastError()==WSAEWOULDBLOCK)
+		return 1;
+	if(n<=0)
+		return 0;
+	client->rxcount += n;
+	if(client->rxcount<MONITOR_SUB_LEN)
+		return 1;
+	client->rxcount = 0;
+
+	// unknown streams are ignored, the client may know of streams this server does not publish
+	id = client->rx[MONITOR_SUB_STREAM];
+	if(id==0 || id>=MONITOR_MAX_STREAMS)
+		return 1;
+	EnterCriticalSection(&g_mon.lock);
+	stream = &client->stream[id];
+	memset(stream, 0, sizeof(monitor_stream));
+	stream->mask = client->rx[MONITOR_SUB_CHNL];
+	stream->flags = client->rx[MONITOR_SUB_FLAGS] | (client->rx[MONITOR_SUB_FLAGS+1]<<8);
+	stream->points = client->rx[MONITOR_SUB_POINTS] | (client->rx[MONITOR_SUB_POINTS+1]<<8);
+	stream->interval = client->rx[MONITOR_SUB_INTERVAL] | (client->rx[MONITOR_SUB_INTERVAL+1]<<8);
+	stream->arg = client->rx[MONITOR_SUB_ARG] | (client->rx[MONITOR_SUB_ARG+1]<<8) | (client->rx[MONITOR_SUB_ARG+2]<<16) |
+		(client->rx[MONITOR_SUB_ARG+3]<<24);
+	LeaveCriticalSection(&g_mon.lock);
+	return 1;
+}
+
+/**
+ * Send what the socket takes of the message held back, called by the monitor thread only. A client holding a message
+ * back for more than MONITOR_SEND_TIMEOUT fails.
+ *
+ * @param	now	tick count.
+ * @return 1 while a message is held back.
+ */
+static int monitor_flush(monitor_client *client, DWORD now)
+{
+	int n;
+
+	EnterCriticalSection(&client->send);
+	while(client->pendlen && !client->failed) {
+		n = send(client->sock, (const char *)client->pending+client->pendoff, client->pendlen, 0);
+		if(n==SOCKET_ERROR && WSAGetLastError()==WSAEWOULDBLOCK) {
+			if(now-client->since>MONITOR_SEND_TIMEOUT)
+				client->failed = 1;
+			break;
+		}
+		if(n==SOCKET_ERROR || n==0)
+			client->failed = 1;
+		else {
+			client->pendoff += n;
+			client->pendlen -= n;
+		}
+	}
+	n = client->pendlen && !client->failed;
+	LeaveCriticalSection(&client->send);
+	return n;
+}
+
+static DWORD WINAPI monitor_thread(LPVOID arg)
+{
+	monitor_client *client;
+	struct timeval tv;
+	fd_set rd, wr;
+	DWORD now;
+
+	while(!g_mon.stop) {
+		FD_ZERO(&rd);
+		FD_ZERO(&wr);
+		FD_SET(g_mon.listener, &rd);
+		now = GetTickCount();
+		for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS; i++) {
+			client = &g_mon.client[i];
+			// a message held back is sent as soon as the socket takes it, the stages do not wait for it
+			if(client->sock!=INVALID_SOCKET && monitor_flush(client, now))
+				FD_SET(client->sock, &wr);
+			if(client->sock!=INVALID_SOCKET && client->failed)
+				monitor_close(client);
+			if(client->sock!=INVALID_SOCKET)
+				FD_SET(client->sock, &rd);
+		}
+
+		tv.tv_sec = 0;
+		tv.tv_usec = MONITOR_POLL_MS*1000;
+		if(select(0, &rd, &wr, NULL, &tv)<=0)
+			continue;
+		for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS; i++) {
+			client = &g_mon.client[i];
+			if(client->sock!=INVALID_SOCKET && FD_ISSET(client->sock, &rd) && !monitor_receive(client))
+				monitor_close(client);
+		}
+		if(FD_ISSET(g_mon.listener, &rd))
+			monitor_accept();
+	}
+
+	for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS; i++) {
+		if(g_mon.client[i].sock!=INVALID_SOCKET)
+			monitor_close(&g_mon.client[i]);
+	}
+	return 0;
+}
+
+int monitor_start(unsigned short port)
+{
+	sockaddr_in local;
+	BOOL reuse = TRUE;
+
+	if(g_mon.active)
+		return MONITOR_ERR_RUNNING;
+
+	memset(&g_mon, 0, sizeof(g_mon));
+	g_mon.listener = socket(AF_INET, SOCK_STREAM, 0);
+	if(g_mon.listener==INVALID_SOCKET)
+		return MONITOR_ERR_SOCKET;
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = INADDR_ANY;
+	local.sin_port = htons(port);
+	setsockopt(g_mon.listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+	if(bind(g_mon.listener, (sockaddr *)&local, sizeof(local))!=0 || listen(g_mon.listener, MONITOR_MAX_CLIENTS)!=0) {
+		closesocket(g_mon.listener);
+		return MONITOR_ERR_SOCKET;
+	}
+
+	InitializeCriticalSection(&g_mon.lock);
+	for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS; i++) {
+		g_mon.client[i].sock = INVALID_SOCKET;
+		InitializeCriticalSection(&g_mon.client[i].send);
+	}
+	g_mon.hthread = CreateThread(NULL, 0, monitor_thread, NULL, 0, NULL);
+	if(!g_mon.hthread) {
+		for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS; i++)
+			DeleteCriticalSection(&g_mon.client[i].send);
+		DeleteCriticalSection(&g_mon.lock);
+		closesocket(g_mon.listener);
+		return MONITOR_ERR_SOCKET;
+	}
+
+	g_mon.active = 1;
+	return MONITOR_ERR_OK;
+}
+
+unsigned int monitor_due(unsigned int stream, unsigned int channel, MONITOR_SUBSCRIPTION *subs, unsigned int max)
+{
+	monitor_client *client;
+	monitor_stream *sub;
+	unsigned int n = 0;
+	DWORD now;
+
+	if(!g_mon.active || !subs || stream==0 || stream>=MONITOR_MAX_STREAMS || channel>=MONITOR_MAX_CHANNELS)
+		return 0;
+
+	now = GetTickCount();
+	EnterCriticalSection(&g_mon.lock);
+	for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS && n < max; i++) {
+		client = &g_mon.client[i];
+		sub = &client->stream[stream];
+		if(client->sock==INVALID_SOCKET || client->failed || client->pendlen || (sub->mask&(1u<<channel))==0)
+			continue;
+		if(sub->served[channel] && now-sub->last[channel]<sub->interval)
+			continue;
+		sub->served[channel] = 1;
+		sub->last[channel] = now;
+		subs[n].stream = stream;
+		subs[n].client = i;
+		subs[n].id = client->id;
+		subs[n].flags = sub->flags;
+		subs[n].points = sub->points;
+		subs[n].interval = sub->interval;
+		subs[n].arg = sub->arg;
+		n++;
+	}
+	LeaveCriticalSection(&g_mon.lock);
+	return n;
+}
+
+int monitor_send(const MONITOR_SUBSCRIPTION *sub, const void *msg, unsigned int len)
+{
+	monitor_client *client;
+	unsigned char *pending;
+	int n, rc = MONITOR_ERR_OK;
+
+	if(!g_mon.active)
+		return MONITOR_ERR_NOT_RUNNING;
+	if(!sub || sub->client>=MONITOR_MAX_CLIENTS || sub->stream==0 || sub->stream>=MONITOR_MAX_STREAMS || (!msg && len))
+		return MONITOR_ERR_ARGUMENT;
+
+	client = &g_mon.client[sub->client];
+	EnterCriticalSection(&client->send);
+	// the client of the subscription may have left, its slot taken by another one
+	if(client->sock==INVALID_SOCKET || client->id!=sub->id || client->failed)
+		rc = MONITOR_ERR_CLOSED;
+	else if(client->pendlen)
+		rc = MONITOR_ERR_BUSY;
+	else if(len) {
+		n = send(client->sock, (const char *)msg, len, 0);
+		if(n==SOCKET_ERROR && WSAGetLastError()==WSAEWOULDBLOCK)
+			rc = MONITOR_ERR_BUSY;
+		else if(n==SOCKET_ERROR || n==0) {
+			client->failed = 1;
+			rc = MONITOR_ERR_CLOSED;
+		}
+		else if((unsigned int)n<len) {
+			// part of the message is in the socket, the rest has to follow before any other message
+			if(client->pendsize<len-n) {
+				pending = (unsigned char *)realloc(client->pending, len-n);
+				if(pending) {
+					client->pending = pending;
+					client->pendsize = len-n;
+				}
+			}
+			if(client->pendsize<len-n) {
+				client->failed = 1;
+				rc = MONITOR_ERR_CLOSED;
+			}
+			else {
+				memcpy(client->pending, (const char *)msg+n, len-n);
+				client->pendoff = 0;
+				client->pendlen = len-n;
+				client->since = GetTickCount();
+			}
+		}
+	}
+	if(rc==MONITOR_ERR_BUSY)
+		client->skipped[sub->stream]++;
+	if(rc==MONITOR_ERR_OK) {
+		client->messages[sub->stream]++;
+		client->bytes[sub->stream] += len;
+	}
+	LeaveCriticalSection(&client->send);
+	return rc;
+}
+
+void monitor_report(FILE *out)
+{
+	unsigned long long messages[MONITOR_MAX_STREAMS], bytes[MONITOR_MAX_STREAMS], skipped[MONITOR_MAX_STREAMS];
+	unsigned int connected = 0;
+
+	if(!g_mon.active)
+		return;
+
+	EnterCriticalSection(&g_mon.lock);
+	memcpy(messages, g_mon.messages, sizeof(messages));
+	memcpy(bytes, g_mon.bytes, sizeof(bytes));
+	memcpy(skipped, g_mon.skipped, sizeof(skipped));
+	for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS; i++) {
+		if(g_mon.client[i].sock==INVALID_SOCKET)
+			continue;
+		connected++;
+		for(unsigned int j = 0; j < MONITOR_MAX_STREAMS; j++) {
+			messages[j] += g_mon.client[i].messages[j];
+			bytes[j] += g_mon.client[i].bytes[j];
+			skipped[j] += g_mon.client[i].skipped[j];
+		}
+	}
+	fprintf(out, "------------------------------- Monitor ------------------------------\n");
+	fprintf(out, "%lu clients accepted, %u connected, %lu refused, %lu disconnected for a failed send\n", g_mon.accepted, connected,
+		g_mon.refused, g_mon.dropped);
+	for(unsigned int i = 1; i < MONITOR_MAX_STREAMS; i++) {
+		if(messages[i] || skipped[i])
+			fprintf(out, "stream %u: %llu messages, %llu bytes, %llu messages dropped for a busy client\n", i, messages[i], bytes[i],
+				skipped[i]);
+	}
+	fprintf(out, "----------------------------------------------------------------------\n");
+	LeaveCriticalSection(&g_mon.lock);
+}
+
+int monitor_stop(void)
+{
+	if(!g_mon.active)
+		return MONITOR_ERR_NOT_RUNNING;
+
+	g_mon.stop = 1;
+	WaitForSingleObject(g_mon.hthread, INFINITE);
+	CloseHandle(g_mon.hthread);
+	closesocket(g_mon.listener);
+	for(unsigned int i = 0; i < MONITOR_MAX_CLIENTS; i++) {
+		DeleteCriticalSection(&g_mon.client[i].send);
+		free(g_mon.client[i].pending);
+	}
+	DeleteCriticalSection(&g_mon.lock);
+	memset(&g_mon, 0, sizeof(g_mon));
+	return MONITOR_ERR_OK;
+}
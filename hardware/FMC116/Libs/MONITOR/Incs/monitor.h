@@ -0,0 +1,129 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file monitor.h
+///@author Pankil Butala (MCL, BU)
+///\brief monitor module publishes streams computed from the bursts to monitoring clients (header)
+///
+/// The control client drives the captures on its own socket. Monitoring clients ( displays,
+/// loggers ) connect to a second port and subscribe to streams, each one a reduced view of the
+/// bursts such as an envelope or a spectrum, per channel and at most every INTERVAL ms. A
+/// client may subscribe to several streams and change a subscription at any time by sending a
+/// new subscription message, MONITOR_SUB_LEN bytes, for the same stream.
+///
+/// The monitor thread accepts the clients and reads their subscriptions. The pipeline stages
+/// ask monitor_due() which subscriptions want the burst they are processing, build one message
+/// for each and hand it to monitor_send(), which never waits. The client sockets do not block:
+/// what the socket does not take at once is kept, one message per client, and sent by the
+/// monitor thread. The messages of a client never interleave, the subscriptions of a client
+/// holding a message back are not due and a message sent meanwhile is dropped, and a client
+/// that does not take a message within MONITOR_SEND_TIMEOUT is disconnected. A slow display
+/// misses bursts, it never holds the captures back.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _MONITOR_H_
+#define _MONITOR_H_
+
+#include <stdio.h>
+
+/* defines */
+#define MONITOR_MAX_CLIENTS		8					/*!< Monitoring clients connected at once */
+#define MONITOR_MAX_STREAMS		4					/*!< Streams 1..MONITOR_MAX_STREAMS-1 */
+#define MONITOR_MAX_CHANNELS	8					/*!< Channels, bit channel of the MONITOR_SUB_CHNL mask */
+#define MONITOR_SEND_TIMEOUT	200					/*!< Longest time a message may be held back, ms, the client is disconnected after that */
+#define MONITOR_SNDBUF			(256*1024)			/*!< Socket send buffer of a client, bytes */
+#define MONITOR_POLL_MS			50					/*!< Longest wait of the monitor thread before it checks for a stop */
+
+// Subscription message, sent by a monitoring client (little endian)
+#define MONITOR_SUB_STREAM		0x00				/*!< stream, 1..MONITOR_MAX_STREAMS-1 */
+#define MONITOR_SUB_CHNL		0x01				/*!< mask of the channels, 0 to unsubscribe from the stream */
+#define MONITOR_SUB_FLAGS		0x02				/*!< 16 bit, stream specific */
+#define MONITOR_SUB_POINTS		0x04				/*!< 16 bit, points per message */
+#define MONITOR_SUB_INTERVAL	0x06				/*!< 16 bit, ms between two messages of a channel at least, 0 for every burst */
+#define MONITOR_SUB_ARG			0x08				/*!< 32 bit, stream specific */
+#define MONITOR_SUB_LEN			0x0C
+
+/**
+ * Subscription of one client to one stream, as returned by monitor_due().
+ */
+typedef struct {
+	unsigned int stream;							/*!< stream */
+	unsigned int client;							/*!< client slot, for monitor_send() */
+	unsigned int id;								/*!< connection number of the client, for monitor_send() */
+	unsigned int flags;								/*!< MONITOR_SUB_FLAGS */
+	unsigned int points;							/*!< MONITOR_SUB_POINTS */
+	unsigned int interval;							/*!< MONITOR_SUB_INTERVAL */
+	unsigned int arg;								/*!< MONITOR_SUB_ARG */
+} MONITOR_SUBSCRIPTION;
+
+/* error codes */
+#define MONITOR_ERR_OK			0					/*!< No error encountered during execution. */
+#define MONITOR_ERR_RUNNING		-1					/*!< monitor_start() has been called already. */
+#define MONITOR_ERR_NOT_RUNNING	-2					/*!< monitor_start() has not been called. */
+#define MONITOR_ERR_SOCKET		-3					/*!< The port could not be opened or the thread created. */
+#define MONITOR_ERR_CLOSED		-4					/*!< The client has left or has been disconnected. */
+#define MONITOR_ERR_ARGUMENT	-5					/*!< An argument is NULL or out of range. */
+#define MONITOR_ERR_BUSY		-6					/*!< The client has not taken its previous message yet, the message is dropped. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Open the monitoring port and start the monitor thread. Winsock has to be started already.
+ *
+ * @param	port	TCP port of the monitoring clients.
+ * @return  - MONITOR_ERR_OK
+ *			- MONITOR_ERR_RUNNING
+ *			- MONITOR_ERR_SOCKET
+ */
+int monitor_start(unsigned short port);
+
+/**
+ * Obtain the subscriptions to a stream that want a message for the current burst of a channel, their interval has
+ * elapsed and their client is not holding a message back. The subscriptions returned count as served, the caller
+ * sends them a message.
+ *
+ * @param	stream	stream, 1..MONITOR_MAX_STREAMS-1.
+ * @param	channel	channel of the burst, 0..MONITOR_MAX_CHANNELS-1.
+ * @param	subs	receives the subscriptions.
+ * @param	max	capacity of subs, MONITOR_MAX_CLIENTS for all of them.
+ * @return  number of subscriptions, 0 when none is due or the monitor does not run.
+ */
+unsigned int monitor_due(unsigned int stream, unsigned int channel, MONITOR_SUBSCRIPTION *subs, unsigned int max);
+
+/**
+ * Send a message to the client of a subscription, the call never waits. The part the socket does not take at once is
+ * copied and sent by the monitor thread, a message finding the previous one still held back is dropped.
+ *
+ * @param	sub	subscription returned by monitor_due().
+ * @param	msg	message.
+ * @param	len	bytes of the message.
+ * @return  - MONITOR_ERR_OK
+ *			- MONITOR_ERR_NOT_RUNNING
+ *			- MONITOR_ERR_CLOSED
+ *			- MONITOR_ERR_ARGUMENT
+ *			- MONITOR_ERR_BUSY
+ */
+int monitor_send(const MONITOR_SUBSCRIPTION *sub, const void *msg, unsigned int len);
+
+/**
+ * Print the clients served, the messages sent, dropped and bytes sent per stream and the clients disconnected.
+ *
+ * @param	out	stream receiving the report, stdout for the console.
+ */
+void monitor_report(FILE *out);
+
+/**
+ * Disconnect the clients, close the port and wait for the monitor thread to leave.
+ *
+ * @return  - MONITOR_ERR_OK
+ *			- MONITOR_ERR_NOT_RUNNING
+ */
+int monitor_stop(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_MONITOR_H_
@@ -0,0 +1,426 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file pipeline.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief pipeline module runs the processing stages of the channels on a pool of threads (implementation)
+///
+/// The bursts of a channel go through the same list of stages ( alignment, demodulation, ... ).
+/// Each stage of each channel is a task of a work stealing thread pool: a worker runs the tasks
+/// of its own queue, most recently scheduled first so that the next stage of a burst runs on
+/// the core that has just produced it, and takes the oldest task of another worker when its own
+/// queue is empty. Throughput grows with the number of cores rather than with the number of
+/// channels, several channels being processed at once.
+///
+/// A stage of a channel is never run by two workers at the same time and the bursts move from
+/// one stage to the next through lock free single producer single consumer queues, so that the
+/// bursts of a channel leave the pipeline in the order they entered it. The stages of different
+/// channels share nothing but the pool, a stage may use per channel state without any lock.
+///
+/// pipeline_submit() and pipeline_collect() are called by one thread only, the server thread,
+/// which captures the bursts and sends the results.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "pipeline.h"
+
+#define PIPELINE_CACHE_LINE		64					/*!< Padding between the indexes written by different threads */
+#define PIPELINE_NB_TASKS		(PIPELINE_MAX_CHANNELS*PIPELINE_MAX_STAGES)	/*!< Tasks of the pool, one per stage of each channel */
+
+/**
+ * Lock free single producer single consumer queue of bursts. head is only written by the producer, tail by the consumer,
+ * each on its own cache line. The queue holds PIPELINE_DEPTH bursts, the number of bursts of a channel in the pipeline.
+ */
+typedef struct {
+	volatile LONG head;								/*!< bursts pushed so far */
+	char pad0[PIPELINE_CACHE_LINE-sizeof(LONG)];
+	volatile LONG tail;								/*!< bursts popped so far */
+	char pad1[PIPELINE_CACHE_LINE-sizeof(LONG)];
+	void *item[PIPELINE_DEPTH];						/*!< bursts, slot index&(PIPELINE_DEPTH-1) */
+} pipeline_queue;
+
+/**
+ * One stage of one channel. scheduled is 1 from the time the task is pushed to a worker queue until the task finds its
+ * input queue empty, the task is therefore never run by two workers at once.
+ */
+typedef struct {
+	unsigned int channel;							/*!< channel */
+	unsigned int stage;								/*!< stage, 0..nbstages-1 */
+	volatile LONG scheduled;						/*!< 1 while queued or running */
+	char pad[PIPELINE_CACHE_LINE-2*sizeof(unsigned int)-sizeof(LONG)];
+	pipeline_queue in;								/*!< bursts waiting for this stage */
+} pipeline_task;
+
+/**
+ * One worker and its task queue. The owner pushes and pops at the bottom, the other workers steal at the top. Every task
+ * is in one queue at most, PIPELINE_NB_TASKS slots are enough.
+ */
+typedef struct {
+	unsigned int index;								/*!< worker number */
+	HANDLE hthread;									/*!< worker thread */
+	CRITICAL_SECTION lock;							/*!< protects top, bottom and task */
+	volatile unsigned int top;						/*!< oldest task, stolen first */
+	volatile unsigned int bottom;					/*!< one past the newest task */
+	pipeline_task *task[PIPELINE_NB_TASKS];			/*!< tasks, slot index%PIPELINE_NB_TASKS */
+	unsigned long long processed;					/*!< bursts processed, only written by the worker */
+	unsigned long long stolen;						/*!< tasks stolen, only written by the worker */
+	TRACE_HIST stage[PIPELINE_MAX_STAGES];			/*!< processing time per stage, only written by the worker */
+} pipeline_worker;
+
+/**
+ * Pool state. collect[channel] receives the bursts leaving the last stage, the server thread is its consumer.
+ */
+typedef struct {
+	int active;										/*!< 1 between pipeline_start() and pipeline_stop() */
+	volatile LONG stop;								/*!< 1 when the workers have to leave */
+	unsigned int nbworkers;							/*!< threads of the pool */
+	unsigned int nbready;							/*!< workers whose lock has been initialized, the first ones */
+	unsigned int nbchannels;						/*!< channels */
+	unsigned int nbstages;							/*!< stages per channel */
+	PIPELINE_STAGE stage[PIPELINE_MAX_STAGES];		/*!< stages */
+	void *context;									/*!< passed to the stages */
+	HANDLE hwork;									/*!< semaphore released for the sleeping workers when a task is scheduled */
+	HANDLE hdone;									/*!< auto reset event set when a burst leaves the last stage */
+	volatile LONG idle;								/*!< workers sleeping on hwork */
+	volatile LONG scheduled;						/*!< tasks scheduled */
+	unsigned int inflight[PIPELINE_MAX_CHANNELS];	/*!< bursts of each channel in the pipeline, only touched by the server thread */
+	pipeline_task *task;							/*!< nbchannels*nbstages tasks, task[channel*nbstages+stage] */
+	pipeline_queue *collect;						/*!< nbchannels queues */
+	pipeline_worker *worker;						/*!< nbworkers workers */
+} pipeline;
+
+static pipeline g_pipe;								/*!< The one and only pool */
+
+
+/**
+ * Push a burst, called by the producer of the queue only. The queue is never full, the number of bursts of a channel
+ * is limited by pipeline_submit().
+ */
+static void pipeline_push(pipeline_queue *queue, void *item)
+{
+	LONG head = queue->head;
+
+	queue->item[head&(PIPELINE_DEPTH-1)] = item;
+	// the burst is visible before the new head
+	MemoryBarrier();
+	queue->head = head+1;
+}
+
+/**
+ * Pop a burst, called by the consumer of the queue only.
+ *
+ * @return 1 when a burst has been popped, 0 when the queue is empty.
+ */
+static int pipeline_pop(pipeline_queue *queue, void **item)
+{
+	LONG tail = queue->tail;
+
+	if(queue->head==tail)
+		return 0;
+	// the burst is read after the head that published it
+	MemoryBarrier();
+	*item = queue->item[tail&(PIPELINE_DEPTH-1)];
+	MemoryBarrier();
+	queue->tail = tail+1;
+	return 1;
+}
+
+/**
+ * Schedule a task unless it is queued or running already. The task goes to the queue of the calling worker, to the
+ * queue of a worker chosen by channel when the server thread calls.
+ *
+ * @param	self	calling worker, NULL for the server thread.
+ */
+static void pipeline_schedule(pipeline_worker *self, pipeline_task *task)
+{
+	pipeline_worker *worker;
+
+	if(InterlockedCompareExchange(&task->scheduled, 1, 0)!=0)
+		return;
+	worker = self ? self : &g_pipe.worker[task->channel%g_pipe.nbworkers];
+
+	EnterCriticalSection(&worker->lock);
+	worker->task[worker->bottom%PIPELINE_NB_TASKS] = task;
+	worker->bottom++;
+	LeaveCriticalSection(&worker->lock);
+	InterlockedIncrement(&g_pipe.scheduled);
+
+	// a worker going to sleep counts itself idle before looking at the queues one last time
+	MemoryBarrier();
+	if(g_pipe.idle>0)
+		ReleaseSemaphore(g_pipe.hwork, 1, NULL);
+}
+
+/**
+ * Take the newest task of a worker's own queue, or the oldest task of another worker.
+ *
+ * @return the task, NULL when every queue is empty.
+ */
+static pipeline_task *pipeline_findtask(pipeline_worker *self)
+{
+	pipeline_task *task = NULL;
+	pipeline_worker *victim;
+
+	EnterCriticalSection(&self->lock);
+	if(self->bottom!=self->top) {
+		self->bottom--;
+		task = self->task[self->bottom%PIPELINE_NB_TASKS];
+	}
+	LeaveCriticalSection(&self->lock);
+	if(task)
+		return task;
+
+	for(unsigned int i = 1; i < g_pipe.nbworkers && !task; i++) {
+		victim = &g_pipe.worker[(self->index+i)%g_pipe.nbworkers];
+		if(victim->bottom==victim->top)
+			continue;
+		EnterCriticalSection(&victim->lock);
+		if(victim->bottom!=victim->top) {
+			task = victim->task[victim->top%PIPELINE_NB_TASKS];
+			victim->top++;
+		}
+		LeaveCriticalSection(&victim->lock);
+	}
+	if(task)
+		self->stolen++;
+	return task;
+}
+
+/**
+ * Run a task until its input queue is empty, every burst is passed on to the next stage.
+ */
+static void pipeline_run(pipeline_worker *self, pipeline_task *task)
+{
+	pipeline_task *next = task->stage+1<g_pipe.nbstages ? task+1 : NULL;
+	PIPELINE_FUNCTION function = g_pipe.stage[task->stage].function;
+	unsigned long long start;
+	void *item;
+
+	for(;;) {
+		while(pipeline_pop(&task->in, &item)) {
+			start = trace_now();
+			function(g_pipe.context, task->channel, item);
+			trace_histadd(&self->stage[task->stage], trace_now()-start);
+			self->processed++;
+
+			if(next) {
+				pipeline_push(&next->in, item);
+				pipeline_schedule(self, next);
+			}
+			else {
+				pipeline_push(&g_pipe.collect[task->channel], item);
+				SetEvent(g_pipe.hdone);
+			}
+		}
+
+		// a burst pushed between the last pop and the release schedules the task again, or is found here
+		InterlockedExchange(&task->scheduled, 0);
+		if(task->in.head==task->in.tail || InterlockedCompareExchange(&task->scheduled, 1, 0)!=0)
+			break;
+	}
+}
+
+static DWORD WINAPI pipeline_thread(LPVOID arg)
+{
+	pipeline_worker *self = (pipeline_worker *)arg;
+	pipeline_task *task;
+
+	while(!g_pipe.stop) {
+		task = pipeline_findtask(self);
+		if(task) {
+			pipeline_run(self, task);
+			continue;
+		}
+
+		// idle first, then a last look, pipeline_schedule() either sees the idle worker or the task is found here
+		InterlockedIncrement(&g_pipe.idle);
+		task = pipeline_findtask(self);
+		if(!task && !g_pipe.stop)
+			WaitForSingleObject(g_pipe.hwork, PIPELINE_IDLE_MS);
+		InterlockedDecrement(&g_pipe.idle);
+		if(task)
+			pipeline_run(self, task);
+	}
+
+	return 0;
+}
+
+/**
+ * Release the threads, handles and buffers of the pool. The threads are asked to stop first.
+ */
+static void pipeline_release(void)
+{
+	g_pipe.stop = 1;
+	// the workers after nbready were never initialized, they have neither a thread nor a lock
+	if(g_pipe.worker) {
+		for(unsigned int i = 0; i < g_pipe.nbready; i++) {
+			if(g_pipe.worker[i].hthread)
+				ReleaseSemaphore(g_pipe.hwork, 1, NULL);
+		}
+		for(unsigned int i = 0; i < g_pipe.nbready; i++) {
+			if(g_pipe.worker[i].hthread) {
+				WaitForSingleObject(g_pipe.worker[i].hthread, INFINITE);
+				CloseHandle(g_pipe.worker[i].hthread);
+			}
+			DeleteCriticalSection(&g_pipe.worker[i].lock);
+		}
+	}
+	if(g_pipe.hwork)
+		CloseHandle(g_pipe.hwork);
+	if(g_pipe.hdone)
+		CloseHandle(g_pipe.hdone);
+	_aligned_free(g_pipe.task);
+	_aligned_free(g_pipe.collect);
+	_aligned_free(g_pipe.worker);
+	memset(&g_pipe, 0, sizeof(g_pipe));
+}
+
+int pipeline_start(unsigned int nbworkers, unsigned int nbchannels, const PIPELINE_STAGE *stages, unsigned int nbstages, void *context)
+{
+	SYSTEM_INFO info;
+
+	if(g_pipe.active)
+		return PIPELINE_ERR_RUNNING;
+	if(!stages || nbchannels==0 || nbchannels>PIPELINE_MAX_CHANNELS || nbstages==0 || nbstages>PIPELINE_MAX_STAGES)
+		return PIPELINE_ERR_ARGUMENT;
+	for(unsigned int i = 0; i < nbstages; i++) {
+		if(!stages[i].function)
+			return PIPELINE_ERR_ARGUMENT;
+	}
+
+	// the server thread captures while the workers process
+	if(nbworkers==0) {
+		GetSystemInfo(&info);
+		nbworkers = info.dwNumberOfProcessors>1 ? info.dwNumberOfProcessors-1 : 1;
+	}
+	if(nbworkers>PIPELINE_MAX_WORKERS)
+		nbworkers = PIPELINE_MAX_WORKERS;
+
+	memset(&g_pipe, 0, sizeof(g_pipe));
+	g_pipe.nbworkers = nbworkers;
+	g_pipe.nbchannels = nbchannels;
+	g_pipe.nbstages = nbstages;
+	memcpy(g_pipe.stage, stages, nbstages*sizeof(PIPELINE_STAGE));
+	g_pipe.context = context;
+
+	g_pipe.task = (pipeline_task *)_aligned_malloc(nbchannels*nbstages*sizeof(pipeline_task), PIPELINE_CACHE_LINE);
+	g_pipe.collect = (pipeline_queue *)_aligned_malloc(nbchannels*sizeof(pipeline_queue), PIPELINE_CACHE_LINE);
+	g_pipe.worker = (pipeline_worker *)_aligned_malloc(nbworkers*sizeof(pipeline_worker), PIPELINE_CACHE_LINE);
+	// cleared before anything may fail, pipeline_release() only sees zeroed or initialized workers
+	if(g_pipe.task)
+		memset(g_pipe.task, 0, nbchannels*nbstages*sizeof(pipeline_task));
+	if(g_pipe.collect)
+		memset(g_pipe.collect, 0, nbchannels*sizeof(pipeline_queue));
+	if(g_pipe.worker)
+		memset(g_pipe.worker, 0, nbworkers*sizeof(pipeline_worker));
+	g_pipe.hwork = CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL);
+	g_pipe.hdone = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if(!g_pipe.task || !g_pipe.collect || !g_pipe.worker || !g_pipe.hwork || !g_pipe.hdone) {
+		pipeline_release();
+		return PIPELINE_ERR_ALLOC;
+	}
+	for(unsigned int i = 0; i < nbchannels*nbstages; i++) {
+		g_pipe.task[i].channel = i/nbstages;
+		g_pipe.task[i].stage = i%nbstages;
+	}
+
+	for(unsigned int i = 0; i < nbworkers; i++) {
+		g_pipe.worker[i].index = i;
+		InitializeCriticalSection(&g_pipe.worker[i].lock);
+		g_pipe.nbready = i+1;
+	}
+	for(unsigned int i = 0; i < nbworkers; i++) {
+		g_pipe.worker[i].hthread = CreateThread(NULL, 0, pipeline_thread, &g_pipe.worker[i], 0, NULL);
+		if(!g_pipe.worker[i].hthread) {
+			pipeline_release();
+			return PIPELINE_ERR_ALLOC;
+		}
+	}
+
+	g_pipe.active = 1;
+	return PIPELINE_ERR_OK;
+}
+
+int pipeline_submit(unsigned int channel, void *item)
+{
+	pipeline_task *first;
+
+	if(!g_pipe.active)
+		return PIPELINE_ERR_NOT_RUNNING;
+	if(channel>=g_pipe.nbchannels)
+		return PIPELINE_ERR_ARGUMENT;
+	// no queue of the channel can overflow
+	if(g_pipe.inflight[channel]==PIPELINE_DEPTH)
+		return PIPELINE_ERR_FULL;
+
+	g_pipe.inflight[channel]++;
+	first = &g_pipe.task[channel*g_pipe.nbstages];
+	pipeline_push(&first->in, item);
+	pipeline_schedule(NULL, first);
+	return PIPELINE_ERR_OK;
+}
+
+int pipeline_collect(unsigned int channel, void **item, unsigned long timeoutms)
+{
+	if(!g_pipe.active)
+		return PIPELINE_ERR_NOT_RUNNING;
+	if(channel>=g_pipe.nbchannels || !item)
+		return PIPELINE_ERR_ARGUMENT;
+
+	// hdone is shared by the channels, the queue is checked again after every wake up
+	while(!pipeline_pop(&g_pipe.collect[channel], item)) {
+		if(g_pipe.inflight[channel]==0 || WaitForSingleObject(g_pipe.hdone, timeoutms)!=WAIT_OBJECT_0)
+			return PIPELINE_ERR_TIMEOUT;
+	}
+	g_pipe.inflight[channel]--;
+	return PIPELINE_ERR_OK;
+}
+
+int pipeline_getstats(PIPELINE_STATS *stats)
+{
+	if(!g_pipe.active)
+		return PIPELINE_ERR_NOT_RUNNING;
+	if(!stats)
+		return PIPELINE_ERR_ARGUMENT;
+
+	memset(stats, 0, sizeof(PIPELINE_STATS));
+	stats->nbworkers = g_pipe.nbworkers;
+	stats->scheduled = (unsigned long long)(unsigned long)g_pipe.scheduled;
+	for(unsigned int i = 0; i < g_pipe.nbworkers; i++) {
+		stats->processed += g_pipe.worker[i].processed;
+		stats->stolen += g_pipe.worker[i].stolen;
+		for(unsigned int j = 0; j < g_pipe.nbstages; j++)
+			trace_histmerge(&stats->stage[j], &g_pipe.worker[i].stage[j]);
+	}
+	return PIPELINE_ERR_OK;
+}
+
+void pipeline_report(FILE *out)
+{
+	static PIPELINE_STATS stats;
+	const TRACE_HIST *hist;
+
+	if(pipeline_getstats(&stats)!=PIPELINE_ERR_OK)
+		return;
+
+	fprintf(out, "---------------------------- Pipeline (us) ---------------------------\n");
+	fprintf(out, "%u workers, %llu bursts processed, %llu tasks scheduled, %llu stolen\n", stats.nbworkers, stats.processed,
+		stats.scheduled, stats.stolen);
+	fprintf(out, "%-16s %8s %10s %10s %10s %10s\n", "", "count", "mean", "p50", "p99", "max");
+	for(unsigned int i = 0; i < g_pipe.nbstages; i++) {
+		hist = &stats.stage[i];
+		if(hist->count)
+			fprintf(out, "%-16.16s %8lu %10.1f %10llu %10llu %10llu\n", g_pipe.stage[i].name ? g_pipe.stage[i].name : "", hist->count,
+				(double)hist->total/hist->count, trace_percentile(hist, 50.0), trace_percentile(hist, 99.0), hist->max);
+	}
+	fprintf(out, "----------------------------------------------------------------------\n");
+}
+
+int pipeline_stop(void)
+{
+	if(!g_pipe.active)
+		return PIPELINE_ERR_NOT_RUNNING;
+
+	pipeline_release();
+	return PIPELINE_ERR_OK;
+}
@@ -0,0 +1,147 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file pipeline.h
+///@author Pankil Butala (MCL, BU)
+///\brief pipeline module runs the processing stages of the channels on a pool of threads (header)
+///
+/// The bursts of a channel go through the same list of stages ( alignment, demodulation, ... ).
+/// Each stage of each channel is a task of a work stealing thread pool: a worker runs the tasks
+/// of its own queue, most recently scheduled first so that the next stage of a burst runs on
+/// the core that has just produced it, and takes the oldest task of another worker when its own
+/// queue is empty. Throughput grows with the number of cores rather than with the number of
+/// channels, several channels being processed at once.
+///
+/// A stage of a channel is never run by two workers at the same time and the bursts move from
+/// one stage to the next through lock free single producer single consumer queues, so that the
+/// bursts of a channel leave the pipeline in the order they entered it. The stages of different
+/// channels share nothing but the pool, a stage may use per channel state without any lock.
+///
+/// pipeline_submit() and pipeline_collect() are called by one thread only, the server thread,
+/// which captures the bursts and sends the results.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <stdio.h>
+#include "trace.h"
+
+/* defines */
+#define PIPELINE_MAX_WORKERS	64					/*!< Largest thread pool */
+#define PIPELINE_MAX_CHANNELS	16					/*!< Channels, 0..PIPELINE_MAX_CHANNELS-1 */
+#define PIPELINE_MAX_STAGES		8					/*!< Stages per channel */
+#define PIPELINE_DEPTH			8					/*!< Bursts of a channel in the pipeline at once, power of 2 */
+#define PIPELINE_IDLE_MS		10					/*!< Longest sleep of an idle worker before it looks for tasks again */
+
+/**
+ * Processing of one burst by one stage.
+ *
+ * @param	context	pointer given to pipeline_start().
+ * @param	channel	channel of the burst.
+ * @param	item	burst given to pipeline_submit().
+ */
+typedef void (*PIPELINE_FUNCTION)(void *context, unsigned int channel, void *item);
+
+/**
+ * One stage of the pipeline.
+ */
+typedef struct {
+	PIPELINE_FUNCTION function;						/*!< processing of a burst */
+	const char *name;								/*!< name in pipeline_report(), kept by pointer */
+} PIPELINE_STAGE;
+
+/**
+ * Activity of the pool since pipeline_start().
+ */
+typedef struct {
+	unsigned int nbworkers;							/*!< threads of the pool */
+	unsigned long long processed;					/*!< bursts processed by a stage */
+	unsigned long long scheduled;					/*!< tasks scheduled */
+	unsigned long long stolen;						/*!< tasks taken from the queue of another worker */
+	TRACE_HIST stage[PIPELINE_MAX_STAGES];			/*!< processing time of a burst, per stage */
+} PIPELINE_STATS;
+
+/* error codes */
+#define PIPELINE_ERR_OK			0					/*!< No error encountered during execution. */
+#define PIPELINE_ERR_RUNNING	-1					/*!< pipeline_start() has been called already. */
+#define PIPELINE_ERR_NOT_RUNNING	-2				/*!< pipeline_start() has not been called. */
+#define PIPELINE_ERR_ALLOC		-3					/*!< The worker threads could not be created. */
+#define PIPELINE_ERR_FULL		-4					/*!< PIPELINE_DEPTH bursts of the channel are in the pipeline already. */
+#define PIPELINE_ERR_TIMEOUT	-5					/*!< No burst of the channel left the pipeline in time. */
+#define PIPELINE_ERR_ARGUMENT	-6					/*!< An argument is NULL or out of range. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Start the worker threads.
+ *
+ * @param	nbworkers	threads of the pool, 0 for one per processor but the one left to the server thread.
+ * @param	nbchannels	channels, 1..PIPELINE_MAX_CHANNELS.
+ * @param	stages	stages run in order on every burst, copied.
+ * @param	nbstages	number of stages, 1..PIPELINE_MAX_STAGES.
+ * @param	context	pointer passed to every stage.
+ * @return  - PIPELINE_ERR_OK
+ *			- PIPELINE_ERR_RUNNING
+ *			- PIPELINE_ERR_ALLOC
+ *			- PIPELINE_ERR_ARGUMENT
+ */
+int pipeline_start(unsigned int nbworkers, unsigned int nbchannels, const PIPELINE_STAGE *stages, unsigned int nbstages, void *context);
+
+/**
+ * Give a burst to the first stage of a channel, the call does not wait for the processing.
+ *
+ * @param	channel	channel of the burst.
+ * @param	item	burst, owned by the pipeline until pipeline_collect() returns it.
+ * @return  - PIPELINE_ERR_OK
+ *			- PIPELINE_ERR_NOT_RUNNING
+ *			- PIPELINE_ERR_FULL
+ *			- PIPELINE_ERR_ARGUMENT
+ */
+int pipeline_submit(unsigned int channel, void *item);
+
+/**
+ * Wait for the oldest burst of a channel to leave the last stage.
+ *
+ * @param	channel	channel of the burst.
+ * @param	item	receives the burst given to pipeline_submit().
+ * @param	timeoutms	longest wait in ms, INFINITE to wait until the burst is processed.
+ * @return  - PIPELINE_ERR_OK
+ *			- PIPELINE_ERR_NOT_RUNNING
+ *			- PIPELINE_ERR_TIMEOUT
+ *			- PIPELINE_ERR_ARGUMENT
+ */
+int pipeline_collect(unsigned int channel, void **item, unsigned long timeoutms);
+
+/**
+ * Obtain the activity of the pool. The counters of the workers are read while they run, they may lag by a few bursts.
+ *
+ * @param	stats	receives the activity.
+ * @return  - PIPELINE_ERR_OK
+ *			- PIPELINE_ERR_NOT_RUNNING
+ *			- PIPELINE_ERR_ARGUMENT
+ */
+int pipeline_getstats(PIPELINE_STATS *stats);
+
+/**
+ * Print the activity of the pool and count, mean, p50, p99 and max of every stage.
+ *
+ * @param	out	stream receiving the report, stdout for the console.
+ */
+void pipeline_report(FILE *out);
+
+/**
+ * Stop the worker threads and wait for them to leave. The bursts still in the pipeline are dropped.
+ *
+ * @return  - PIPELINE_ERR_OK
+ *			- PIPELINE_ERR_NOT_RUNNING
+ */
+int pipeline_stop(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_PIPELINE_H_
@@ -0,0 +1,317 @@
+/**
+@file sipif_bench.cpp
+@author Pankil Butala (MCL, BU)
+@brief sipif transport micro-benchmark
+*************************************************************************/
+
+
+// system includes
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+// project includes
+#include "sipif.h"
+#include "sipif_standin.h"
+#include "trace.h"
+
+#define SYNTH_M						250				/*!< Reference value for M on the synthesizer frequency (f = M/N) */
+#define SYNTH_N						2				/*!< Reference value for N on the synthesizer frequency (f = M/N) */
+#define TIMEOUTDMA					2000			/*!< Timeout value is 2000 ms. */
+
+#define BENCH_TEST_REGISTER			0x1				/*!< {tests} bit, register read and write latency */
+#define BENCH_TEST_BATCH			0x2				/*!< {tests} bit, batched versus single register throughput */
+#define BENCH_TEST_BURST			0x4				/*!< {tests} bit, data burst throughput versus g_burstsize */
+#define BENCH_TEST_ALL				0x7				/*!< {tests} default */
+
+#define BENCH_REG_ITER				10000			/*!< Register reads and writes timed one by one */
+#define BENCH_BATCH_OPS				8192			/*!< Register reads per batch size, a multiple of SIPIF_MAX_BATCH */
+#define BENCH_BLOCK_SIZE			(1024*1024)		/*!< Bytes moved by one sipif_readdata()/sipif_writedata() */
+#define BENCH_BLOCK_ITER			16				/*!< Blocks moved per burst size and direction */
+
+#define BENCH_OP_READ				1				/*!< trace command ID of sipif_readsipreg() */
+#define BENCH_OP_WRITE				2				/*!< trace command ID of sipif_writesipreg() */
+
+extern unsigned int g_burstsize;					/*!< The burst size for transfers, see sipif.cpp */
+
+static const unsigned int g_batchsizes[] = { 1, 2, 4, 8, 16, 32, 64 };								/*!< sipif_transact() batch sizes */
+static const unsigned int g_burstsizes[] = { 1024, 2048, 4096, 8192, 16384, 32768, 65536 };		/*!< g_burstsize values, TCP/IP only */
+
+
+/**
+ *  Write the statistics of a latency histogram as a JSON object.
+ */
+static void WriteLatency(FILE *json, const char *name, const TRACE_HIST *hist)
+{
+	fprintf(json, "\t\t\"%s\": { \"count\": %lu, \"mean_us\": %.2f, \"min_us\": %llu, \"p50_us\": %llu, \"p90_us\": %llu, "
+		"\"p99_us\": %llu, \"p999_us\": %llu, \"max_us\": %llu }", name, hist->count, hist->count ? (double)hist->total/hist->count : 0.0,
+		hist->min, trace_percentile(hist, 50.0), trace_percentile(hist, 90.0), trace_percentile(hist, 99.0), trace_percentile(hist, 99.9),
+		hist->max);
+	printf("%-8s count %6lu   mean %8.1f us   p50 %6llu us   p99 %6llu us   p99.9 %6llu us   max %6llu us\n", name, hist->count,
+		hist->count ? (double)hist->total/hist->count : 0.0, trace_percentile(hist, 50.0), trace_percentile(hist, 99.0),
+		trace_percentile(hist, 99.9), hist->max);
+}
+
+/**
+ *  Time BENCH_REG_ITER register reads then BENCH_REG_ITER register writes, one round trip each.
+ *
+ *  @param json	output file.
+ *  @param addr	scratch register.
+ *  @return SIPIF_ERR_OK or the first sipif error met.
+ */
+static int BenchRegister(FILE *json, unsigned int addr)
+{
+	TRACE_SPAN span;
+	unsigned long value;
+	int rc;
+
+	printf("\nRegister latency ( address 0x%08X )\n", addr);
+	for(unsigned int i = 0; i < BENCH_REG_ITER; i++) {
+		trace_start(&span, BENCH_OP_READ, trace_now());
+		rc = sipif_readsipreg(addr, &value);
+		trace_end(&span);
+		if(rc!=SIPIF_ERR_OK)
+			return rc;
+	}
+	for(unsigned int i = 0; i < BENCH_REG_ITER; i++) {
+		trace_start(&span, BENCH_OP_WRITE, trace_now());
+		rc = sipif_writesipreg(addr, i);
+		trace_end(&span);
+		if(rc!=SIPIF_ERR_OK)
+			return rc;
+	}
+
+	fprintf(json, ",\n\t\"register\": {\n\t\t\"address\": %u,\n", addr);
+	WriteLatency(json, "read", trace_gethistcommand(BENCH_OP_READ));
+	fprintf(json, ",\n");
+	WriteLatency(json, "write", trace_gethistcommand(BENCH_OP_WRITE));
+	fprintf(json, "\n\t}");
+	return SIPIF_ERR_OK;
+}
+
+/**
+ *  Read BENCH_BATCH_OPS registers with sipif_readsipreg() ( batch size 0 in the output ), then with sipif_transact() for each
+ *  batch size of g_batchsizes.
+ *
+ *  @param json	output file.
+ *  @param addr	first register, BENCH_BATCH_OPS consecutive registers are read.
+ *  @return SIPIF_ERR_OK or the first sipif error met.
+ */
+static int BenchBatch(FILE *json, unsigned int addr)
+{
+	SIPIF_REGOP ops[SIPIF_MAX_BATCH];
+	unsigned long long start, elapsed;
+	unsigned long value;
+	unsigned int size;
+	int rc;
+
+	printf("\nRegister throughput ( %d reads )\n", BENCH_BATCH_OPS);
+	fprintf(json, ",\n\t\"batch\": [");
+	for(unsigned int b = 0; b <= sizeof(g_batchsizes)/sizeof(g_batchsizes[0]); b++) {
+		size = b==0 ? 0 : g_batchsizes[b-1];
+		start = trace_now();
+		for(unsigned int i = 0; i < BENCH_BATCH_OPS; ) {
+			if(size==0) {
+				rc = sipif_readsipreg(addr+i, &value);
+				i++;
+			}
+			else {
+				for(unsigned int j = 0; j < size; j++) {
+					ops[j].op = SIPIF_OP_READ;
+					ops[j].addr = addr+i+j;
+					ops[j].value = 0;
+				}
+				rc = sipif_transact(ops, size);
+				i += size;
+			}
+			if(rc!=SIPIF_ERR_OK) {
+				fprintf(json, "\n\t]");
+				return rc;
+			}
+		}
+		elapsed = trace_now()-start;
+		if(elapsed==0)
+			elapsed = 1;
+
+		fprintf(json, "%s\n\t\t{ \"batch\": %u, \"ops\": %u, \"elapsed_us\": %llu, \"ops_per_s\": %.1f }", b==0 ? "" : ",", size,
+			BENCH_BATCH_OPS, elapsed, BENCH_BATCH_OPS*1e6/elapsed);
+		if(size==0)
+			printf("single   %10.1f reads/s\n", BENCH_BATCH_OPS*1e6/elapsed);
+		else
+			printf("batch %2u %10.1f reads/s\n", size, BENCH_BATCH_OPS*1e6/elapsed);
+	}
+	fprintf(json, "\n\t]");
+	return SIPIF_ERR_OK;
+}
+
+/**
+ *  Move BENCH_BLOCK_ITER blocks of BENCH_BLOCK_SIZE bytes with sipif_readdata() then with sipif_writedata() for each value of
+ *  g_burstsizes. g_burstsize only splits the TCP/IP transfers, the other interfaces are measured once with the current value.
+ *
+ *  @param json	output file.
+ *  @param typeif	interface in use.
+ *  @return SIPIF_ERR_OK or the first sipif error met.
+ */
+static int BenchBurst(FILE *json, unsigned int typeif)
+{
+	unsigned int nbsizes = typeif==SIPIF_TCPIP_V4 ? sizeof(g_burstsizes)/sizeof(g_burstsizes[0]) : 1;
+	unsigned int burstsize = g_burstsize;
+	unsigned long long start, elapsed[2];
+	void *block;
+	int rc = SIPIF_ERR_OK;
+
+	block = _aligned_malloc(BENCH_BLOCK_SIZE, 4096);
+	if(block==NULL)
+		return SIPIF_ERR_NULL_ARGUMENT;
+	memset(block, 0, BENCH_BLOCK_SIZE);
+
+	printf("\nData throughput ( %d x %d bytes )\n", BENCH_BLOCK_ITER, BENCH_BLOCK_SIZE);
+	fprintf(json, ",\n\t\"burst\": [");
+	for(unsigned int s = 0; s < nbsizes && rc==SIPIF_ERR_OK; s++) {
+		if(typeif==SIPIF_TCPIP_V4)
+			g_burstsize = g_burstsizes[s];
+
+		start = trace_now();
+		for(unsigned int i = 0; i < BENCH_BLOCK_ITER && rc==SIPIF_ERR_OK; i++)
+			rc = sipif_readdata(block, BENCH_BLOCK_SIZE);
+		elapsed[0] = trace_now()-start+1;
+
+		start = trace_now();
+		for(unsigned int i = 0; i < BENCH_BLOCK_ITER && rc==SIPIF_ERR_OK; i++)
+			rc = sipif_writedata(block, BENCH_BLOCK_SIZE);
+		elapsed[1] = trace_now()-start+1;
+
+		if(rc==SIPIF_ERR_OK) {
+			// bytes per us are MB/s
+			fprintf(json, "%s\n\t\t{ \"burstsize\": %u, \"bytes\": %u, \"read_us\": %llu, \"read_mb_s\": %.2f, \"write_us\": %llu, \"write_mb_s\": %.2f }",
+				s==0 ? "" : ",", g_burstsize, BENCH_BLOCK_ITER*BENCH_BLOCK_SIZE, elapsed[0], (double)BENCH_BLOCK_ITER*BENCH_BLOCK_SIZE/elapsed[0],
+				elapsed[1], (double)BENCH_BLOCK_ITER*BENCH_BLOCK_SIZE/elapsed[1]);
+			printf("burst %6u   read %8.2f MB/s   write %8.2f MB/s\n", g_burstsize, (double)BENCH_BLOCK_ITER*BENCH_BLOCK_SIZE/elapsed[0],
+				(double)BENCH_BLOCK_ITER*BENCH_BLOCK_SIZE/elapsed[1]);
+		}
+	}
+	fprintf(json, "\n\t]");
+
+	g_burstsize = burstsize;
+	_aligned_free(block);
+	return rc;
+}
+
+/**
+ *  \brief sipif transport micro-benchmark (main).
+ *
+ *  This application measures the host to firmware transport so every transport change, NIC or firmware build can be
+ *  compared with a repeatable number. It runs against real hardware or against the in-process firmware stand-in.
+ *
+ *  Description of the software sequence :
+ *	- Check and convert arguments passed to the application.
+ *	- Start the firmware stand-in using sipif_standin_start() when requested.
+ *	- Open the device using sipif_init().
+ *	- Time register reads and writes one by one using sipif_readsipreg() and sipif_writesipreg().
+ *	- Compare the register throughput of single reads with sipif_transact() batches of 1 to SIPIF_MAX_BATCH reads.
+ *	- Measure sipif_readdata() and sipif_writedata() throughput for several g_burstsize values.
+ *	- Save the results as JSON.
+ *
+ *  @param argc the command line
+ *  @param argv the number of options in the command line.
+ *  @return 0 ( success ) or any other error code.
+ */
+int main(int argc, char* argv[])
+{
+	int ifType;
+	const char *devType;
+	int devIdx;
+	unsigned int addr;
+	unsigned int tests = BENCH_TEST_ALL;
+	int standin;
+	FILE *json;
+	int rc = SIPIF_ERR_OK;
+
+	// Parse the application arguments
+	if(argc!=6 && argc!=7) {
+		printf("Usage: SipifBench.exe {interface type} {device type} {device index} {register address} {json file} [{tests}]\n\n");
+		printf(" {interface type} can be either 0 (PCI) or 1 (Ethernet) or 2 (TCPIP) or 3 (local firmware stand-in)\n");
+		printf(" {device type} is a string defining the target hardware (VP680, ML605, KC705, VC707 ...)\n");
+		printf(" {device type} is an ip address when using TCPIP interface, it is ignored by the stand-in\n");
+		printf(" {device index} is a PCI index or an Ethernet interface index or a TCPIP port when using TCPIP interface or the stand-in\n");
+		printf(" {register address} is a register the benchmark may read and overwrite, in hexadecimal\n");
+		printf("    the throughput test reads %d consecutive registers from there\n", BENCH_BATCH_OPS);
+		printf(" {json file} receives the results\n");
+		printf(" {tests} sum of the tests to run, all by default\n");
+		printf("	1  Register latency\n");
+		printf("	2  Batched versus single register throughput\n");
+		printf("	4  Data throughput, the firmware has to accept and produce data ( configure it with FMC116App.exe first )\n");
+		printf("\n");
+		return -1;
+	}
+
+	// Convert arguments
+	ifType = atoi(argv[1]);
+	devType = (const char *)argv[2];
+	devIdx = atoi(argv[3]);
+	addr = (unsigned int)strtoul(argv[4], NULL, 16);
+	if(argc==7)
+		tests = (unsigned int)atoi(argv[6]);
+
+	// translate interface type to the sipif values
+	standin = ifType==3;
+	if(ifType==0)
+		ifType = SIPIF_4FM;
+	else if(ifType==1)
+		ifType = SIPIF_ETHAPI;
+	else
+		ifType = SIPIF_TCPIP_V4;
+
+	if(standin) {
+		devType = SIPIF_STANDIN_IP;
+		if(devIdx==0)
+			devIdx = SIPIF_STANDIN_PORT;
+		if(sipif_standin_start((unsigned short)devIdx)!=SIPIF_STANDIN_ERR_OK) {
+			printf("Could not start the firmware stand-in on port %d\n", devIdx);
+			return -2;
+		}
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Open one of the device from a given device ID argument
+	if(sipif_init(ifType, devType, devIdx, TIMEOUTDMA, SYNTH_M, SYNTH_N) != SIPIF_ERR_OK) {
+		printf("Could not open device %d\n", devIdx);
+		sipif_free();
+		if(standin)
+			sipif_standin_stop();
+		return -3;
+	}
+
+	json = fopen(argv[5], "w");
+	if(json==NULL) {
+		printf("Could not open '%s' with write access\n", argv[5]);
+		sipif_free();
+		if(standin)
+			sipif_standin_stop();
+		return -4;
+	}
+
+	trace_init();
+	fprintf(json, "{\n\t\"interface\": %d,\n\t\"device\": \"%s\",\n\t\"index\": %d,\n\t\"standin\": %s,\n\t\"burstsize\": %u",
+		ifType, devType, devIdx, standin ? "true" : "false", g_burstsize);
+
+	if(rc==SIPIF_ERR_OK && (tests&BENCH_TEST_REGISTER))
+		rc = BenchRegister(json, addr);
+	if(rc==SIPIF_ERR_OK && (tests&BENCH_TEST_BATCH))
+		rc = BenchBatch(json, addr);
+	if(rc==SIPIF_ERR_OK && (tests&BENCH_TEST_BURST))
+		rc = BenchBurst(json, ifType);
+
+	fprintf(json, ",\n\t\"error\": %d\n}\n", rc);
+	fclose(json);
+	if(rc!=SIPIF_ERR_OK)
+		printf("\nBenchmark stopped by sipif error %d\n", rc);
+	printf("\nResults saved to %s\n", argv[5]);
+
+	sipif_free();
+	if(standin)
+		sipif_standin_stop();
+	return rc==SIPIF_ERR_OK ? 0 : -5;
+}
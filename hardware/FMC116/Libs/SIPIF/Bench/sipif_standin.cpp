@@ -0,0 +1,186 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file sipif_standin.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief sipif_standin module emulates the TCP/IP firmware on the local host (implementation)
+///
+/// The stand-in answers the StellarIP packets used by the SIPIF_TCPIP_V4 layer ( register reads
+/// and writes, data bursts in both directions ) from a thread of the calling process. It allows
+/// running sipif based tools without hardware, e.g. to measure the host side cost of the transport.
+/// Register values are kept in memory, data read back is a counting pattern and data written is
+/// discarded.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <winsock2.h>
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include "sipif.h"
+#include "sipif_standin.h"
+
+/**
+ * Stand-in state.
+ */
+typedef struct {
+	SOCKET listener;									/*!< listening socket */
+	SOCKET client;										/*!< connection of the sipif layer */
+	HANDLE hthread;										/*!< stand-in thread */
+	int active;											/*!< 1 between sipif_standin_start() and sipif_standin_stop() */
+	unsigned long regs[SIPIF_STANDIN_NB_REGS];			/*!< register space */
+	unsigned char pattern[SIPIF_STANDIN_CHUNK];			/*!< data sent back for STELLAR_OPCODE_READ_DATA */
+	unsigned char sink[SIPIF_STANDIN_CHUNK];			/*!< data received for STELLAR_OPCODE_WRITE_DATA */
+} sipif_standin;
+
+static sipif_standin g_standin;							/*!< The one and only stand-in */
+
+
+/**
+ * Send or receive a whole buffer.
+ *
+ * @return 1 on success, 0 when the connection is gone.
+ */
+static int sipif_standin_send(const void *buf, int size)
+{
+	const char *p8 = (const char *)buf;
+	int rc;
+
+	while(size>0) {
+		rc = send(g_standin.client, p8, size, 0);
+		if(rc==SOCKET_ERROR || rc==0)
+			return 0;
+		p8 += rc;
+		size -= rc;
+	}
+	return 1;
+}
+
+static int sipif_standin_receive(void *buf, int size)
+{
+	return recv(g_standin.client, (char *)buf, size, MSG_WAITALL)==size;
+}
+
+/**
+ * Move a data burst through the socket, SIPIF_STANDIN_CHUNK bytes at a time.
+ */
+static int sipif_standin_burst(SIP_PKT *pkt)
+{
+	unsigned int left, n;
+
+	if(pkt->cmd==STELLAR_OPCODE_READ_DATA) {
+		// the firmware answers with the data only
+		for(left = pkt->size; left>0; left -= n) {
+			n = left>SIPIF_STANDIN_CHUNK ? SIPIF_STANDIN_CHUNK : left;
+			if(!sipif_standin_send(g_standin.pattern, n))
+				return 0;
+		}
+		return 1;
+	}
+
+	// STELLAR_OPCODE_WRITE_DATA, one ack before and one ack after the data
+	pkt->cmd = STELLAR_OPCODE_WRITE_DATA_ACK;
+	if(!sipif_standin_send(pkt, sizeof(SIP_PKT)))
+		return 0;
+	for(left = pkt->size; left>0; left -= n) {
+		n = left>SIPIF_STANDIN_CHUNK ? SIPIF_STANDIN_CHUNK : left;
+		if(!sipif_standin_receive(g_standin.sink, n))
+			return 0;
+	}
+	return sipif_standin_send(pkt, sizeof(SIP_PKT));
+}
+
+static DWORD WINAPI sipif_standin_thread(LPVOID arg)
+{
+	SIP_PKT pkt;
+	int alive = 1;
+	int nodelay = 1;
+
+	g_standin.client = accept(g_standin.listener, NULL, NULL);
+	if(g_standin.client==INVALID_SOCKET)
+		return 0;
+
+	// the acknowledges of a pipelined batch go out one by one, Nagle would hold them until the host acks the first one
+	setsockopt(g_standin.client, IPPROTO_TCP, TCP_NODELAY, (const char *)&nodelay, sizeof(nodelay));
+
+	while(alive && sipif_standin_receive(&pkt, sizeof(SIP_PKT))) {
+		switch(pkt.cmd) {
+		case STELLAR_OPCODE_READ:
+			pkt.cmd = STELLAR_OPCODE_READ_ACK;
+			pkt.data = (unsigned int)g_standin.regs[pkt.address&(SIPIF_STANDIN_NB_REGS-1)];
+			alive = sipif_standin_send(&pkt, sizeof(SIP_PKT));
+			break;
+		case STELLAR_OPCODE_WRITE:
+			g_standin.regs[pkt.address&(SIPIF_STANDIN_NB_REGS-1)] = pkt.data;
+			pkt.cmd = STELLAR_OPCODE_WRITE_ACK;
+			alive = sipif_standin_send(&pkt, sizeof(SIP_PKT));
+			break;
+		case STELLAR_OPCODE_READ_DATA:
+		case STELLAR_OPCODE_WRITE_DATA:
+			alive = sipif_standin_burst(&pkt);
+			break;
+		default:
+			printf("sipif_standin: unexpected opcode %d, closing\n", pkt.cmd);
+			alive = 0;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+int sipif_standin_start(unsigned short port)
+{
+	WSADATA wsaData;
+	sockaddr_in local;
+
+	if(g_standin.active)
+		return SIPIF_STANDIN_ERR_RUNNING;
+
+	memset(g_standin.regs, 0, sizeof(g_standin.regs));
+	for(unsigned int i = 0; i < SIPIF_STANDIN_CHUNK; i++)
+		g_standin.pattern[i] = (unsigned char)i;
+	g_standin.client = INVALID_SOCKET;
+
+	if(WSAStartup(MAKEWORD(2,2), &wsaData)!=NO_ERROR)
+		return SIPIF_STANDIN_ERR_SOCKET;
+
+	g_standin.listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(g_standin.listener==INVALID_SOCKET) {
+		WSACleanup();
+		return SIPIF_STANDIN_ERR_SOCKET;
+	}
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = inet_addr(SIPIF_STANDIN_IP);
+	local.sin_port = htons(port);
+	if(bind(g_standin.listener, (SOCKADDR*)&local, sizeof(local))!=0 || listen(g_standin.listener, 1)!=0) {
+		closesocket(g_standin.listener);
+		WSACleanup();
+		return SIPIF_STANDIN_ERR_SOCKET;
+	}
+
+	g_standin.hthread = CreateThread(NULL, 0, sipif_standin_thread, NULL, 0, NULL);
+	if(!g_standin.hthread) {
+		closesocket(g_standin.listener);
+		WSACleanup();
+		return SIPIF_STANDIN_ERR_ALLOC;
+	}
+
+	g_standin.active = 1;
+	return SIPIF_STANDIN_ERR_OK;
+}
+
+int sipif_standin_stop(void)
+{
+	if(!g_standin.active)
+		return SIPIF_STANDIN_ERR_NOT_RUNNING;
+
+	// closing the sockets releases the thread from accept() or recv()
+	closesocket(g_standin.listener);
+	if(g_standin.client!=INVALID_SOCKET)
+		shutdown(g_standin.client, SD_BOTH);
+	WaitForSingleObject(g_standin.hthread, INFINITE);
+	if(g_standin.client!=INVALID_SOCKET)
+		closesocket(g_standin.client);
+	CloseHandle(g_standin.hthread);
+	WSACleanup();
+	g_standin.active = 0;
+
+	return SIPIF_STANDIN_ERR_OK;
+}
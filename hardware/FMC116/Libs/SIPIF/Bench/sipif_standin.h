@@ -0,0 +1,59 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file sipif_standin.h
+///@author Pankil Butala (MCL, BU)
+///\brief sipif_standin module emulates the TCP/IP firmware on the local host (header)
+///
+/// The stand-in answers the StellarIP packets used by the SIPIF_TCPIP_V4 layer ( register reads
+/// and writes, data bursts in both directions ) from a thread of the calling process. It allows
+/// running sipif based tools without hardware, e.g. to measure the host side cost of the transport.
+/// Register values are kept in memory, data read back is a counting pattern and data written is
+/// discarded.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _SIPIF_STANDIN_H_
+#define _SIPIF_STANDIN_H_
+
+/* defines */
+#define SIPIF_STANDIN_IP				"127.0.0.1"		/*!< Address to pass to sipif_init() once the stand-in is running */
+#define SIPIF_STANDIN_PORT				7000			/*!< Default TCP port of the stand-in */
+#define SIPIF_STANDIN_NB_REGS			4096			/*!< Register space, addresses wrap around ( power of 2 ) */
+#define SIPIF_STANDIN_CHUNK				(64*1024)		/*!< Socket transfer size used for the data bursts */
+
+/* error codes */
+#define SIPIF_STANDIN_ERR_OK			0				/*!< No error encountered during execution. */
+#define SIPIF_STANDIN_ERR_RUNNING		-1				/*!< sipif_standin_start() has been called already. */
+#define SIPIF_STANDIN_ERR_NOT_RUNNING	-2				/*!< sipif_standin_start() has not been called. */
+#define SIPIF_STANDIN_ERR_SOCKET		-3				/*!< The listening socket could not be created or bound. */
+#define SIPIF_STANDIN_ERR_ALLOC			-4				/*!< The stand-in thread could not be created. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Start listening on SIPIF_STANDIN_IP and serve one connection from a background thread. Call
+ * sipif_init(SIPIF_TCPIP_V4, SIPIF_STANDIN_IP, port, ...) afterwards.
+ *
+ * @param	port	TCP port to listen on, SIPIF_STANDIN_PORT is a reasonable value.
+ * @return  - SIPIF_STANDIN_ERR_OK
+ *			- SIPIF_STANDIN_ERR_RUNNING
+ *			- SIPIF_STANDIN_ERR_SOCKET
+ *			- SIPIF_STANDIN_ERR_ALLOC
+ */
+int sipif_standin_start(unsigned short port);
+
+/**
+ * Close the sockets and wait for the stand-in thread to leave. Call sipif_free() first.
+ *
+ * @return  - SIPIF_STANDIN_ERR_OK
+ *			- SIPIF_STANDIN_ERR_NOT_RUNNING
+ */
+int sipif_standin_stop(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_SIPIF_STANDIN_H_
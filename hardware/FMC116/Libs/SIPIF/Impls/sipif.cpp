@@ -10,8 +10,10 @@
 //////////////////////////////////////////////////////////////////////////////////////////////////
 #ifdef __linux__
  #define _XOPEN_SOURCE 600
+ #define _GNU_SOURCE					// PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
  #include <unistd.h>
  #include <sys/time.h>
+ #include <pthread.h>
 #endif 
 #include <stdlib.h>
 #include <stdio.h>
@@ -31,6 +33,12 @@
 _4FM_DeviceContext g_hDev;			/*!< The 4FM API handle */
 unsigned int g_timeout;				/*!< The timeout value */
 unsigned int g_typeif;				/*!< The currently selected interface */
+#ifdef WIN32
+static CRITICAL_SECTION g_lock;		/*!< Serializes the transport between threads, see sipif_lock() */
+static int g_lockinit = 0;			/*!< 1 once g_lock is initialized */
+#else
+static pthread_mutex_t g_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;	/*!< Serializes the transport between threads, see sipif_lock() */
+#endif
 unsigned int g_burstsize = 32*1024;			/*!< The burst size for transfers */
 
 // Function pointers for 4FM.dll. They receive pointer of the various function required by this module. We actually want to load
@@ -380,6 +388,12 @@ int sipif_init( unsigned char typeif, const char *devtype4FM, unsigned int devid
 	_4FM_error_t rc;
 
 	// something common for all our interfaces
+#ifdef WIN32
+	if(!g_lockinit) {
+		InitializeCriticalSection(&g_lock);
+		g_lockinit = 1;
+	}
+#endif
 	g_timeout = timeout;
 	g_typeif = typeif;
 
@@ -580,6 +594,143 @@ int sipif_writesipreg(unsigned int addr, unsigned long value)
 	return SIPIF_ERR_OK;
 }
 
+int sipif_transact(SIPIF_REGOP *ops, unsigned int count)
+{
+	int rc;
+
+	// check if arguments are valid
+	if(ops==NULL) {
+		return SIPIF_ERR_NULL_ARGUMENT;
+	}
+
+	switch(g_typeif)
+	{
+	case SIPIF_ETHAPI: 
+	case SIPIF_4FM: {
+		// these layers have a blocking register API, one operation at a time
+		for(unsigned int i = 0; i < count; i++) {
+			if(ops[i].op==SIPIF_OP_READ)
+				rc = sipif_readsipreg(ops[i].addr, &ops[i].value);
+			else
+				rc = sipif_writesipreg(ops[i].addr, ops[i].value);
+			if(rc!=SIPIF_ERR_OK)
+				return rc;
+		}
+		break;
+	}
+	case SIPIF_TCPIP_V4: {
+#ifdef WIN32
+		SIP_PKT pkt[SIPIF_MAX_BATCH];
+
+		for(unsigned int first = 0; first < count; first += SIPIF_MAX_BATCH) {
+			unsigned int n = (count-first)>SIPIF_MAX_BATCH ? SIPIF_MAX_BATCH : count-first;
+
+			// Send all the STELLAR_OPCODE_READ/STELLAR_OPCODE_WRITE commands at once
+			for(unsigned int i = 0; i < n; i++) {
+				pkt[i].address	= ops[first+i].addr;
+				pkt[i].cmd		= ops[first+i].op==SIPIF_OP_READ ? STELLAR_OPCODE_READ : STELLAR_OPCODE_WRITE;
+				pkt[i].data		= ops[first+i].op==SIPIF_OP_READ ? 0 : ops[first+i].value;
+				pkt[i].size		= 0;
+			}
+			if(SendData(pkt, n*sizeof(SIP_PKT))!=TCPIP_OK) 
+				return SIPIF_ERR_TIMEOUT;
+
+			// Collect the answers, the firmware acknowledges in order
+			if(ReceiveData(pkt, n*sizeof(SIP_PKT))!=TCPIP_OK) 
+				return SIPIF_ERR_TIMEOUT;
+
+			for(unsigned int i = 0; i < n; i++) {
+				// Sanity check 1
+				if(ops[first+i].op==SIPIF_OP_READ) {
+					if((pkt[i].cmd!=STELLAR_OPCODE_READ_ACK)&&(pkt[i].cmd!=STELLAR_OPCODE_READ_TO_ACK))
+						return SIPIF_ERR_WRONG_TCPIP_ACK;
+				}
+				else if(pkt[i].cmd!=STELLAR_OPCODE_WRITE_ACK)
+					return SIPIF_ERR_WRONG_TCPIP_ACK;
+
+				// Sanity check 2
+				if(pkt[i].address!=ops[first+i].addr) 
+					return SIPIF_ERR_WRONG_TCPIP_PKT;
+
+				// If we got TO we should indicate TO
+				if(pkt[i].cmd==STELLAR_OPCODE_READ_TO_ACK)
+					return SIPIF_ERR_TIMEOUT;
+
+				// Copy data to the caller
+				if(ops[first+i].op==SIPIF_OP_READ)
+					ops[first+i].value = pkt[i].data;
+			}
+		}
+		break;
+#else
+		return SIPIF_ERR_UNEXPECTED_LAYER_ID;
+#endif
+	}
+	default:
+		return SIPIF_ERR_UNEXPECTED_LAYER_ID;
+	}
+
+	return SIPIF_ERR_OK;
+}
+
+int sipif_readsipregs(unsigned int addr, unsigned int count, unsigned long *values)
+{
+	SIPIF_REGOP ops[SIPIF_MAX_BATCH];
+	unsigned int n;
+	int rc;
+
+	// check if arguments are valid
+	if(values==NULL) {
+		return SIPIF_ERR_NULL_ARGUMENT;
+	}
+
+	for(unsigned int i = 0; i < count; i += n) {
+		n = count-i<SIPIF_MAX_BATCH ? count-i : SIPIF_MAX_BATCH;
+		for(unsigned int j = 0; j < n; j++) {
+			ops[j].op = SIPIF_OP_READ;
+			ops[j].addr = addr+i+j;
+			ops[j].value = 0;
+		}
+		rc = sipif_transact(ops, n);
+		if(rc!=SIPIF_ERR_OK)
+			return rc;
+		for(unsigned int j = 0; j < n; j++)
+			values[i+j] = ops[j].value;
+	}
+
+	return SIPIF_ERR_OK;
+}
+
+void sipif_lock(void)
+{
+#ifdef WIN32
+	EnterCriticalSection(&g_lock);
+#else
+	pthread_mutex_lock(&g_lock);
+#endif
+}
+
+int sipif_trylock(void)
+{
+#ifdef WIN32
+	if(!TryEnterCriticalSection(&g_lock))
+		return SIPIF_ERR_BUSY;
+#else
+	if(pthread_mutex_trylock(&g_lock)!=0)
+		return SIPIF_ERR_BUSY;
+#endif
+	return SIPIF_ERR_OK;
+}
+
+void sipif_unlock(void)
+{
+#ifdef WIN32
+	LeaveCriticalSection(&g_lock);
+#else
+	pthread_mutex_unlock(&g_lock);
+#endif
+}
+
 int sipif_getdeviceenumeration(unsigned long mode)
 {
 #ifdef WIN32	
@@ -796,6 +947,13 @@ int sipif_free()
 #endif
 			g_p4FM_CloseDevice(&g_hDev);
 		break;
+	case SIPIF_TCPIP_V4: 
+#ifdef WIN32
+		CleanConnection();
+		break;
+#else
+		return SIPIF_ERR_UNEXPECTED_LAYER_ID;
+#endif	
 	default:
 		return SIPIF_ERR_UNEXPECTED_LAYER_ID;
 	}
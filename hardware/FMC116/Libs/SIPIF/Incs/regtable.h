@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file regtable.h
+///@author Pankil Butala (MCL, BU)
+///\brief regtable module executes register programming tables (header)
+///
+/// Chip initialization sequences are described as tables of register writes, settle delays and
+/// wait conditions. The executor groups consecutive writes into one sipif_transact() batch and
+/// only stops where the table asks for it, either for a fixed delay or until a status register
+/// reports the expected value.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _REGTABLE_H_
+#define _REGTABLE_H_
+
+// type of entry
+#define REGTABLE_WRITE	0							/*!< Write value to bar+offset */
+#define REGTABLE_DELAY	1							/*!< Flush pending writes and wait ms milliseconds */
+#define REGTABLE_WAIT	2							/*!< Flush pending writes and poll bar+offset until (register&mask)==value, ms is the timeout */
+
+typedef struct {
+	unsigned int type;								//!< REGTABLE_WRITE, REGTABLE_DELAY or REGTABLE_WAIT
+	unsigned int offset;							//!< Register offset relative to the bar given to regtable_run()
+	unsigned long value;							//!< Value written ( REGTABLE_WRITE ) or expected value ( REGTABLE_WAIT )
+	unsigned long mask;								//!< Bits compared by REGTABLE_WAIT
+	unsigned int ms;								//!< Delay ( REGTABLE_DELAY ) or timeout ( REGTABLE_WAIT ) in milliseconds
+} REGTABLE_ENTRY;
+
+// helpers to write tables
+#define REG_WR(offset, value)				{ REGTABLE_WRITE, (offset), (value), 0, 0 }			/*!< Table entry writing a register */
+#define REG_DELAY(ms)						{ REGTABLE_DELAY, 0, 0, 0, (ms) }					/*!< Table entry waiting a fixed time */
+#define REG_WAIT(offset, mask, value, ms)	{ REGTABLE_WAIT, (offset), (value), (mask), (ms) }	/*!< Table entry polling a status register */
+
+#define REGTABLE_SIZE(table)	(sizeof(table)/sizeof(table[0]))	/*!< Number of entries in a static table */
+
+
+/* error codes */
+#define REGTABLE_ERR_OK					0		/*!< No error encountered during execution. */
+#define REGTABLE_ERR_WAIT_TIMEOUT		-100	/*!< A REGTABLE_WAIT condition was not met before its timeout. */
+#define REGTABLE_ERR_NULL_ARGUMENT		-101	/*!< Unexpected NULL argument received in a function. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif 
+
+/**
+ * Execute a register table. Consecutive REGTABLE_WRITE entries are sent as one batch ( sipif_transact() ), the
+ * executor only waits on REGTABLE_DELAY and REGTABLE_WAIT entries.
+ *
+ * @param	bar	offset of the peripheral in the constellation memory space, added to every entry offset.
+ * @param	table	pointer to the table.
+ * @param	count	number of entries in the table ( REGTABLE_SIZE() for a static table ).
+ * @return  - REGTABLE_ERR_OK
+ *			- REGTABLE_ERR_WAIT_TIMEOUT
+ *			- REGTABLE_ERR_NULL_ARGUMENT
+ *			- Any sipif error codes.
+ */
+int regtable_run(unsigned long bar, const REGTABLE_ENTRY *table, unsigned int count);
+
+/**
+ * Poll a register until (register&mask)==value or the timeout expires.
+ *
+ * @param	addr	address of the status register.
+ * @param	mask	bits to compare.
+ * @param	value	expected value of the masked bits.
+ * @param	timeoutms	maximum time to wait in milliseconds.
+ * @param	elapsedus	optional pointer receiving the time it took for the condition to be met, in microseconds. Can be NULL.
+ * @return  - REGTABLE_ERR_OK
+ *			- REGTABLE_ERR_WAIT_TIMEOUT
+ *			- Any sipif error codes.
+ */
+int regtable_wait(unsigned long addr, unsigned long mask, unsigned long value, unsigned int timeoutms, unsigned long *elapsedus);
+
+/**
+ * Monotonic time stamp used to measure settling times.
+ *
+ * @return  time in microseconds since an arbitrary origin.
+ */
+unsigned long long regtable_gettimeus(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif 
+
+
+#endif //_REGTABLE_H_
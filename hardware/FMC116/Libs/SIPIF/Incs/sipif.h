@@ -44,6 +44,18 @@ typedef struct {
 
 
 
+// Register operations, see sipif_transact()
+#define SIPIF_OP_WRITE	0							/*!< SIPIF_REGOP writes value to addr */
+#define SIPIF_OP_READ	1							/*!< SIPIF_REGOP reads addr into value */
+#define SIPIF_MAX_BATCH	64							/*!< Maximum number of operations pipelined at once by sipif_transact() */
+
+typedef struct {
+	unsigned int op;								//!< SIPIF_OP_WRITE or SIPIF_OP_READ
+	unsigned long addr;								//!< Register address in the constellation memory space
+	unsigned long value;							//!< Value written, or value read back
+} SIPIF_REGOP;
+
+
 /* error codes */
 #define SIPIF_ERR_OK					0		/*!< No error encountered during execution. */
 #define SIPIF_ERR_UNEXPECTED_LAYER_ID	-1		/*!< sipif_init() does not know the type of interface passed as argument. */
@@ -58,6 +70,7 @@ typedef struct {
 #define SIPIF_ERR_NO_TCPIP_DEVICE_FOUND	-10		/*!< sipif_init() could not find any TCPIP based devices. */
 #define SIPIF_ERR_WRONG_TCPIP_ACK		-11		/*!< Did not get the expected ack */
 #define SIPIF_ERR_WRONG_TCPIP_PKT		-12		/*!< Wrong address in the packet */
+#define SIPIF_ERR_BUSY					-13		/*!< sipif_trylock() found the transport in use by another thread. */
 
 // C++ "helper"
 #ifdef __cplusplus
@@ -106,6 +119,58 @@ int sipif_readsipreg(unsigned int addr, unsigned long *value);
  */
 int sipif_writesipreg(unsigned int addr, unsigned long value);
 
+/**
+ * Execute a list of register reads and writes in order. Depending on the interface the operations are either pipelined
+ * ( all requests sent before the acknowledges are collected ) or executed one by one, the result is the same as calling
+ * sipif_readsipreg()/sipif_writesipreg() for each entry but with much fewer round trips on pipelined interfaces.
+ *
+ * @param	ops	pointer to count operations. The value of read operations is updated with the register content.
+ * @param	count	number of operations.
+ * @return  - SIPIF_ERR_OK
+ *			- SIPIF_ERR_NULL_ARGUMENT
+ *			- SIPIF_ERR_TIMEOUT
+ *			- SIPIF_ERR_UNEXPECTED_LAYER_ID
+ */
+int sipif_transact(SIPIF_REGOP *ops, unsigned int count);
+
+/**
+ * Read a range of consecutive system registers from the constellation memory address space. The reads are issued
+ * through sipif_transact(), SIPIF_MAX_BATCH registers per round trip on pipelined interfaces.
+ *
+ * @param	addr	address of the first register we want to read from
+ * @param	count	number of registers to read.
+ * @param	values	pointer to count 32 bit variables about to receive the registers from addr to addr+count-1.
+ * @return  - SIPIF_ERR_OK
+ *			- SIPIF_ERR_NULL_ARGUMENT
+ *			- SIPIF_ERR_TIMEOUT
+ *			- SIPIF_ERR_UNEXPECTED_LAYER_ID
+ */
+int sipif_readsipregs(unsigned int addr, unsigned int count, unsigned long *values);
+
+/**
+ * Take exclusive use of the transport. The layers below sipif are not thread safe, every thread talking to the hardware
+ * has to hold the lock around a sequence of calls that belongs together ( e.g. arm, trigger and sipif_readdata() ). The
+ * lock is recursive, the thread holding it may take it again.
+ *
+ * @warning Calling sipif_init() prior calling this function is mandatory.
+ */
+void sipif_lock(void);
+
+/**
+ * Take exclusive use of the transport if nobody else holds it. Background threads use this to step aside while the
+ * capture path is busy instead of delaying it.
+ *
+ * @warning Calling sipif_init() prior calling this function is mandatory.
+ * @return  - SIPIF_ERR_OK ( the lock is held, release it with sipif_unlock() )
+ *			- SIPIF_ERR_BUSY
+ */
+int sipif_trylock(void);
+
+/**
+ * Release the transport taken by sipif_lock() or sipif_trylock().
+ */
+void sipif_unlock(void);
+
 /**
  * Read data using DMA transactions in the case of 4FM interface. In the case of an Ethernet device this function
  * read as many EthernetII packets as required to obtain the data.
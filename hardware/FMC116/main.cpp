@@ -9,6 +9,7 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 //PD ADD
 #include <Shlwapi.h>
@@ -22,6 +23,16 @@
 #include "FMC116.h"
 #include "ctgen.h"
 #include "FMC116_IF.h"
+#include "trace.h"
+#include "dsp_pilot.h"
+#include "dsp_ook.h"
+#include "dsp_ofdm.h"
+#include "dsp_ber.h"
+#include "dsp_cond.h"
+#include "dsp_env.h"
+#include "dsp_psd.h"
+#include "pipeline.h"
+#include "monitor.h"
 
 // PB added to create Winsock server
 // END
@@ -52,6 +63,75 @@
 
 #define CUR_INTERFACE				(SIPIF_ETHAPI)		/*!< The interface in use for this project */
 #define BUFFER_SIZE					1024			/*in number of BYTES */
+#define NB_CHANNELS					4				/*!< ADC channels served over the socket, CHNL_1..CHNL_4 */
+#define NB_STAGES					7				/*!< Pipeline stages of a burst, conditioning, alignment, demodulation, bit errors, envelope, spectrum and files */
+#define PILOT_TRACK					0				/*!< Track of the alignment engine of a channel, each channel has its own engine */
+
+// Latency trace phases, see trace_mark()
+enum
+{
+	PH_RECEIVE = 0,						/*!< socket receive of the command header and payload */
+	PH_PREPARE,							/*!< output file names */
+	PH_LOCK,							/*!< wait for the transport held by the telemetry sampler */
+	PH_ROUTER,							/*!< sxdx_configurerouter() */
+	PH_ENABLE,							/*!< FMC116_ctrl_enable_channel() */
+	PH_ARM,								/*!< FMC116_ctrl_arm() */
+	PH_SETTLE,							/*!< wait between arm and trigger */
+	PH_TRIGGER,							/*!< FMC116_ctrl_sw_trigger() */
+	PH_READDATA,						/*!< sipif_readdata() */
+	PH_PIPELINE,						/*!< wait for the stages of a channel, see pipeline_report() for the time spent in each stage */
+	PH_SEND,							/*!< send() of the burst to the client */
+	PH_HANDLE,							/*!< whole handling of the other commands */
+};
+
+/**
+ * Processing configured by CMD_COND, CMD_ALIGN, CMD_DEMOD, CMD_BER and CMD_PSD, shared by the pipeline stages. The server thread only changes it
+ * between two CMD_DATA, when no burst is in the pipeline. Every channel has its own engines, the stages of different
+ * channels run at the same time.
+ */
+typedef struct {
+	int condMode;									/*!< COND_OFF, COND_INT16 or COND_FLOAT */
+	DSP_COND cond[NB_CHANNELS];						/*!< calibration per channel */
+	int alignMode;									/*!< ALIGN_OFF, ALIGN_TAG or ALIGN_ROTATE */
+	unsigned char alignInvert;						/*!< CHNL_x mask of the channels wired with an inverted polarity */
+	unsigned int alignClk;							/*!< ADC sample clock, Hz */
+	unsigned int alignLen;							/*!< frame samples at the beginning of the burst, 0 for the whole burst */
+	int demodMode;									/*!< DEMOD_OFF, DEMOD_OOK or DEMOD_OFDM */
+	bool demodRaw;									/*!< burst sent before the bits */
+	unsigned int demodSym;							/*!< symbols per frame, 0 for as many as fit after the pilot */
+	int ofdmEq;										/*!< DSP_OFDM_EQ_FLAT or DSP_OFDM_EQ_PILOT */
+	float ofdmScale;								/*!< pilot chip amplitude in OFDM signal units */
+	DSP_PILOT pilot[NB_CHANNELS];					/*!< alignment engine per channel, stages of different channels run at once, PILOT_TRACK only */
+	DSP_OOK ook[NB_CHANNELS];						/*!< OOK engine per channel */
+	DSP_OFDM ofdm[NB_CHANNELS];						/*!< OFDM engine per channel */
+	bool ofdmPilot[NB_CHANNELS];					/*!< expected pilot given to ofdm[channel] */
+	unsigned int berPeriod;							/*!< CMD_DATA between two CMD_LINK replies sent unasked, 0 for none */
+	DSP_BER ber[NB_CHANNELS];						/*!< bit error statistics per channel, no reference payload when not measured */
+	DSP_PSD psd[NB_CHANNELS];						/*!< spectrum estimator per channel, not initialized when not estimated */
+	unsigned char *monitorMsg[NB_CHANNELS];			/*!< message to the monitoring clients per channel */
+	unsigned int monitorSize[NB_CHANNELS];			/*!< bytes allocated for monitorMsg */
+} SERVER_DSP;
+
+/**
+ * One burst of a channel, from the capture to the reply.
+ */
+typedef struct {
+	unsigned char chnl;								/*!< CHNL_x */
+	unsigned long number;							/*!< bursts captured on the channel so far, this one included */
+	bool pending;									/*!< in the pipeline, to be collected before the reply */
+	unsigned char *burst;							/*!< captured samples, rotated with ALIGN_ROTATE */
+	unsigned int burstSize;							/*!< samples in burst */
+	bool invert;									/*!< polarity left to correct by the alignment and the demodulation */
+	float *volts;									/*!< conditioned burst in volts, sent with COND_FLOAT */
+	unsigned int voltsSize;							/*!< samples allocated for volts */
+	unsigned int frameLen;							/*!< frame samples at the beginning of the burst */
+	unsigned int alignOffset;						/*!< pilot offset, ALIGN_NO_OFFSET when the pilot could not be aligned */
+	unsigned char *bits;							/*!< 32 bit number of bits then the packed bits */
+	unsigned int bitsSize;							/*!< bytes allocated for bits */
+	unsigned int nbBits;							/*!< bits demodulated */
+	char filenameascii[1024];						/*!< ASCII copy of the burst */
+	char filenamebin[1024];							/*!< binary copy of the burst */
+} SERVER_FRAME;
 
 // Save a buffer to a file.
 #ifndef Save16BitArrayToFile
@@ -115,6 +195,365 @@ static ULONG Save16BitArrayToFile(void *buf, int bufsize, const char *filename,
 	return 0;
 }
 #endif
+
+/**
+ *  Send the telemetry reply ( TLM_LEN bytes, see FMC116_IF.h ) answering CMD_TELEMETRY. The reply is built from the latest
+ *  snapshot published by the telemetry sampler, the hardware is not accessed.
+ *
+ *  @param client	socket connected to the client.
+ *  @return 
+ *						- SOCKET_ERROR ( Could not send the reply )
+ *						- TLM_LEN ( Success )
+ */
+static int SendTelemetry(SOCKET client)
+{
+	FMC116_TELEMETRY snapshot;
+	unsigned char tlm[TLM_LEN];
+	unsigned long counters[4];
+	float values[TLM_NBVAL];
+	unsigned int dword;
+	int n = 0;
+
+	FMC116_telemetry_get(&snapshot);
+	counters[0] = snapshot.sequence;
+	counters[1] = snapshot.sequence ? GetTickCount()-snapshot.timestamp : 0;
+	counters[2] = snapshot.deferred;
+	counters[3] = (unsigned long)snapshot.source;
+
+	values[n++] = snapshot.temperature;
+	for(int i = 0; i < FMC116_MON_NB_VOLTAGES; i++)
+		values[n++] = snapshot.voltage[i];
+	for(int i = 0; i < FMC116_TELEMETRY_NB_CLOCKS; i++)
+		values[n++] = snapshot.frequency[i];
+
+	tlm[IDX_TLM_CMD] = CMD_TELEMETRY;
+	tlm[IDX_TLM_ERR] = (unsigned char)(-snapshot.error);
+	tlm[IDX_TLM_NBVAL+0] = (unsigned char)(TLM_NBVAL>>0);
+	tlm[IDX_TLM_NBVAL+1] = (unsigned char)(TLM_NBVAL>>8);
+	for(int i = 0; i < 4; i++) {
+		for(int j = 0; j < 4; j++)
+			tlm[IDX_TLM_SEQ+4*i+j] = (unsigned char)(counters[i]>>(8*j));
+	}
+	for(int i = 0; i < TLM_NBVAL; i++) {
+		memcpy(&dword, &values[i], sizeof(dword));
+		for(int j = 0; j < 4; j++)
+			tlm[IDX_TLM_VALUES+4*i+j] = (unsigned char)(dword>>(8*j));
+	}
+
+	return send(client, (const char *)tlm, TLM_LEN, 0);
+}
+
+/**
+ *  Send the link statistics reply ( LNK_LEN bytes, see FMC116_IF.h ) of a channel, answering CMD_LINK or following its
+ *  CMD_DATA reply. The statistics are only read between two CMD_DATA, when no burst of the channel is in the pipeline.
+ *
+ *  @param client	socket connected to the client.
+ *  @param ber	statistics of the channel.
+ *  @param chnl	CHNL_x of the channel.
+ *  @return 
+ *						- SOCKET_ERROR ( Could not send the reply )
+ *						- LNK_LEN ( Success )
+ */
+static int SendLink(SOCKET client, const DSP_BER *ber, unsigned char chnl)
+{
+	unsigned char lnk[LNK_LEN];
+	unsigned long counters[3];
+	unsigned long long totals[2];
+	float values[LNK_NBVAL];
+	unsigned int dword;
+
+	counters[0] = ber->frames;
+	counters[1] = ber->synclosses;
+	counters[2] = ber->errframes;
+	totals[0] = ber->bits;
+	totals[1] = ber->errors;
+	values[0] = (float)dsp_ber_rate(ber);
+	values[1] = ber->peak;
+	values[2] = ber->pilots ? (float)(ber->peaksum/ber->pilots) : 0.0f;
+	values[3] = ber->peakmin;
+	values[4] = ber->pilots ? ber->snr : 0.0f;
+	values[5] = dsp_ber_meansnr(ber);
+
+	lnk[IDX_LNK_CMD] = CMD_LINK;
+	lnk[IDX_LNK_CHNL] = chnl;
+	lnk[IDX_LNK_ERR] = ber->ref ? 0 : 1;
+	lnk[IDX_LNK_ERR+1] = 0;
+	for(int i = 0; i < 3; i++) {
+		for(int j = 0; j < 4; j++)
+			lnk[IDX_LNK_FRAMES+4*i+j] = (unsigned char)(counters[i]>>(8*j));
+	}
+	for(int i = 0; i < 2; i++) {
+		for(int j = 0; j < 8; j++)
+			lnk[IDX_LNK_BITS+8*i+j] = (unsigned char)(totals[i]>>(8*j));
+	}
+	for(int i = 0; i < LNK_NBVAL; i++) {
+		memcpy(&dword, &values[i], sizeof(dword));
+		for(int j = 0; j < 4; j++)
+			lnk[IDX_LNK_VALUES+4*i+j] = (unsigned char)(dword>>(8*j));
+	}
+
+	return send(client, (const char *)lnk, LNK_LEN, 0);
+}
+
+/**
+ *  Pipeline stage, calibrate the burst in place using dsp_cond_apply16(), in volts as well with COND_FLOAT ( CMD_COND ).
+ *
+ *  @param context	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param item	SERVER_FRAME of the burst.
+ */
+static void StageCondition(void *context, unsigned int channel, void *item)
+{
+	SERVER_DSP *dsp = (SERVER_DSP *)context;
+	SERVER_FRAME *frame = (SERVER_FRAME *)item;
+	DSP_COND *cond = &dsp->cond[channel];
+	bool volts = dsp->condMode==COND_FLOAT && frame->volts && frame->voltsSize>=frame->burstSize;
+
+	// IDX_ALN_INVERT describes the captured samples, a conditioning that negates them corrects it
+	frame->invert = ((dsp->alignInvert&frame->chnl)!=0)!=(dsp->condMode!=COND_OFF && cond->invert);
+	if(dsp->condMode==COND_OFF)
+		return;
+	dsp_cond_apply16(cond, (short *)frame->burst, frame->burstSize, volts ? frame->volts : NULL);
+}
+
+/**
+ *  Pipeline stage, find the Barker pilot of a burst using dsp_pilot_track16() and rotate the frame using
+ *  dsp_pilot_rotate16() ( CMD_ALIGN ).
+ *
+ *  @param context	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param item	SERVER_FRAME of the burst.
+ */
+static void StageAlign(void *context, unsigned int channel, void *item)
+{
+	SERVER_DSP *dsp = (SERVER_DSP *)context;
+	SERVER_FRAME *frame = (SERVER_FRAME *)item;
+
+	// the frame occupies the beginning of the burst, the pilot may wrap around its end
+	frame->frameLen = (dsp->alignLen==0 || dsp->alignLen>frame->burstSize) ? frame->burstSize : dsp->alignLen;
+	frame->alignOffset = ALIGN_NO_OFFSET;
+	if(dsp->alignMode==ALIGN_OFF)
+		return;
+	if(dsp_pilot_track16(&dsp->pilot[channel], PILOT_TRACK, dsp->alignClk, (const short *)frame->burst, frame->frameLen,
+		frame->invert, &frame->alignOffset)!=DSP_PILOT_ERR_OK)
+		frame->alignOffset = ALIGN_NO_OFFSET;
+	else if(dsp->alignMode==ALIGN_ROTATE)
+		dsp_pilot_rotate16((short *)frame->burst, frame->frameLen, frame->alignOffset);
+}
+
+/**
+ *  Pipeline stage, demodulate the symbols following the pilot using dsp_ook_demod16() or dsp_ofdm_demod16() ( CMD_DEMOD ).
+ *
+ *  @param context	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param item	SERVER_FRAME of the burst, bits receives the reply.
+ */
+static void StageDemod(void *context, unsigned int channel, void *item)
+{
+	SERVER_DSP *dsp = (SERVER_DSP *)context;
+	SERVER_FRAME *frame = (SERVER_FRAME *)item;
+	DSP_OOK *ook = &dsp->ook[channel];
+	DSP_OFDM *ofdm = &dsp->ofdm[channel];
+	unsigned int frameLen = frame->frameLen;
+	unsigned int alignOffset = frame->alignOffset;
+	unsigned int demodStart, nbSym, pltLen = 0;
+	const float *pltRef;
+
+	frame->nbBits = 0;
+	if(dsp->demodMode==DEMOD_OFF || !frame->bits)
+		return;
+
+	// the symbols follow the pilot and may wrap around the end of the frame as well
+	if(dsp->demodMode==DEMOD_OOK) {
+		if(frameLen>0 && (dsp->alignMode==ALIGN_OFF || (alignOffset!=ALIGN_NO_OFFSET && dsp_pilot_length(&dsp->pilot[channel], dsp->alignClk, frameLen, &pltLen)==DSP_PILOT_ERR_OK))) {
+			demodStart = ((dsp->alignMode==ALIGN_TAG ? alignOffset : 0)+pltLen)%frameLen;
+			nbSym = dsp->demodSym ? dsp->demodSym : (frameLen-pltLen)/ook->npsym;
+			if(dsp_ook_demod16(ook, (const short *)frame->burst, frameLen, demodStart, nbSym, frame->invert, frame->bits+4)==DSP_OOK_ERR_OK)
+				frame->nbBits = nbSym;
+		}
+	}
+	// the channel is estimated on the pilot of every burst, the expected pilot is given once per configuration
+	else if(frameLen>0 && dsp->alignMode!=ALIGN_OFF && alignOffset!=ALIGN_NO_OFFSET && ofdm->clksmp==dsp->alignClk &&
+		dsp_pilot_reference(&dsp->pilot[channel], dsp->alignClk, frameLen, &pltRef, &pltLen)==DSP_PILOT_ERR_OK &&
+		(dsp->ofdmPilot[channel] || dsp_ofdm_setpilot(ofdm, pltRef, pltLen, dsp->ofdmScale, dsp->ofdmEq)==DSP_OFDM_ERR_OK)) {
+		dsp->ofdmPilot[channel] = true;
+		demodStart = ((dsp->alignMode==ALIGN_TAG ? alignOffset : 0)+pltLen)%frameLen;
+		nbSym = dsp->demodSym ? dsp->demodSym : (frameLen-pltLen)/ofdm->npsym;
+		if(4+DSP_OFDM_NBYTES(nbSym*ofdm->bpsym)>frame->bitsSize) {
+			unsigned char *grown = (unsigned char *)_aligned_malloc(4+DSP_OFDM_NBYTES(nbSym*ofdm->bpsym), 4096);
+			if(grown) {
+				_aligned_free(frame->bits);
+				frame->bits = grown;
+				frame->bitsSize = 4+DSP_OFDM_NBYTES(nbSym*ofdm->bpsym);
+			}
+		}
+		if(4+DSP_OFDM_NBYTES(nbSym*ofdm->bpsym)<=frame->bitsSize && dsp_ofdm_demod16(ofdm, (const short *)frame->burst, frameLen,
+			dsp->alignMode==ALIGN_TAG ? alignOffset : 0, demodStart, nbSym, frame->invert, frame->bits+4)==DSP_OFDM_ERR_OK)
+			frame->nbBits = nbSym*ofdm->bpsym;
+	}
+	for(int j = 0; j < 4; j++)
+		frame->bits[j] = (unsigned char)(frame->nbBits>>(8*j));
+}
+
+/**
+ *  Pipeline stage, compare the demodulated bits with the reference payload using dsp_ber_frame() and record the
+ *  correlation of the pilot using dsp_ber_pilot() ( CMD_BER ).
+ *
+ *  @param context	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param item	SERVER_FRAME of the burst.
+ */
+static void StageBer(void *context, unsigned int channel, void *item)
+{
+	SERVER_DSP *dsp = (SERVER_DSP *)context;
+	SERVER_FRAME *frame = (SERVER_FRAME *)item;
+	DSP_BER *ber = &dsp->ber[channel];
+
+	if(!ber->ref || dsp->demodMode==DEMOD_OFF || !frame->bits)
+		return;
+	// a burst without bits is a lost synchronization, its pilot tells nothing about the link
+	if(dsp->alignMode!=ALIGN_OFF && frame->alignOffset!=ALIGN_NO_OFFSET)
+		dsp_ber_pilot(ber, dsp->pilot[channel].track[PILOT_TRACK].confidence);
+	dsp_ber_frame(ber, frame->bits+4, frame->nbBits);
+}
+
+/**
+ *  Message buffer of a channel for the monitoring clients, grown as needed.
+ *
+ *  @param dsp	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param size	bytes of the message.
+ *  @return the buffer, NULL when out of memory.
+ */
+static unsigned char *MonitorBuffer(SERVER_DSP *dsp, unsigned int channel, unsigned int size)
+{
+	if(size>dsp->monitorSize[channel]) {
+		unsigned char *grown = (unsigned char *)_aligned_malloc(size, 4096);
+		if(!grown)
+			return NULL;
+		_aligned_free(dsp->monitorMsg[channel]);
+		dsp->monitorMsg[channel] = grown;
+		dsp->monitorSize[channel] = size;
+	}
+	return dsp->monitorMsg[channel];
+}
+
+/**
+ *  Pipeline stage, send the min/max envelope of the burst computed by dsp_env_minmax16() to the monitoring clients
+ *  subscribed to MON_ENVELOPE, each one at its own number of points.
+ *
+ *  @param context	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param item	SERVER_FRAME of the burst.
+ */
+static void StageEnvelope(void *context, unsigned int channel, void *item)
+{
+	SERVER_DSP *dsp = (SERVER_DSP *)context;
+	SERVER_FRAME *frame = (SERVER_FRAME *)item;
+	MONITOR_SUBSCRIPTION subs[MONITOR_MAX_CLIENTS];
+	unsigned int nbsubs, points, len, dword;
+	unsigned char *msg;
+	short *lo;
+	bool mean;
+	float lsb = DSP_COND_ADC_LSB;
+
+	if(frame->burstSize==0)
+		return;
+	nbsubs = monitor_due(MON_ENVELOPE, channel, subs, MONITOR_MAX_CLIENTS);
+	for(unsigned int i = 0; i < nbsubs; i++) {
+		points = subs[i].points ? subs[i].points : MON_ENV_POINTS;
+		if(points>frame->burstSize)
+			points = frame->burstSize;
+		mean = (subs[i].flags&MON_ENV_MEAN)!=0;
+		len = ENV_LEN(points, mean);
+		msg = MonitorBuffer(dsp, channel, len);
+		if(!msg)
+			return;
+
+		msg[IDX_ENV_STREAM] = MON_ENVELOPE;
+		msg[IDX_ENV_CHNL] = frame->chnl;
+		msg[IDX_ENV_POINTS+0] = (unsigned char)(points>>0);
+		msg[IDX_ENV_POINTS+1] = (unsigned char)(points>>8);
+		memcpy(&dword, &lsb, sizeof(dword));
+		for(int j = 0; j < 4; j++) {
+			msg[IDX_ENV_BURST+j] = (unsigned char)(frame->number>>(8*j));
+			msg[IDX_ENV_SAMPLES+j] = (unsigned char)(frame->burstSize>>(8*j));
+			msg[IDX_ENV_LSB+j] = (unsigned char)(dword>>(8*j));
+		}
+		// the values are written in place, the server is little endian
+		lo = (short *)(msg+IDX_ENV_DATA);
+		dsp_env_minmax16((const short *)frame->burst, frame->burstSize, points, lo, lo+points, mean ? (float *)(lo+2*points) : NULL);
+		monitor_send(&subs[i], msg, len);
+	}
+}
+
+/**
+ *  Pipeline stage, add the burst to the spectrum of the channel using dsp_psd_frame16() and send the averaged spectrum
+ *  to the monitoring clients subscribed to MON_SPECTRUM, each one at its own number of points.
+ *
+ *  @param context	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param item	SERVER_FRAME of the burst.
+ */
+static void StageSpectrum(void *context, unsigned int channel, void *item)
+{
+	SERVER_DSP *dsp = (SERVER_DSP *)context;
+	SERVER_FRAME *frame = (SERVER_FRAME *)item;
+	DSP_PSD *psd = &dsp->psd[channel];
+	MONITOR_SUBSCRIPTION subs[MONITOR_MAX_CLIENTS];
+	unsigned int nbsubs, points, len, dword[2];
+	unsigned char *msg;
+	int mode;
+	float first, step;
+
+	if(!psd->avg || frame->burstSize==0)
+		return;
+	// every burst is averaged, the subscriptions only decide which ones are published, a client still taking a
+	// previous spectrum misses this one rather than holding the stage
+	dsp_psd_frame16(psd, (const short *)frame->burst, frame->burstSize);
+	nbsubs = monitor_due(MON_SPECTRUM, channel, subs, MONITOR_MAX_CLIENTS);
+	for(unsigned int i = 0; i < nbsubs; i++) {
+		mode = ((subs[i].flags&MON_SPC_WHOLE) ? DSP_PSD_WHOLE : 0) | ((subs[i].flags&MON_SPC_PEAK) ? DSP_PSD_PEAK : 0) | ((subs[i].flags&MON_SPC_DB) ? DSP_PSD_DB : 0);
+		points = dsp_psd_points(psd, subs[i].points ? subs[i].points : MON_SPC_POINTS, mode);
+		len = SPC_LEN(points);
+		msg = MonitorBuffer(dsp, channel, len);
+		if(!msg)
+			return;
+
+		// the densities are written in place, the server is little endian
+		dsp_psd_get(psd, points, mode, (float *)(msg+IDX_SPC_DATA), &first, &step);
+		msg[IDX_SPC_STREAM] = MON_SPECTRUM;
+		msg[IDX_SPC_CHNL] = frame->chnl;
+		msg[IDX_SPC_POINTS+0] = (unsigned char)(points>>0);
+		msg[IDX_SPC_POINTS+1] = (unsigned char)(points>>8);
+		memcpy(&dword[0], &first, sizeof(dword[0]));
+		memcpy(&dword[1], &step, sizeof(dword[1]));
+		for(int j = 0; j < 4; j++) {
+			msg[IDX_SPC_BURST+j] = (unsigned char)(frame->number>>(8*j));
+			msg[IDX_SPC_BURSTS+j] = (unsigned char)(psd->frames>>(8*j));
+			msg[IDX_SPC_NFFT+j] = (unsigned char)(psd->nfft>>(8*j));
+			msg[IDX_SPC_FIRST+j] = (unsigned char)(dword[0]>>(8*j));
+			msg[IDX_SPC_STEP+j] = (unsigned char)(dword[1]>>(8*j));
+		}
+		monitor_send(&subs[i], msg, len);
+	}
+}
+
+/**
+ *  Pipeline stage, save the burst as it is sent using Save16BitArrayToFile().
+ *
+ *  @param context	SERVER_DSP of the server.
+ *  @param channel	channel number, 0..NB_CHANNELS-1.
+ *  @param item	SERVER_FRAME of the burst.
+ */
+static void StageSave(void *context, unsigned int channel, void *item)
+{
+	SERVER_FRAME *frame = (SERVER_FRAME *)item;
+
+	Save16BitArrayToFile(frame->burst, frame->burstSize, frame->filenameascii, ASCII);
+	Save16BitArrayToFile(frame->burst, frame->burstSize, frame->filenamebin, BINARY);
+}
+
 /**
  *  \brief FMC116 Reference application (main).
  *
@@ -130,9 +569,19 @@ static ULONG Save16BitArrayToFile(void *buf, int bufsize, const char *filename,
  *	- Configure the data routers with some defautl settings using sxdx_configurerouter().
  *	- Display FMC116 diagnostics using FMC116_getdiagnostics().
  *	- Init all the FMC116 peripherals using FMC116_init().
- *	- Display all the freqencies part of the frequency tree using FMC116_freqcnt_getfrequency().
+ *	- Display all the freqencies part of the frequency tree using FMC116_freqcnt_sweep().
  *	- Configure burst size using FMC116_ctrl_configure_burst().
+ *	- Start sampling voltages, temperatures and frequencies in the background using FMC116_telemetry_start().
  *	- Grab {n} times a burst from ADC{n} using 	sxdx_configurerouter(), FMC116_ctrl_enable_channel(), FMC116_ctrl_arm(), FMC116_ctrl_sw_trigger() and Save16BitArrayToFile().
+ *	- Answer CMD_TELEMETRY with the latest snapshot obtained by FMC116_telemetry_get().
+ *	- Once configured by CMD_COND, calibrate the polarity, gain and offset of every burst using dsp_cond_apply16() and send it as 16 bit samples or as floats in volts.
+ *	- Once configured by CMD_ALIGN, find the Barker pilot in every burst using dsp_pilot_track16(), rotate the frame using dsp_pilot_rotate16() and send the offset after the burst.
+ *	- Once configured by CMD_DEMOD, demodulate the symbols following the pilot using dsp_ook_demod16() or dsp_ofdm_demod16() and send the packed bits instead of ( or after ) the burst.
+ *	- Capture the channels of a CMD_DATA in turn while the bursts already captured are aligned, demodulated and saved by the stages started with pipeline_start(), the replies follow the order of the channels.
+ *	- Once configured by CMD_BER, compare the demodulated bits with the reference payload using dsp_ber_frame() and answer CMD_LINK ( or every few CMD_DATA ) with the bit errors and the pilot correlation.
+ *	- Publish the min/max envelope of every burst computed by dsp_env_minmax16() to the monitoring clients connected to MON_PORT using monitor_start() and monitor_send().
+ *	- Once configured by CMD_PSD, average the Welch spectrum of every burst using dsp_psd_frame16() and publish it to the monitoring clients using dsp_psd_get().
+ *	- Trace the latency of every command and phase, print the histograms using trace_report() and save the session as a Chrome trace using trace_export().
  *
  *  @param argc the command line
  *  @param argv the number of options in the command line.
@@ -148,6 +597,7 @@ int main(int argc, char* argv[])
 	const char *deviceFW;
 	int FMCConstID = 0;
 	int FMCnbrch = 16; 
+	FMC116_ADC_TRAINING training;
 	int modeML605 = 0;
 	int modeKC705 = 0;
 	int modeVC707 = 0;
@@ -406,11 +856,15 @@ int main(int argc, char* argv[])
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Init FMC116
 	if(FMC116_init(AddrSipFMC116Cpld, AddrSipFMC116ClkSpi, AddrSipFMC116AdcSpi0, AddrSipFMC116AdcSpi1, AddrSipFMC116AdcSpi2, AddrSipFMC116AdcSpi3,
-		AddrSipFMC116AdcPhy, AddrSipFMC116DacSpi0, AddrSipFMC116DacSpi1, AddrSipFMC116Monitor, modeClock, FMCnbrch)!=FMC116_ERR_OK) {
+		AddrSipFMC116AdcPhy, AddrSipFMC116DacSpi0, AddrSipFMC116DacSpi1, AddrSipFMC116Monitor, modeClock, FMCnbrch, &training)!=FMC116_ERR_OK) {
 		printf("Could not initialize FMC116\n");
 		sipif_free();
 		return -10;
 	}
+	printf("Training status : Ready after %d attempt(s), %lu us\n", training.attempts, training.trainus);
+	printf("--------------------------------------\n");
+	for(unsigned int i = 0; i < training.nbregs; i++)
+		printf("%2d | %2d | %2d | %2d | ", training.taps[i][0], training.taps[i][1], training.taps[i][2], training.taps[i][3]);
     printf("\n");
 
 	/////////////////////////////////////////////////////////////////////////////////////////////
@@ -419,16 +873,22 @@ int main(int argc, char* argv[])
 	// FMC is actually attached.
     printf("--------------------------------------\n");
 	printf("--- Measuring on-board frequencies ---\n");
-	for(int i = 0; i < 7; i++) {
-		if (i==4 && FMCnbrch==12) i++; //Skip Clock ADC 3 for FMC112
-		if(FMC116_freqcnt_getfrequency(AddrSipFMC116FreqCnt, i, NULL, FMC116_FREQCNT_DISPLAY_CONSOLE)!=FMC116_FREQCNT_ERR_OK) {
-			printf("Could not obtain frequency id%d from FMC116.FREQCNT\n", i);
-			sipif_free();
-			return -11;
-		}
+	FMC116_FREQCNT_SWEEP sweep;
+	unsigned int clkmask = FMC116_FREQCNT_ALL_CLOCKS;
+	if (FMCnbrch==12) clkmask &= ~(1<<4); //Skip Clock ADC 3 for FMC112
+	if(FMC116_freqcnt_sweep(AddrSipFMC116FreqCnt, clkmask, &sweep, FMC116_FREQCNT_DISPLAY_CONSOLE)!=FMC116_FREQCNT_ERR_OK) {
+		printf("Could not obtain frequencies from FMC116.FREQCNT\n");
+		sipif_free();
+		return -11;
 	}
     printf("--------------------------------------\n\n");
 
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Keep sampling voltages, temperatures and frequencies in the background, the server answers CMD_TELEMETRY from the
+	// latest snapshot. From now on every hardware access of this thread is done under sipif_lock().
+	if(FMC116_telemetry_start(AddrSipFMC116Monitor, AddrSipFMC116FreqCnt, FMCnbrch, FMC116_TELEMETRY_PERIOD_MS)!=FMC116_TELEMETRY_ERR_OK)
+		printf("Could not start the telemetry sampler, CMD_TELEMETRY will not report any snapshot\n");
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Configure burst size and burst number
 	int BurstSize    = 0;		// samples
@@ -436,9 +896,8 @@ int main(int argc, char* argv[])
 	GetModuleFileName(NULL,dirCurrent,1024);
 	PathRemoveFileSpec(dirCurrent);
 	char filename[1024];
-	char filenamebin[1024];
-	char filenameascii[1024];
-	unsigned char *CMDFRM = (unsigned char *)_aligned_malloc(PRELIM_LEN, 4096);
+	// command header and payload, the bursts have their own buffers, a header announcing more than CFG_MAX_LEN bytes is rejected
+	unsigned char *CMDFRM = (unsigned char *)_aligned_malloc(CFG_MAX_LEN, 4096);
 	
 		
 	/****************************************************************************************************/
@@ -497,6 +956,7 @@ int main(int argc, char* argv[])
 	bool FLG_PRELIM0_DATA1 = false;
 	unsigned int BYTECOUNT = 0;
 	unsigned int DATALENGTH = PRELIM_LEN;
+	unsigned int DRAINCOUNT = 0;
 	unsigned char DATACHNL = 0;
 	unsigned char DATACMD = 0;
 	int iResult;
@@ -508,32 +968,292 @@ int main(int argc, char* argv[])
 	int chnlNum = 0;
 	unsigned __int64 routerword;
 	int ChannelEnable;
+	unsigned long long rxstart = 0;
+	TRACE_SPAN span;
+	static SERVER_DSP dsp;
+	static SERVER_FRAME frames[NB_CHANNELS];
+	SERVER_FRAME *frame;
+	void *item;
+	const PIPELINE_STAGE stages[NB_STAGES] = { { StageCondition, "cond" }, { StageAlign, "align" }, { StageDemod, "demod" }, { StageBer, "ber" }, { StageEnvelope, "envelope" }, { StageSpectrum, "spectrum" }, { StageSave, "save" } };
+	unsigned int berCount = 0;
+	bool berPush;
+	bool pipelined;
+
+	memset(&dsp, 0, sizeof(dsp));
+	dsp.condMode = COND_OFF;
+	dsp.alignMode = ALIGN_OFF;
+	dsp.demodMode = DEMOD_OFF;
+	dsp.ofdmEq = DSP_OFDM_EQ_FLAT;
+	dsp.ofdmScale = 1.0f;
+	memset(frames, 0, sizeof(frames));
+	for(int j = 0; j < NB_CHANNELS; j++) {
+		frames[j].chnl = (unsigned char)(CHNL_1<<j);
+		frames[j].burst = (unsigned char *)_aligned_malloc(CFG_MAX_LEN, 4096);
+	}
+
+	// the server thread captures, the other cores align, demodulate and save the bursts
+	pipelined = pipeline_start(0, NB_CHANNELS, stages, NB_STAGES, &dsp)==PIPELINE_ERR_OK;
+	if(!pipelined)
+		printf("Could not start the processing threads, the bursts are processed by the server thread\n");
+	// displays follow the bursts on their own port
+	if(monitor_start(MON_PORT)!=MONITOR_ERR_OK)
+		printf("Could not open the monitoring port %u, no stream published\n", MON_PORT);
+
+	// every command is traced from its first byte on
+	trace_init();
+	trace_namecommand(CMD_BURSTSIZE, "CMD_BURSTSIZE");
+	trace_namecommand(CMD_DATA, "CMD_DATA");
+	trace_namecommand(CMD_TELEMETRY, "CMD_TELEMETRY");
+	trace_namecommand(CMD_ALIGN, "CMD_ALIGN");
+	trace_namecommand(CMD_DEMOD, "CMD_DEMOD");
+	trace_namecommand(CMD_BER, "CMD_BER");
+	trace_namecommand(CMD_LINK, "CMD_LINK");
+	trace_namecommand(CMD_COND, "CMD_COND");
+	trace_namecommand(CMD_PSD, "CMD_PSD");
+	trace_namephase(PH_RECEIVE, "receive");
+	trace_namephase(PH_PREPARE, "prepare");
+	trace_namephase(PH_LOCK, "lock");
+	trace_namephase(PH_ROUTER, "router");
+	trace_namephase(PH_ENABLE, "enable");
+	trace_namephase(PH_ARM, "arm");
+	trace_namephase(PH_SETTLE, "settle");
+	trace_namephase(PH_TRIGGER, "trigger");
+	trace_namephase(PH_READDATA, "readdata");
+	trace_namephase(PH_PIPELINE, "pipeline");
+	trace_namephase(PH_SEND, "send");
+	trace_namephase(PH_HANDLE, "handle");
+
 	// Get burst size
 	printf("Server online...\n");
 	do{
-		iResult = recv(client, ((char*)CMDFRM)+BYTECOUNT, DATALENGTH-BYTECOUNT, 0);
+		if(DRAINCOUNT) {
+			// the payload of a rejected command is read and dropped, the next header follows it
+			iResult = recv(client, (char*)CMDFRM, DRAINCOUNT<CFG_MAX_LEN ? DRAINCOUNT : CFG_MAX_LEN, 0);
+			if(iResult > 0) {
+				DRAINCOUNT -= iResult;
+				continue;
+			}
+		}
+		else
+			iResult = recv(client, ((char*)CMDFRM)+BYTECOUNT, DATALENGTH-BYTECOUNT, 0);
+		if(iResult > 0 && BYTECOUNT == 0 && !FLG_PRELIM0_DATA1)
+			rxstart = trace_now();
 		BYTECOUNT+=iResult;
 		if(iResult > 0) {
 			if(BYTECOUNT == DATALENGTH){
 				if(FLG_PRELIM0_DATA1){
+					trace_start(&span, DATACMD, rxstart);
+					trace_mark(&span, PH_RECEIVE);
 					switch(DATACMD){
 					case CMD_BURSTSIZE:
 						BurstSize = (CMDFRM[1]<<8) + CMDFRM[0];
 						printf("Setting BurstSize = %d\n",BurstSize);
 						// Configure Burst Size
-						if(FMC116_ctrl_configure_burst(AddrSipFMC116Ctrl, 1, BurstSize)!=FMC116_CTRL_ERR_OK) {
+						sipif_lock();
+						rc = FMC116_ctrl_configure_burst(AddrSipFMC116Ctrl, 1, BurstSize);
+						sipif_unlock();
+						if(rc!=FMC116_CTRL_ERR_OK) {
 							printf("Could not configure burst size/length in FMC116.CTRL\n ");
 							sipif_free();
 							closesocket(client);
 							WSACleanup();
 							return -12;
 						}
-						_aligned_free(CMDFRM);
-						CMDFRM = (unsigned char *)_aligned_malloc(((2*BurstSize)>PRELIM_LEN?(2*BurstSize):PRELIM_LEN), 4096);
+						for(int j = 0; j < NB_CHANNELS; j++) {
+							_aligned_free(frames[j].burst);
+							frames[j].burst = (unsigned char *)_aligned_malloc(((2*BurstSize)>CFG_MAX_LEN?(2*BurstSize):CFG_MAX_LEN), 4096);
+							// number of symbols and one bit per sample at most
+							_aligned_free(frames[j].bits);
+							frames[j].bits = (unsigned char *)_aligned_malloc(4+DSP_OOK_NBYTES(BurstSize), 4096);
+							frames[j].bitsSize = frames[j].bits ? 4+DSP_OOK_NBYTES(BurstSize) : 0;
+							_aligned_free(frames[j].volts);
+							frames[j].volts = (float *)_aligned_malloc(4*BurstSize, 4096);
+							frames[j].voltsSize = frames[j].volts ? BurstSize : 0;
+						}
+						break;
+					case CMD_ALIGN:
+						if(DATALENGTH!=ALN_LEN && DATALENGTH!=ALN_LEN_NOTRACK) {
+							printf("Incorrect alignment configuration length (%d)\n", DATALENGTH);
+							break;
+						}
+						for(int j = 0; j < NB_CHANNELS; j++) {
+							dsp_pilot_free(&dsp.pilot[j]);
+							dsp.ofdmPilot[j] = false;
+						}
+						dsp.alignMode = CMDFRM[IDX_ALN_MODE];
+						dsp.alignInvert = CMDFRM[IDX_ALN_INVERT];
+						dsp.alignClk = CMDFRM[IDX_ALN_CLKSMP] | (CMDFRM[IDX_ALN_CLKSMP+1]<<8) | (CMDFRM[IDX_ALN_CLKSMP+2]<<16) | (CMDFRM[IDX_ALN_CLKSMP+3]<<24);
+						dsp.alignLen = CMDFRM[IDX_ALN_FRAMELEN] | (CMDFRM[IDX_ALN_FRAMELEN+1]<<8) | (CMDFRM[IDX_ALN_FRAMELEN+2]<<16) | (CMDFRM[IDX_ALN_FRAMELEN+3]<<24);
+						if(dsp.alignMode==ALIGN_OFF) {
+							printf("Pilot alignment disabled\n");
+							break;
+						}
+						// one engine per channel, the channels are aligned at the same time
+						rc = DSP_PILOT_ERR_OK;
+						for(int j = 0; j < NB_CHANNELS && rc==DSP_PILOT_ERR_OK; j++) {
+							rc = dsp_pilot_init(&dsp.pilot[j], CMDFRM[IDX_ALN_PILOT], CMDFRM[IDX_ALN_FILTER],
+								(double)(CMDFRM[IDX_ALN_CLKIN] | (CMDFRM[IDX_ALN_CLKIN+1]<<8) | (CMDFRM[IDX_ALN_CLKIN+2]<<16) | (CMDFRM[IDX_ALN_CLKIN+3]<<24)));
+						}
+						if(rc!=DSP_PILOT_ERR_OK || (dsp.alignMode!=ALIGN_TAG && dsp.alignMode!=ALIGN_ROTATE)) {
+							printf("Incorrect alignment configuration (mode %d, pilot %d, filter %d), alignment disabled\n",
+								CMDFRM[IDX_ALN_MODE], CMDFRM[IDX_ALN_PILOT], CMDFRM[IDX_ALN_FILTER]);
+							dsp.alignMode = ALIGN_OFF;
+							break;
+						}
+						// successive bursts of a channel are searched around the previous offset only
+						for(int j = 0; j < NB_CHANNELS; j++) {
+							if(DATALENGTH==ALN_LEN)
+								dsp_pilot_settracking(&dsp.pilot[j], CMDFRM[IDX_ALN_WINDOW] | (CMDFRM[IDX_ALN_WINDOW+1]<<8), CMDFRM[IDX_ALN_THRESHOLD]/100.0f);
+							else
+								dsp_pilot_settracking(&dsp.pilot[j], 0, 0.0f);
+						}
+						printf("Aligning BARKER%d pilot, sample clock %u Hz, frame %u samples, %s, tracking window +-%u\n", CMDFRM[IDX_ALN_PILOT],
+							dsp.alignClk, dsp.alignLen, dsp.alignMode==ALIGN_ROTATE ? "rotated" : "tagged", dsp.pilot[0].window);
+						break;
+					case CMD_DEMOD:
+						if(DATALENGTH<DMD_LEN || (CMDFRM[IDX_DMD_MODE]==DEMOD_OFDM ?
+							DATALENGTH<IDX_OFDM_SYMBOLS || DATALENGTH!=OFDM_LEN(CMDFRM[IDX_OFDM_MSC] | (CMDFRM[IDX_OFDM_MSC+1]<<8)) : DATALENGTH!=DMD_LEN)) {
+							printf("Incorrect demodulation configuration length (%d)\n", DATALENGTH);
+							break;
+						}
+						for(int j = 0; j < NB_CHANNELS; j++) {
+							dsp_ook_free(&dsp.ook[j]);
+							dsp_ofdm_free(&dsp.ofdm[j]);
+							dsp.ofdmPilot[j] = false;
+						}
+						dsp.demodMode = CMDFRM[IDX_DMD_MODE];
+						dsp.demodRaw = CMDFRM[IDX_DMD_RAW]!=0;
+						dsp.demodSym = CMDFRM[IDX_DMD_NSYM] | (CMDFRM[IDX_DMD_NSYM+1]<<8);
+						if(dsp.demodMode==DEMOD_OFF) {
+							printf("Demodulation disabled\n");
+							break;
+						}
+						if(dsp.demodMode==DEMOD_OFDM) {
+							unsigned int msc = CMDFRM[IDX_OFDM_MSC] | (CMDFRM[IDX_OFDM_MSC+1]<<8);
+							float symre[OFDM_MAX_MSC], symim[OFDM_MAX_MSC];
+							// the symbols are sampled at the clock of the pilot, the pilot itself is built on the first burst of each channel
+							rc = DSP_OFDM_ERR_SIZE;
+							if(dsp.alignMode!=ALIGN_OFF && msc<=OFDM_MAX_MSC) {
+								for(unsigned int j = 0; j < msc; j++) {
+									memcpy(&symre[j], CMDFRM+IDX_OFDM_SYMBOLS+8*j, 4);
+									memcpy(&symim[j], CMDFRM+IDX_OFDM_SYMBOLS+8*j+4, 4);
+								}
+								memcpy(&dsp.ofdmScale, CMDFRM+IDX_OFDM_PLTSCALE, 4);
+								dsp.ofdmEq = CMDFRM[IDX_OFDM_EQ];
+								rc = DSP_OFDM_ERR_OK;
+								for(int j = 0; j < NB_CHANNELS && rc==DSP_OFDM_ERR_OK; j++) {
+									rc = dsp_ofdm_init(&dsp.ofdm[j], CMDFRM[IDX_OFDM_TYPE], CMDFRM[IDX_OFDM_NSC] | (CMDFRM[IDX_OFDM_NSC+1]<<8), symre, symim, msc, dsp.alignClk,
+										(double)(CMDFRM[IDX_OFDM_CLKSIG] | (CMDFRM[IDX_OFDM_CLKSIG+1]<<8) | (CMDFRM[IDX_OFDM_CLKSIG+2]<<16) | (CMDFRM[IDX_OFDM_CLKSIG+3]<<24)),
+										CMDFRM[IDX_OFDM_FILTER]);
+								}
+							}
+							if(rc!=DSP_OFDM_ERR_OK || (dsp.ofdmEq!=DSP_OFDM_EQ_FLAT && dsp.ofdmEq!=DSP_OFDM_EQ_PILOT) || dsp.ofdmScale==0.0f) {
+								printf("Incorrect OFDM demodulation configuration (type %d, %d subcarriers, %u points, alignment %s), demodulation disabled\n",
+									CMDFRM[IDX_OFDM_TYPE], CMDFRM[IDX_OFDM_NSC] | (CMDFRM[IDX_OFDM_NSC+1]<<8), msc, dsp.alignMode!=ALIGN_OFF ? "on" : "off");
+								for(int j = 0; j < NB_CHANNELS; j++)
+									dsp_ofdm_free(&dsp.ofdm[j]);
+								dsp.demodMode = DEMOD_OFF;
+								break;
+							}
+							printf("Demodulating OFDM, %u subcarriers, %u points, %u samples per symbol, %s equalizer%s\n", dsp.ofdm[0].nsc, dsp.ofdm[0].msc, dsp.ofdm[0].npsym,
+								dsp.ofdmEq==DSP_OFDM_EQ_PILOT ? "per subcarrier" : "flat", dsp.demodRaw ? ", burst sent" : "");
+							break;
+						}
+						rc = DSP_OOK_ERR_OK;
+						for(int j = 0; j < NB_CHANNELS && rc==DSP_OOK_ERR_OK; j++) {
+							rc = dsp_ook_init(&dsp.ook[j], CMDFRM[IDX_DMD_NPSYM] | (CMDFRM[IDX_DMD_NPSYM+1]<<8),
+								(short)(CMDFRM[IDX_DMD_ON] | (CMDFRM[IDX_DMD_ON+1]<<8)), (short)(CMDFRM[IDX_DMD_OFF] | (CMDFRM[IDX_DMD_OFF+1]<<8)));
+						}
+						if(rc!=DSP_OOK_ERR_OK || dsp.demodMode!=DEMOD_OOK) {
+							printf("Incorrect demodulation configuration (mode %d, %d samples per symbol), demodulation disabled\n",
+								CMDFRM[IDX_DMD_MODE], CMDFRM[IDX_DMD_NPSYM] | (CMDFRM[IDX_DMD_NPSYM+1]<<8));
+							for(int j = 0; j < NB_CHANNELS; j++)
+								dsp_ook_free(&dsp.ook[j]);
+							dsp.demodMode = DEMOD_OFF;
+							break;
+						}
+						if(dsp.ook[0].on==dsp.ook[0].off)
+							printf("Demodulating OOK, %u samples per symbol, levels measured on every burst%s\n", dsp.ook[0].npsym, dsp.demodRaw ? ", burst sent" : "");
+						else
+							printf("Demodulating OOK, %u samples per symbol, threshold %.1f%s\n", dsp.ook[0].npsym, dsp.ook[0].threshold, dsp.demodRaw ? ", burst sent" : "");
+						break;
+					case CMD_COND:
+						if(DATALENGTH!=CND_LEN) {
+							printf("Incorrect conditioning configuration length (%d)\n", DATALENGTH);
+							break;
+						}
+						dsp.condMode = CMDFRM[IDX_CND_MODE];
+						if(dsp.condMode==COND_OFF) {
+							printf("Conditioning disabled\n");
+							break;
+						}
+						rc = DSP_COND_ERR_OK;
+						for(int j = 0; j < NB_CHANNELS && rc==DSP_COND_ERR_OK; j++) {
+							float gain, offset;
+							memcpy(&gain, CMDFRM+IDX_CND_TABLE+8*j, 4);
+							memcpy(&offset, CMDFRM+IDX_CND_TABLE+8*j+4, 4);
+							rc = dsp_cond_init(&dsp.cond[j], (CMDFRM[IDX_CND_INVERT]&(CHNL_1<<j))!=0, gain, offset, DSP_COND_ADC_LSB);
+						}
+						if(rc!=DSP_COND_ERR_OK || (dsp.condMode!=COND_INT16 && dsp.condMode!=COND_FLOAT)) {
+							printf("Incorrect conditioning configuration (mode %d), conditioning disabled\n", CMDFRM[IDX_CND_MODE]);
+							dsp.condMode = COND_OFF;
+							break;
+						}
+						printf("Conditioning the bursts, channels %x negated, sent as %s\n", CMDFRM[IDX_CND_INVERT], dsp.condMode==COND_FLOAT ? "floats in volts" : "16 bit samples");
+						break;
+					case CMD_BER:
+						{
+							unsigned int nbits = DATALENGTH<IDX_BER_BITS ? 0 : CMDFRM[IDX_BER_NBITS] | (CMDFRM[IDX_BER_NBITS+1]<<8) | (CMDFRM[IDX_BER_NBITS+2]<<16) | (CMDFRM[IDX_BER_NBITS+3]<<24);
+							if(DATALENGTH<IDX_BER_BITS || nbits>BER_MAX_BITS || DATALENGTH!=BER_LEN(nbits) || (DATACHNL&~(CHNL_1|CHNL_2|CHNL_3|CHNL_4))!=0) {
+								printf("Incorrect bit error rate configuration length (%d) or channel (%x)\n", DATALENGTH, DATACHNL);
+								break;
+							}
+							// the counters of the channels start over with the new reference
+							dsp.berPeriod = CMDFRM[IDX_BER_PERIOD] | (CMDFRM[IDX_BER_PERIOD+1]<<8);
+							berCount = 0;
+							for(int j = 0; j < NB_CHANNELS; j++) {
+								if((DATACHNL&(CHNL_1<<j))==0)
+									continue;
+								dsp_ber_free(&dsp.ber[j]);
+								if(nbits && dsp_ber_init(&dsp.ber[j], CMDFRM+IDX_BER_BITS, nbits)!=DSP_BER_ERR_OK)
+									printf("Could not store the reference payload of ADC%d, bit errors not measured\n", j);
+							}
+							if(nbits)
+								printf("Measuring bit errors against %u reference bits, channels %x, statistics sent every %u CMD_DATA\n", nbits, DATACHNL, dsp.berPeriod);
+							else
+								printf("Bit error measurement stopped, channels %x\n", DATACHNL);
+						}
+						break;
+					case CMD_PSD:
+						{
+							unsigned int nfft = DATALENGTH!=PSD_LEN ? 0 : CMDFRM[IDX_PSD_NFFT] | (CMDFRM[IDX_PSD_NFFT+1]<<8) | (CMDFRM[IDX_PSD_NFFT+2]<<16) | (CMDFRM[IDX_PSD_NFFT+3]<<24);
+							unsigned int clk = DATALENGTH!=PSD_LEN ? 0 : CMDFRM[IDX_PSD_CLKSMP] | (CMDFRM[IDX_PSD_CLKSMP+1]<<8) | (CMDFRM[IDX_PSD_CLKSMP+2]<<16) | (CMDFRM[IDX_PSD_CLKSMP+3]<<24);
+							unsigned int averages = DATALENGTH!=PSD_LEN ? 0 : CMDFRM[IDX_PSD_AVERAGES] | (CMDFRM[IDX_PSD_AVERAGES+1]<<8);
+							if(DATALENGTH!=PSD_LEN || CMDFRM[IDX_PSD_OVERLAP]>90 || (DATACHNL&~(CHNL_1|CHNL_2|CHNL_3|CHNL_4))!=0) {
+								printf("Incorrect spectrum configuration length (%d), overlap or channel (%x)\n", DATALENGTH, DATACHNL);
+								break;
+							}
+							// the averages of the channels start over with the new configuration
+							for(int j = 0; j < NB_CHANNELS; j++) {
+								if((DATACHNL&(CHNL_1<<j))==0)
+									continue;
+								dsp_psd_free(&dsp.psd[j]);
+								if(nfft && dsp_psd_init(&dsp.psd[j], nfft, nfft*CMDFRM[IDX_PSD_OVERLAP]/100, CMDFRM[IDX_PSD_WINDOW], averages, (float)clk, DSP_COND_ADC_LSB)!=DSP_PSD_ERR_OK) {
+									printf("Incorrect spectrum configuration of ADC%d (%u samples, window %d, clock %u Hz), spectrum not estimated\n", j, nfft, CMDFRM[IDX_PSD_WINDOW], clk);
+									dsp_psd_free(&dsp.psd[j]);
+								}
+							}
+							if(nfft)
+								printf("Estimating the spectrum of channels %x, %u samples per segment, %d%% overlap, %u bursts averaged\n", DATACHNL, nfft, CMDFRM[IDX_PSD_OVERLAP], averages);
+							else
+								printf("Spectrum estimate stopped, channels %x\n", DATACHNL);
+						}
 						break;
 					default:
 						break;
 					}
+					trace_mark(&span, PH_HANDLE);
+					trace_end(&span);
 					DATALENGTH = PRELIM_LEN;
 					FLG_PRELIM0_DATA1 = false;
 				}
@@ -544,98 +1264,168 @@ int main(int argc, char* argv[])
 					DATACHNL = CMDFRM[IDX_CHNL];
 					// Get Command Length
 					DATALENGTH = (CMDFRM[IDX_LENMSB]<<8) + CMDFRM[IDX_LENLSB];
-					if (DATALENGTH == 0){
+					if (DATALENGTH > CFG_MAX_LEN){
+						// CMDFRM holds CFG_MAX_LEN bytes, a longer payload is not a command of this server
+						printf("Incorrect length (%d) of command 0x%02X, %d bytes at most, payload dropped\n", DATALENGTH, DATACMD, CFG_MAX_LEN);
+						DRAINCOUNT = DATALENGTH;
+						DATALENGTH = PRELIM_LEN;
+						FLG_PRELIM0_DATA1 = false;
+					}
+					else if (DATALENGTH == 0){
+						trace_start(&span, DATACMD, rxstart);
+						trace_mark(&span, PH_RECEIVE);
 						switch(DATACMD){
 							case CMD_DATA:
-								switch(DATACHNL){
-								case CHNL_1:
-									chnlNum = 0;
-									pITER = &ITER1;
-									break;
-								case CHNL_2:
-									chnlNum = 1;
-									pITER = &ITER2;
-									break;
-								case CHNL_3:
-									chnlNum = 2;
-									pITER = &ITER3;
-									break;
-								case CHNL_4:
-									chnlNum = 3;
-									pITER = &ITER4;
-									break;
-								default:
+								// the channels of the mask are captured in turn, a burst is processed while the next one is captured
+								if(DATACHNL==0 || (DATACHNL&~(CHNL_1|CHNL_2|CHNL_3|CHNL_4))!=0) {
 									printf("Incorrect channel (%x) specified\n",DATACHNL);
 									break;
 								}
-								strcpy(filenameascii,dirCurrent); 
-								sprintf(filename,"\\adc%d_%d.txt",chnlNum,*pITER);
-								strcat(filenameascii, filename);
-								strcpy(filenamebin,dirCurrent); 
-								sprintf(filename,"\\adc%d_%d.bin",chnlNum,*pITER);
-								strcat(filenamebin, filename);
-								DeleteFile(filenamebin);
-								DeleteFile(filenameascii);
-
-								// compute the router configuration for a given loop
-								routerword = 0xFFFFFFFFFFFFFF00 | chnlNum;
-
-								//ChannelEnable
-								ChannelEnable = (0x01 << chnlNum);
-
-								/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-								// Read a burst from ADC0 and save to file
-								// route data from ADC0's FIFO
-								if(sxdx_configurerouter(AddrSipRouter, routerword)!=SXDXROUTER_ERR_OK) {
-									printf("Could not configure S3D1 router, exiting\n");
-									sipif_free();
-									_aligned_free(CMDFRM);
-									return -13;
-								}
+								for(chnlNum = 0; chnlNum < NB_CHANNELS; chnlNum++) {
+									frame = &frames[chnlNum];
+									if((DATACHNL&frame->chnl)==0)
+										continue;
+									switch(frame->chnl){
+									case CHNL_1:
+										pITER = &ITER1;
+										break;
+									case CHNL_2:
+										pITER = &ITER2;
+										break;
+									case CHNL_3:
+										pITER = &ITER3;
+										break;
+									default:
+										pITER = &ITER4;
+										break;
+									}
+									strcpy(frame->filenameascii,dirCurrent); 
+									sprintf(filename,"\\adc%d_%d.txt",chnlNum,*pITER);
+									strcat(frame->filenameascii, filename);
+									strcpy(frame->filenamebin,dirCurrent); 
+									sprintf(filename,"\\adc%d_%d.bin",chnlNum,*pITER);
+									strcat(frame->filenamebin, filename);
+									DeleteFile(frame->filenamebin);
+									DeleteFile(frame->filenameascii);
+									trace_mark(&span, PH_PREPARE);
 
-								if(FMC116_ctrl_enable_channel(AddrSipFMC116Ctrl, ChannelEnable, 0)!=FMC116_CTRL_ERR_OK) {
-									printf("Could not enable, exiting\n");
-									sipif_free();
-									_aligned_free(CMDFRM);
-									return -21;
-								}
+									// compute the router configuration for a given loop
+									routerword = 0xFFFFFFFFFFFFFF00 | chnlNum;
 
-								// arm the FMC116
-								if(FMC116_ctrl_arm(AddrSipFMC116Ctrl)!=FMC116_CTRL_ERR_OK) {
-									printf("Could not arm FMC116, exiting\n");
-									sipif_free();
-									_aligned_free(CMDFRM);
-									return -22;
-								}
+									//ChannelEnable
+									ChannelEnable = (0x01 << chnlNum);
+
+									/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+									// Read a burst from ADC0 and save to file
+									// route data from ADC0's FIFO
+									// the whole sequence up to the data read belongs together, the telemetry sampler waits meanwhile
+									sipif_lock();
+									trace_mark(&span, PH_LOCK);
+									if(sxdx_configurerouter(AddrSipRouter, routerword)!=SXDXROUTER_ERR_OK) {
+										printf("Could not configure S3D1 router, exiting\n");
+										sipif_free();
+										_aligned_free(CMDFRM);
+										return -13;
+									}
+									trace_mark(&span, PH_ROUTER);
+
+									if(FMC116_ctrl_enable_channel(AddrSipFMC116Ctrl, ChannelEnable, 0)!=FMC116_CTRL_ERR_OK) {
+										printf("Could not enable, exiting\n");
+										sipif_free();
+										_aligned_free(CMDFRM);
+										return -21;
+									}
+									trace_mark(&span, PH_ENABLE);
+
+									// arm the FMC116
+									if(FMC116_ctrl_arm(AddrSipFMC116Ctrl)!=FMC116_CTRL_ERR_OK) {
+										printf("Could not arm FMC116, exiting\n");
+										sipif_free();
+										_aligned_free(CMDFRM);
+										return -22;
+									}
+									trace_mark(&span, PH_ARM);
+
+									Sleep(2);
+									trace_mark(&span, PH_SETTLE);
+
+									// send a software trigger to the ADC block
+									if(FMC116_ctrl_sw_trigger(AddrSipFMC116Ctrl)!=FMC116_CTRL_ERR_OK) {
+										printf("Could not send software trigger to ADC0, exiting\n");
+										sipif_free();
+										_aligned_free(CMDFRM);
+										return -23;
+									}
+									trace_mark(&span, PH_TRIGGER);
 
-								Sleep(2);
+									// Read data from the pipe
+									printf("Retrieve %d samples from ADC%d\n", BurstSize,chnlNum);
+									if(sipif_readdata  (frame->burst,  2*BurstSize)!=SIPIF_ERR_OK) {
+										printf("Could not communicate with device %d\n", devIdx);
+										sipif_free();
+										_aligned_free(CMDFRM);
+										return -24;
+									}
+									sipif_unlock();
+									trace_mark(&span, PH_READDATA);
+									*pITER++;
 
-								// send a software trigger to the ADC block
-								if(FMC116_ctrl_sw_trigger(AddrSipFMC116Ctrl)!=FMC116_CTRL_ERR_OK) {
-									printf("Could not send software trigger to ADC0, exiting\n");
-									sipif_free();
-									_aligned_free(CMDFRM);
-									return -23;
+									// alignment, demodulation and files, on the server thread when the pipeline does not run
+									frame->burstSize = BurstSize;
+									frame->number++;
+									frame->pending = pipelined && pipeline_submit(chnlNum, frame)==PIPELINE_ERR_OK;
+									if(!frame->pending) {
+										for(int j = 0; j < NB_STAGES; j++)
+											stages[j].function(&dsp, chnlNum, frame);
+									}
 								}
 
-								// Read data from the pipe
-								printf("Retrieve %d samples from ADC%d\n", BurstSize,chnlNum);
-								if(sipif_readdata  (CMDFRM,  2*BurstSize)!=SIPIF_ERR_OK) {
-									printf("Could not communicate with device %d\n", devIdx);
-									sipif_free();
-									_aligned_free(CMDFRM);
-									return -24;
+								// the replies follow the order of the channels, the link statistics follow every berPeriod CMD_DATA
+								berPush = dsp.berPeriod && ++berCount%dsp.berPeriod==0;
+								for(chnlNum = 0; chnlNum < NB_CHANNELS; chnlNum++) {
+									frame = &frames[chnlNum];
+									if((DATACHNL&frame->chnl)==0)
+										continue;
+									if(frame->pending)
+										pipeline_collect(chnlNum, &item, INFINITE);
+									trace_mark(&span, PH_PIPELINE);
+
+									if((dsp.demodMode==DEMOD_OFF || dsp.demodRaw) && dsp.condMode==COND_FLOAT && frame->volts && frame->voltsSize>=frame->burstSize)
+										send(client, (const char *)frame->volts, 4*frame->burstSize, 0);
+									else if(dsp.demodMode==DEMOD_OFF || dsp.demodRaw)
+										send(client, (const char *)frame->burst, 2*frame->burstSize, 0);
+									if(dsp.alignMode!=ALIGN_OFF) {
+										unsigned char tag[4];
+										for(int j = 0; j < 4; j++)
+											tag[j] = (unsigned char)(frame->alignOffset>>(8*j));
+										send(client, (const char *)tag, 4, 0);
+									}
+									if(dsp.demodMode!=DEMOD_OFF && frame->bits)
+										send(client, (const char *)frame->bits, 4+(frame->nbBits+7)/8, 0);
+									if(berPush)
+										SendLink(client, &dsp.ber[chnlNum], frame->chnl);
+									trace_mark(&span, PH_SEND);
+								}
+								break;
+							case CMD_TELEMETRY:
+								SendTelemetry(client);
+								break;
+							case CMD_LINK:
+								if(DATACHNL==0 || (DATACHNL&~(CHNL_1|CHNL_2|CHNL_3|CHNL_4))!=0) {
+									printf("Incorrect channel (%x) specified\n",DATACHNL);
+									break;
+								}
+								for(int j = 0; j < NB_CHANNELS; j++) {
+									if(DATACHNL&(CHNL_1<<j))
+										SendLink(client, &dsp.ber[j], (unsigned char)(CHNL_1<<j));
 								}
-								*pITER++;
-								
-								send(client, (const char *)CMDFRM, 2*BurstSize, 0);
-			
-								Save16BitArrayToFile(CMDFRM, BurstSize, filenameascii, ASCII);
-								Save16BitArrayToFile(CMDFRM, BurstSize, filenamebin, BINARY);
 								break;
 							default:
 								break;
 						}
+						if(DATACMD!=CMD_DATA)
+							trace_mark(&span, PH_HANDLE);
+						trace_end(&span);
 						DATALENGTH = PRELIM_LEN;
 						FLG_PRELIM0_DATA1 = false;
 					}
@@ -656,10 +1446,44 @@ int main(int argc, char* argv[])
 			return 1;
 		}
 	} while(iResult > 0);
+	monitor_report(stdout);
+	monitor_stop();
     closesocket(server);
     WSACleanup();
+
+	// latency of the session
+	trace_report(stdout);
+	pipeline_report(stdout);
+	pipeline_stop();
+	for(int i = 0; i < NB_CHANNELS; i++) {
+		if(dsp.pilot[i].track[PILOT_TRACK].valid)
+			printf("ADC%d pilot: %lu bursts tracked, %lu searched, last offset %u ( correlation %.2f )\n", i, dsp.pilot[i].track[PILOT_TRACK].tracked,
+				dsp.pilot[i].track[PILOT_TRACK].searched, dsp.pilot[i].track[PILOT_TRACK].offset, dsp.pilot[i].track[PILOT_TRACK].confidence);
+		if(dsp.ber[i].ref)
+			printf("ADC%d link: %lu bursts, %lu synchronization losses, %llu bit errors in %llu bits ( BER %.3g ), mean SNR %.1f dB\n", i, dsp.ber[i].frames,
+				dsp.ber[i].synclosses, dsp.ber[i].errors, dsp.ber[i].bits, dsp_ber_rate(&dsp.ber[i]), dsp_ber_meansnr(&dsp.ber[i]));
+		if(dsp.psd[i].avg)
+			printf("ADC%d spectrum: %lu bursts averaged, %u segments of %u samples in the last one\n", i, dsp.psd[i].frames, dsp.psd[i].segments, dsp.psd[i].nfft);
+	}
+	strcpy(filename, dirCurrent);
+	strcat(filename, "\\trace.json");
+	if(trace_export(filename)==TRACE_ERR_OK)
+		printf("Session trace saved to %s ( open with chrome://tracing )\n", filename);
 	// Close the device
 	printf("\nEnd of program.\n\n\n");
+	FMC116_telemetry_stop();
+	for(int i = 0; i < NB_CHANNELS; i++) {
+		dsp_pilot_free(&dsp.pilot[i]);
+		dsp_ook_free(&dsp.ook[i]);
+		dsp_ofdm_free(&dsp.ofdm[i]);
+		dsp_ber_free(&dsp.ber[i]);
+		dsp_psd_free(&dsp.psd[i]);
+		_aligned_free(dsp.monitorMsg[i]);
+		_aligned_free(frames[i].burst);
+		_aligned_free(frames[i].bits);
+		_aligned_free(frames[i].volts);
+	}
+	dsp_fft_releaseplans();
 	sipif_free();
 	_aligned_free(CMDFRM);
 	//system("pause");
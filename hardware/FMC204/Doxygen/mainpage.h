@@ -32,6 +32,9 @@
 * -# Libs\FMC204\Incs\FMC204_freqcnt.h (frequency counter)
 * -# Libs\FMC204\Incs\FMC204_dac.h (digital to analog converter)
 * -# Libs\FMC204\Incs\FMC204_ctrl.h (burst size, burst length, arm, disarm, ... )
+* -# Libs\FMC204\Incs\fmc204_stream.h (continuous waveform feed with credit based flow control)
+* -# Libs\FMC204\Incs\fmc204_calib.h (DAC DLL tuning snapshot for warm starts)
+* -# Libs\FMC204\Incs\fmc204_telemetry.h (background voltage, temperature and frequency sampler)
 * -# Libs\FMC204\Incs\FMC204_cpld.h (fans, clock, HDMI signal directions)
 * -# Libs\FMC204\Incs\FMC204_clocktree.h (internal/external clock, part id verification)
 *
@@ -47,5 +50,14 @@
 *
 * - Interface to the hardware (sipif).
 * -# Libs\SXDXROUTER\Incs\sipif.h (sxdxrouter)
+* -# Libs\SIPIF\Incs\regtable.h (register programming tables)
+*
+* - Command latency tracing of the socket server.
+* -# Libs\TRACE\Incs\trace.h (latency histograms and Chrome trace export)
+*
+* - Signal processing of the uploaded waveforms, copied from the FMC116 package.
+* -# Libs\DSP\Incs\dsp_resample.h (polyphase rational resampler, native updnClock)
+* -# Libs\DSP\Incs\dsp_simd.h (vector instruction selection and aligned buffers)
+* -# Libs\DSP\Incs\dsp_ring.h (lock free sample queue between two threads, frame queue of the stream feeder)
 *
 */
\ No newline at end of file
@@ -24,6 +24,55 @@
 #define CMD_DATA		0x20
 #define CMD_ENCHNL		0x30
 #define CMD_ARMDAC		0x40
+#define CMD_STRMSTART	0x50	// STRM_LEN bytes payload, period and queue depth. Channel in IDX_CHNL
+#define CMD_STRMFRAME	0x60	// payload: one frame of 2*BurstSize bytes, needs one credit
+#define CMD_STRMSTATUS	0x70	// no payload
+#define CMD_STRMSTOP	0x80	// no payload
+#define CMD_TELEMETRY	0x90	// no payload, answered with the latest telemetry snapshot
+#define CMD_RESAMPLE	0xA0	// RSP_LEN bytes payload, no reply, clock of the samples of the following CMD_DATA
+
+// Stream configuration, payload of CMD_STRMSTART (little endian)
+#define IDX_STRM_PERIOD		0x00	// 16 bit, frame period (ms)
+#define IDX_STRM_DEPTH		0x02	// frames queued at most, the initial credit
+#define STRM_LEN			0x04	// the last byte is reserved
+
+// Stream status reply, sent for every CMD_STRMxxx command (little endian). Once a failed upload has stopped the stream,
+// the accepted commands are answered with FMC204_STREAM_ERR_STOPPED until the next CMD_STRMSTART.
+#define IDX_STS_CMD			0x00	// command being answered
+#define IDX_STS_ERR			0x01	// 0 when the command was accepted, the negated FMC204_STREAM_ERR_x code otherwise
+#define IDX_STS_CREDITS		0x02	// 16 bit, frames the client may still send
+#define IDX_STS_FRAMES		0x04	// 32 bit, frames played
+#define IDX_STS_UNDERRUNS	0x08	// 32 bit, frame periods without a queued frame
+#define IDX_STS_LATE		0x0C	// 32 bit, frames armed after the end of their period
+#define IDX_STS_OVERFLOWS	0x10	// 32 bit, frames sent without credit and dropped
+#define STS_LEN				0x14
+
+// Telemetry reply, sent for CMD_TELEMETRY (little endian)
+#define IDX_TLM_CMD			0x00	// CMD_TELEMETRY
+#define IDX_TLM_ERR			0x01	// 0 when all values of the snapshot are fresh, the negated error code of IDX_TLM_SRC otherwise
+#define IDX_TLM_NBVAL		0x02	// 16 bit, number of values at IDX_TLM_VALUES
+#define IDX_TLM_SEQ			0x04	// 32 bit, snapshot number, 0 before the first snapshot
+#define IDX_TLM_AGE			0x08	// 32 bit, ms since the snapshot was taken
+#define IDX_TLM_DEFERRED	0x0C	// 32 bit, sampler batches postponed behind the capture path
+#define IDX_TLM_SRC			0x10	// 32 bit, TLM_SRC_x, function whose error code is IDX_TLM_ERR, the codes of two sources overlap
+#define IDX_TLM_VALUES		0x14	// IEEE 754 floats: temperature (C), 9 voltages (V), 4 clocks (MHz)
+#define TLM_NBVAL			14
+#define TLM_LEN				(IDX_TLM_VALUES+4*TLM_NBVAL)
+#define TLM_SRC_NONE		0x00	// IDX_TLM_SRC, no error
+#define TLM_SRC_MONITOR		0x01	// IDX_TLM_SRC, monitoring device, i2cmaster_readmonitorFMC204() or i2cmaster_startmonitorFMC204() codes
+#define TLM_SRC_FREQCNT		0x02	// IDX_TLM_SRC, frequency counters, sipif codes
+
+// Resampling configuration, payload of CMD_RESAMPLE (little endian)
+#define IDX_RSP_MODE		0x00	// RESAMPLE_OFF or RESAMPLE_ON
+#define IDX_RSP_FILTER		0x01	// 0 ( RAISEDCOSINE ) or 1 ( IDEALRECT )
+#define IDX_RSP_CLKIN		0x04	// 32 bit, clock of the uploaded samples (Hz)
+#define IDX_RSP_CLKOUT		0x08	// 32 bit, DAC sample clock (Hz)
+#define RSP_LEN				0x0C
+
+// Resampling modes, with RESAMPLE_ON the CMD_DATA payload holds any number of samples ( 2*BurstSize bytes at most ) at
+// the clock IDX_RSP_CLKIN, the server resamples them to BurstSize samples at IDX_RSP_CLKOUT before the upload
+#define RESAMPLE_OFF		0x00	// CMD_DATA payload uploaded as received
+#define RESAMPLE_ON			0x01
 
 // DAC Channel 
 #define CHNL_1		0x01
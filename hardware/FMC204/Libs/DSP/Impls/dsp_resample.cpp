@@ -0,0 +1,357 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_resample.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_resample module changes the sample rate by a rational factor (implementation)
+///
+/// Polyphase FIR version of updnClock(). The signal is conceptually upsampled by USF ( zero
+/// insertion ), filtered at the upsampled rate and decimated by DSF, with USF/DSF obtained the
+/// same way as rat(). The filter has the frequency response of the updnClock() masks, 'IDEALRECT'
+/// ( flat up to half the input clock ) or 'RAISEDCOSINE' ( sinc main lobe up to the input clock ),
+/// and a gain of USF so that the amplitude is kept. Its impulse response is truncated to
+/// +-DSP_RESAMPLE_HALFTAPS input samples with a Kaiser window and split into USF phases, each
+/// output sample is then one dot product of a phase with the input history, computed with the
+/// vector instructions selected by dsp_simd.h. The filter is zero phase, output sample m is
+/// aligned with input sample m*DSF/USF as with updnClock().
+///
+/// The resampler keeps the input history between calls, a long signal may be processed in
+/// chunks of any size: the concatenation of the outputs of dsp_resample_process() and of
+/// dsp_resample_flush() is the same as the output of one dsp_resample_frame() of the whole
+/// signal, ceil(N*USF/DSF) samples for N input samples. A resampler is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dsp_simd.h"
+#include "dsp_resample.h"
+
+#define DSP_RESAMPLE_PI				3.14159265358979323846
+#define DSP_RESAMPLE_NB_STEPS		512					/*!< Simpson steps of the raised cosine impulse response integral */
+#define DSP_RESAMPLE_HIST_INIT		4096				/*!< Initial capacity of the history, samples */
+
+
+/**
+ * Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+ */
+static double dsp_resample_bessel0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for(k = 1; k < 64 && term>1e-12*sum; k++) {
+		term *= (x/(2.0*k))*(x/(2.0*k));
+		sum += term;
+	}
+	return sum;
+}
+
+/**
+ * Impulse response of the filter at the upsampled rate, t in upsampled samples.
+ *
+ * The updnClock() masks are H(f) = USF*W(f/xFs) with W = 1 up to 1/2 ( IDEALRECT ) or W = sinc up to 1 ( RAISEDCOSINE ),
+ * limited to the upsampled band |f| <= USF*xFs/2. With u = f/xFs, h(t) = 2*integral( W(u)*cos(2*pi*u*t/USF), u = 0..uc ).
+ */
+static double dsp_resample_response(int filter, unsigned int usf, double t, const double *sinctab)
+{
+	double uc, du, a, k, c0, c1, c2, sum;
+	int i;
+
+	if(filter==DSP_RESAMPLE_IDEALRECT) {
+		if(t==0.0)
+			return 1.0;
+		return sin(DSP_RESAMPLE_PI*t/usf)/(DSP_RESAMPLE_PI*t/usf);
+	}
+
+	// Simpson rule, cos(a*u) is obtained by the Chebyshev recurrence over the regular steps
+	uc = usf<2 ? 0.5 : 1.0;
+	du = uc/DSP_RESAMPLE_NB_STEPS;
+	a = 2.0*DSP_RESAMPLE_PI*t/usf;
+	k = 2.0*cos(a*du);
+	c0 = 1.0;
+	c1 = k/2.0;
+	sum = sinctab[0];
+	for(i = 1; i <= DSP_RESAMPLE_NB_STEPS; i++) {
+		sum += (i==DSP_RESAMPLE_NB_STEPS ? 1.0 : (i&1 ? 4.0 : 2.0))*sinctab[i]*c1;
+		c2 = k*c1-c0;
+		c0 = c1;
+		c1 = c2;
+	}
+	return 2.0*sum*du/3.0;
+}
+
+/**
+ * Fill the filter bank, phase p holds the taps applied to the input samples n0-K..n0+K of the output samples at
+ * upsampled index n0*USF+p. Every phase is normalized to a DC gain of 1.
+ */
+static void dsp_resample_bank(DSP_RESAMPLE *rs)
+{
+	double sinctab[DSP_RESAMPLE_NB_STEPS+1];
+	double uc, span, t, w, sum;
+	unsigned int p, i;
+	float *taps;
+
+	uc = rs->usf<2 ? 0.5 : 1.0;
+	for(i = 0; i <= DSP_RESAMPLE_NB_STEPS; i++) {
+		double u = uc*i/DSP_RESAMPLE_NB_STEPS;
+		sinctab[i] = i==0 ? 1.0 : sin(DSP_RESAMPLE_PI*u)/(DSP_RESAMPLE_PI*u);
+	}
+
+	span = (double)(DSP_RESAMPLE_HALFTAPS+1)*rs->usf;
+	for(p = 0; p < rs->usf; p++) {
+		taps = rs->bank+p*rs->ntaps;
+		sum = 0.0;
+		for(i = 0; i < rs->ntaps; i++) {
+			if(i>2*DSP_RESAMPLE_HALFTAPS) {
+				taps[i] = 0.0f;
+				continue;
+			}
+			t = (double)p+((double)DSP_RESAMPLE_HALFTAPS-i)*rs->usf;
+			w = dsp_resample_bessel0(DSP_RESAMPLE_KAISER_BETA*sqrt(1.0-(t/span)*(t/span)))/dsp_resample_bessel0(DSP_RESAMPLE_KAISER_BETA);
+			taps[i] = (float)(w*dsp_resample_response(rs->filter, rs->usf, t, sinctab));
+			sum += taps[i];
+		}
+		if(sum!=0.0) {
+			for(i = 0; i <= 2*DSP_RESAMPLE_HALFTAPS; i++)
+				taps[i] = (float)(taps[i]/sum);
+		}
+	}
+}
+
+/**
+ * Dot product of n taps ( aligned, n multiple of DSP_SIMD_FLOATS ) with n samples.
+ */
+static float dsp_resample_dot(const float *taps, const float *x, unsigned int n)
+{
+	unsigned int i;
+#if defined(DSP_SIMD_AVX)
+	__m256 acc = _mm256_setzero_ps();
+	__m128 s;
+
+	for(i = 0; i < n; i += 8)
+		acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_load_ps(taps+i), _mm256_loadu_ps(x+i)));
+	s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+#elif defined(DSP_SIMD_SSE)
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	__m128 s;
+
+	for(i = 0; i < n; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(taps+i), _mm_loadu_ps(x+i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(taps+i+4), _mm_loadu_ps(x+i+4)));
+	}
+	s = _mm_add_ps(acc0, acc1);
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+#else
+	float acc = 0.0f;
+
+	for(i = 0; i < n; i++)
+		acc += taps[i]*x[i];
+	return acc;
+#endif
+}
+
+/**
+ * Make room for count more samples after the history, plus the padding read by the vector loops.
+ */
+static int dsp_resample_reserve(DSP_RESAMPLE *rs, unsigned int count)
+{
+	unsigned int needed = rs->histcount+count+rs->ntaps;
+	unsigned int size;
+	float *hist;
+
+	if(needed<=rs->histsize)
+		return DSP_RESAMPLE_ERR_OK;
+
+	size = needed*2;
+	hist = (float *)dsp_malloc(size*sizeof(float));
+	if(!hist)
+		return DSP_RESAMPLE_ERR_ALLOC;
+	// the padding is multiplied by zero taps, it only has to hold finite values
+	memset(hist, 0, size*sizeof(float));
+	if(rs->hist)
+		memcpy(hist, rs->hist, rs->histcount*sizeof(float));
+	dsp_free(rs->hist);
+	rs->hist = hist;
+	rs->histsize = size;
+	return DSP_RESAMPLE_ERR_OK;
+}
+
+/**
+ * Produce the output samples up to index target ( excluded ) whose input samples up to n0+K are below avail, then drop
+ * the history no longer needed.
+ */
+static unsigned int dsp_resample_emit(DSP_RESAMPLE *rs, float *out, unsigned int maxout, unsigned long long target, long long avail)
+{
+	unsigned int count = 0;
+	unsigned long long t;
+	long long n0, drop;
+
+	while(count<maxout && rs->nout<target) {
+		t = rs->nout*rs->dsf;
+		n0 = (long long)(t/rs->usf);
+		if(n0+DSP_RESAMPLE_HALFTAPS>=avail)
+			break;
+		out[count++] = dsp_resample_dot(rs->bank+(t%rs->usf)*rs->ntaps, rs->hist+(n0-DSP_RESAMPLE_HALFTAPS-rs->histbase), rs->ntaps);
+		rs->nout++;
+	}
+
+	n0 = (long long)((rs->nout*rs->dsf)/rs->usf);
+	drop = n0-DSP_RESAMPLE_HALFTAPS-rs->histbase;
+	if(drop>(long long)rs->histcount)
+		drop = rs->histcount;
+	if(drop>0) {
+		memmove(rs->hist, rs->hist+drop, (rs->histcount-(unsigned int)drop)*sizeof(float));
+		rs->histcount -= (unsigned int)drop;
+		rs->histbase += drop;
+	}
+	return count;
+}
+
+int dsp_resample_rat(double xfs, double cfs, unsigned int *usf, unsigned int *dsf)
+{
+	double x, tol, n, d, lastn, lastd, frac, flip, step, save;
+
+	if(!usf || !dsf)
+		return DSP_RESAMPLE_ERR_ARGUMENT;
+	if(xfs<=0.0 || cfs<=0.0)
+		return DSP_RESAMPLE_ERR_RATIO;
+
+	x = cfs/xfs;
+	tol = 1e-6*fabs(x);
+	n = floor(x+0.5);
+	d = 1.0;
+	lastn = 1.0;
+	lastd = 0.0;
+	frac = x-n;
+	while(fabs(x-n/d)>=tol) {
+		flip = 1.0/frac;
+		step = floor(flip+0.5);
+		frac = flip-step;
+		save = n; n = n*step+lastn; lastn = save;
+		save = d; d = d*step+lastd; lastd = save;
+		if(fabs(n)>4294967295.0 || fabs(d)>4294967295.0)
+			return DSP_RESAMPLE_ERR_RATIO;
+	}
+	if(d<0) {
+		n = -n;
+		d = -d;
+	}
+	if(n<=0.0)
+		return DSP_RESAMPLE_ERR_RATIO;
+	*usf = (unsigned int)n;
+	*dsf = (unsigned int)d;
+	return DSP_RESAMPLE_ERR_OK;
+}
+
+int dsp_resample_init(DSP_RESAMPLE *rs, double xfs, double cfs, int filter)
+{
+	unsigned int usf, dsf;
+	int rc;
+
+	if(!rs)
+		return DSP_RESAMPLE_ERR_ARGUMENT;
+	if(filter!=DSP_RESAMPLE_RAISEDCOSINE && filter!=DSP_RESAMPLE_IDEALRECT)
+		return DSP_RESAMPLE_ERR_FILTER;
+	rc = dsp_resample_rat(xfs, cfs, &usf, &dsf);
+	if(rc!=DSP_RESAMPLE_ERR_OK)
+		return rc;
+	if(usf>DSP_RESAMPLE_MAX_PHASES)
+		return DSP_RESAMPLE_ERR_RATIO;
+
+	memset(rs, 0, sizeof(DSP_RESAMPLE));
+	rs->usf = usf;
+	rs->dsf = dsf;
+	rs->filter = filter;
+	rs->ntaps = DSP_SIMD_ROUNDUP(2*DSP_RESAMPLE_HALFTAPS+1);
+	rs->bank = (float *)dsp_malloc(usf*rs->ntaps*sizeof(float));
+	if(!rs->bank || dsp_resample_reserve(rs, DSP_RESAMPLE_HIST_INIT)!=DSP_RESAMPLE_ERR_OK) {
+		dsp_resample_free(rs);
+		return DSP_RESAMPLE_ERR_ALLOC;
+	}
+	dsp_resample_bank(rs);
+	dsp_resample_reset(rs);
+	return DSP_RESAMPLE_ERR_OK;
+}
+
+unsigned int dsp_resample_maxout(const DSP_RESAMPLE *rs, unsigned int nin)
+{
+	if(!rs || !rs->bank)
+		return 0;
+	return (unsigned int)(((rs->nin+nin)*rs->usf+rs->dsf-1)/rs->dsf-rs->nout);
+}
+
+int dsp_resample_process(DSP_RESAMPLE *rs, const float *in, unsigned int nin, float *out, unsigned int maxout, unsigned int *nout)
+{
+	if(!rs || !rs->bank || (!in && nin) || (!out && maxout) || !nout)
+		return DSP_RESAMPLE_ERR_ARGUMENT;
+	if(dsp_resample_reserve(rs, nin)!=DSP_RESAMPLE_ERR_OK)
+		return DSP_RESAMPLE_ERR_ALLOC;
+
+	memcpy(rs->hist+rs->histcount, in, nin*sizeof(float));
+	rs->histcount += nin;
+	rs->nin += nin;
+	*nout = dsp_resample_emit(rs, out, maxout, (unsigned long long)-1, (long long)rs->nin);
+	return DSP_RESAMPLE_ERR_OK;
+}
+
+int dsp_resample_flush(DSP_RESAMPLE *rs, float *out, unsigned int maxout, unsigned int *nout)
+{
+	unsigned long long target;
+
+	if(!rs || !rs->bank || (!out && maxout) || !nout)
+		return DSP_RESAMPLE_ERR_ARGUMENT;
+	if(dsp_resample_reserve(rs, DSP_RESAMPLE_HALFTAPS+rs->ntaps)!=DSP_RESAMPLE_ERR_OK)
+		return DSP_RESAMPLE_ERR_ALLOC;
+
+	// the zeros following the signal are not part of the history, they are written again by every flush
+	memset(rs->hist+rs->histcount, 0, (DSP_RESAMPLE_HALFTAPS+rs->ntaps)*sizeof(float));
+	target = (rs->nin*rs->usf+rs->dsf-1)/rs->dsf;
+	*nout = dsp_resample_emit(rs, out, maxout, target, (long long)rs->nin+DSP_RESAMPLE_HALFTAPS+1);
+	if(rs->nout==target)
+		dsp_resample_reset(rs);
+	return DSP_RESAMPLE_ERR_OK;
+}
+
+int dsp_resample_frame(DSP_RESAMPLE *rs, const float *in, unsigned int nin, float *out, unsigned int maxout, unsigned int *nout)
+{
+	unsigned int n1, n2;
+	int rc;
+
+	if(!rs || !rs->bank || !nout)
+		return DSP_RESAMPLE_ERR_ARGUMENT;
+	dsp_resample_reset(rs);
+	rc = dsp_resample_process(rs, in, nin, out, maxout, &n1);
+	if(rc!=DSP_RESAMPLE_ERR_OK)
+		return rc;
+	rc = dsp_resample_flush(rs, out ? out+n1 : NULL, maxout-n1, &n2);
+	if(rc!=DSP_RESAMPLE_ERR_OK)
+		return rc;
+	dsp_resample_reset(rs);
+	*nout = n1+n2;
+	return DSP_RESAMPLE_ERR_OK;
+}
+
+void dsp_resample_reset(DSP_RESAMPLE *rs)
+{
+	if(!rs || !rs->hist)
+		return;
+	// the signal is preceded by zeros, the first output samples see DSP_RESAMPLE_HALFTAPS of them
+	memset(rs->hist, 0, DSP_RESAMPLE_HALFTAPS*sizeof(float));
+	rs->histcount = DSP_RESAMPLE_HALFTAPS;
+	rs->histbase = -DSP_RESAMPLE_HALFTAPS;
+	rs->nin = 0;
+	rs->nout = 0;
+}
+
+void dsp_resample_free(DSP_RESAMPLE *rs)
+{
+	if(!rs)
+		return;
+	dsp_free(rs->bank);
+	dsp_free(rs->hist);
+	memset(rs, 0, sizeof(DSP_RESAMPLE));
+}
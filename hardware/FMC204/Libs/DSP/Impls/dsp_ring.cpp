@@ -0,0 +1,304 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ring.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ring module queues samples between two threads (implementation)
+///
+/// Native version of cFIFO, the queue between the stages of cModulator and cDemodulator. One
+/// thread writes the samples, 16 bit ADC samples or floats, another thread reads them. The
+/// buffer holds a power of 2 number of samples so that the positions wrap with a mask, and the
+/// write and read positions sit on their own cache lines, each thread only writes its own. No
+/// lock is taken, a memory barrier publishes the samples before the position moves.
+///
+/// A write that does not fit is refused as a whole and counted, the samples already queued are
+/// never overwritten ( cFIFO.enQ() warns and corrupts them ). A read returns the samples
+/// available up to the number requested, as cFIFO.deQ() does, a short read is counted. The
+/// span functions give the contiguous part of the buffer that may be written or read in place,
+/// the samples then need no copy. The wait functions retry until the samples fit or arrive,
+/// spinning first and then sleeping 1 ms at a time until the timeout.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <string.h>
+#ifdef WIN32
+ #include <windows.h>
+ #define DSP_RING_BARRIER()		MemoryBarrier()
+ #define DSP_RING_YIELD()		YieldProcessor()
+ #define DSP_RING_SLEEP1MS()	Sleep(1)
+#else
+ #include <sched.h>
+ #include <time.h>
+ #define DSP_RING_BARRIER()		__sync_synchronize()
+ #define DSP_RING_YIELD()		sched_yield()
+ static void dsp_ring_sleep1ms(void) { struct timespec ts = { 0, 1000000 }; nanosleep(&ts, NULL); }
+ #define DSP_RING_SLEEP1MS()	dsp_ring_sleep1ms()
+#endif
+#include "dsp_simd.h"
+#include "dsp_ring.h"
+
+
+/**
+ * Copy samples into the buffer from position pos on, wrapping around its end.
+ */
+static void dsp_ring_copyin(DSP_RING *ring, unsigned int pos, const void *samples, unsigned int count)
+{
+	unsigned int first = ring->size-(pos&ring->mask);
+
+	if(first>count)
+		first = count;
+	memcpy(ring->buffer+(size_t)(pos&ring->mask)*ring->sample, samples, (size_t)first*ring->sample);
+	memcpy(ring->buffer, (const char *)samples+(size_t)first*ring->sample, (size_t)(count-first)*ring->sample);
+}
+
+/**
+ * Copy samples out of the buffer from position pos on, wrapping around its end.
+ */
+static void dsp_ring_copyout(const DSP_RING *ring, unsigned int pos, void *samples, unsigned int count)
+{
+	unsigned int first = ring->size-(pos&ring->mask);
+
+	if(first>count)
+		first = count;
+	memcpy(samples, ring->buffer+(size_t)(pos&ring->mask)*ring->sample, (size_t)first*ring->sample);
+	memcpy((char *)samples+(size_t)first*ring->sample, ring->buffer, (size_t)(count-first)*ring->sample);
+}
+
+/**
+ * Room seen by the writer, the position of the reader is read again only when the cached one is not enough.
+ */
+static unsigned int dsp_ring_writerroom(DSP_RING *ring, unsigned int count)
+{
+	unsigned int room = ring->size-(ring->head-ring->tailcache);
+
+	if(room<count) {
+		ring->tailcache = ring->tail;
+		// the reader is done with the samples before tail, they may be overwritten
+		DSP_RING_BARRIER();
+		room = ring->size-(ring->head-ring->tailcache);
+	}
+	return room;
+}
+
+/**
+ * Samples seen by the reader, the position of the writer is read again only when the cached one is not enough.
+ */
+static unsigned int dsp_ring_readercount(DSP_RING *ring, unsigned int count)
+{
+	unsigned int avail = ring->headcache-ring->tail;
+
+	if(avail<count) {
+		ring->headcache = ring->head;
+		// the samples before head are read after head
+		DSP_RING_BARRIER();
+		avail = ring->headcache-ring->tail;
+	}
+	return avail;
+}
+
+/**
+ * Queue all the samples or none of them, without counting.
+ *
+ * @return 1 when the samples have been queued, 0 when they do not fit.
+ */
+static int dsp_ring_put(DSP_RING *ring, const void *samples, unsigned int count)
+{
+	unsigned int head = ring->head;
+
+	if(dsp_ring_writerroom(ring, count)<count)
+		return 0;
+	dsp_ring_copyin(ring, head, samples, count);
+	// the samples are visible before the new head
+	DSP_RING_BARRIER();
+	ring->head = head+count;
+	return 1;
+}
+
+/**
+ * Wait a little before trying again, spin first then sleep.
+ *
+ * @return 0 once timeoutms has elapsed.
+ */
+static int dsp_ring_backoff(unsigned int *tries, unsigned long *waitedms, unsigned long timeoutms)
+{
+	if(*tries<DSP_RING_SPIN) {
+		(*tries)++;
+		DSP_RING_YIELD();
+		return 1;
+	}
+	if(timeoutms!=DSP_RING_INFINITE && *waitedms>=timeoutms)
+		return 0;
+	DSP_RING_SLEEP1MS();
+	(*waitedms)++;
+	return 1;
+}
+
+int dsp_ring_init(DSP_RING *ring, int type, unsigned int size)
+{
+	unsigned int n;
+
+	if(!ring)
+		return DSP_RING_ERR_ARGUMENT;
+	memset(ring, 0, sizeof(DSP_RING));
+	if(type!=DSP_RING_INT16 && type!=DSP_RING_FLOAT)
+		return DSP_RING_ERR_TYPE;
+	if(size==0 || size>DSP_RING_MAX_SIZE)
+		return DSP_RING_ERR_SIZE;
+
+	for(n = 1; n < size; n <<= 1)
+		;
+	ring->type = type;
+	ring->sample = type==DSP_RING_INT16 ? sizeof(short) : sizeof(float);
+	ring->size = n;
+	ring->mask = n-1;
+	ring->buffer = (char *)dsp_malloc((size_t)n*ring->sample);
+	if(!ring->buffer)
+		return DSP_RING_ERR_ALLOC;
+	return DSP_RING_ERR_OK;
+}
+
+unsigned int dsp_ring_count(const DSP_RING *ring)
+{
+	if(!ring)
+		return 0;
+	return ring->head-ring->tail;
+}
+
+unsigned int dsp_ring_room(const DSP_RING *ring)
+{
+	if(!ring)
+		return 0;
+	return ring->size-(ring->head-ring->tail);
+}
+
+int dsp_ring_write(DSP_RING *ring, const void *samples, unsigned int count)
+{
+	if(!ring || !ring->buffer || (!samples && count) || count>ring->size)
+		return DSP_RING_ERR_ARGUMENT;
+
+	if(!dsp_ring_put(ring, samples, count)) {
+		ring->overflows++;
+		ring->dropped += count;
+		return DSP_RING_ERR_OVERFLOW;
+	}
+	return DSP_RING_ERR_OK;
+}
+
+int dsp_ring_writewait(DSP_RING *ring, const void *samples, unsigned int count, unsigned long timeoutms)
+{
+	unsigned int tries = 0;
+	unsigned long waitedms = 0;
+
+	if(!ring || !ring->buffer || (!samples && count) || count>ring->size)
+		return DSP_RING_ERR_ARGUMENT;
+
+	while(!dsp_ring_put(ring, samples, count)) {
+		if(!dsp_ring_backoff(&tries, &waitedms, timeoutms)) {
+			ring->overflows++;
+			ring->dropped += count;
+			return DSP_RING_ERR_OVERFLOW;
+		}
+	}
+	return DSP_RING_ERR_OK;
+}
+
+int dsp_ring_read(DSP_RING *ring, void *samples, unsigned int count, unsigned int *read)
+{
+	unsigned int tail, n;
+
+	if(read)
+		*read = 0;
+	if(!ring || !ring->buffer || (!samples && count) || count>ring->size)
+		return DSP_RING_ERR_ARGUMENT;
+
+	tail = ring->tail;
+	n = dsp_ring_readercount(ring, count);
+	if(n>count)
+		n = count;
+	dsp_ring_copyout(ring, tail, samples, n);
+	// the samples are copied before the writer may overwrite them
+	DSP_RING_BARRIER();
+	ring->tail = tail+n;
+
+	if(read)
+		*read = n;
+	if(n<count) {
+		ring->underflows++;
+		ring->missing += count-n;
+		return DSP_RING_ERR_UNDERFLOW;
+	}
+	return DSP_RING_ERR_OK;
+}
+
+int dsp_ring_readwait(DSP_RING *ring, void *samples, unsigned int count, unsigned int *read, unsigned long timeoutms)
+{
+	unsigned int tries = 0;
+	unsigned long waitedms = 0;
+
+	if(ring && ring->buffer && count<=ring->size) {
+		while(dsp_ring_readercount(ring, count)<count && dsp_ring_backoff(&tries, &waitedms, timeoutms))
+			;
+	}
+	return dsp_ring_read(ring, samples, count, read);
+}
+
+int dsp_ring_writespan(DSP_RING *ring, void **span, unsigned int *count)
+{
+	unsigned int head, room, first;
+
+	if(!ring || !ring->buffer || !span || !count)
+		return DSP_RING_ERR_ARGUMENT;
+
+	head = ring->head;
+	room = dsp_ring_writerroom(ring, ring->size);
+	first = ring->size-(head&ring->mask);
+	*span = ring->buffer+(size_t)(head&ring->mask)*ring->sample;
+	*count = room<first ? room : first;
+	return DSP_RING_ERR_OK;
+}
+
+int dsp_ring_commitwrite(DSP_RING *ring, unsigned int count)
+{
+	if(!ring || !ring->buffer)
+		return DSP_RING_ERR_ARGUMENT;
+	if(count>ring->size-(ring->head-ring->tailcache))
+		return DSP_RING_ERR_OVERFLOW;
+
+	// the samples written in the span are visible before the new head
+	DSP_RING_BARRIER();
+	ring->head = ring->head+count;
+	return DSP_RING_ERR_OK;
+}
+
+int dsp_ring_readspan(DSP_RING *ring, const void **span, unsigned int *count)
+{
+	unsigned int tail, avail, first;
+
+	if(!ring || !ring->buffer || !span || !count)
+		return DSP_RING_ERR_ARGUMENT;
+
+	tail = ring->tail;
+	avail = dsp_ring_readercount(ring, ring->size);
+	first = ring->size-(tail&ring->mask);
+	*span = ring->buffer+(size_t)(tail&ring->mask)*ring->sample;
+	*count = avail<first ? avail : first;
+	return DSP_RING_ERR_OK;
+}
+
+int dsp_ring_commitread(DSP_RING *ring, unsigned int count)
+{
+	if(!ring || !ring->buffer)
+		return DSP_RING_ERR_ARGUMENT;
+	if(count>ring->headcache-ring->tail)
+		return DSP_RING_ERR_UNDERFLOW;
+
+	// the samples of the span are read before the writer may overwrite them
+	DSP_RING_BARRIER();
+	ring->tail = ring->tail+count;
+	return DSP_RING_ERR_OK;
+}
+
+void dsp_ring_free(DSP_RING *ring)
+{
+	if(!ring)
+		return;
+	dsp_free(ring->buffer);
+	memset(ring, 0, sizeof(DSP_RING));
+}
@@ -0,0 +1,154 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_resample.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_resample module changes the sample rate by a rational factor (header)
+///
+/// Polyphase FIR version of updnClock(). The signal is conceptually upsampled by USF ( zero
+/// insertion ), filtered at the upsampled rate and decimated by DSF, with USF/DSF obtained the
+/// same way as rat(). The filter has the frequency response of the updnClock() masks, 'IDEALRECT'
+/// ( flat up to half the input clock ) or 'RAISEDCOSINE' ( sinc main lobe up to the input clock ),
+/// and a gain of USF so that the amplitude is kept. Its impulse response is truncated to
+/// +-DSP_RESAMPLE_HALFTAPS input samples with a Kaiser window and split into USF phases, each
+/// output sample is then one dot product of a phase with the input history, computed with the
+/// vector instructions selected by dsp_simd.h. The filter is zero phase, output sample m is
+/// aligned with input sample m*DSF/USF as with updnClock().
+///
+/// The resampler keeps the input history between calls, a long signal may be processed in
+/// chunks of any size: the concatenation of the outputs of dsp_resample_process() and of
+/// dsp_resample_flush() is the same as the output of one dsp_resample_frame() of the whole
+/// signal, ceil(N*USF/DSF) samples for N input samples. A resampler is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_RESAMPLE_H_
+#define _DSP_RESAMPLE_H_
+
+/* defines */
+#define DSP_RESAMPLE_RAISEDCOSINE	0					/*!< updnClock() 'RAISEDCOSINE' filter */
+#define DSP_RESAMPLE_IDEALRECT		1					/*!< updnClock() 'IDEALRECT' filter */
+#define DSP_RESAMPLE_HALFTAPS		32					/*!< Input samples on each side of an output sample */
+#define DSP_RESAMPLE_MAX_PHASES		4096				/*!< Largest USF supported */
+#define DSP_RESAMPLE_KAISER_BETA	3.0					/*!< Kaiser window of the truncated impulse response, low to keep the mask shape */
+
+/**
+ * Resampler, see dsp_resample_init().
+ */
+typedef struct {
+	unsigned int usf;									/*!< upsampling factor */
+	unsigned int dsf;									/*!< downsampling factor */
+	int filter;											/*!< DSP_RESAMPLE_RAISEDCOSINE or DSP_RESAMPLE_IDEALRECT */
+	unsigned int ntaps;									/*!< taps per phase, 2*DSP_RESAMPLE_HALFTAPS+1 rounded up for the vector loops */
+	float *bank;										/*!< usf phases of ntaps taps, phase p at bank+p*ntaps */
+	float *hist;										/*!< input history, hist[0] is input sample histbase */
+	unsigned int histsize;								/*!< capacity of hist, samples */
+	unsigned int histcount;								/*!< samples stored in hist */
+	long long histbase;									/*!< input index of hist[0], negative for the zeros preceding the signal */
+	unsigned long long nin;								/*!< input samples received since the last reset */
+	unsigned long long nout;							/*!< output samples produced since the last reset */
+} DSP_RESAMPLE;
+
+/* error codes */
+#define DSP_RESAMPLE_ERR_OK			0					/*!< No error encountered during execution. */
+#define DSP_RESAMPLE_ERR_RATIO		-1					/*!< The clocks are not positive or USF exceeds DSP_RESAMPLE_MAX_PHASES. */
+#define DSP_RESAMPLE_ERR_FILTER		-2					/*!< Unknown filter type. */
+#define DSP_RESAMPLE_ERR_ALLOC		-3					/*!< The filter bank or the history could not be allocated. */
+#define DSP_RESAMPLE_ERR_ARGUMENT	-4					/*!< An argument is NULL or the resampler has not been initialized. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Obtain the rational factor of a clock change, same continued fraction expansion and tolerance as MATLAB rat().
+ *
+ * @param	xfs	clock of the input samples, Hz.
+ * @param	cfs	clock of the output samples, Hz.
+ * @param	usf	receives the upsampling factor.
+ * @param	dsf	receives the downsampling factor.
+ * @return  - DSP_RESAMPLE_ERR_OK
+ *			- DSP_RESAMPLE_ERR_RATIO
+ *			- DSP_RESAMPLE_ERR_ARGUMENT
+ */
+int dsp_resample_rat(double xfs, double cfs, unsigned int *usf, unsigned int *dsf);
+
+/**
+ * Build the filter bank of a resampler and reset its history.
+ *
+ * @param	rs	resampler to be initialized, released with dsp_resample_free().
+ * @param	xfs	clock of the input samples, Hz.
+ * @param	cfs	clock of the output samples, Hz.
+ * @param	filter	DSP_RESAMPLE_RAISEDCOSINE or DSP_RESAMPLE_IDEALRECT.
+ * @return  - DSP_RESAMPLE_ERR_OK
+ *			- DSP_RESAMPLE_ERR_RATIO
+ *			- DSP_RESAMPLE_ERR_FILTER
+ *			- DSP_RESAMPLE_ERR_ALLOC
+ *			- DSP_RESAMPLE_ERR_ARGUMENT
+ */
+int dsp_resample_init(DSP_RESAMPLE *rs, double xfs, double cfs, int filter);
+
+/**
+ * Obtain the largest number of output samples a call may produce, to size the output buffers.
+ *
+ * @param	rs	resampler initialized by dsp_resample_init().
+ * @param	nin	input samples passed to dsp_resample_process(), 0 for dsp_resample_flush().
+ * @return  the number of output samples.
+ */
+unsigned int dsp_resample_maxout(const DSP_RESAMPLE *rs, unsigned int nin);
+
+/**
+ * Append input samples and produce the output samples they complete. An output sample needs the
+ * DSP_RESAMPLE_HALFTAPS input samples that follow it, these come with the next call or with dsp_resample_flush().
+ *
+ * @param	rs	resampler initialized by dsp_resample_init().
+ * @param	in	input samples.
+ * @param	nin	number of input samples.
+ * @param	out	receives the output samples.
+ * @param	maxout	capacity of out, output samples that do not fit are produced by the next call.
+ * @param	nout	receives the number of output samples written.
+ * @return  - DSP_RESAMPLE_ERR_OK
+ *			- DSP_RESAMPLE_ERR_ALLOC
+ *			- DSP_RESAMPLE_ERR_ARGUMENT
+ */
+int dsp_resample_process(DSP_RESAMPLE *rs, const float *in, unsigned int nin, float *out, unsigned int maxout, unsigned int *nout);
+
+/**
+ * End the signal: produce the remaining output samples, the input is taken as 0 past its last sample. The history is
+ * reset once every output sample has been produced, the next call to dsp_resample_process() starts a new signal.
+ *
+ * @param	rs	resampler initialized by dsp_resample_init().
+ * @param	out	receives the output samples.
+ * @param	maxout	capacity of out, call again while *nout equals maxout.
+ * @param	nout	receives the number of output samples written.
+ * @return  - DSP_RESAMPLE_ERR_OK
+ *			- DSP_RESAMPLE_ERR_ALLOC
+ *			- DSP_RESAMPLE_ERR_ARGUMENT
+ */
+int dsp_resample_flush(DSP_RESAMPLE *rs, float *out, unsigned int maxout, unsigned int *nout);
+
+/**
+ * Resample a whole signal, same as dsp_resample_reset(), dsp_resample_process() and dsp_resample_flush().
+ *
+ * @param	maxout	capacity of out, ceil(nin*USF/DSF) samples are produced at most.
+ */
+int dsp_resample_frame(DSP_RESAMPLE *rs, const float *in, unsigned int nin, float *out, unsigned int maxout, unsigned int *nout);
+
+/**
+ * Drop the history, the next call to dsp_resample_process() starts a new signal.
+ *
+ * @param	rs	resampler initialized by dsp_resample_init().
+ */
+void dsp_resample_reset(DSP_RESAMPLE *rs);
+
+/**
+ * Release the filter bank and the history.
+ *
+ * @param	rs	resampler initialized by dsp_resample_init(), or cleared with memset().
+ */
+void dsp_resample_free(DSP_RESAMPLE *rs);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_RESAMPLE_H_
@@ -0,0 +1,191 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_ring.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_ring module queues samples between two threads (header)
+///
+/// Native version of cFIFO, the queue between the stages of cModulator and cDemodulator. One
+/// thread writes the samples, 16 bit ADC samples or floats, another thread reads them. The
+/// buffer holds a power of 2 number of samples so that the positions wrap with a mask, and the
+/// write and read positions sit on their own cache lines, each thread only writes its own. No
+/// lock is taken, a memory barrier publishes the samples before the position moves.
+///
+/// A write that does not fit is refused as a whole and counted, the samples already queued are
+/// never overwritten ( cFIFO.enQ() warns and corrupts them ). A read returns the samples
+/// available up to the number requested, as cFIFO.deQ() does, a short read is counted. The
+/// span functions give the contiguous part of the buffer that may be written or read in place,
+/// the samples then need no copy. The wait functions retry until the samples fit or arrive,
+/// spinning first and then sleeping 1 ms at a time until the timeout.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_RING_H_
+#define _DSP_RING_H_
+
+/* defines */
+#define DSP_RING_INT16				0				/*!< 16 bit samples */
+#define DSP_RING_FLOAT				1				/*!< single precision samples */
+#define DSP_RING_MAX_SIZE			(1u<<28)		/*!< Largest buffer, samples */
+#define DSP_RING_CACHE_LINE			64				/*!< Padding between the fields written by the two threads, bytes */
+#define DSP_RING_SPIN				256				/*!< Tries of the wait functions before they start sleeping */
+#define DSP_RING_INFINITE			0xFFFFFFFF		/*!< Timeout of the wait functions that never gives up */
+
+/**
+ * Sample queue, see dsp_ring_init(). The writer owns head and the overflow counters, the reader owns tail and the
+ * underflow counters, the counters may be read by any thread.
+ */
+typedef struct {
+	int type;										/*!< DSP_RING_INT16 or DSP_RING_FLOAT */
+	unsigned int sample;							/*!< bytes per sample */
+	unsigned int size;								/*!< samples held by buffer, power of 2 */
+	unsigned int mask;								/*!< size-1 */
+	char *buffer;									/*!< size samples */
+	char pad0[DSP_RING_CACHE_LINE];
+	volatile unsigned int head;						/*!< samples written so far, modulo 2^32 */
+	unsigned int tailcache;							/*!< tail last read by the writer */
+	unsigned long overflows;						/*!< writes refused for lack of room */
+	unsigned long long dropped;						/*!< samples of the writes refused */
+	char pad1[DSP_RING_CACHE_LINE];
+	volatile unsigned int tail;						/*!< samples read so far, modulo 2^32 */
+	unsigned int headcache;							/*!< head last read by the reader */
+	unsigned long underflows;						/*!< reads that returned fewer samples than requested */
+	unsigned long long missing;						/*!< samples requested but not available */
+	char pad2[DSP_RING_CACHE_LINE];
+} DSP_RING;
+
+/* error codes */
+#define DSP_RING_ERR_OK				0				/*!< No error encountered during execution. */
+#define DSP_RING_ERR_TYPE			-1				/*!< Unknown sample type. */
+#define DSP_RING_ERR_SIZE			-2				/*!< The buffer size is 0 or larger than DSP_RING_MAX_SIZE. */
+#define DSP_RING_ERR_OVERFLOW		-3				/*!< The samples do not fit, nothing has been written. */
+#define DSP_RING_ERR_UNDERFLOW		-4				/*!< Fewer samples than requested have been read. */
+#define DSP_RING_ERR_ALLOC			-5				/*!< The buffer could not be allocated. */
+#define DSP_RING_ERR_ARGUMENT		-6				/*!< An argument is NULL, or more samples than the buffer holds are requested. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initialize an empty queue.
+ *
+ * @param	ring	queue to be initialized, released with dsp_ring_free().
+ * @param	type	DSP_RING_INT16 or DSP_RING_FLOAT.
+ * @param	size	samples the queue holds at least, rounded up to a power of 2, 1..DSP_RING_MAX_SIZE.
+ * @return  - DSP_RING_ERR_OK
+ *			- DSP_RING_ERR_TYPE
+ *			- DSP_RING_ERR_SIZE
+ *			- DSP_RING_ERR_ALLOC
+ *			- DSP_RING_ERR_ARGUMENT
+ */
+int dsp_ring_init(DSP_RING *ring, int type, unsigned int size);
+
+/**
+ * Obtain the number of samples queued ( cFIFO.COUNT ), exact for the reader, a lower bound for the writer.
+ */
+unsigned int dsp_ring_count(const DSP_RING *ring);
+
+/**
+ * Obtain the room left for samples, exact for the writer, a lower bound for the reader.
+ */
+unsigned int dsp_ring_room(const DSP_RING *ring);
+
+/**
+ * Queue samples ( cFIFO.enQ() ), writer thread only. The call does not wait.
+ *
+ * @param	ring	queue initialized by dsp_ring_init().
+ * @param	samples	samples of the type of the queue.
+ * @param	count	number of samples.
+ * @return  - DSP_RING_ERR_OK
+ *			- DSP_RING_ERR_OVERFLOW
+ *			- DSP_RING_ERR_ARGUMENT
+ */
+int dsp_ring_write(DSP_RING *ring, const void *samples, unsigned int count);
+
+/**
+ * Same as dsp_ring_write(), waiting for the room to free up.
+ *
+ * @param	timeoutms	longest wait in ms, DSP_RING_INFINITE to wait until the reader makes room.
+ * @return  DSP_RING_ERR_OVERFLOW when the room is still missing after timeoutms.
+ */
+int dsp_ring_writewait(DSP_RING *ring, const void *samples, unsigned int count, unsigned long timeoutms);
+
+/**
+ * Dequeue up to count samples ( cFIFO.deQ() ), reader thread only. The call does not wait.
+ *
+ * @param	ring	queue initialized by dsp_ring_init().
+ * @param	samples	receives the samples, of the type of the queue.
+ * @param	count	number of samples requested.
+ * @param	read	receives the number of samples read, may be NULL.
+ * @return  - DSP_RING_ERR_OK
+ *			- DSP_RING_ERR_UNDERFLOW
+ *			- DSP_RING_ERR_ARGUMENT
+ */
+int dsp_ring_read(DSP_RING *ring, void *samples, unsigned int count, unsigned int *read);
+
+/**
+ * Same as dsp_ring_read(), waiting for the count samples to arrive.
+ *
+ * @param	timeoutms	longest wait in ms, DSP_RING_INFINITE to wait until the writer queues them.
+ * @return  DSP_RING_ERR_UNDERFLOW when fewer samples have arrived after timeoutms, they are read.
+ */
+int dsp_ring_readwait(DSP_RING *ring, void *samples, unsigned int count, unsigned int *read, unsigned long timeoutms);
+
+/**
+ * Obtain the contiguous room following the last sample queued, writer thread only. The samples written there are
+ * queued by dsp_ring_commitwrite().
+ *
+ * @param	ring	queue initialized by dsp_ring_init().
+ * @param	span	receives the first sample of the room.
+ * @param	count	receives the number of samples of the room, 0 when the queue is full.
+ * @return  - DSP_RING_ERR_OK
+ *			- DSP_RING_ERR_ARGUMENT
+ */
+int dsp_ring_writespan(DSP_RING *ring, void **span, unsigned int *count);
+
+/**
+ * Queue the samples written in the span of dsp_ring_writespan().
+ *
+ * @param	ring	queue initialized by dsp_ring_init().
+ * @param	count	number of samples written at the beginning of the span.
+ * @return  - DSP_RING_ERR_OK
+ *			- DSP_RING_ERR_OVERFLOW
+ *			- DSP_RING_ERR_ARGUMENT
+ */
+int dsp_ring_commitwrite(DSP_RING *ring, unsigned int count);
+
+/**
+ * Obtain the contiguous samples following the last sample dequeued, reader thread only. The samples stay queued until
+ * dsp_ring_commitread().
+ *
+ * @param	ring	queue initialized by dsp_ring_init().
+ * @param	span	receives the first sample.
+ * @param	count	receives the number of samples, 0 when the queue is empty.
+ * @return  - DSP_RING_ERR_OK
+ *			- DSP_RING_ERR_ARGUMENT
+ */
+int dsp_ring_readspan(DSP_RING *ring, const void **span, unsigned int *count);
+
+/**
+ * Dequeue the samples read in the span of dsp_ring_readspan().
+ *
+ * @param	ring	queue initialized by dsp_ring_init().
+ * @param	count	number of samples read at the beginning of the span.
+ * @return  - DSP_RING_ERR_OK
+ *			- DSP_RING_ERR_UNDERFLOW
+ *			- DSP_RING_ERR_ARGUMENT
+ */
+int dsp_ring_commitread(DSP_RING *ring, unsigned int count);
+
+/**
+ * Release the buffer of a queue, no thread may use it any more.
+ *
+ * @param	ring	queue initialized by dsp_ring_init(), or cleared with memset().
+ */
+void dsp_ring_free(DSP_RING *ring);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_DSP_RING_H_
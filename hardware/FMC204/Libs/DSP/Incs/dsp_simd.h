@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file dsp_simd.h
+///@author Pankil Butala (MCL, BU)
+///\brief dsp_simd module selects the vector instructions of the DSP inner loops (header)
+///
+/// The instruction set is chosen at compile time: AVX when the compiler targets it ( /arch:AVX
+/// or /arch:AVX2 with MSVC ), SSE on every x64 build, plain C otherwise. The loops on 16 bit
+/// samples use SSE2, and AVX2 when the compiler targets it. Defining DSP_NO_SIMD forces the
+/// plain C loops. Buffers read with aligned loads come from dsp_malloc().
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DSP_SIMD_H_
+#define _DSP_SIMD_H_
+
+#include <stdlib.h>
+#ifdef WIN32
+ #include <malloc.h>
+#endif
+
+/* defines */
+#if defined(DSP_NO_SIMD)
+ // plain C
+#elif defined(__AVX__)
+ #define DSP_SIMD_AVX										/*!< 8 floats per instruction */
+ #include <immintrin.h>
+#elif defined(_M_X64) || defined(__x86_64__) || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+ #define DSP_SIMD_SSE										/*!< 4 floats per instruction */
+ #include <xmmintrin.h>
+#endif
+
+#if !defined(DSP_NO_SIMD) && (defined(__AVX__) || defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP>=2))
+ #define DSP_SIMD_SSE2										/*!< 8 shorts per instruction */
+ #include <emmintrin.h>
+#endif
+#if defined(DSP_SIMD_AVX) && defined(__AVX2__)
+ #define DSP_SIMD_AVX2										/*!< 16 shorts per instruction, POPCNT */
+#endif
+
+#define DSP_SIMD_ALIGN			32							/*!< Alignment of the dsp_malloc() buffers, bytes */
+#define DSP_SIMD_FLOATS			8							/*!< Vector loops run on multiples of this many floats */
+#define DSP_SIMD_ROUNDUP(n)		(((n)+DSP_SIMD_FLOATS-1)&~(DSP_SIMD_FLOATS-1))	/*!< n rounded up to a multiple of DSP_SIMD_FLOATS */
+
+/**
+ * Allocate a buffer aligned on DSP_SIMD_ALIGN bytes.
+ *
+ * @param	size	size in bytes.
+ * @return  the buffer, released with dsp_free(), NULL when out of memory.
+ */
+static inline void *dsp_malloc(size_t size)
+{
+#ifdef WIN32
+	return _aligned_malloc(size ? size : 1, DSP_SIMD_ALIGN);
+#else
+	void *p = NULL;
+	if(posix_memalign(&p, DSP_SIMD_ALIGN, size ? size : 1)!=0)
+		return NULL;
+	return p;
+#endif
+}
+
+/**
+ * Release a buffer obtained from dsp_malloc(), NULL is ignored.
+ */
+static inline void dsp_free(void *p)
+{
+#ifdef WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+
+#endif //_DSP_SIMD_H_
@@ -60,6 +60,9 @@ int FMC204_init(unsigned long bar_cpld, unsigned long bar_clk, unsigned long bar
 
 	unsigned int clksrc_cpld;
 	unsigned int clksrc_clktree;
+	FMC204_CALIB calib;
+	const unsigned long *dllhint = NULL;
+	FMC204_DAC_REPORT report[FMC204_DAC_NB];
 	if(clockmode==FMC204_INTERNAL_CLK) {
 		clksrc_cpld = CLKSRC_INTERNAL_CLK_INTERNAL_REF;
 		clksrc_clktree = CLOCKTREE_CLKSRC_INTERNAL;
@@ -82,13 +85,31 @@ int FMC204_init(unsigned long bar_cpld, unsigned long bar_clk, unsigned long bar
 		printf("Could not initialize FMC204.CLOCKTREE\n");
 		return FMC204_ERR_CLOCKTREE_INIT;
 	}
+	if(clksrc_clktree==CLOCKTREE_CLKSRC_INTERNAL) {
+		unsigned long lockus;
+		FMC204_clocktree_getlocktime(&lockus);
+		printf("FMC204.CLOCKTREE PLL locked in %lu us\n", lockus);
+	}
 
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Configure DAC0 and DAC1
-	if(FMC204_dac_init(bar_dac0, bar_dac0_phy, bar_dac1, bar_dac1_phy)!=FMC204_DAC_ERR_OK) {
+	// Configure DAC0 and DAC1, the DLL tuning words of the previous run are tried first
+	if(FMC204_calib_load(clockmode, &calib)==FMC204_CALIB_ERR_OK) {
+		printf("Using FMC204 calibration snapshot\n");
+		dllhint = calib.dllword;
+	}
+	if(FMC204_dac_init(bar_dac0, bar_dac0_phy, bar_dac1, bar_dac1_phy, dllhint, report)!=FMC204_DAC_ERR_OK) {
 		printf("Could not initialize FMC204.DAC\n");
+		for(int d = 0; d < FMC204_DAC_NB; d++)
+			printf("DAC%d : %d tries, DLL %s, pattern %s, FIFO %s\n", d, report[d].tries, report[d].dlllocked ? "locked" : "not locked",
+				report[d].pattern ? "ok" : "failed", report[d].fifoerror ? "failed" : "ok");
 		return FMC204_ERR_DAC_INIT;
 	}
+	if(dllhint==NULL || report[0].dllword!=calib.dllword[0] || report[1].dllword!=calib.dllword[1]) {
+		calib.dllword[0] = report[0].dllword;
+		calib.dllword[1] = report[1].dllword;
+		if(FMC204_calib_save(clockmode, &calib)!=FMC204_CALIB_ERR_OK)
+			printf("Could not save FMC204 calibration snapshot\n");
+	}
 
 	// little pause after init
 	Sleep(100);
@@ -9,6 +9,7 @@
 ///////////////////////////////////////////////////////////////////////////////////
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "fmc204_freqcnt.h"
 #include "sipif.h"
 
@@ -53,42 +54,129 @@ static void DeleteFile(const char *filename)
 
 #endif
 
+/**
+ * Convert a counter value to MHz, the counter counts the measured clock during 8192 periods of the 125 MHz reference.
+ */
+static float FMC204_freqcnt_tofrequency(unsigned long dword)
+{
+	// compute the frequency
+	float testClkPeriod = 1.0f/125.0f;
+	float tmp = 8192 * testClkPeriod;
+	tmp = (tmp / (dword + 1));
+	return 1.00f/tmp;
+}
+
+/**
+ * Display one measured frequency to the console.
+ */
+static void FMC204_freqcnt_display(unsigned int clksel, float freq)
+{
+	switch (clksel)
+	{
+	case 0	: printf("Stellar IP Clock : %6.2f MHz\n", freq); break; 
+	case 1	: printf("DAC PHY Clock    : %6.2f MHz (Fs = %6.2f)\n", freq, 8*freq); break; 
+	case 2	: printf("DAC REF Clock    : %6.2f MHz (Fs = %6.2f)\n", freq, 2*freq); break; 
+	case 3	: printf("External Trigger : %6.2f MHz\n", freq); break; 
+	default	: printf("Frequency(%d)    : %6.2f MHz\n", clksel, freq); break; 
+	}
+}
+
 int FMC204_freqcnt_getfrequency(unsigned long bar, unsigned int clksel, float *freq, int outputconsole) 
 {
-	unsigned long dword;
+	float tmp;
 	int rc;
 
 	// tell the firmware to start a measure on a given clock index
-	rc = sipif_writesipreg(bar+0, clksel); Sleep(2);
+	rc = FMC204_freqcnt_select(bar, clksel); Sleep(FMC204_FREQCNT_MEASURE_MS);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
 
 	// read back the just measured value
-	rc = sipif_readsipreg(bar+1, &dword);
+	rc = FMC204_freqcnt_read(bar, &tmp);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
-
-	// compute the frequency
-	float testClkPeriod = 1.0f/125.0f;
-	float tmp = 8192 * testClkPeriod;
-	tmp = (tmp / (dword + 1));
-	tmp = 1.00f/tmp;
 	
 	// if we were asked to display to console then we do that
-	if(outputconsole) {
-		switch (clksel)
-		{
-		case 0	: printf("Stellar IP Clock : %6.2f MHz\n", tmp); break; 
-		case 1	: printf("DAC PHY Clock    : %6.2f MHz (Fs = %6.2f)\n", tmp, 8*tmp); break; 
-		case 2	: printf("DAC REF Clock    : %6.2f MHz (Fs = %6.2f)\n", tmp, 2*tmp); break; 
-		case 3	: printf("External Trigger : %6.2f MHz\n", tmp); break; 
-		default	: printf("Frequency(%d)    : %6.2f MHz\n", clksel, tmp); break; 
-		}
-	}
+	if(outputconsole)
+		FMC204_freqcnt_display(clksel, tmp);
 
 	// if the pointer passed as argument is not NULL we then update the memory pointed
 	if(freq!=NULL)
 		*freq = tmp;
 
 	return FMC204_FREQCNT_ERR_OK;
-}
\ No newline at end of file
+}
+
+int FMC204_freqcnt_select(unsigned long bar, unsigned int clksel)
+{
+	return sipif_writesipreg(bar+0, clksel);
+}
+
+int FMC204_freqcnt_read(unsigned long bar, float *freq)
+{
+	unsigned long dword;
+	int rc;
+
+	rc = sipif_readsipreg(bar+1, &dword);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
+
+	if(freq!=NULL)
+		*freq = FMC204_freqcnt_tofrequency(dword);
+
+	return FMC204_FREQCNT_ERR_OK;
+}
+
+int FMC204_freqcnt_sweep(unsigned long bar, unsigned int clkmask, FMC204_FREQCNT_SWEEP *sweep, int outputconsole)
+{
+	SIPIF_REGOP ops[2];
+	unsigned int pending = FMC204_FREQCNT_NB_CLOCKS;		// clock being measured, none yet
+	unsigned int n;
+	int rc;
+
+	// check if arguments are valid
+	if(sweep==NULL)
+		return FMC204_FREQCNT_ERR_NULL_ARGUMENT;
+	memset(sweep, 0, sizeof(*sweep));
+
+	// every round trip collects the pending measure and starts the next one, the last one only collects
+	for(unsigned int clksel = 0; clksel <= FMC204_FREQCNT_NB_CLOCKS; clksel++) {
+		if(clksel<FMC204_FREQCNT_NB_CLOCKS && !(clkmask&(1<<clksel)))
+			continue;
+
+		n = 0;
+		if(pending<FMC204_FREQCNT_NB_CLOCKS) {
+			ops[n].op = SIPIF_OP_READ;
+			ops[n].addr = bar+1;
+			ops[n].value = 0;
+			n++;
+		}
+		if(clksel<FMC204_FREQCNT_NB_CLOCKS) {
+			ops[n].op = SIPIF_OP_WRITE;
+			ops[n].addr = bar+0;
+			ops[n].value = clksel;
+			n++;
+		}
+		if(n==0)
+			break;
+		rc = sipif_transact(ops, n);
+		if(rc!=SIPIF_ERR_OK)
+			return rc;
+
+		// a clock that does not toggle leaves the counter at 0
+		if(pending<FMC204_FREQCNT_NB_CLOCKS && ops[0].value!=0) {
+			sweep->valid[pending] = 1;
+			sweep->frequency[pending] = FMC204_freqcnt_tofrequency(ops[0].value);
+			if(outputconsole)
+				FMC204_freqcnt_display(pending, sweep->frequency[pending]);
+		}
+		else if(pending<FMC204_FREQCNT_NB_CLOCKS && outputconsole)
+			printf("Frequency(%d)    : no clock\n", pending);
+
+		if(clksel<FMC204_FREQCNT_NB_CLOCKS)
+			Sleep(FMC204_FREQCNT_MEASURE_MS);
+		pending = clksel;
+	}
+
+	return FMC204_FREQCNT_ERR_OK;
+}
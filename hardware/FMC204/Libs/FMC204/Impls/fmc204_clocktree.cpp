@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include "fmc204_clocktree.h"
 #include "sipif.h"
+#include "regtable.h"
 
 #if defined WIN32
 
@@ -52,6 +53,109 @@ static void DeleteFile(const char *filename)
 
 #endif
 
+static unsigned long g_lockus = 0;			/*!< time it took for the PLL to lock during the last FMC204_clocktree_init() */
+
+/**
+ * Internal clock, the on board VCO is locked to the on board reference
+ */
+static const REGTABLE_ENTRY g_clocktree_internal[] = {
+	REG_WR(0x010, 0x7C),		//CP 4.8mA, normal op.
+	REG_WR(0x011, 10),			//R lo
+	REG_WR(0x012, 0),			//R hi
+	REG_WR(0x013, 4),			//A
+	REG_WR(0x014, 12),			//B lo
+	REG_WR(0x015, 0),			//B hi
+	REG_WR(0x016, 0x04),		//presc. DM8
+	REG_WR(0x017, 0xB4),		//STATUS = DLD
+
+	REG_WR(0x019, 0x00),
+	REG_WR(0x01A, 0x00),		//LD = DLD
+	REG_WR(0x01B, 0x00),		//REFMON = GND
+	REG_WR(0x01C, 0x87),		//Diff ref input
+	REG_WR(0x01D, 0x00),
+
+	REG_WR(0x0F0, 0x0C),		//out0, adc1, lvpecl 960mW
+	REG_WR(0x0F1, 0x0C),		//out1, adc0, lvpecl 960mW
+
+	REG_WR(0x0F4, 0x0C),		//out2, dac1, lvpecl 960mW
+	REG_WR(0x0F5, 0x0C),		//out3, dac0, lvpecl 960mW
+
+	REG_WR(0x140, 0x01),		//out4, sync, pd
+	REG_WR(0x141, 0x01),		//out5, pd
+	REG_WR(0x142, 0x00),		//out6, lvds 1.75mA
+	REG_WR(0x143, 0x01),		//out7, pd
+
+	REG_WR(0x190, 0x00),		//div0, adc, /2
+	REG_WR(0x191, 0x80),		//div0, adc, divider bypassed
+	REG_WR(0x192, 0x00),		//div0, adc, divider to output
+
+	REG_WR(0x196, 0x00),		//div1, dac, /2
+	REG_WR(0x197, 0x80),		//div1, dac, divider bypassed
+	REG_WR(0x198, 0x00),		//div1, dac, divider to output
+
+	REG_WR(0x199, 0x00),		//div2.1, /2
+	REG_WR(0x19A, 0x00),		//phase
+	REG_WR(0x19B, 0x00),		//div2.2, /2
+	REG_WR(0x19C, 0x20),		//div2.1 on, div2.2 bypass
+	REG_WR(0x19D, 0x00),		//div2 dcc on
+
+	REG_WR(0x19E, 0x00),		//div3.1, /2
+	REG_WR(0x19F, 0x00),		//phase
+	REG_WR(0x1A0, 0x00),		//div3.2, /2
+	REG_WR(0x1A1, 0x20),		//div3.1 on, div3.2 bypass
+	REG_WR(0x1A2, 0x00),		//div3 dcc on
+
+	REG_WR(0x1E0, 0x00),		//vco div /2
+	REG_WR(0x1E1, 0x01),		//bypass vco divider
+
+	REG_WR(0x230, 0x00),		//no pwd, no sync
+	REG_WR(0x232, 0x01),		//update
+};
+
+/**
+ * External clock, the clock goes straight to the dividers
+ */
+static const REGTABLE_ENTRY g_clocktree_external[] = {
+	REG_WR(0x0F0, 0x0C),		//out0, adc0, lvpecl 960mW
+	REG_WR(0x0F1, 0x0C),		//out1, adc1, lvpecl 960mW
+
+	REG_WR(0x0F4, 0x0C),		//out0, dac0, lvpecl 960mW
+	REG_WR(0x0F5, 0x0C),		//out1, dac1, lvpecl 960mW
+
+	REG_WR(0x140, 0x01),		//out4, pd
+	REG_WR(0x141, 0x01),		//out5, pd
+	REG_WR(0x142, 0x00),		//out6, lvds 1.75mA
+	REG_WR(0x143, 0x01),		//out7, pd
+
+	REG_WR(0x190, 0x00),		//div0, adc, /2
+	REG_WR(0x191, 0x00),		//div0, adc
+	REG_WR(0x192, 0x02),		//div0, adc, direct to output
+
+	REG_WR(0x196, 0x00),		//div1, dac, /2
+	REG_WR(0x197, 0x00),		//div1, dac
+	REG_WR(0x198, 0x02),		//div1, dac, direct to output
+
+	REG_WR(0x199, 0x00),		//div2.1
+	REG_WR(0x19A, 0x00),		//phase div2
+	REG_WR(0x19B, 0x00),		//div2.2
+	REG_WR(0x19C, 0x30),		//div2 bypass
+	REG_WR(0x19D, 0x00),		//div2 dcc on
+
+	REG_WR(0x19E, 0x00),		//div3.1
+	REG_WR(0x19F, 0x00),		//phase div3
+	REG_WR(0x1A0, 0x00),		//div3.2
+	REG_WR(0x1A1, 0x30),		//div3 bypass
+	REG_WR(0x1A2, 0x00),		//div3 dcc on
+
+	REG_WR(0x1E0, 0x00),		//vco dic /2
+	REG_WR(0x1E1, 0x00),		//ena vco divider
+	REG_WR(0x230, 0x00),
+
+	REG_WR(0x232, 0x01),		//update
+	REG_DELAY(10),
+};
+
+
 int FMC204_clocktree_init(unsigned long bar, unsigned int clocksource)
 {
 	unsigned long dword;
@@ -65,253 +169,31 @@ int FMC204_clocktree_init(unsigned long bar, unsigned int clocksource)
 		dword!=FMC204_CLOCKTREE_PART_ID_4)
 		return FMC204_CLOCKTREE_ERR_WRONG_PART_ID;
 
+	g_lockus = 0;
 	if(clocksource==CLOCKTREE_CLKSRC_INTERNAL) {
-		rc = sipif_writesipreg(bar+0x010, 0x7C); Sleep(1); //CP 4.8mA, normal op.
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x011,   10); Sleep(1); //R lo
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x012,    0); Sleep(1); //R hi
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x013,    4); Sleep(1); //A
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x014,   12); Sleep(1); //B lo
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x015,    0); Sleep(1); //B hi
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x016, 0x04); Sleep(1); //presc. DM8
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x017, 0xB4); Sleep(1); //STATUS = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x019, 0x00); Sleep(1);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01A, 0x00); Sleep(1); //LD = DLD
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01B, 0x00); Sleep(1); //REFMON = GND
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01C, 0x87); Sleep(1); //Diff ref input
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x01D, 0x00); Sleep(1);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F0, 0x0C); Sleep(1); //out0, adc1, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F1, 0x0C); Sleep(1); //out1, adc0, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F4, 0x0C); Sleep(1); //out2, dac1, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F5, 0x0C); Sleep(1); //out3, dac0, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x140, 0x01); Sleep(1); //out4, sync, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x141, 0x01); Sleep(1); //out5, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x142, 0x00); Sleep(1); //out6, lvds 1.75mA
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x143, 0x01); Sleep(1); //out7, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x190, 0x00); Sleep(1); //div0, adc, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x191, 0x80); Sleep(1); //div0, adc, divider bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x192, 0x00); Sleep(1); //div0, adc, divider to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x196, 0x00); Sleep(1); //div1, dac, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x197, 0x80); Sleep(1); //div1, dac, divider bypassed
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x198, 0x00); Sleep(1); //div1, dac, divider to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x199, 0x00); Sleep(1); //div2.1, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19A, 0x00); Sleep(1); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19B, 0x00); Sleep(1); //div2.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19C, 0x20); Sleep(1); //div2.1 on, div2.2 bypass
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19D, 0x00); Sleep(1); //div2 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x19E, 0x00); Sleep(1); //div3.1, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19F, 0x00); Sleep(1); //phase
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A0, 0x00); Sleep(1); //div3.2, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A1, 0x20); Sleep(1); //div3.1 on, div3.2 bypass
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A2, 0x00); Sleep(1); //div3 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x1E0, 0x00); Sleep(1); //vco div /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1E1, 0x01); Sleep(1); //bypass vco divider
-		if(rc!=SIPIF_ERR_OK)
+		rc = regtable_run(bar, g_clocktree_internal, REGTABLE_SIZE(g_clocktree_internal));
+		if(rc!=REGTABLE_ERR_OK)
 			return rc;
 
-		rc = sipif_writesipreg(bar+0x230, 0x00); Sleep(1); //no pwd, no sync
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x232, 0x01); Sleep(1); //update
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		Sleep(10);
-
-		// verify CLK0 PLL status
-		rc = sipif_readsipreg(bar+0x1F, &dword);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		if((dword&0x01)!=0x01)
+		// wait for CLK0 PLL digital lock detect
+		rc = regtable_wait(bar+0x1F, 0x01, 0x01, FMC204_CLOCKTREE_LOCK_TIMEOUT_MS, &g_lockus);
+		if(rc==REGTABLE_ERR_WAIT_TIMEOUT)
 			return FMC204_CLOCKTREE_ERR_CLK0_PLL_NOT_LOCKED;
-
+		if(rc!=REGTABLE_ERR_OK)
+			return rc;
 	}
 	else {
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////
-		// External clock
-
-#if 0
-		rc = sipif_writesipreg(0x13402, 0x01); //Enable 1GHz generation on ML605
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-#endif;
-
-		rc = sipif_writesipreg(bar+0x0F0, 0x0C); Sleep(1); //out0, adc0, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F1, 0x0C); Sleep(1); //out1, adc1, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x0F4, 0x0C); Sleep(1); //out0, dac0, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x0F5, 0x0C); Sleep(1); //out1, dac1, lvpecl 960mW
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x140, 0x01); Sleep(1); //out4, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x141, 0x01); Sleep(1); //out5, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x142, 0x00); Sleep(1); //out6, lvds 1.75mA
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x143, 0x01); Sleep(1); //out7, pd
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x190, 0x00); Sleep(1); //div0, adc, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x191, 0x00); Sleep(1); //div0, adc
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x192, 0x02); Sleep(1); //div0, adc, direct to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x196, 0x00); Sleep(1); //div1, dac, /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x197, 0x00); Sleep(1); //div1, dac
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x198, 0x02); Sleep(1); //div1, dac, direct to output
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x199, 0x00); Sleep(1); //div2.1
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19A, 0x00); Sleep(1); //phase div2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19B, 0x00); Sleep(1); //div2.2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19C, 0x30); Sleep(1); //div2 bypass
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19D, 0x00); Sleep(1); //div2 dcc on
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-
-		rc = sipif_writesipreg(bar+0x19E, 0x00); Sleep(1); //div3.1
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x19F, 0x00); Sleep(1); //phase div3
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A0, 0x00); Sleep(1); //div3.2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A1, 0x30); Sleep(1); //div3 bypass
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1A2, 0x00); Sleep(1); //div3 dcc on
-		if(rc!=SIPIF_ERR_OK)
+		rc = regtable_run(bar, g_clocktree_external, REGTABLE_SIZE(g_clocktree_external));
+		if(rc!=REGTABLE_ERR_OK)
 			return rc;
+	}
+	return FMC204_CLOCKTREE_ERR_OK;
+}
 
-		rc = sipif_writesipreg(bar+0x1E0, 0x00); Sleep(1); //vco dic /2
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x1E1, 0x00); Sleep(1); //ena vco divider
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar+0x230, 0x00); Sleep(1);
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
+int FMC204_clocktree_getlocktime(unsigned long *lockus)
+{
+	if(lockus)
+		*lockus = g_lockus;
 
-		rc = sipif_writesipreg(bar+0x232, 0x01); Sleep(10); //update
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-	}
 	return FMC204_CLOCKTREE_ERR_OK;
 }
@@ -9,8 +9,10 @@
 ///////////////////////////////////////////////////////////////////////////////////
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "fmc204_dac.h"
 #include "sipif.h"
+#include "regtable.h"
 
 #if defined WIN32
 
@@ -53,224 +55,252 @@ static void DeleteFile(const char *filename)
 
 #endif
 
-int FMC204_dac_init(unsigned long bar_dac0, unsigned long bar_dac0_phy, unsigned long bar_dac1, unsigned long bar_dac1_phy)
+/**
+ * Reset DCM in the FPGA. This is required after the DAC reference clock from the
+ * clock tree has become stable ( offsets relative to DAC0PHY )
+ */
+static const REGTABLE_ENTRY g_dac_dcm_reset[] = {
+	REG_WR(0x01, 0x02),			//force DCM reset
+	REG_WR(0x01, 0x00),			//release DCM reset
+	REG_DELAY(10),				//wait for dcm lock
+};
+
+/**
+ * DAC0 setup
+ */
+static const REGTABLE_ENTRY g_dac0_setup[] = {
+	REG_WR(0x01, 0x11),			// FIR on, FIFO offset 1
+	REG_WR(0x02, 0xC0),			// twos compl, dual DAC
+	REG_WR(0x03, 0x08),			// no masks, swap A and B
+	REG_WR(0x04, 0x00),			// clear errors
+	REG_WR(0x05, 0x42),			// DLL enable, PLL bypass
+	REG_WR(0x06, 0x0E),			// 472kHz, DLL awake, PLL sleep
+	REG_WR(0x07, 0xFF),			// DAC gain
+	REG_WR(0x08, 0x00),			// no DLL restart
+	REG_WR(0x09, 0x00),			// M=0, N=0
+	REG_WR(0x0A, 0x00),			// DLL tuning for 500MHz DDR
+	REG_WR(0x0B, 0x00),			// no PLL tuning
+	REG_WR(0x0C, 0x00),			// no manual offset DACA
+	REG_WR(0x0D, 0x00),			// no manual offset DACA
+	REG_WR(0x0E, 0x00),			// normal SDO function, no manual offset DACB
+	REG_WR(0x0F, 0x00),			// no manual offset DACB
+};
+
+/**
+ * DAC1 setup
+ */
+static const REGTABLE_ENTRY g_dac1_setup[] = {
+	REG_WR(0x01, 0x51),			// FIR on, FIFO offset 1, delay 1 sample
+	REG_WR(0x02, 0xC0),			// twos compl, dual DAC
+	REG_WR(0x03, 0x00),			// no masks, no swap
+	REG_WR(0x04, 0x00),			// clear errors
+	REG_WR(0x05, 0x42),			// DLL enable, PLL bypass
+	REG_WR(0x06, 0x0E),			// 472kHz, DLL awake, PLL sleep
+	REG_WR(0x07, 0xFF),			// DAC gain
+	REG_WR(0x08, 0x00),			// no DLL restart
+	REG_WR(0x09, 0x00),			// M=0, N=0
+	REG_WR(0x0A, 0x00),			// DLL tuning for 500MHz DDR
+	REG_WR(0x0B, 0x00),			// no PLL tuning
+	REG_WR(0x0C, 0x00),			// no manual offset DACA
+	REG_WR(0x0D, 0x00),			// no manual offset DACA
+	REG_WR(0x0E, 0x00),			// normal SDO function, no manual offset DACB
+	REG_WR(0x0F, 0x00),			// no manual offset DACB
+};
+
+/**
+ * Build the order in which DLL tuning words are tried: the hint, then the words FMC204_DAC_DLL_FIRST to
+ * FMC204_DAC_DLL_LAST in order, as the original search. The range is searched in full after the hint, the hint word
+ * included, so that a failing hint leaves the search of a run without hint.
+ *
+ * @param   hint     DLL tuning word tried first, FMC204_DAC_DLL_NONE if none.
+ * @param   words     array receiving the tuning words, FMC204_DAC_DLL_LAST-FMC204_DAC_DLL_FIRST+2 entries at most.
+ * @return  number of words in the array.
+ */
+static unsigned int FMC204_dac_dllorder(unsigned long hint, unsigned long *words)
 {
-	unsigned long dword;
-	unsigned long dll0[2] = {0x00,0x01}; //tuning words for DAC0 DLL
-	unsigned long dll1[2] = {0x00,0x01}; //tuning words for DAC1 DLL
-	int dac0_pattern = 0;
-	int dac1_pattern = 0;
+	unsigned int n = 0;
+
+	if(hint!=FMC204_DAC_DLL_NONE)
+		words[n++] = hint;
+
+	for(unsigned long w = FMC204_DAC_DLL_FIRST; w <= FMC204_DAC_DLL_LAST; w++)
+		words[n++] = w;
+
+	return n;
+}
+
+/**
+ * Tune the DLL of several DAC chips at once and run the pattern check on all of them. Only the DACs with active[]
+ * set are touched.
+ *
+ * @param   bar_dac     offsets where FMC204.DACxSPI are located in the constellation memory space.
+ * @param   bar_dac_phy     offset where FMC204.DAC0PHY is located in the constellation memory space.
+ * @param   word     DLL tuning word of every DAC.
+ * @param   active     1 for the DACs to tune.
+ * @param   report     per DAC report, dlllocked and flags are updated for the active DACs.
+ * @return  - FMC204_DAC_ERR_OK
+ *			- Any sipif error codes.
+ */
+static int FMC204_dac_trydll(const unsigned long *bar_dac, unsigned long bar_dac_phy, const unsigned long *word, const int *active, 
+							 FMC204_DAC_REPORT *report)
+{
+	SIPIF_REGOP ops[1+3*FMC204_DAC_NB];
+	unsigned int n = 0;
+	int checked = 0;
 	int rc;
 
-	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Reset DCM in the FPGA. This is required after the DAC reference clock from the
-	// clock tree has become stable
-	rc = sipif_writesipreg(bar_dac0_phy+1, 0x02); //force DCM reset
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0_phy+1, 0x00); //release DCM reset
+	// restart every DLL with its tuning word in one go, they lock in parallel
+	ops[n].op = SIPIF_OP_WRITE; ops[n].addr = bar_dac_phy+1; ops[n].value = 0x01; n++;	//enable test pattern
+	for(int d = 0; d < FMC204_DAC_NB; d++) {
+		if(!active[d])
+			continue;
+		ops[n].op = SIPIF_OP_WRITE; ops[n].addr = bar_dac[d]+0x0A; ops[n].value = word[d]; n++;	// DLL tuning for 500MHz DDR
+		ops[n].op = SIPIF_OP_WRITE; ops[n].addr = bar_dac[d]+0x08; ops[n].value = 0x04; n++;	// set DLL restart flag
+		ops[n].op = SIPIF_OP_WRITE; ops[n].addr = bar_dac[d]+0x08; ops[n].value = 0x00; n++;	// clear DLL restart flag
+	}
+	rc = sipif_transact(ops, n);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
-	Sleep(10); //wait for dcm lock
 
-	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Setup DAC0
-	rc = sipif_readsipreg(bar_dac0+0, &dword); //check Device ID
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	dword = (dword&0x1C)>>2;
-	if(dword != FMC204_DAC_PART_ID)
-		return FMC204_DAC_ERR_WRONG_PART_ID;
+	for(int d = 0; d < FMC204_DAC_NB; d++) {
+		if(!active[d])
+			continue;
+		rc = regtable_wait(bar_dac[d]+0, FMC204_DAC_DLL_LOCKED, FMC204_DAC_DLL_LOCKED, 10, NULL); //wait for DLL lock
+		if(rc!=REGTABLE_ERR_OK && rc!=REGTABLE_ERR_WAIT_TIMEOUT)
+			return rc;
+		report[d].dlllocked = (rc==REGTABLE_ERR_OK);
+		report[d].flags = 0;
+		checked |= report[d].dlllocked;
+	}
+	if(!checked)
+		return FMC204_DAC_ERR_OK;
 
-	rc = sipif_writesipreg(bar_dac0+0x01, 0x11); Sleep(2); // FIR on, FIFO offset 1
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x02, 0xC0); Sleep(2); // twos compl, dual DAC
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x03, 0x08); Sleep(2); // no masks, swap A and B
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x04, 0x00); Sleep(2); // clear errors
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x05, 0x42); Sleep(2); // DLL enable, PLL bypass
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x06, 0x0E); Sleep(2); // 472kHz, DLL awake, PLL sleep
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x07, 0xFF); Sleep(2); // DAC gain
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x08, 0x00); Sleep(2); // no DLL restart
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x09, 0x00); Sleep(2); // M=0, N=0
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x0A, dll0[0]); Sleep(2); // DLL tuning for 500MHz DDR
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x0B, 0x00); Sleep(2); // no PLL tuning
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x0C, 0x00); Sleep(2); // no manual offset DACA
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x0D, 0x00); Sleep(2); // no manual offset DACA
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x0E, 0x00); Sleep(2); // normal SDO function, no manual offset DACB
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac0+0x0F, 0x00); Sleep(2); // no manual offset DACB
+	// one checking time for all the DACs
+	n = 0;
+	for(int d = 0; d < FMC204_DAC_NB; d++) {
+		if(!active[d] || !report[d].dlllocked)
+			continue;
+		ops[n].op = SIPIF_OP_WRITE; ops[n].addr = bar_dac[d]+0x04; ops[n].value = 0x00; n++;	//clear error flags
+	}
+	ops[n].op = SIPIF_OP_WRITE; ops[n].addr = bar_dac_phy+1; ops[n].value = 0x01|0x04; n++;	//enable test pattern, drive TXENABLE high
+	rc = sipif_transact(ops, n);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
+	Sleep(100); //checking time
 
-	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Setup DAC1
-	rc = sipif_readsipreg(bar_dac1+0, &dword); //check Device ID
+	n = 0;
+	for(int d = 0; d < FMC204_DAC_NB; d++) {
+		if(!active[d] || !report[d].dlllocked)
+			continue;
+		ops[n].op = SIPIF_OP_READ; ops[n].addr = bar_dac[d]+0x04; ops[n].value = 0; n++;	//read error flags
+	}
+	rc = sipif_transact(ops, n);
 	if(rc!=SIPIF_ERR_OK)
 		return rc;
-	dword = (dword&0x1C)>>2;
-	if(dword != FMC204_DAC_PART_ID)
-		return FMC204_DAC_ERR_WRONG_PART_ID;
+	n = 0;
+	for(int d = 0; d < FMC204_DAC_NB; d++) {
+		if(active[d] && report[d].dlllocked)
+			report[d].flags = ops[n++].value;
+	}
 
-	rc = sipif_writesipreg(bar_dac1+0x01, 0x51); Sleep(2); // FIR on, FIFO offset 1, delay 1 sample
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x02, 0xC0); Sleep(2); // twos compl, dual DAC
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x03, 0x00); Sleep(2); // no masks, no swap
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x04, 0x00); Sleep(2); // clear errors
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x05, 0x42); Sleep(2); // DLL enable, PLL bypass
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x06, 0x0E); Sleep(2); // 472kHz, DLL awake, PLL sleep
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x07, 0xFF); Sleep(2); // DAC gain
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x08, 0x00); Sleep(2); // no DLL restart
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x09, 0x00); Sleep(2); // M=0, N=0
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x0A, dll1[0]); Sleep(2); // DLL tuning for 500MHz DDR
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x0B, 0x00); Sleep(2); // no PLL tuning
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x0C, 0x00); Sleep(2); // no manual offset DACA
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x0D, 0x00); Sleep(2); // no manual offset DACA
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x0E, 0x00); Sleep(2); // normal SDO function, no manual offset DACB
-	if(rc!=SIPIF_ERR_OK)
-		return rc;
-	rc = sipif_writesipreg(bar_dac1+0x0F, 0x00); Sleep(2); // no manual offset DACB
-	if(rc!=SIPIF_ERR_OK)
+	return FMC204_DAC_ERR_OK;
+}
+
+int FMC204_dac_init(unsigned long bar_dac0, unsigned long bar_dac0_phy, unsigned long bar_dac1, unsigned long bar_dac1_phy,
+					const unsigned long *dllhint, FMC204_DAC_REPORT *report)
+{
+	const unsigned long bar_dac[FMC204_DAC_NB] = { bar_dac0, bar_dac1 };
+	const REGTABLE_ENTRY *setup[FMC204_DAC_NB] = { g_dac0_setup, g_dac1_setup };
+	const unsigned int setupsize[FMC204_DAC_NB] = { REGTABLE_SIZE(g_dac0_setup), REGTABLE_SIZE(g_dac1_setup) };
+	unsigned long words[FMC204_DAC_NB][FMC204_DAC_DLL_LAST-FMC204_DAC_DLL_FIRST+2];
+	unsigned int nbwords[FMC204_DAC_NB];
+	unsigned long word[FMC204_DAC_NB];
+	unsigned long hint[FMC204_DAC_NB];
+	FMC204_DAC_REPORT local[FMC204_DAC_NB];
+	int active[FMC204_DAC_NB];
+	int searching;
+	unsigned long dword;
+	int rc;
+
+	if(report==NULL)
+		report = local;
+	memset(report, 0, FMC204_DAC_NB*sizeof(FMC204_DAC_REPORT));
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Reset DCM in the FPGA
+	rc = regtable_run(bar_dac0_phy, g_dac_dcm_reset, REGTABLE_SIZE(g_dac_dcm_reset));
+	if(rc!=REGTABLE_ERR_OK)
 		return rc;
 
-	////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Check DAC0: is DLL locked? Is internal FIFO OK? Is Pattern checking OK?
-	// Loop until DAC0 Pattern check is OK
-	for (int i = 0; i < 2; i++)
-	{
-		rc = sipif_writesipreg(bar_dac0_phy+1, 0x01); Sleep(2); //enable test pattern
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac0+0x0A, dll0[i]); Sleep(2); // DLL tuning for 500MHz DDR
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac0+0x08, 0x04); Sleep(2); // set DLL restart flag
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac0+0x08, 0x00); Sleep(2); // clear DLL restart flag
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		Sleep(10); //wait for DLL lock
-		rc = sipif_readsipreg(bar_dac0+0, &dword); //check for DLL lock
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		if((dword&FMC204_DAC_DLL_LOCKED)!=FMC204_DAC_DLL_LOCKED)
-			return FMC204_DAC_ERR_DLL_NOT_LOCKED;
-		rc = sipif_writesipreg(bar_dac0+0x04, 0x00); Sleep(2); //clear error flags
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac0_phy+1, 0x01|0x04); Sleep(2); //enable test pattern, drive TXENABLE high
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Setup DAC0 and DAC1
+	for(int d = 0; d < FMC204_DAC_NB; d++) {
+		rc = sipif_readsipreg(bar_dac[d]+0, &dword); //check Device ID
 		if(rc!=SIPIF_ERR_OK)
 			return rc;
-		Sleep(100); //checking time
-		rc = sipif_readsipreg(bar_dac0+0x04, &dword); //read error flags
-		if(rc!=SIPIF_ERR_OK)
+		dword = (dword&0x1C)>>2;
+		if(dword != FMC204_DAC_PART_ID)
+			return FMC204_DAC_ERR_WRONG_PART_ID;
+
+		rc = regtable_run(bar_dac[d], setup[d], setupsize[d]);
+		if(rc!=REGTABLE_ERR_OK)
 			return rc;
-		if((dword&FMC204_DAC_FIFO_ERROR)==FMC204_DAC_FIFO_ERROR)
-			return FMC204_DAC_ERR_CHAN0_FIFO;
-		if((dword&FMC204_DAC_PATTERN_ERROR)!=FMC204_DAC_PATTERN_ERROR) {
-			printf("DLL0 Tuning : 0x%02X\n", dll0[i]);
-			dac0_pattern = 1;
-			break;
-		}
-	}
-	if (dac0_pattern == 0)
-		return FMC204_DAC_ERR_CHAN0_PATTERN;
 
+		report[d].dllword = FMC204_DAC_DLL_NONE;
+		hint[d] = dllhint ? dllhint[d] : FMC204_DAC_DLL_NONE;
+		nbwords[d] = FMC204_dac_dllorder(hint[d], words[d]);
+	}
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Check DAC1: is DLL locked? Is internal FIFO OK? Is Pattern checking OK?
-	// Loop until DAC1 Pattern check is OK
-	for (int i = 0; i < 2; i++)
-	{
-		rc = sipif_writesipreg(bar_dac0_phy+1, 0x01); Sleep(2); //enable test pattern
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac1+0x0A, dll1[i]); Sleep(2); // DLL tuning for 500MHz DDR
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac1+0x08, 0x04); Sleep(2); // set DLL restart flag
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac1+0x08, 0x00); Sleep(2); // clear DLL restart flag
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		Sleep(10); //wait for DLL lock
-		rc = sipif_readsipreg(bar_dac1+0, &dword); //check for DLL lock
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		if((dword&FMC204_DAC_DLL_LOCKED)!=FMC204_DAC_DLL_LOCKED)
-			return FMC204_DAC_ERR_DLL_NOT_LOCKED;
-		rc = sipif_writesipreg(bar_dac1+0x04, 0x00); Sleep(2); //clear error flags
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		rc = sipif_writesipreg(bar_dac0_phy+1, 0x01|0x04); Sleep(2); //enable test pattern, drive TXENABLE high
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		Sleep(100); //checking time
-		rc = sipif_readsipreg(bar_dac1+0x04, &dword); //read error flags
-		if(rc!=SIPIF_ERR_OK)
-			return rc;
-		if((dword&FMC204_DAC_FIFO_ERROR)==FMC204_DAC_FIFO_ERROR)
-			return FMC204_DAC_ERR_CHAN1_FIFO;
-		if((dword&FMC204_DAC_PATTERN_ERROR)!=FMC204_DAC_PATTERN_ERROR) {
-			printf("DLL1 Tuning : 0x%02X\n", dll1[i]);
-			dac1_pattern = 1;
+	// Check DAC0 and DAC1 together: is DLL locked? Is internal FIFO OK? Is Pattern checking OK?
+	// Every round tries the next tuning word of each DAC still searching, the previous tuning word goes first
+	do {
+		searching = 0;
+		for(int d = 0; d < FMC204_DAC_NB; d++) {
+			active[d] = report[d].dllword==FMC204_DAC_DLL_NONE && !report[d].fifoerror && report[d].tries<nbwords[d];
+			if(active[d])
+				word[d] = words[d][report[d].tries++];
+			searching |= active[d];
+		}
+		if(!searching)
 			break;
+
+		rc = FMC204_dac_trydll(bar_dac, bar_dac0_phy, word, active, report);
+		if(rc!=FMC204_DAC_ERR_OK)
+			return rc;
+
+		for(int d = 0; d < FMC204_DAC_NB; d++) {
+			if(!active[d])
+				continue;
+			// the hint may come from another board, it failing only sends the DAC to the normal search
+			if(hint[d]!=FMC204_DAC_DLL_NONE && report[d].tries==1 &&
+				(!report[d].dlllocked || (report[d].flags&FMC204_DAC_FIFO_ERROR)==FMC204_DAC_FIFO_ERROR)) {
+				printf("DLL%d Tuning : hint 0x%02lX rejected, searching\n", d, word[d]);
+				report[d].dlllocked = 0;
+				report[d].flags = 0;
+				continue;
+			}
+			if(!report[d].dlllocked)
+				continue;
+			if((report[d].flags&FMC204_DAC_FIFO_ERROR)==FMC204_DAC_FIFO_ERROR)
+				report[d].fifoerror = 1;
+			else if((report[d].flags&FMC204_DAC_PATTERN_ERROR)!=FMC204_DAC_PATTERN_ERROR) {
+				report[d].dllword = word[d];
+				report[d].pattern = 1;
+				printf("DLL%d Tuning : 0x%02lX\n", d, word[d]);
+			}
 		}
-	}
+	} while(searching);
 
-	if (dac1_pattern == 0)
+	if(report[0].fifoerror)
+		return FMC204_DAC_ERR_CHAN0_FIFO;
+	if(report[1].fifoerror)
+		return FMC204_DAC_ERR_CHAN1_FIFO;
+	if(!report[0].dlllocked || !report[1].dlllocked)
+		return FMC204_DAC_ERR_DLL_NOT_LOCKED;
+	if(!report[0].pattern)
+		return FMC204_DAC_ERR_CHAN0_PATTERN;
+	if(!report[1].pattern)
 		return FMC204_DAC_ERR_CHAN1_PATTERN;
 
 
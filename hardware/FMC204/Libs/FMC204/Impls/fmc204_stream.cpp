@@ -0,0 +1,272 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc204_stream.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief FMC204_stream module to feed the FMC204 waveform memory continuously (implementation)
+///
+/// This module keeps a bounded queue of waveform frames pushed by the client and
+/// feeds them to the waveform memory of one DAC channel at a fixed frame period.
+/// A feeder thread uploads the next frame and re-arms the DAC at every period
+/// boundary. The client is only allowed to push as many frames as it has credits
+/// (free queue slots); frame periods without a queued frame are counted as
+/// underruns and frames armed after the end of their period as late frames.
+/// The frames go through a dsp_ring of 16 bit samples, written by the server
+/// thread and read by the feeder thread without a lock. A frame contiguous in
+/// the ring is uploaded in place, a frame wrapping around its end is copied.
+/// A failed upload stops the feeder thread and the stream, FMC204_stream_stop()
+/// still has to be called to release it.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include <windows.h>
+#include "fmc204_stream.h"
+#include "fmc204_ctrl.h"
+#include "sipif.h"
+#include "dsp_ring.h"
+
+/**
+ * State shared between the server thread ( push, status ) and the feeder thread.
+ * Everything below cs is protected by cs.
+ */
+typedef struct {
+	unsigned long bar;					/*!< offset where FMC204.CTRL is located */
+	unsigned int dacchannel;			/*!< DAC receiving the frames */
+	unsigned int framesize;				/*!< size of one frame in bytes */
+	unsigned int framelen;				/*!< samples of one frame, framesize/2 */
+	unsigned int depth;					/*!< number of frames in the queue */
+	unsigned int periodms;				/*!< frame period in milliseconds */
+	DSP_RING ring;						/*!< queued frames, written by the server thread, read by the feeder thread */
+	unsigned char *stage;				/*!< framesize bytes, copy of a frame wrapping around the end of the ring */
+	HANDLE hthread;						/*!< feeder thread, NULL once released by FMC204_stream_stop() */
+	HANDLE hstop;						/*!< manual reset event signaled by FMC204_stream_stop() */
+	CRITICAL_SECTION cs;
+	int active;							/*!< 1 between FMC204_stream_start() and FMC204_stream_stop() or a failed upload */
+	FMC204_STREAM_STATUS status;		/*!< counters reported to the client */
+} fmc204_stream;
+
+static fmc204_stream g_stream;			/*!< The one and only stream, the FMC204 server feeds a single channel at a time */
+static int g_streamcsinit = 0;			/*!< 1 once g_stream.cs is initialized */
+
+
+/**
+ * Obtain the number of queued frames, a frame being uploaded in place included. Exact for the feeder thread, an upper
+ * bound for the server thread.
+ */
+static unsigned int FMC204_stream_queued(void)
+{
+	return (dsp_ring_count(&g_stream.ring)+g_stream.framelen-1)/g_stream.framelen;
+}
+
+static DWORD WINAPI FMC204_stream_feeder(LPVOID arg)
+{
+	LARGE_INTEGER freq, now;
+	LONGLONG period, next;
+	const void *span;
+	unsigned char *frame;
+	unsigned int count;
+	// the FMC204_ctrl functions called here return sipif codes only, FMC204_CTRL_ERR_OK being SIPIF_ERR_OK
+	int rc = SIPIF_ERR_OK;
+
+	QueryPerformanceFrequency(&freq);
+	period = freq.QuadPart*g_stream.periodms/1000;
+
+	// the first frame period starts as soon as the thread runs
+	QueryPerformanceCounter(&now);
+	next = now.QuadPart;
+
+	for(;;) {
+		// wait for the beginning of the next frame period, the last millisecond is spent spinning
+		QueryPerformanceCounter(&now);
+		if(now.QuadPart<next) {
+			DWORD waitms = (DWORD)((next-now.QuadPart)*1000/freq.QuadPart);
+			if(WaitForSingleObject(g_stream.hstop, waitms)==WAIT_OBJECT_0)
+				break;
+			continue;
+		}
+		if(WaitForSingleObject(g_stream.hstop, 0)==WAIT_OBJECT_0)
+			break;
+
+		// a frame uploaded in place stays in the ring until it is armed so FMC204_stream_push() cannot overwrite it
+		frame = NULL;
+		count = 0;
+		if(dsp_ring_count(&g_stream.ring)<g_stream.framelen) {
+			EnterCriticalSection(&g_stream.cs);
+			g_stream.status.underruns++;
+			LeaveCriticalSection(&g_stream.cs);
+		}
+		else {
+			dsp_ring_readspan(&g_stream.ring, &span, &count);
+			if(count>=g_stream.framelen)
+				frame = (unsigned char *)span;
+			else {
+				dsp_ring_read(&g_stream.ring, g_stream.stage, g_stream.framelen, NULL);
+				frame = g_stream.stage;
+			}
+		}
+
+		if(frame) {
+			sipif_lock();
+			rc = FMC204_ctrl_prepare_wfm_load(g_stream.bar, g_stream.dacchannel);
+			if(rc==SIPIF_ERR_OK)
+				rc = sipif_writedata(frame, g_stream.framesize);
+			if(rc==SIPIF_ERR_OK)
+				rc = FMC204_ctrl_arm_dac(g_stream.bar);
+			sipif_unlock();
+			if(rc!=SIPIF_ERR_OK)
+				break;
+
+			if(frame!=g_stream.stage)
+				dsp_ring_commitread(&g_stream.ring, g_stream.framelen);
+			QueryPerformanceCounter(&now);
+			EnterCriticalSection(&g_stream.cs);
+			if(now.QuadPart>next+period)
+				g_stream.status.late++;
+			g_stream.status.frames++;
+			LeaveCriticalSection(&g_stream.cs);
+		}
+
+		// do not try to catch up with periods we missed, the following frame goes out right away instead
+		next += period;
+		QueryPerformanceCounter(&now);
+		if(now.QuadPart>next)
+			next = now.QuadPart;
+	}
+
+	// a failed upload stops the stream, the pushes are refused until FMC204_stream_stop() releases it
+	EnterCriticalSection(&g_stream.cs);
+	if(rc!=SIPIF_ERR_OK)
+		g_stream.active = 0;
+	g_stream.status.running = 0;
+	g_stream.status.error = rc;
+	LeaveCriticalSection(&g_stream.cs);
+
+	return 0;
+}
+
+int FMC204_stream_start(unsigned long bar, unsigned int dacchannel, unsigned int framesize, unsigned int depth, unsigned int periodms)
+{
+	if(!g_streamcsinit) {
+		InitializeCriticalSection(&g_stream.cs);
+		g_streamcsinit = 1;
+	}
+
+	// a stream stopped by a failed upload is running until FMC204_stream_stop() releases it
+	if(g_stream.hthread)
+		return FMC204_STREAM_ERR_RUNNING;
+	if(framesize==0 || framesize%2 || depth==0 || depth>FMC204_STREAM_MAX_DEPTH || periodms==0)
+		return FMC204_STREAM_ERR_ARGUMENT;
+
+	g_stream.bar = bar;
+	g_stream.dacchannel = dacchannel;
+	g_stream.framesize = framesize;
+	g_stream.framelen = framesize/2;
+	g_stream.depth = depth;
+	g_stream.periodms = periodms;
+	memset(&g_stream.status, 0, sizeof(g_stream.status));
+	g_stream.status.credits = depth;
+	g_stream.status.running = 1;
+	g_stream.status.error = SIPIF_ERR_OK;
+
+	// depth frames at least, the credits rather than the room of the ring limit the frames queued
+	if(dsp_ring_init(&g_stream.ring, DSP_RING_INT16, depth*g_stream.framelen)!=DSP_RING_ERR_OK)
+		return FMC204_STREAM_ERR_ALLOC;
+	g_stream.stage = (unsigned char *)_aligned_malloc(framesize, 4096);
+	if(!g_stream.stage) {
+		dsp_ring_free(&g_stream.ring);
+		return FMC204_STREAM_ERR_ALLOC;
+	}
+
+	g_stream.hstop = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if(!g_stream.hstop) {
+		_aligned_free(g_stream.stage);
+		dsp_ring_free(&g_stream.ring);
+		return FMC204_STREAM_ERR_ALLOC;
+	}
+
+	g_stream.active = 1;
+	g_stream.hthread = CreateThread(NULL, 0, FMC204_stream_feeder, NULL, 0, NULL);
+	if(!g_stream.hthread) {
+		g_stream.active = 0;
+		CloseHandle(g_stream.hstop);
+		_aligned_free(g_stream.stage);
+		dsp_ring_free(&g_stream.ring);
+		return FMC204_STREAM_ERR_ALLOC;
+	}
+	// uploads have to go out on time, the server thread only copies frames into the queue
+	SetThreadPriority(g_stream.hthread, THREAD_PRIORITY_TIME_CRITICAL);
+
+	return FMC204_STREAM_ERR_OK;
+}
+
+int FMC204_stream_push(const void *frame, unsigned int size)
+{
+	if(!g_stream.hthread)
+		return FMC204_STREAM_ERR_NOT_RUNNING;
+	if(!frame || size!=g_stream.framesize)
+		return FMC204_STREAM_ERR_ARGUMENT;
+
+	EnterCriticalSection(&g_stream.cs);
+	if(!g_stream.active) {
+		LeaveCriticalSection(&g_stream.cs);
+		return FMC204_STREAM_ERR_STOPPED;
+	}
+	if(FMC204_stream_queued()>=g_stream.depth) {
+		g_stream.status.overflows++;
+		LeaveCriticalSection(&g_stream.cs);
+		return FMC204_STREAM_ERR_NO_CREDIT;
+	}
+	LeaveCriticalSection(&g_stream.cs);
+
+	// the server thread is the only writer of the ring, the frame is visible to the feeder once it is whole
+	if(dsp_ring_write(&g_stream.ring, frame, g_stream.framelen)!=DSP_RING_ERR_OK)
+		return FMC204_STREAM_ERR_NO_CREDIT;
+
+	return FMC204_STREAM_ERR_OK;
+}
+
+int FMC204_stream_getstatus(FMC204_STREAM_STATUS *status)
+{
+	if(!status)
+		return FMC204_STREAM_ERR_ARGUMENT;
+
+	if(!g_streamcsinit) {
+		memset(status, 0, sizeof(*status));
+		return FMC204_STREAM_ERR_OK;
+	}
+
+	EnterCriticalSection(&g_stream.cs);
+	*status = g_stream.status;
+	status->credits = g_stream.active ? g_stream.depth-FMC204_stream_queued() : 0;
+	LeaveCriticalSection(&g_stream.cs);
+
+	return FMC204_STREAM_ERR_OK;
+}
+
+int FMC204_stream_stop(void)
+{
+	int rc;
+
+	if(!g_stream.hthread)
+		return FMC204_STREAM_ERR_NOT_RUNNING;
+
+	SetEvent(g_stream.hstop);
+	WaitForSingleObject(g_stream.hthread, INFINITE);
+	CloseHandle(g_stream.hthread);
+	CloseHandle(g_stream.hstop);
+	g_stream.hthread = NULL;
+
+	EnterCriticalSection(&g_stream.cs);
+	g_stream.active = 0;
+	LeaveCriticalSection(&g_stream.cs);
+	dsp_ring_free(&g_stream.ring);
+	_aligned_free(g_stream.stage);
+	g_stream.stage = NULL;
+
+	sipif_lock();
+	rc = FMC204_ctrl_disarm_dac(g_stream.bar);
+	sipif_unlock();
+
+	return rc;
+}
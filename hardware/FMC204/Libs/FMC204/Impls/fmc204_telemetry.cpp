@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc204_telemetry.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief FMC204_telemetry module to sample the FMC204 health in the background (implementation)
+///
+/// This module samples the temperature and voltages of the monitoring device and
+/// the frequency counters from a low priority thread. The sampler only takes the
+/// transport for one short batch at a time and steps aside while the capture path
+/// holds it ( see sipif_trylock() ). The latest snapshot is published through a
+/// double buffer, FMC204_telemetry_get() never communicates with the hardware.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#include <windows.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "fmc204_telemetry.h"
+#include "fmc204_freqcnt.h"
+#include "i2cmaster_fmc204.h"
+#include "sipif.h"
+#include "regtable.h"
+
+/**
+ * Sampler state. The snapshot slot (published+1)&1 belongs to the sampler, the slot published&1 to the readers. The sampler
+ * only writes the readers' slot again after publishing the next sequence number, readers retry when that happened during
+ * their copy.
+ */
+typedef struct {
+	unsigned long bar_mon;					/*!< offset where the monitoring device is located */
+	unsigned long bar_freqcnt;				/*!< offset where FMC204.FREQCNT is located */
+	unsigned int periodms;					/*!< time between two snapshots */
+	HANDLE hthread;							/*!< sampler thread */
+	HANDLE hstop;							/*!< manual reset event signaled by FMC204_telemetry_stop() */
+	int active;								/*!< 1 between FMC204_telemetry_start() and FMC204_telemetry_stop() */
+	unsigned long deferred;					/*!< batches postponed, only touched by the sampler */
+	volatile LONG published;				/*!< sequence number of the latest published snapshot */
+	FMC204_TELEMETRY slot[2];				/*!< double buffer */
+} fmc204_telemetry;
+
+static fmc204_telemetry g_tlm;				/*!< The one and only sampler */
+
+
+/**
+ * Take the transport for one batch. The capture path always goes first, the sampler waits FMC204_TELEMETRY_BACKOFF_MS
+ * and tries again while somebody else holds it.
+ *
+ * @return 1 when the transport is held, 0 when the sampler has been asked to stop.
+ */
+static int FMC204_telemetry_acquire(void)
+{
+	while(sipif_trylock()!=SIPIF_ERR_OK) {
+		g_tlm.deferred++;
+		if(WaitForSingleObject(g_tlm.hstop, FMC204_TELEMETRY_BACKOFF_MS)==WAIT_OBJECT_0)
+			return 0;
+	}
+	return 1;
+}
+
+/**
+ * Take one snapshot into the sampler's slot.
+ *
+ * @return 1 when the snapshot is complete ( error may be set ), 0 when the sampler has been asked to stop.
+ */
+static int FMC204_telemetry_sample(FMC204_TELEMETRY *snapshot)
+{
+	unsigned long long start = regtable_gettimeus();
+	int rc;
+
+	snapshot->error = SIPIF_ERR_OK;
+	snapshot->source = FMC204_TELEMETRY_SRC_NONE;
+
+	// one bulk read for the whole monitoring device
+	if(!FMC204_telemetry_acquire())
+		return 0;
+	rc = i2cmaster_readmonitorFMC204(g_tlm.bar_mon, &snapshot->temperature, snapshot->voltage);
+	sipif_unlock();
+	if(rc!=I2CMASTER_FMC204_ERR_OK) {
+		snapshot->error = rc;
+		snapshot->source = FMC204_TELEMETRY_SRC_MONITOR;
+	}
+
+	// the frequency counters measure while the transport is released
+	for(unsigned int i = 0; i < FMC204_TELEMETRY_NB_CLOCKS; i++) {
+		snapshot->frequency[i] = 0.0f;
+		if(!FMC204_telemetry_acquire())
+			return 0;
+		rc = FMC204_freqcnt_select(g_tlm.bar_freqcnt, i);
+		sipif_unlock();
+		if(rc==SIPIF_ERR_OK) {
+			if(WaitForSingleObject(g_tlm.hstop, FMC204_FREQCNT_MEASURE_MS)==WAIT_OBJECT_0)
+				return 0;
+			if(!FMC204_telemetry_acquire())
+				return 0;
+			rc = FMC204_freqcnt_read(g_tlm.bar_freqcnt, &snapshot->frequency[i]);
+			sipif_unlock();
+		}
+		if(rc!=SIPIF_ERR_OK) {
+			snapshot->error = rc;
+			snapshot->source = FMC204_TELEMETRY_SRC_FREQCNT;
+		}
+	}
+
+	snapshot->timestamp = GetTickCount();
+	snapshot->sampleus = (unsigned long)(regtable_gettimeus()-start);
+	snapshot->deferred = g_tlm.deferred;
+	return 1;
+}
+
+static DWORD WINAPI FMC204_telemetry_sampler(LPVOID arg)
+{
+	FMC204_TELEMETRY *next;
+	LONG sequence;
+	int rc;
+
+	// configure the monitoring device once, the conversions keep running afterwards
+	if(!FMC204_telemetry_acquire())
+		return 0;
+	rc = i2cmaster_startmonitorFMC204(g_tlm.bar_mon);
+	sipif_unlock();
+
+	for(DWORD waitms = I2CMASTER_FMC204_FIRST_ROUND_MS; ; waitms = g_tlm.periodms) {
+		if(WaitForSingleObject(g_tlm.hstop, waitms)==WAIT_OBJECT_0)
+			break;
+
+		sequence = g_tlm.published+1;
+		next = &g_tlm.slot[sequence&1];
+		if(!FMC204_telemetry_sample(next))
+			break;
+		if(rc!=I2CMASTER_FMC204_ERR_OK) {
+			next->error = rc;
+			next->source = FMC204_TELEMETRY_SRC_MONITOR;
+		}
+		next->sequence = (unsigned long)sequence;
+
+		// publish, the readers switch to the slot just written
+		InterlockedExchange(&g_tlm.published, sequence);
+	}
+
+	return 0;
+}
+
+int FMC204_telemetry_start(unsigned long bar_mon, unsigned long bar_freqcnt, unsigned int periodms)
+{
+	if(g_tlm.active)
+		return FMC204_TELEMETRY_ERR_RUNNING;
+
+	g_tlm.bar_mon = bar_mon;
+	g_tlm.bar_freqcnt = bar_freqcnt;
+	g_tlm.periodms = periodms;
+	g_tlm.deferred = 0;
+	g_tlm.published = 0;
+	memset(g_tlm.slot, 0, sizeof(g_tlm.slot));
+
+	g_tlm.hstop = CreateEvent(NULL, TRUE, FALSE, NULL);
+	if(!g_tlm.hstop)
+		return FMC204_TELEMETRY_ERR_ALLOC;
+
+	g_tlm.hthread = CreateThread(NULL, 0, FMC204_telemetry_sampler, NULL, 0, NULL);
+	if(!g_tlm.hthread) {
+		CloseHandle(g_tlm.hstop);
+		return FMC204_TELEMETRY_ERR_ALLOC;
+	}
+	// health data can wait, the capture path and the server thread cannot
+	SetThreadPriority(g_tlm.hthread, THREAD_PRIORITY_LOWEST);
+
+	g_tlm.active = 1;
+	return FMC204_TELEMETRY_ERR_OK;
+}
+
+int FMC204_telemetry_get(FMC204_TELEMETRY *snapshot)
+{
+	LONG sequence;
+
+	if(!snapshot)
+		return FMC204_TELEMETRY_ERR_NULL_ARGUMENT;
+
+	// the copy is only valid if the sampler has not moved on to our slot in the meantime
+	do {
+		sequence = g_tlm.published;
+		MemoryBarrier();
+		*snapshot = g_tlm.slot[sequence&1];
+		MemoryBarrier();
+	} while(g_tlm.published!=sequence);
+
+	return FMC204_TELEMETRY_ERR_OK;
+}
+
+int FMC204_telemetry_stop(void)
+{
+	if(!g_tlm.active)
+		return FMC204_TELEMETRY_ERR_NOT_RUNNING;
+
+	SetEvent(g_tlm.hstop);
+	WaitForSingleObject(g_tlm.hthread, INFINITE);
+	CloseHandle(g_tlm.hthread);
+	CloseHandle(g_tlm.hstop);
+	g_tlm.active = 0;
+
+	return FMC204_TELEMETRY_ERR_OK;
+}
@@ -17,6 +17,9 @@
 #include "fmc204_dac.h"
 #include "fmc204_freqcnt.h"
 #include "fmc204_ctrl.h"
+#include "fmc204_stream.h"
+#include "fmc204_calib.h"
+#include "fmc204_telemetry.h"
 
 enum 
 {
@@ -50,6 +53,8 @@ extern "C" {
  * @param   clockmode     decide which clock operation modes is used:
  *							- FMC204_INTERNAL_CLK
  *							- FMC204_EXTERNAL_CLK
+ * @note The DAC DLL tuning words are kept in a calibration snapshot ( see FMC204_calib_load() ). When a snapshot exists
+ *		 for the running firmware and clockmode its words are verified first and the full search only runs on mismatch.
  * @return  - FMC204_ERR_OK
  *			- FMC204_ERR_CPLD_INIT
  *			- FMC204_ERR_CLOCKTREE_INIT
@@ -18,8 +18,21 @@ enum
 };
 
 
+#define FMC204_FREQCNT_NB_CLOCKS	4											/*!< Number of clocks wired to the frequency counter */
+#define FMC204_FREQCNT_ALL_CLOCKS	((1<<FMC204_FREQCNT_NB_CLOCKS)-1)				/*!< FMC204_freqcnt_sweep() mask selecting every clock */
+
+/**
+ * Result of FMC204_freqcnt_sweep().
+ */
+typedef struct {
+	unsigned char valid[FMC204_FREQCNT_NB_CLOCKS];		/*!< 1 when the clock was measured and toggles, 0 when it was not selected or does not toggle */
+	float frequency[FMC204_FREQCNT_NB_CLOCKS];			/*!< frequency of each clock in MHz, 0 when not valid */
+} FMC204_FREQCNT_SWEEP;
+
 /* error codes */
 #define FMC204_FREQCNT_ERR_OK					0	/*!< No error encountered during execution. */
+#define FMC204_FREQCNT_ERR_NULL_ARGUMENT		-100	/*!< An unexpected NULL argument has been passed to a function. */
+#define FMC204_FREQCNT_MEASURE_MS				2	/*!< Time between FMC204_freqcnt_select() and a valid FMC204_freqcnt_read() */
 
 
 
@@ -50,6 +63,43 @@ extern "C" {
  */
 int FMC204_freqcnt_getfrequency(unsigned long bar, unsigned int clksel, float *freq, int outputconsole);
 
+/**
+ * Measure a set of clocks in one pass. The reads of a measure and the selection of the next clock go out in the same
+ * sipif_transact() call, a sweep over n clocks costs n+1 round trips and n measure times instead of 2n round trips.
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar     offset where FMC204.FREQCNT is located in the constellation memory space.
+ * @param   clkmask     bit n set to measure clock n ( see FMC204_freqcnt_getfrequency() ), FMC204_FREQCNT_ALL_CLOCKS for all of them.
+ * @param   sweep     pointer to a structure receiving the frequencies and their validity.
+ * @param	outputconsole	decide if the function displays the frequencies to the console or not. Either FMC204_FREQCNT_DISPLAY_CONSOLE or FMC204_FREQCNT_NO_DISPLAY_CONSOLE
+ *							can be passed as argument.
+ * @return  - FMC204_FREQCNT_ERR_OK
+ *			- FMC204_FREQCNT_ERR_NULL_ARGUMENT
+ *			- any sipif error codes
+ */
+int FMC204_freqcnt_sweep(unsigned long bar, unsigned int clkmask, FMC204_FREQCNT_SWEEP *sweep, int outputconsole);
+
+/**
+ * Start a measure on a given clock, the result is available 2 ms later through FMC204_freqcnt_read(). This is the first half of
+ * FMC204_freqcnt_getfrequency() for callers that do not want to sleep in the middle of a measure.
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar     offset where FMC204.FREQCNT is located in the constellation memory space.
+ * @param   clksel     ID of the clock we want to obtain, see FMC204_freqcnt_getfrequency().
+ * @return  FMC204_FREQCNT_ERR_OK in case of success or any ethapi ( please see ethapi documentation ) error codes.
+ */
+int FMC204_freqcnt_select(unsigned long bar, unsigned int clksel);
+
+/**
+ * Read back the frequency measured on the clock selected by FMC204_freqcnt_select().
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar     offset where FMC204.FREQCNT is located in the constellation memory space.
+ * @param   freq     pointer to a float receiving the frequency in MHz.
+ * @return  FMC204_FREQCNT_ERR_OK in case of success or any ethapi ( please see ethapi documentation ) error codes.
+ */
+int FMC204_freqcnt_read(unsigned long bar, float *freq);
+
 // C++ "helper"
 #ifdef __cplusplus
 }
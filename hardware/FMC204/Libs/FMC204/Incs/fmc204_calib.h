@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc204_calib.h
+///@author Pankil Butala (MCL, BU)
+///\brief FMC204_calib module to keep the FMC204 calibration between runs (header)
+///
+/// This module saves the DLL tuning words found by FMC204_dac_init() to a
+/// snapshot file and reads them back on the next start. A snapshot is only valid
+/// for the firmware build, the constellation and the clock mode it was taken
+/// with, these are part of the file name and are checked again when loading.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#ifndef _FMC204_CALIB_H_
+#define _FMC204_CALIB_H_
+
+/* defines */
+#define FMC204_CALIB_MAGIC				0x43323034	/*!< Marker at the beginning of every snapshot file ( 'C204' ) */
+
+/**
+ * Content of a calibration snapshot.
+ */
+typedef struct {
+	unsigned long magic;				/*!< FMC204_CALIB_MAGIC */
+	unsigned long fwbuild;				/*!< firmware build code ( cid_getfwbuildcode() ) */
+	unsigned long constellationid;		/*!< constellation ID ( cid_getconstellationid() ) */
+	unsigned long clockmode;			/*!< clock mode given to FMC204_init() */
+	unsigned long dllword[2];			/*!< DLL tuning word of DAC0 and DAC1 */
+} FMC204_CALIB;
+
+/* error codes */
+#define FMC204_CALIB_ERR_OK				0			/*!< No error encountered during execution. */
+#define FMC204_CALIB_ERR_NOT_FOUND		-1			/*!< There is no valid snapshot for this firmware, constellation and clock mode. */
+#define FMC204_CALIB_ERR_FILE			-2			/*!< The snapshot file could not be written. */
+#define FMC204_CALIB_ERR_NULL_ARGUMENT	-3			/*!< An unexpected NULL argument has been passed to a function. */
+
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Load the calibration snapshot matching the running firmware and the clock mode.
+ *
+ * @warning Calling cid_init() prior calling this function is mandatory.
+ * @note This function does not communicate with the hardware.
+ *
+ * @param   clockmode     clock mode given to FMC204_init().
+ * @param   calib     pointer to a structure receiving the snapshot.
+ * @return  - FMC204_CALIB_ERR_OK
+ *			- FMC204_CALIB_ERR_NOT_FOUND
+ *			- FMC204_CALIB_ERR_NULL_ARGUMENT
+ */
+int FMC204_calib_load(unsigned int clockmode, FMC204_CALIB *calib);
+
+/**
+ * Save a calibration snapshot for the running firmware and the clock mode. The magic and key members of calib
+ * are filled by this function, only dllword has to be set by the caller.
+ *
+ * @warning Calling cid_init() prior calling this function is mandatory.
+ * @note This function does not communicate with the hardware.
+ *
+ * @param   clockmode     clock mode given to FMC204_init().
+ * @param   calib     pointer to the snapshot.
+ * @return  - FMC204_CALIB_ERR_OK
+ *			- FMC204_CALIB_ERR_FILE
+ *			- FMC204_CALIB_ERR_NULL_ARGUMENT
+ */
+int FMC204_calib_save(unsigned int clockmode, FMC204_CALIB *calib);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_FMC204_CALIB_H_
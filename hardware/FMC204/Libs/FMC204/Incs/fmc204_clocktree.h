@@ -16,6 +16,7 @@
 #define FMC204_CLOCKTREE_PART_ID_2 0x91						/*!< Expected part ID for the AD9517-2 clock tree chip */
 #define FMC204_CLOCKTREE_PART_ID_3 0x53						/*!< Expected part ID for the AD9517-3 clock tree chip */
 #define FMC204_CLOCKTREE_PART_ID_4 0xD3						/*!< Expected part ID for the AD9517-4 clock tree chip */
+#define FMC204_CLOCKTREE_LOCK_TIMEOUT_MS 100				/*!< Maximum time given to the PLL to lock after the update */
 
 enum 
 {
@@ -43,12 +44,24 @@ extern "C" {
  * @param   clocksource     clocking mode for the clock tree chip :
  *							- CLOCKTREE_CLKSRC_EXTERNAL
  *							- CLOCKTREE_CLKSRC_INTERNAL
+ * @note With the internal clock the function returns as soon as the PLL reports digital lock, or fails after
+ *		 FMC204_CLOCKTREE_LOCK_TIMEOUT_MS. See FMC204_clocktree_getlocktime().
  * @return  - FMC204_CLOCKTREE_ERR_OK
  *			- FMC204_CLOCKTREE_ERR_WRONG_PART_ID
+ *			- FMC204_CLOCKTREE_ERR_CLK0_PLL_NOT_LOCKED
  *			- Any ethapi error codes ( please consult ethapi documentation for more informations ).
  */
 int FMC204_clocktree_init(unsigned long bar, unsigned int clocksource);
 
+/**
+ * Obtain the lock time measured during the last FMC204_clocktree_init(). The time is counted from the update of
+ * the clock tree registers, it is 0 with the external clock or when the PLL did not lock.
+ *
+ * @param   lockus     pointer receiving the time it took for the PLL to report digital lock in microseconds. Can be NULL.
+ * @return  - FMC204_CLOCKTREE_ERR_OK
+ */
+int FMC204_clocktree_getlocktime(unsigned long *lockus);
+
 // C++ "helper"
 #ifdef __cplusplus
 }
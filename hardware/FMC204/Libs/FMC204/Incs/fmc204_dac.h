@@ -15,11 +15,27 @@
 #define FMC204_DAC_DLL_LOCKED		0x40					/*!< DAC chip's status register : DLL locked status */
 #define FMC204_DAC_FIFO_ERROR		0x20					/*!< DAC chip's status register : FIFO check has failed */
 #define FMC204_DAC_PATTERN_ERROR	0x10					/*!< DAC chip's status register : pattern check has failed */
+#define FMC204_DAC_DLL_NONE			0xFFFFFFFF				/*!< FMC204_dac_init() : no DLL tuning word */
+#define FMC204_DAC_DLL_FIRST		0x00					/*!< First DLL tuning word searched by FMC204_dac_init() */
+#define FMC204_DAC_DLL_LAST			0x01					/*!< Last DLL tuning word searched by FMC204_dac_init() */
+#define FMC204_DAC_NB				2						/*!< Number of DAC chips on the FMC204 */
 
 enum 
 {	
 };
 
+/**
+ * Outcome of the DLL tuning of one DAC chip, filled by FMC204_dac_init().
+ */
+typedef struct {
+	unsigned long dllword;				/*!< tuning word passing the pattern check, FMC204_DAC_DLL_NONE if none did */
+	unsigned int dlllocked;				/*!< 1 when the DLL locked with the last tuning word tried */
+	unsigned int pattern;				/*!< 1 when the pattern check passed */
+	unsigned int fifoerror;				/*!< 1 when the FIFO check failed, the search stops for this DAC */
+	unsigned int tries;					/*!< number of tuning words tried */
+	unsigned long flags;				/*!< error flags register read after the last checking time */
+} FMC204_DAC_REPORT;
+
 
 /* error codes */
 #define FMC204_DAC_ERR_OK						0			/*!< No error encountered during execution. */
@@ -45,6 +61,12 @@ extern "C" {
  * @param   bar_dac0_phy     offset where FMC204.DAC0PHY is located in the constellation memory space.
  * @param   bar_dac1     offset where FMC204.DAC1SPI is located in the constellation memory space.
  * @param	bar_dac1_phy	offset where FMC204.DAC1PHY is located in the constellation memory space.
+ * @param	dllhint	pointer to the DLL tuning words of DAC0 and DAC1 tried before any other word, typically the words found
+ *					during a previous run ( see FMC204_calib_load() ). An entry can be FMC204_DAC_DLL_NONE, the pointer can be NULL.
+ *					A hint that does not lock or fails the FIFO check is skipped, only the words searched afterwards can fail the init.
+ * @param	report	pointer to FMC204_DAC_NB structures receiving the DLL lock and pattern check outcome for DAC0 and DAC1. Can be NULL.
+ * @note Both DACs are tuned and pattern checked at the same time. The tuning words are tried in this order: the hint, then
+ *		 FMC204_DAC_DLL_FIRST to FMC204_DAC_DLL_LAST, the words of the original search.
  * @return  - FMC204_DAC_ERR_OK
  *			- FMC204_DAC_ERR_WRONG_PART_ID
  *			- FMC204_DAC_ERR_DLL_NOT_LOCKED
@@ -53,7 +75,8 @@ extern "C" {
  *			- FMC204_DAC_ERR_CHAN0_PATTERN
  *			- FMC204_DAC_ERR_CHAN1_PATTERN
  */
-int FMC204_dac_init(unsigned long bar_dac0, unsigned long bar_dac0_phy, unsigned long bar_dac1, unsigned long bar_dac1_phy) ;
+int FMC204_dac_init(unsigned long bar_dac0, unsigned long bar_dac0_phy, unsigned long bar_dac1, unsigned long bar_dac1_phy,
+					const unsigned long *dllhint, FMC204_DAC_REPORT *report);
 
 // C++ "helper"
 #ifdef __cplusplus
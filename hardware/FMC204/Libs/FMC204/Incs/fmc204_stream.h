@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc204_stream.h
+///@author Pankil Butala (MCL, BU)
+///\brief FMC204_stream module to feed the FMC204 waveform memory continuously (header)
+///
+/// This module keeps a bounded queue of waveform frames pushed by the client and
+/// feeds them to the waveform memory of one DAC channel at a fixed frame period.
+/// A feeder thread uploads the next frame and re-arms the DAC at every period
+/// boundary. The client is only allowed to push as many frames as it has credits
+/// (free queue slots); frame periods without a queued frame are counted as
+/// underruns and frames armed after the end of their period as late frames.
+/// The frames go through a dsp_ring of 16 bit samples, written by the server
+/// thread and read by the feeder thread without a lock. A frame contiguous in
+/// the ring is uploaded in place, a frame wrapping around its end is copied.
+/// A failed upload stops the feeder thread and the stream, FMC204_stream_stop()
+/// still has to be called to release it.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#ifndef _FMC204_STREAM_H_
+#define _FMC204_STREAM_H_
+
+/* defines */
+#define FMC204_STREAM_MAX_DEPTH			64			/*!< Maximum number of frames the stream queue can hold */
+
+/**
+ * Counters reported by FMC204_stream_getstatus().
+ */
+typedef struct {
+	unsigned long frames;				/*!< number of frames uploaded and armed since FMC204_stream_start() */
+	unsigned long underruns;			/*!< number of frame periods where the queue was empty */
+	unsigned long late;					/*!< number of frames armed after the end of their frame period */
+	unsigned long overflows;			/*!< number of frames rejected because the client had no credit left */
+	unsigned int credits;				/*!< number of free queue slots, i.e. frames the client may still push */
+	unsigned int running;				/*!< 1 when the feeder thread is running, 0 otherwise */
+	int error;							/*!< sipif error code that stopped the feeder thread, SIPIF_ERR_OK otherwise */
+} FMC204_STREAM_STATUS;
+
+/* error codes */
+#define FMC204_STREAM_ERR_OK			0			/*!< No error encountered during execution. */
+#define FMC204_STREAM_ERR_RUNNING		-1			/*!< FMC204_stream_start() called while a stream is already running. */
+#define FMC204_STREAM_ERR_NOT_RUNNING	-2			/*!< No stream is running. */
+#define FMC204_STREAM_ERR_ARGUMENT		-3			/*!< Frame size, queue depth or frame period out of range. */
+#define FMC204_STREAM_ERR_NO_CREDIT		-4			/*!< FMC204_stream_push() called while the queue is full. */
+#define FMC204_STREAM_ERR_ALLOC			-5			/*!< Could not allocate the queue or create the feeder thread. */
+#define FMC204_STREAM_ERR_STOPPED		-6			/*!< The feeder thread stopped on a failed upload, FMC204_STREAM_STATUS.error tells why. */
+
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Start streaming to one DAC channel. The router must already route the data path to the waveform memory of
+ * dacchannel and the burst size must be configured for framesize bytes ( FMC204_ctrl_configure_burst() ).
+ *
+ * @note This function does not communicate with the hardware, the feeder thread does.
+ *
+ * @param   bar     offset where FMC204.CTRL is located in the constellation memory space.
+ * @param   dacchannel     DAC receiving the frames ( DAC0, DAC1, DAC2 or DAC3 ).
+ * @param   framesize     size of one frame in bytes, 16 bit samples.
+ * @param   depth     number of frames the queue can hold ( 1 to FMC204_STREAM_MAX_DEPTH ). This is the initial credit.
+ * @param   periodms     frame period in milliseconds. A new frame is uploaded and armed every periodms.
+ * @return  - FMC204_STREAM_ERR_OK
+ *			- FMC204_STREAM_ERR_RUNNING
+ *			- FMC204_STREAM_ERR_ARGUMENT
+ *			- FMC204_STREAM_ERR_ALLOC
+ */
+int FMC204_stream_start(unsigned long bar, unsigned int dacchannel, unsigned int framesize, unsigned int depth, unsigned int periodms);
+
+/**
+ * Queue one frame. The frame is copied, the caller can reuse the buffer as soon as the function returns.
+ *
+ * @param   frame     pointer to framesize bytes of 16 bit samples.
+ * @param   size     size of the frame in bytes, must match the framesize given to FMC204_stream_start().
+ * @return  - FMC204_STREAM_ERR_OK
+ *			- FMC204_STREAM_ERR_NOT_RUNNING
+ *			- FMC204_STREAM_ERR_ARGUMENT
+ *			- FMC204_STREAM_ERR_NO_CREDIT
+ *			- FMC204_STREAM_ERR_STOPPED
+ */
+int FMC204_stream_push(const void *frame, unsigned int size);
+
+/**
+ * Obtain the stream counters and the current credit.
+ *
+ * @param   status     pointer to a structure receiving the counters.
+ * @return  - FMC204_STREAM_ERR_OK
+ *			- FMC204_STREAM_ERR_ARGUMENT
+ */
+int FMC204_stream_getstatus(FMC204_STREAM_STATUS *status);
+
+/**
+ * Stop the feeder thread, disarm the DAC and release the queue, also once the feeder thread has stopped on a failed
+ * upload. Counters remain readable using FMC204_stream_getstatus() until the next FMC204_stream_start().
+ *
+ * @note This function communicates with the hardware.
+ *
+ * @return  - FMC204_STREAM_ERR_OK
+ *			- FMC204_STREAM_ERR_NOT_RUNNING
+ *			- any sipif error code returned while disarming the DAC.
+ */
+int FMC204_stream_stop(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_FMC204_STREAM_H_
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////////
+///@file fmc204_telemetry.h
+///@author Pankil Butala (MCL, BU)
+///\brief FMC204_telemetry module to sample the FMC204 health in the background (header)
+///
+/// This module samples the temperature and voltages of the monitoring device and
+/// the frequency counters from a low priority thread. The sampler only takes the
+/// transport for one short batch at a time and steps aside while the capture path
+/// holds it ( see sipif_trylock() ). The latest snapshot is published through a
+/// double buffer, FMC204_telemetry_get() never communicates with the hardware.
+///
+///////////////////////////////////////////////////////////////////////////////////
+#ifndef _FMC204_TELEMETRY_H_
+#define _FMC204_TELEMETRY_H_
+
+#include "i2cmaster_fmc204.h"
+
+/* defines */
+#define FMC204_TELEMETRY_NB_CLOCKS		4			/*!< Frequency counter clocks sampled, see FMC204_freqcnt_getfrequency() */
+#define FMC204_TELEMETRY_PERIOD_MS		1000		/*!< Default time between two snapshots */
+#define FMC204_TELEMETRY_BACKOFF_MS		2			/*!< Wait before trying again when the capture path holds the transport */
+#define FMC204_TELEMETRY_SRC_NONE			0			/*!< error source, no error */
+#define FMC204_TELEMETRY_SRC_MONITOR		1			/*!< error source, i2cmaster_readmonitorFMC204() or i2cmaster_startmonitorFMC204() */
+#define FMC204_TELEMETRY_SRC_FREQCNT		2			/*!< error source, FMC204_freqcnt_select() or FMC204_freqcnt_read() */
+
+/**
+ * One telemetry snapshot.
+ */
+typedef struct {
+	unsigned long sequence;							/*!< snapshot number, 0 until the first snapshot is published */
+	unsigned long timestamp;						/*!< GetTickCount() when the snapshot was completed */
+	unsigned long sampleus;							/*!< time spent taking the snapshot, including the waits for the transport */
+	unsigned long deferred;							/*!< batches postponed so far because the capture path held the transport */
+	int error;										/*!< error met while taking the snapshot, code of the source function, 0 when all values are fresh */
+	int source;										/*!< FMC204_TELEMETRY_SRC_x, function that returned error, the codes of the sources overlap */
+	float temperature;								/*!< monitoring device temperature in degree C */
+	float voltage[I2CMASTER_FMC204_NB_VOLTAGES];	/*!< voltages in V, see i2cmaster_readmonitorFMC204() */
+	float frequency[FMC204_TELEMETRY_NB_CLOCKS];	/*!< clocks 0..3 in MHz */
+} FMC204_TELEMETRY;
+
+/* error codes */
+#define FMC204_TELEMETRY_ERR_OK				0		/*!< No error encountered during execution. */
+#define FMC204_TELEMETRY_ERR_RUNNING		-1		/*!< FMC204_telemetry_start() has been called already. */
+#define FMC204_TELEMETRY_ERR_NOT_RUNNING	-2		/*!< FMC204_telemetry_start() has not been called. */
+#define FMC204_TELEMETRY_ERR_ALLOC			-3		/*!< The sampler thread could not be created. */
+#define FMC204_TELEMETRY_ERR_NULL_ARGUMENT	-4		/*!< An unexpected NULL argument has been passed to a function. */
+
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Start the sampler thread. The monitoring device is configured once by the thread, after that every snapshot is one bulk
+ * read of the monitoring device plus one select/read pair per frequency counter clock.
+ * @note The sampler communicates with the hardware, always through sipif_trylock().
+ *
+ * @param   bar_mon     offset where the FMC204 monitoring device is located on FMC204.I2CMASTER in the constellation memory space.
+ * @param   bar_freqcnt     offset where FMC204.FREQCNT is located in the constellation memory space.
+ * @param   periodms     time between two snapshots, FMC204_TELEMETRY_PERIOD_MS is a reasonable value.
+ * @return  - FMC204_TELEMETRY_ERR_OK
+ *			- FMC204_TELEMETRY_ERR_RUNNING
+ *			- FMC204_TELEMETRY_ERR_ALLOC
+ */
+int FMC204_telemetry_start(unsigned long bar_mon, unsigned long bar_freqcnt, unsigned int periodms);
+
+/**
+ * Copy the latest published snapshot. This function does not block the sampler and the sampler does not block it.
+ * @note This function does not communicate with the hardware.
+ *
+ * @param   snapshot     pointer to a structure receiving the snapshot. sequence is 0 when no snapshot has been taken yet.
+ * @return  - FMC204_TELEMETRY_ERR_OK
+ *			- FMC204_TELEMETRY_ERR_NULL_ARGUMENT
+ */
+int FMC204_telemetry_get(FMC204_TELEMETRY *snapshot);
+
+/**
+ * Stop the sampler thread and wait for it to leave.
+ *
+ * @return  - FMC204_TELEMETRY_ERR_OK
+ *			- FMC204_TELEMETRY_ERR_NOT_RUNNING
+ */
+int FMC204_telemetry_stop(void);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_FMC204_TELEMETRY_H_
@@ -328,3 +328,61 @@ int i2cmaster_getdiagnosticsFMC204(unsigned long bar, float *siliconrevision, fl
 
 	return I2CMASTER_FMC204_ERR_OK;
 }
+
+int i2cmaster_startmonitorFMC204(unsigned long bar)
+{
+	int rc;
+
+	//Control configuration 1, the conversions run round robin from now on
+	rc = sipif_writesipreg(bar+0x18, 0x29);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
+	Sleep(100);
+	//Control configuration 3
+	rc = sipif_writesipreg(bar+0x1A, 0x10);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
+
+	return I2CMASTER_FMC204_ERR_OK;
+}
+
+int i2cmaster_readmonitorFMC204(unsigned long bar, float *temperature, float *voltage)
+{
+	// input scaling of AIN1..AIN8, see i2cmaster_getdiagnosticsFMC204()
+	static const float scale[8] = { 2.0f, 1.0f, 1.0f, 1.0f, 2.0f, 2.0f, 2.0f, 7.04f };
+	unsigned long regs[13];
+	unsigned long lsb, msb;
+	float Vref;
+	int rc;
+
+	if(temperature==NULL || voltage==NULL)
+		return I2CMASTER_FMC204_ERR_NULL_ARGUMENT;
+
+	// Snapshot of all the conversion results, the LSB registers 0x03..0x05 come first and
+	// hold the MSB registers 0x06..0x0F until they are read
+	rc = sipif_readsipregs(bar+0x03, 13, regs);
+	if(rc!=SIPIF_ERR_OK)
+		return rc;
+#define ADT_REG(offset)		regs[(offset)-0x03]
+
+	//Onchip TEMP
+	lsb = (ADT_REG(0x03) >> 0) & 0x3;
+	msb = ADT_REG(0x07) << 2;
+	*temperature = (msb + lsb) / 4.0f;
+
+	//Onchip VDD
+	lsb = (ADT_REG(0x03) >> 2) & 0x3;
+	msb = ADT_REG(0x06) << 2;
+	Vref = (msb + lsb) * 3.11f * 2.197f / 1000.0f;
+	voltage[0] = Vref;
+
+	//AIN1..AIN8, the LSBs are packed four per register
+	for(int i = 0; i < 8; i++) {
+		lsb = (ADT_REG(0x04+i/4) >> (2*(i%4))) & 0x3;
+		msb = ADT_REG(0x08+i) << 2;
+		voltage[1+i] = scale[i] * (msb + lsb) * Vref / 1024.0f;
+	}
+#undef ADT_REG
+
+	return I2CMASTER_FMC204_ERR_OK;
+}
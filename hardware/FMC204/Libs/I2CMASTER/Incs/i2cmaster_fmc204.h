@@ -17,6 +17,10 @@ enum
 
 /* error codes */
 #define I2CMASTER_FMC204_ERR_OK					0	/*!< No error encountered during execution. */
+#define I2CMASTER_FMC204_ERR_NULL_ARGUMENT		-100	/*!< An unexpected NULL argument has been passed to a function. */
+
+#define I2CMASTER_FMC204_NB_VOLTAGES			9	/*!< Voltages returned by i2cmaster_readmonitorFMC204(): 3.3V rail, 3.3V clk, 1.8V dig, Vadj, 2.5V clk, 3.3V dig, 3.3V adc, 3.3V cp, 12V */
+#define I2CMASTER_FMC204_FIRST_ROUND_MS			110	/*!< Time for the first conversion round after i2cmaster_startmonitorFMC204() */
 
 // C++ "helper"
 #ifdef __cplusplus
@@ -47,6 +51,30 @@ int i2cmaster_getdiagnosticsFMC204(unsigned long bar, float *siliconrevision, fl
 	float *voltage1V8_dig, float *voltage2V5_adj, float *voltage2V5_clk, float *voltage3V3_dig, float *voltage3V3_adc, 
 	float *voltage3V3_cp, float *voltage12V, int outputconsole);
 
+/**
+ * Configure the FMC204 monitoring device for continuous conversions. The device converts its inputs round robin from now on,
+ * the first complete round is available I2CMASTER_FMC204_FIRST_ROUND_MS later.
+ * @note This function communicates with the hardware and waits 100 ms between the two configuration registers.
+ *
+ * @param   bar     offset where FMC204.I2CMASTER is located in the constellation memory space.
+ * @return  I2CMASTER_FMC204_ERR_OK in case of success or any sipif error codes.
+ */
+int i2cmaster_startmonitorFMC204(unsigned long bar);
+
+/**
+ * Read the latest conversion results of the FMC204 monitoring device, started by i2cmaster_startmonitorFMC204(). The results
+ * are read in a single bulk read and the function does not wait, it is cheap enough to be called periodically.
+ * @note This function communicates with the hardware.
+ *
+ * @param   bar     offset where FMC204.I2CMASTER is located in the constellation memory space.
+ * @param   temperature			pointer to a float variable about to receive the silicon temperature.
+ * @param   voltage				I2CMASTER_FMC204_NB_VOLTAGES floats receiving the voltages, in the order of i2cmaster_getdiagnosticsFMC204().
+ * @return  - I2CMASTER_FMC204_ERR_OK
+ *			- I2CMASTER_FMC204_ERR_NULL_ARGUMENT
+ *			- any sipif error codes
+ */
+int i2cmaster_readmonitorFMC204(unsigned long bar, float *temperature, float *voltage);
+
 // C++ "helper"
 #ifdef __cplusplus
 }
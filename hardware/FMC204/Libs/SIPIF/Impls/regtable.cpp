@@ -0,0 +1,116 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file regtable.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief regtable module executes register programming tables (implementation)
+///
+/// Chip initialization sequences are described as tables of register writes, settle delays and
+/// wait conditions. The executor groups consecutive writes into one sipif_transact() batch and
+/// only stops where the table asks for it, either for a fixed delay or until a status register
+/// reports the expected value.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef __linux__
+ #define _XOPEN_SOURCE 600
+ #include <unistd.h>
+ #include <sys/time.h>
+#endif 
+#include <stdlib.h>
+#include <stdio.h>
+#ifdef WIN32
+ #include <windows.h>
+#else
+ static void Sleep(unsigned long timems)
+ {
+   usleep(timems*1000);
+ }
+#endif
+#include "sipif.h"
+#include "regtable.h"
+
+
+unsigned long long regtable_gettimeus(void)
+{
+#ifdef WIN32
+	LARGE_INTEGER freq, now;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (unsigned long long)(now.QuadPart/freq.QuadPart)*1000000 + 
+		(unsigned long long)(now.QuadPart%freq.QuadPart)*1000000/freq.QuadPart;
+#else
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (unsigned long long)tv.tv_sec*1000000 + tv.tv_usec;
+#endif
+}
+
+int regtable_wait(unsigned long addr, unsigned long mask, unsigned long value, unsigned int timeoutms, unsigned long *elapsedus)
+{
+	unsigned long long start, now;
+	unsigned long dword;
+	int rc;
+
+	start = regtable_gettimeus();
+	for(;;) {
+		rc = sipif_readsipreg(addr, &dword);
+		if(rc!=SIPIF_ERR_OK)
+			return rc;
+		now = regtable_gettimeus();
+		if((dword&mask)==value)
+			break;
+		if(now-start>=(unsigned long long)timeoutms*1000)
+			return REGTABLE_ERR_WAIT_TIMEOUT;
+		// a register read is a round trip already, only yield when the interface answers faster than that
+		if(now-start>=1000)
+			Sleep(1);
+	}
+
+	if(elapsedus)
+		*elapsedus = (unsigned long)(now-start);
+
+	return REGTABLE_ERR_OK;
+}
+
+int regtable_run(unsigned long bar, const REGTABLE_ENTRY *table, unsigned int count)
+{
+	SIPIF_REGOP batch[SIPIF_MAX_BATCH];
+	unsigned int n = 0;
+	int rc;
+
+	// check if arguments are valid
+	if(table==NULL) {
+		return REGTABLE_ERR_NULL_ARGUMENT;
+	}
+
+	for(unsigned int i = 0; i <= count; i++) {
+		// flush the pending writes when the batch is full, before waiting and at the end of the table
+		if(n && (n==SIPIF_MAX_BATCH || i==count || table[i].type!=REGTABLE_WRITE)) {
+			rc = sipif_transact(batch, n);
+			if(rc!=SIPIF_ERR_OK)
+				return rc;
+			n = 0;
+		}
+		if(i==count)
+			break;
+
+		switch(table[i].type)
+		{
+		case REGTABLE_WRITE:
+			batch[n].op = SIPIF_OP_WRITE;
+			batch[n].addr = bar+table[i].offset;
+			batch[n].value = table[i].value;
+			n++;
+			break;
+		case REGTABLE_DELAY:
+			Sleep(table[i].ms);
+			break;
+		case REGTABLE_WAIT:
+			rc = regtable_wait(bar+table[i].offset, table[i].mask, table[i].value, table[i].ms, NULL);
+			if(rc!=REGTABLE_ERR_OK)
+				return rc;
+			break;
+		}
+	}
+
+	return REGTABLE_ERR_OK;
+}
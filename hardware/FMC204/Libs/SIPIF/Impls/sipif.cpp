@@ -10,8 +10,10 @@
 //////////////////////////////////////////////////////////////////////////////////////////////////
 #ifdef __linux__
  #define _XOPEN_SOURCE 600
+ #define _GNU_SOURCE					// PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
  #include <unistd.h>
  #include <sys/time.h>
+ #include <pthread.h>
 #endif 
 #include <stdlib.h>
 #include <stdio.h>
@@ -30,6 +32,12 @@
 _4FM_DeviceContext g_hDev;			/*!< The 4FM API handle */
 unsigned int g_timeout;				/*!< The timeout value */
 unsigned int g_typeif;				/*!< The currently selected interface */
+#ifdef WIN32
+static CRITICAL_SECTION g_lock;		/*!< Serializes the transport between threads, see sipif_lock() */
+static int g_lockinit = 0;			/*!< 1 once g_lock is initialized */
+#else
+static pthread_mutex_t g_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;	/*!< Serializes the transport between threads, see sipif_lock() */
+#endif
 
 
 // Function pointers for 4FM.dll. They receive pointer of the various function required by this module. We actually want to load
@@ -376,6 +384,12 @@ int sipif_init( unsigned char typeif, const char *devtype4FM, unsigned int devid
 	_4FM_error_t rc;
 
 	// something common for all our interfaces
+#ifdef WIN32
+	if(!g_lockinit) {
+		InitializeCriticalSection(&g_lock);
+		g_lockinit = 1;
+	}
+#endif
 	g_timeout = timeout;
 	g_typeif = typeif;
 
@@ -501,6 +515,95 @@ int sipif_writesipreg(unsigned int addr, unsigned long value)
 	return SIPIF_ERR_OK;
 }
 
+int sipif_transact(SIPIF_REGOP *ops, unsigned int count)
+{
+	int rc;
+
+	// check if arguments are valid
+	if(ops==NULL) {
+		return SIPIF_ERR_NULL_ARGUMENT;
+	}
+
+	switch(g_typeif)
+	{
+	case SIPIF_ETHAPI: 
+	case SIPIF_4FM: {
+		// these layers have a blocking register API, one operation at a time
+		for(unsigned int i = 0; i < count; i++) {
+			if(ops[i].op==SIPIF_OP_READ)
+				rc = sipif_readsipreg(ops[i].addr, &ops[i].value);
+			else
+				rc = sipif_writesipreg(ops[i].addr, ops[i].value);
+			if(rc!=SIPIF_ERR_OK)
+				return rc;
+		}
+		break;
+	}
+	default:
+		return SIPIF_ERR_UNEXPECTED_LAYER_ID;
+	}
+
+	return SIPIF_ERR_OK;
+}
+
+int sipif_readsipregs(unsigned int addr, unsigned int count, unsigned long *values)
+{
+	SIPIF_REGOP ops[SIPIF_MAX_BATCH];
+	unsigned int n;
+	int rc;
+
+	// check if arguments are valid
+	if(values==NULL) {
+		return SIPIF_ERR_NULL_ARGUMENT;
+	}
+
+	for(unsigned int i = 0; i < count; i += n) {
+		n = count-i<SIPIF_MAX_BATCH ? count-i : SIPIF_MAX_BATCH;
+		for(unsigned int j = 0; j < n; j++) {
+			ops[j].op = SIPIF_OP_READ;
+			ops[j].addr = addr+i+j;
+			ops[j].value = 0;
+		}
+		rc = sipif_transact(ops, n);
+		if(rc!=SIPIF_ERR_OK)
+			return rc;
+		for(unsigned int j = 0; j < n; j++)
+			values[i+j] = ops[j].value;
+	}
+
+	return SIPIF_ERR_OK;
+}
+
+void sipif_lock(void)
+{
+#ifdef WIN32
+	EnterCriticalSection(&g_lock);
+#else
+	pthread_mutex_lock(&g_lock);
+#endif
+}
+
+int sipif_trylock(void)
+{
+#ifdef WIN32
+	if(!TryEnterCriticalSection(&g_lock))
+		return SIPIF_ERR_BUSY;
+#else
+	if(pthread_mutex_trylock(&g_lock)!=0)
+		return SIPIF_ERR_BUSY;
+#endif
+	return SIPIF_ERR_OK;
+}
+
+void sipif_unlock(void)
+{
+#ifdef WIN32
+	LeaveCriticalSection(&g_lock);
+#else
+	pthread_mutex_unlock(&g_lock);
+#endif
+}
+
 int sipif_getdeviceenumeration(unsigned long mode)
 {
 #ifdef WIN32	
@@ -0,0 +1,288 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file trace.cpp
+///@author Pankil Butala (MCL, BU)
+///\brief trace module measures the latency of the server commands (implementation)
+///
+/// Every command served over the socket is traced as a span made of consecutive phases ( socket
+/// receive, router configuration, data transfer, ... ). The duration of each phase and of each
+/// command is recorded into a log-linear ( HDR style ) histogram with 6.25% precision, and as
+/// an event in a ring buffer that trace_export() writes as a Chrome trace ( chrome://tracing ).
+/// Timestamps are monotonic, in microseconds since trace_init().
+///
+/// The module is meant for the server thread, it is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef __linux__
+ #define _XOPEN_SOURCE 600
+ #include <time.h>
+#endif
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef WIN32
+ #include <windows.h>
+#endif
+#include "trace.h"
+
+#define TRACE_NO_PHASE	0xFF				/*!< Event kind of a whole command */
+
+/**
+ * One entry of the event ring, either a phase or a whole command.
+ */
+typedef struct {
+	unsigned long long ts;					/*!< beginning, us */
+	unsigned long long dur;					/*!< duration, us */
+	unsigned char cmd;						/*!< command byte */
+	unsigned char phase;					/*!< phase ID or TRACE_NO_PHASE */
+} trace_event;
+
+static TRACE_HIST g_cmdhist[TRACE_MAX_COMMANDS];			/*!< one histogram per command byte */
+static TRACE_HIST g_phasehist[TRACE_MAX_PHASES];			/*!< one histogram per phase */
+static const char *g_cmdname[TRACE_MAX_COMMANDS];			/*!< names given by trace_namecommand() */
+static const char *g_phasename[TRACE_MAX_PHASES];			/*!< names given by trace_namephase() */
+static trace_event g_events[TRACE_MAX_EVENTS];				/*!< event ring */
+static unsigned long g_nbevents = 0;						/*!< events recorded since trace_init(), the ring keeps the last TRACE_MAX_EVENTS */
+static unsigned long long g_origin = 0;						/*!< raw timestamp of trace_init() */
+
+
+/**
+ * Raw monotonic clock in microseconds.
+ */
+static unsigned long long trace_clockus(void)
+{
+#ifdef WIN32
+	LARGE_INTEGER freq, now;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (unsigned long long)(now.QuadPart/freq.QuadPart)*1000000 +
+		(unsigned long long)(now.QuadPart%freq.QuadPart)*1000000/freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+#endif
+}
+
+/**
+ * Bucket of a value: values below 2^TRACE_HIST_SUBBITS have a bucket each, above that every power of two is split in
+ * 2^(TRACE_HIST_SUBBITS-1) buckets.
+ */
+static unsigned int trace_bucket(unsigned long long value)
+{
+	unsigned int msb = 0, shift;
+
+	if(value>=(1ULL<<TRACE_HIST_MAXBITS))
+		value = (1ULL<<TRACE_HIST_MAXBITS)-1;
+	if(value<(1ULL<<TRACE_HIST_SUBBITS))
+		return (unsigned int)value;
+
+	while((value>>msb)>1)
+		msb++;
+	shift = msb-(TRACE_HIST_SUBBITS-1);
+	return (shift<<(TRACE_HIST_SUBBITS-1)) + (unsigned int)(value>>shift);
+}
+
+/**
+ * Highest value falling in a bucket.
+ */
+static unsigned long long trace_bucketvalue(unsigned int bucket)
+{
+	unsigned int shift, sub;
+
+	if(bucket<(1U<<TRACE_HIST_SUBBITS))
+		return bucket;
+
+	shift = (bucket>>(TRACE_HIST_SUBBITS-1))-1;
+	sub = bucket-(shift<<(TRACE_HIST_SUBBITS-1));
+	return (((unsigned long long)sub+1)<<shift)-1;
+}
+
+void trace_histadd(TRACE_HIST *hist, unsigned long long value)
+{
+	if(hist->count==0 || value<hist->min)
+		hist->min = value;
+	if(value>hist->max)
+		hist->max = value;
+	hist->count++;
+	hist->total += value;
+	hist->counts[trace_bucket(value)]++;
+}
+
+static void trace_log(unsigned char cmd, unsigned char phase, unsigned long long ts, unsigned long long dur)
+{
+	trace_event *event = &g_events[g_nbevents%TRACE_MAX_EVENTS];
+
+	event->ts = ts;
+	event->dur = dur;
+	event->cmd = cmd;
+	event->phase = phase;
+	g_nbevents++;
+}
+
+void trace_init(void)
+{
+	memset(g_cmdhist, 0, sizeof(g_cmdhist));
+	memset(g_phasehist, 0, sizeof(g_phasehist));
+	g_nbevents = 0;
+	g_origin = trace_clockus();
+}
+
+unsigned long long trace_now(void)
+{
+	return trace_clockus()-g_origin;
+}
+
+void trace_namecommand(unsigned char cmd, const char *name)
+{
+	g_cmdname[cmd] = name;
+}
+
+void trace_namephase(unsigned int phase, const char *name)
+{
+	if(phase<TRACE_MAX_PHASES)
+		g_phasename[phase] = name;
+}
+
+void trace_start(TRACE_SPAN *span, unsigned char cmd, unsigned long long start)
+{
+	span->cmd = cmd;
+	span->start = start;
+	span->last = start;
+}
+
+void trace_mark(TRACE_SPAN *span, unsigned int phase)
+{
+	unsigned long long now = trace_now();
+
+	if(phase<TRACE_MAX_PHASES) {
+		trace_histadd(&g_phasehist[phase], now-span->last);
+		trace_log(span->cmd, (unsigned char)phase, span->last, now-span->last);
+	}
+	span->last = now;
+}
+
+void trace_end(TRACE_SPAN *span)
+{
+	unsigned long long now = trace_now();
+
+	trace_histadd(&g_cmdhist[span->cmd], now-span->start);
+	trace_log(span->cmd, TRACE_NO_PHASE, span->start, now-span->start);
+}
+
+void trace_histmerge(TRACE_HIST *dst, const TRACE_HIST *src)
+{
+	if(src->count==0)
+		return;
+	if(dst->count==0 || src->min<dst->min)
+		dst->min = src->min;
+	if(src->max>dst->max)
+		dst->max = src->max;
+	dst->count += src->count;
+	dst->total += src->total;
+	for(unsigned int i = 0; i < TRACE_HIST_BUCKETS; i++)
+		dst->counts[i] += src->counts[i];
+}
+
+unsigned long long trace_percentile(const TRACE_HIST *hist, double percentile)
+{
+	unsigned long long target, seen = 0;
+	unsigned long long value;
+
+	if(hist==NULL || hist->count==0)
+		return 0;
+
+	// rank of the percentile, rounded up
+	target = (unsigned long long)(percentile*hist->count/100.0);
+	if(target<percentile*hist->count/100.0 || target<1)
+		target++;
+	for(unsigned int i = 0; i < TRACE_HIST_BUCKETS; i++) {
+		seen += hist->counts[i];
+		if(seen>=target) {
+			value = trace_bucketvalue(i);
+			return value>hist->max ? hist->max : value;
+		}
+	}
+	return hist->max;
+}
+
+const TRACE_HIST *trace_gethistcommand(unsigned char cmd)
+{
+	return &g_cmdhist[cmd];
+}
+
+const TRACE_HIST *trace_gethistphase(unsigned int phase)
+{
+	return phase<TRACE_MAX_PHASES ? &g_phasehist[phase] : NULL;
+}
+
+/**
+ * Print one line of the report.
+ */
+static void trace_reportline(FILE *out, const char *name, unsigned int id, const TRACE_HIST *hist)
+{
+	char label[32];
+
+	if(name)
+		sprintf(label, "%.31s", name);
+	else
+		sprintf(label, "0x%02X", id);
+	fprintf(out, "%-16s %8lu %10.1f %10llu %10llu %10llu %10llu %10llu\n", label, hist->count, (double)hist->total/hist->count,
+		trace_percentile(hist, 50.0), trace_percentile(hist, 90.0), trace_percentile(hist, 99.0), trace_percentile(hist, 99.9), hist->max);
+}
+
+void trace_report(FILE *out)
+{
+	fprintf(out, "---------------------------- Latency (us) ----------------------------\n");
+	fprintf(out, "%-16s %8s %10s %10s %10s %10s %10s %10s\n", "", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for(unsigned int i = 0; i < TRACE_MAX_COMMANDS; i++) {
+		if(g_cmdhist[i].count)
+			trace_reportline(out, g_cmdname[i], i, &g_cmdhist[i]);
+	}
+	for(unsigned int i = 0; i < TRACE_MAX_PHASES; i++) {
+		if(g_phasehist[i].count)
+			trace_reportline(out, g_phasename[i], i, &g_phasehist[i]);
+	}
+	fprintf(out, "----------------------------------------------------------------------\n");
+}
+
+int trace_export(const char *filename)
+{
+	unsigned long first, i;
+	trace_event *event;
+	FILE *file;
+
+	if(filename==NULL)
+		return TRACE_ERR_ARGUMENT;
+
+	file = fopen(filename, "w");
+	if(file==NULL)
+		return TRACE_ERR_FILE;
+
+	// the ring holds the last TRACE_MAX_EVENTS events
+	first = g_nbevents>TRACE_MAX_EVENTS ? g_nbevents-TRACE_MAX_EVENTS : 0;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for(i = first; i < g_nbevents; i++) {
+		event = &g_events[i%TRACE_MAX_EVENTS];
+		fprintf(file, "%s{\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu,", i==first ? "" : ",\n", event->ts, event->dur);
+		if(event->phase==TRACE_NO_PHASE) {
+			if(g_cmdname[event->cmd])
+				fprintf(file, "\"cat\":\"command\",\"name\":\"%s\"", g_cmdname[event->cmd]);
+			else
+				fprintf(file, "\"cat\":\"command\",\"name\":\"0x%02X\"", event->cmd);
+		}
+		else {
+			if(g_phasename[event->phase])
+				fprintf(file, "\"cat\":\"phase\",\"name\":\"%s\"", g_phasename[event->phase]);
+			else
+				fprintf(file, "\"cat\":\"phase\",\"name\":\"%u\"", event->phase);
+		}
+		fprintf(file, ",\"args\":{\"cmd\":%u}}", event->cmd);
+	}
+	fprintf(file, "\n]}\n");
+
+	if(fclose(file)!=0)
+		return TRACE_ERR_FILE;
+
+	return TRACE_ERR_OK;
+}
@@ -0,0 +1,176 @@
+//////////////////////////////////////////////////////////////////////////////////////////////////
+///@file trace.h
+///@author Pankil Butala (MCL, BU)
+///\brief trace module measures the latency of the server commands (header)
+///
+/// Every command served over the socket is traced as a span made of consecutive phases ( socket
+/// receive, router configuration, data transfer, ... ). The duration of each phase and of each
+/// command is recorded into a log-linear ( HDR style ) histogram with 6.25% precision, and as
+/// an event in a ring buffer that trace_export() writes as a Chrome trace ( chrome://tracing ).
+/// Timestamps are monotonic, in microseconds since trace_init().
+///
+/// The module is meant for the server thread, it is not thread safe.
+//////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stdio.h>
+
+/* defines */
+#define TRACE_MAX_PHASES		16									/*!< Number of phase IDs, 0..TRACE_MAX_PHASES-1 */
+#define TRACE_MAX_COMMANDS		256									/*!< Number of command IDs, one per command byte */
+#define TRACE_MAX_EVENTS		65536								/*!< Events kept for trace_export(), the oldest are overwritten */
+#define TRACE_HIST_SUBBITS		5									/*!< 2^(TRACE_HIST_SUBBITS-1) sub-buckets per power of two, 1/2^(TRACE_HIST_SUBBITS-1) precision */
+#define TRACE_HIST_MAXBITS		40									/*!< Durations are clamped to 2^TRACE_HIST_MAXBITS-1 us */
+#define TRACE_HIST_BUCKETS		(((TRACE_HIST_MAXBITS-TRACE_HIST_SUBBITS)+2)<<(TRACE_HIST_SUBBITS-1))	/*!< Counters per histogram */
+
+/**
+ * Log-linear latency histogram, values in microseconds.
+ */
+typedef struct {
+	unsigned long count;							/*!< number of values recorded */
+	unsigned long long total;						/*!< sum of the values recorded */
+	unsigned long long min;							/*!< smallest value recorded */
+	unsigned long long max;							/*!< largest value recorded */
+	unsigned long counts[TRACE_HIST_BUCKETS];		/*!< values recorded per bucket */
+} TRACE_HIST;
+
+/**
+ * One command being traced, see trace_start().
+ */
+typedef struct {
+	unsigned char cmd;								/*!< command byte */
+	unsigned long long start;						/*!< beginning of the command */
+	unsigned long long last;						/*!< end of the last phase */
+} TRACE_SPAN;
+
+/* error codes */
+#define TRACE_ERR_OK			0					/*!< No error encountered during execution. */
+#define TRACE_ERR_FILE			-1					/*!< The trace file could not be written. */
+#define TRACE_ERR_ARGUMENT		-2					/*!< An argument is NULL or out of range. */
+
+// C++ "helper"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reset all histograms and events, the timestamps restart from 0.
+ */
+void trace_init(void);
+
+/**
+ * Obtain a monotonic timestamp.
+ *
+ * @return  microseconds since trace_init().
+ */
+unsigned long long trace_now(void);
+
+/**
+ * Name a command in the report and in the exported trace, unnamed commands are shown by their value.
+ *
+ * @param	cmd	command byte.
+ * @param	name	string kept by pointer, it has to stay valid.
+ */
+void trace_namecommand(unsigned char cmd, const char *name);
+
+/**
+ * Name a phase in the report and in the exported trace, unnamed phases are shown by their ID.
+ *
+ * @param	phase	phase ID, 0..TRACE_MAX_PHASES-1.
+ * @param	name	string kept by pointer, it has to stay valid.
+ */
+void trace_namephase(unsigned int phase, const char *name);
+
+/**
+ * Start tracing a command.
+ *
+ * @param	span	span receiving the command.
+ * @param	cmd	command byte.
+ * @param	start	beginning of the command, usually the trace_now() taken when its first byte arrived.
+ */
+void trace_start(TRACE_SPAN *span, unsigned char cmd, unsigned long long start);
+
+/**
+ * End the current phase of a command, the phase lasted from the end of the previous one ( or the beginning of the command )
+ * until now.
+ *
+ * @param	span	span started by trace_start().
+ * @param	phase	phase ID, 0..TRACE_MAX_PHASES-1.
+ */
+void trace_mark(TRACE_SPAN *span, unsigned int phase);
+
+/**
+ * End a command and record its total duration.
+ *
+ * @param	span	span started by trace_start().
+ */
+void trace_end(TRACE_SPAN *span);
+
+/**
+ * Record a value into a histogram. The histograms owned by the caller are not shared with this module, a thread may
+ * record into its own histograms while the server thread traces its commands.
+ *
+ * @param	hist	histogram, cleared with memset() before the first value.
+ * @param	value	value in microseconds.
+ */
+void trace_histadd(TRACE_HIST *hist, unsigned long long value);
+
+/**
+ * Add all the values recorded into a histogram to another one.
+ *
+ * @param	dst	histogram receiving the values.
+ * @param	src	histogram left unchanged.
+ */
+void trace_histmerge(TRACE_HIST *dst, const TRACE_HIST *src);
+
+/**
+ * Obtain a percentile of a histogram. The value returned is the highest value equivalent to the bucket holding the
+ * percentile, it is at most 1/2^(TRACE_HIST_SUBBITS-1) ( 6.25% ) above the exact value.
+ *
+ * @param	hist	histogram.
+ * @param	percentile	0.0 to 100.0.
+ * @return  the percentile in microseconds, 0 for an empty histogram.
+ */
+unsigned long long trace_percentile(const TRACE_HIST *hist, double percentile);
+
+/**
+ * Obtain the histogram of a command.
+ *
+ * @param	cmd	command byte.
+ * @return  the histogram, never NULL.
+ */
+const TRACE_HIST *trace_gethistcommand(unsigned char cmd);
+
+/**
+ * Obtain the histogram of a phase.
+ *
+ * @param	phase	phase ID, 0..TRACE_MAX_PHASES-1.
+ * @return  the histogram, NULL when phase is out of range.
+ */
+const TRACE_HIST *trace_gethistphase(unsigned int phase);
+
+/**
+ * Print count, mean, p50, p90, p99, p99.9 and max of every command and phase that has been recorded.
+ *
+ * @param	out	stream receiving the report, stdout for the console.
+ */
+void trace_report(FILE *out);
+
+/**
+ * Write the events kept so far as a Chrome trace JSON file, commands and their phases are nested on a single track.
+ *
+ * @param	filename	path of the file to be written.
+ * @return  - TRACE_ERR_OK
+ *			- TRACE_ERR_FILE
+ *			- TRACE_ERR_ARGUMENT
+ */
+int trace_export(const char *filename);
+
+// C++ "helper"
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif //_TRACE_H_
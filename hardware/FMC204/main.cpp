@@ -63,6 +63,8 @@ static void DeleteFile(const char *filename)
 #include "i2cmaster.h"
 #include "fmc204.h"
 #include "ctgen.h"
+#include "trace.h"
+#include "dsp_resample.h"
 
 #define CONSTELLATION_ID_FM680	0x89			/*!< firmware(constellation) ID for FM680-FMC204 is 137 */
 #define CONSTELLATION_ID_VP680	0x99			/*!< firmware(constellation) ID for VM680-FMC204 is 153 */
@@ -85,6 +87,21 @@ static void DeleteFile(const char *filename)
 #define BINARY					1				/*!< Save16BitArrayToFile() saves the samples as binary */
 #define TIMEOUTDMA				2000			/*!< DMA tiemout is 2 seconds (2000 ms) */
 
+// Latency trace phases, see trace_mark()
+enum
+{
+	PH_RECEIVE = 0,						/*!< socket receive of the command header and payload */
+	PH_RESAMPLE,						/*!< ResampleWaveform16() */
+	PH_PREPARE,							/*!< output file names */
+	PH_SAVEASCII,						/*!< Save16BitArrayToFile() ASCII */
+	PH_SAVEBIN,							/*!< Save16BitArrayToFile() BINARY */
+	PH_LOCK,							/*!< wait for the transport held by the telemetry sampler or the stream feeder */
+	PH_ROUTER,							/*!< sxdx_configurerouter() */
+	PH_PREPAREWFM,						/*!< FMC204_ctrl_prepare_wfm_load() */
+	PH_WRITEDATA,						/*!< sipif_writedata() */
+	PH_HANDLE,							/*!< whole handling of the other commands */
+};
+
 
 //#define LOADFROMFILE						/*!< Application does not generate buffer but read it from file using GetBufferFromFile() */
 //#define BUFFERFILENAME "ST_25MHz-0dB.txt"	/*!< "path to the DAC buffer file */
@@ -289,6 +306,214 @@ static ULONG Save16BitArrayToFile(void *buf, int bufsize, const char *filename,
 
 
 
+/**
+ *  Translate a channel of the socket interface ( CHNL_1 to CHNL_4 ) into the DAC number and the S1D5 router value that routes
+ *  the data path to the waveform memory of that DAC.
+ *
+ *  @param chnl	channel as received in the IDX_CHNL byte of a command.
+ *  @param dacchannel	pointer receiving DAC0, DAC1, DAC2 or DAC3.
+ *  @param routerValue	pointer receiving the value for sxdx_configurerouter().
+ *  @return 
+ *						- -1 ( Unknown channel )
+ *						- 0 ( Success )
+ */
+static int GetChannelRoute(unsigned char chnl, unsigned int *dacchannel, unsigned long long *routerValue)
+{
+	switch(chnl){
+	case CHNL_1: 
+		*dacchannel = DAC0; 
+	#ifdef WIN32
+		*routerValue = 0xFFFFFFFFFFFFFF00;
+	#else
+		*routerValue = 0xFFFFFFFFFFFFFF00ULL;
+	#endif
+		break;
+	case CHNL_2: 
+		*dacchannel = DAC1; 
+	#ifdef WIN32
+		*routerValue = 0xFFFFFFFFFFFF00FF;
+	#else
+		*routerValue = 0xFFFFFFFFFFFF00FFULL;
+	#endif
+		break;
+	case CHNL_3:
+		*dacchannel = DAC2; 
+	#ifdef WIN32
+		*routerValue = 0xFFFFFFFFFF00FFFF;
+	#else
+		*routerValue = 0xFFFFFFFFFF00FFFFULL;
+	#endif
+		break;
+	case CHNL_4: 
+		*dacchannel = DAC3; 
+	#ifdef WIN32
+		*routerValue = 0xFFFFFFFF00FFFFFF;
+	#else
+		*routerValue = 0xFFFFFFFF00FFFFFFULL;
+	#endif
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+
+
+/**
+ *  Send the stream status reply ( STS_LEN bytes, see FMC204_IF.h ) answering a CMD_STRMxxx command. The reply carries the
+ *  credit the client has left as well as the played, underrun, late and overflow counters.
+ *
+ *  @param client	socket connected to the client.
+ *  @param cmd	command being answered.
+ *  @param err	0 if the command was accepted, any negative FMC204_STREAM_ERR_xxx code otherwise. An accepted command is
+ *				answered with FMC204_STREAM_ERR_STOPPED once the feeder thread has stopped on a failed upload.
+ *  @return 
+ *						- SOCKET_ERROR ( Could not send the reply )
+ *						- STS_LEN ( Success )
+ */
+static int SendStreamStatus(SOCKET client, unsigned char cmd, int err)
+{
+	FMC204_STREAM_STATUS status;
+	unsigned char sts[STS_LEN];
+	unsigned long counters[4];
+
+	FMC204_stream_getstatus(&status);
+	if(err==FMC204_STREAM_ERR_OK && status.error!=SIPIF_ERR_OK)
+		err = FMC204_STREAM_ERR_STOPPED;
+	counters[0] = status.frames;
+	counters[1] = status.underruns;
+	counters[2] = status.late;
+	counters[3] = status.overflows;
+
+	sts[IDX_STS_CMD] = cmd;
+	sts[IDX_STS_ERR] = (unsigned char)(-err);
+	sts[IDX_STS_CREDITS+0] = (unsigned char)(status.credits>>0);
+	sts[IDX_STS_CREDITS+1] = (unsigned char)(status.credits>>8);
+	for(int i = 0; i < 4; i++) {
+		for(int j = 0; j < 4; j++)
+			sts[IDX_STS_FRAMES+4*i+j] = (unsigned char)(counters[i]>>(8*j));
+	}
+
+	return send(client, (const char *)sts, STS_LEN, 0);
+}
+
+/**
+ *  Tear the stream down once its feeder thread has stopped on a failed upload, the DAC is disarmed and the queue released.
+ *  The failure is reported by the following stream status replies.
+ *
+ *  @param streaming	STREAMING flag of the server, cleared when the stream is torn down.
+ */
+static void CheckStream(bool *streaming)
+{
+	FMC204_STREAM_STATUS status;
+
+	if(!*streaming)
+		return;
+	FMC204_stream_getstatus(&status);
+	if(status.running)
+		return;
+	printf("Stream stopped by error %d, tearing it down\n", status.error);
+	FMC204_stream_stop();
+	*streaming = false;
+}
+
+/**
+ *  Send the telemetry reply ( TLM_LEN bytes, see FMC204_IF.h ) answering CMD_TELEMETRY. The reply is built from the latest
+ *  snapshot published by the telemetry sampler, the hardware is not accessed.
+ *
+ *  @param client	socket connected to the client.
+ *  @return 
+ *						- SOCKET_ERROR ( Could not send the reply )
+ *						- TLM_LEN ( Success )
+ */
+static int SendTelemetry(SOCKET client)
+{
+	FMC204_TELEMETRY snapshot;
+	unsigned char tlm[TLM_LEN];
+	unsigned long counters[4];
+	float values[TLM_NBVAL];
+	unsigned int dword;
+	int n = 0;
+
+	FMC204_telemetry_get(&snapshot);
+	counters[0] = snapshot.sequence;
+	counters[1] = snapshot.sequence ? GetTickCount()-snapshot.timestamp : 0;
+	counters[2] = snapshot.deferred;
+	counters[3] = (unsigned long)snapshot.source;
+
+	values[n++] = snapshot.temperature;
+	for(int i = 0; i < I2CMASTER_FMC204_NB_VOLTAGES; i++)
+		values[n++] = snapshot.voltage[i];
+	for(int i = 0; i < FMC204_TELEMETRY_NB_CLOCKS; i++)
+		values[n++] = snapshot.frequency[i];
+
+	tlm[IDX_TLM_CMD] = CMD_TELEMETRY;
+	tlm[IDX_TLM_ERR] = (unsigned char)(-snapshot.error);
+	tlm[IDX_TLM_NBVAL+0] = (unsigned char)(TLM_NBVAL>>0);
+	tlm[IDX_TLM_NBVAL+1] = (unsigned char)(TLM_NBVAL>>8);
+	for(int i = 0; i < 4; i++) {
+		for(int j = 0; j < 4; j++)
+			tlm[IDX_TLM_SEQ+4*i+j] = (unsigned char)(counters[i]>>(8*j));
+	}
+	for(int i = 0; i < TLM_NBVAL; i++) {
+		memcpy(&dword, &values[i], sizeof(dword));
+		for(int j = 0; j < 4; j++)
+			tlm[IDX_TLM_VALUES+4*i+j] = (unsigned char)(dword>>(8*j));
+	}
+
+	return send(client, (const char *)tlm, TLM_LEN, 0);
+}
+
+
+
+/**
+ *  Bring a waveform uploaded at another clock to the DAC clock, in place. The samples are resampled with dsp_resample_frame()
+ *  and the result is truncated or padded with zeros to the burst size.
+ *
+ *  @param rs	resampler configured by CMD_RESAMPLE.
+ *  @param buffer	pointer to the received samples, receives the resampled burst. This point to a previously allocated memory
+ *					as big as numbersamples*2 ( byte size ).
+ *  @param nin	number of samples received.
+ *  @param numbersamples	burst size, samples.
+ *  @param nout	pointer receiving the number of samples produced by the resampler, before the padding.
+ *  @return 
+ *						- DSP_RESAMPLE_ERR_ALLOC ( Could not allocate the float samples, the buffer is left as received )
+ *						- any other negative DSP_RESAMPLE_ERR_xxx code returned by dsp_resample_frame()
+ *						- 0 ( Success )
+ */
+static int ResampleWaveform16(DSP_RESAMPLE *rs, short *buffer, unsigned int nin, unsigned int numbersamples, unsigned int *nout)
+{
+	float *in = (float *)malloc((nin ? nin : 1)*sizeof(float));
+	float *out = (float *)malloc((numbersamples ? numbersamples : 1)*sizeof(float));
+	float y;
+	int err;
+
+	*nout = 0;
+	if(!in || !out) {
+		free(in);
+		free(out);
+		 return DSP_RESAMPLE_ERR_ALLOC;
+	}
+
+	for(unsigned int i = 0; i < nin; i++)
+		in[i] = buffer[i];
+	err = dsp_resample_frame(rs, in, nin, out, numbersamples, nout);
+	if(err==DSP_RESAMPLE_ERR_OK) {
+		// the filter may overshoot a full scale waveform, round and saturate
+		for(unsigned int i = 0; i < numbersamples; i++) {
+			y = i < *nout ? (float)floor(out[i]+0.5f) : 0.0f;
+			buffer[i] = y > 32767.0f ? 32767 : (y < -32768.0f ? -32768 : (short)y);
+		}
+	}
+
+	free(in);
+	free(out);
+	 return err;
+}
+
+
+
 /**
  *  \brief FMC204 Reference application (main).
  *
@@ -305,12 +530,17 @@ static ULONG Save16BitArrayToFile(void *buf, int bufsize, const char *filename,
  *	- Display FMC204 diagnostics using i2cmaster_getdiagnosticsFMC204().
  *  - If ML605 constellation is found in the hardware, we configure the clock trigger generation module (in external clock mode only).
  *	- Init all the FMC204 peripherals using FMC204_init().
- *	- Display all the freqencies part of the frequency tree using FMC204_freqcnt_getfrequency().
+ *	- Display all the freqencies part of the frequency tree using FMC204_freqcnt_sweep().
  *	- Configure burst size and burst number ( common for both ADC and DAC chips ) using FMC204_ctrl_configure_burst().
  *	- Generate a waveform and upload waveform to DAC0 using GenerateWaveform16(), sxdx_configurerouter(), FMC204_ctrl_prepare_wfm_load() and sipif_writedata() part of ethapi.
  *	- Generate a waveform and upload waveform to DAC1 using GenerateWaveform16(), sxdx_configurerouter(), FMC204_ctrl_prepare_wfm_load() and sipif_writedata() part of ethapi.
  *	- Generate a waveform and upload waveform to DAC2 using GenerateWaveform16(), sxdx_configurerouter(), FMC204_ctrl_prepare_wfm_load() and sipif_writedata() part of ethapi.
  *	- Generate a waveform and upload waveform to DAC3 using GenerateWaveform16(), sxdx_configurerouter(), FMC204_ctrl_prepare_wfm_load() and sipif_writedata() part of ethapi.
+ *	- Start sampling voltages, temperatures and frequencies in the background using FMC204_telemetry_start().
+ *	- Serve waveform uploads received over the socket, either one at a time ( CMD_DATA ) or as a continuous stream fed by FMC204_stream_start().
+ *	- Once configured by CMD_RESAMPLE, bring the CMD_DATA waveforms to the DAC clock using ResampleWaveform16() before the upload.
+ *	- Answer CMD_TELEMETRY with the latest snapshot obtained by FMC204_telemetry_get().
+ *	- Trace the latency of every command and phase, print the histograms using trace_report() and save the session as a Chrome trace using trace_export().
 
  *  @param argc the command line
  *  @param argv the number of options in the command line.
@@ -515,19 +745,26 @@ int main(int argc, char* argv[])
 	// Note that the first frequencies (ADC clocks) are going to display erroneous values if no
 	// FMC is actually attached.
 	printf("\n--- Measuring on-board frequencies ---\n");
-	for(int i = 0; i < 4; i++) {
-		if(FMC204_freqcnt_getfrequency(AddrSipFMC204FreqCnt, i, NULL, FMC204_FREQCNT_DISPLAY_CONSOLE)!=FMC204_FREQCNT_ERR_OK) {
-			printf("Could not obtain frequency id%d from FMC204.FREQCNT\n", i);
-			sipif_free();
-			 return -12;
-		}
+	FMC204_FREQCNT_SWEEP sweep;
+	if(FMC204_freqcnt_sweep(AddrSipFMC204FreqCnt, FMC204_FREQCNT_ALL_CLOCKS, &sweep, FMC204_FREQCNT_DISPLAY_CONSOLE)!=FMC204_FREQCNT_ERR_OK) {
+		printf("Could not obtain frequencies from FMC204.FREQCNT\n");
+		sipif_free();
+		 return -12;
 	}
     printf("--------------------------------------\n\n");
 
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Keep sampling voltages, temperatures and frequencies in the background, the server answers CMD_TELEMETRY from the
+	// latest snapshot. From now on every hardware access of this thread is done under sipif_lock().
+	if(FMC204_telemetry_start(AddrTempMon, AddrSipFMC204FreqCnt, FMC204_TELEMETRY_PERIOD_MS)!=FMC204_TELEMETRY_ERR_OK)
+		printf("Could not start the telemetry sampler, CMD_TELEMETRY will not report any snapshot\n");
+
 	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Configure burst size and burst number
 	int BurstSize    = 0;			// samples
-	unsigned char *CMDFRM = (unsigned char *)_aligned_malloc(PRELIM_LEN, 4096);
+	// command payload, a header announcing more than CMDSIZE bytes is rejected and its payload dropped
+	unsigned char *CMDFRM = (unsigned char *)_aligned_malloc(RSP_LEN, 4096);
+	unsigned int CMDSIZE = RSP_LEN;	// bytes of CMDFRM, RSP_LEN until CMD_BURSTSIZE, 2*BurstSize at least afterwards
 
 	char dirCurrent[1024];
 	GetModuleFileName(NULL,dirCurrent,1024);
@@ -593,6 +830,8 @@ int main(int argc, char* argv[])
 	bool FLG_PRELIM0_DATA1 = false;
 	unsigned int BYTECOUNT = 0;
 	unsigned int DATALENGTH = PRELIM_LEN;
+	unsigned int DRAINCOUNT = 0;
+	unsigned int MAXLENGTH = 0;
 	unsigned char DATACHNL = 0;
 	unsigned char DATACMD = 0;
 	int iResult;
@@ -603,28 +842,95 @@ int main(int argc, char* argv[])
 	unsigned int *pITER;
 	unsigned int chnlNum = 0;
 	unsigned long long routerValue = 0;
+	bool STREAMING = false;
+	int streamErr;
+	unsigned long long rxstart = 0;
+	TRACE_SPAN span;
+	DSP_RESAMPLE resampler;
+	bool RESAMPLING = false;
+	unsigned int rspClkIn = 0;
+	unsigned int rspClkOut = 0;
+	unsigned int rspOut;
+
+	memset(&resampler, 0, sizeof(resampler));
+
+	// every command is traced from its first byte on
+	trace_init();
+	trace_namecommand(CMD_BURSTSIZE, "CMD_BURSTSIZE");
+	trace_namecommand(CMD_DATA, "CMD_DATA");
+	trace_namecommand(CMD_ENCHNL, "CMD_ENCHNL");
+	trace_namecommand(CMD_ARMDAC, "CMD_ARMDAC");
+	trace_namecommand(CMD_STRMSTART, "CMD_STRMSTART");
+	trace_namecommand(CMD_STRMFRAME, "CMD_STRMFRAME");
+	trace_namecommand(CMD_STRMSTATUS, "CMD_STRMSTATUS");
+	trace_namecommand(CMD_STRMSTOP, "CMD_STRMSTOP");
+	trace_namecommand(CMD_TELEMETRY, "CMD_TELEMETRY");
+	trace_namecommand(CMD_RESAMPLE, "CMD_RESAMPLE");
+	trace_namephase(PH_RECEIVE, "receive");
+	trace_namephase(PH_RESAMPLE, "resample");
+	trace_namephase(PH_PREPARE, "prepare");
+	trace_namephase(PH_SAVEASCII, "save ascii");
+	trace_namephase(PH_SAVEBIN, "save binary");
+	trace_namephase(PH_LOCK, "lock");
+	trace_namephase(PH_ROUTER, "router");
+	trace_namephase(PH_PREPAREWFM, "prepare wfm");
+	trace_namephase(PH_WRITEDATA, "writedata");
+	trace_namephase(PH_HANDLE, "handle");
+
 	// Get burst size
 	printf("Server online...\n");
 	do{
-		iResult = recv(client, ((char*)CMDFRM)+BYTECOUNT, DATALENGTH-BYTECOUNT, 0);
+		if(DRAINCOUNT) {
+			// the payload of a rejected command is read and dropped, the next header follows it
+			iResult = recv(client, (char*)CMDFRM, DRAINCOUNT<CMDSIZE ? DRAINCOUNT : CMDSIZE, 0);
+			if(iResult > 0) {
+				DRAINCOUNT -= iResult;
+				continue;
+			}
+		}
+		else
+			iResult = recv(client, ((char*)CMDFRM)+BYTECOUNT, DATALENGTH-BYTECOUNT, 0);
+		if(iResult > 0 && BYTECOUNT == 0 && !FLG_PRELIM0_DATA1)
+			rxstart = trace_now();
 		BYTECOUNT+=iResult;
 		if(iResult > 0) {
 			if(BYTECOUNT == DATALENGTH){
 				if(FLG_PRELIM0_DATA1){
+					trace_start(&span, DATACMD, rxstart);
+					trace_mark(&span, PH_RECEIVE);
+					// the feeder thread owns the waveform memory while streaming
+					CheckStream(&STREAMING);
+					if(STREAMING && (DATACMD==CMD_BURSTSIZE || DATACMD==CMD_DATA)) {
+						printf("Ignoring command 0x%02X while streaming\n", DATACMD);
+						DATACMD = 0;
+					}
 					switch(DATACMD){
 					case CMD_BURSTSIZE:
 						BurstSize = (CMDFRM[1]<<8) + CMDFRM[0];
 						printf("Setting BurstSize = %d\n",BurstSize);
 						// Configure Burst Size
-						if(FMC204_ctrl_configure_burst(AddrSipFMC204Ctrl, 1, BurstSize)!=FMC204_CTRL_ERR_OK) {
+						sipif_lock();
+						rc = FMC204_ctrl_configure_burst(AddrSipFMC204Ctrl, 1, BurstSize);
+						sipif_unlock();
+						if(rc!=FMC204_CTRL_ERR_OK) {
 							printf("Could not configure burst size/length in FMC204.CTRL\n ");
 							sipif_free();
 							 return -13;
 						}
 						_aligned_free(CMDFRM);
-						CMDFRM = (unsigned char *)_aligned_malloc(((2*BurstSize)>PRELIM_LEN?(2*BurstSize):PRELIM_LEN), 4096);
+						CMDSIZE = (2*BurstSize)>RSP_LEN?(2*BurstSize):RSP_LEN;
+						CMDFRM = (unsigned char *)_aligned_malloc(CMDSIZE, 4096);
 						break;
 					case CMD_DATA:
+						// samples uploaded at another clock are brought to the DAC clock, the burst is always BurstSize samples
+						if(RESAMPLING) {
+							rc = ResampleWaveform16(&resampler, (short *)CMDFRM, DATALENGTH/2, BurstSize, &rspOut);
+							if(rc!=DSP_RESAMPLE_ERR_OK)
+								printf("Could not resample the waveform (error %d), uploading it as received\n", rc);
+							else if(rspOut!=(unsigned int)BurstSize)
+								printf("Resampled waveform has %u samples, burst size is %d\n", rspOut, BurstSize);
+							trace_mark(&span, PH_RESAMPLE);
+						}
 						switch(DATACHNL){
 						case CHNL_1: 
 							pITER = &ITER1; 
@@ -672,8 +978,14 @@ int main(int argc, char* argv[])
 
 						DeleteFile(filenamebin);
 						DeleteFile(filenameascii);
+						trace_mark(&span, PH_PREPARE);
 						Save16BitArrayToFile(CMDFRM, BurstSize, filenameascii, ASCII);
+						trace_mark(&span, PH_SAVEASCII);
 						Save16BitArrayToFile(CMDFRM, BurstSize, filenamebin, BINARY);
+						trace_mark(&span, PH_SAVEBIN);
+						// the upload sequence belongs together, the telemetry sampler waits meanwhile
+						sipif_lock();
+						trace_mark(&span, PH_LOCK);
 						// configure the router ( route data to DAC0's wave form memory )
 					#ifdef WIN32
 						if(sxdx_configurerouter(AddrSipRouterS1D5, routerValue)!=SXDXROUTER_ERR_OK) {
@@ -684,25 +996,86 @@ int main(int argc, char* argv[])
 							sipif_free();
 							 return -15;
 						}
+						trace_mark(&span, PH_ROUTER);
 						// prepare the firmware to receive waveform data
 						if(FMC204_ctrl_prepare_wfm_load(AddrSipFMC204Ctrl, chnlNum)!=FMC204_CTRL_ERR_OK) {
 							printf("Could not prepare waveform upload, exiting\n");
 							sipif_free();
 							 return -16;
 						}
+						trace_mark(&span, PH_PREPAREWFM);
 						// send the data to the waveform memory
 						if(sipif_writedata  (CMDFRM,  2*BurstSize)!=SIPIF_ERR_OK) {
 							printf("Could not communicate with device %d.\n", devIdx);
 							sipif_free();
 							 return -17;
 						}
+						sipif_unlock();
+						trace_mark(&span, PH_WRITEDATA);
 						*pITER++;
 						
 						printf("Send data to channel %d\n",chnlNum);
 						break;
+					case CMD_STRMSTART:
+						// period in ms and queue depth, the frames are 2*BurstSize bytes
+						streamErr = FMC204_STREAM_ERR_ARGUMENT;
+						if(DATALENGTH!=STRM_LEN)
+							printf("Incorrect stream configuration length (%d)\n", DATALENGTH);
+						else if(!STREAMING && BurstSize>0 && GetChannelRoute(DATACHNL, &chnlNum, &routerValue)==0) {
+							sipif_lock();
+							rc = sxdx_configurerouter(AddrSipRouterS1D5, routerValue);
+							sipif_unlock();
+							if(rc!=SXDXROUTER_ERR_OK) {
+								printf("Could not configure S1D5 router, exiting\n");
+								sipif_free();
+								 return -15;
+							}
+							streamErr = FMC204_stream_start(AddrSipFMC204Ctrl, chnlNum, 2*BurstSize, CMDFRM[IDX_STRM_DEPTH],
+								(CMDFRM[IDX_STRM_PERIOD+1]<<8) + CMDFRM[IDX_STRM_PERIOD]);
+						}
+						else if(STREAMING)
+							streamErr = FMC204_STREAM_ERR_RUNNING;
+						if(streamErr==FMC204_STREAM_ERR_OK) {
+							STREAMING = true;
+							printf("Streaming to channel %d every %d ms\n", chnlNum, (CMDFRM[IDX_STRM_PERIOD+1]<<8) + CMDFRM[IDX_STRM_PERIOD]);
+						}
+						else
+							printf("Could not start streaming (error %d)\n", streamErr);
+						SendStreamStatus(client, CMD_STRMSTART, streamErr);
+						break;
+					case CMD_STRMFRAME:
+						streamErr = FMC204_stream_push(CMDFRM, DATALENGTH);
+						SendStreamStatus(client, CMD_STRMFRAME, streamErr);
+						break;
+					case CMD_RESAMPLE:
+						if(DATALENGTH!=RSP_LEN) {
+							printf("Incorrect resampling configuration length (%d)\n", DATALENGTH);
+							break;
+						}
+						dsp_resample_free(&resampler);
+						RESAMPLING = false;
+						rspClkIn = CMDFRM[IDX_RSP_CLKIN] | (CMDFRM[IDX_RSP_CLKIN+1]<<8) | (CMDFRM[IDX_RSP_CLKIN+2]<<16) | (CMDFRM[IDX_RSP_CLKIN+3]<<24);
+						rspClkOut = CMDFRM[IDX_RSP_CLKOUT] | (CMDFRM[IDX_RSP_CLKOUT+1]<<8) | (CMDFRM[IDX_RSP_CLKOUT+2]<<16) | (CMDFRM[IDX_RSP_CLKOUT+3]<<24);
+						if(CMDFRM[IDX_RSP_MODE]==RESAMPLE_OFF) {
+							printf("Waveform resampling disabled\n");
+							break;
+						}
+						rc = dsp_resample_init(&resampler, rspClkIn, rspClkOut, CMDFRM[IDX_RSP_FILTER]);
+						if(rc!=DSP_RESAMPLE_ERR_OK || CMDFRM[IDX_RSP_MODE]!=RESAMPLE_ON) {
+							printf("Incorrect resampling configuration (mode %d, filter %d, error %d), resampling disabled\n",
+								CMDFRM[IDX_RSP_MODE], CMDFRM[IDX_RSP_FILTER], rc);
+							dsp_resample_free(&resampler);
+							break;
+						}
+						RESAMPLING = true;
+						printf("Resampling waveforms from %u Hz to %u Hz ( x%u/%u )\n", rspClkIn, rspClkOut, resampler.usf, resampler.dsf);
+						break;
 					default:
 						break;
 					}
+					if(DATACMD!=CMD_DATA)
+						trace_mark(&span, PH_HANDLE);
+					trace_end(&span);
 					DATALENGTH = PRELIM_LEN;
 					FLG_PRELIM0_DATA1 = false;
 				}
@@ -713,10 +1086,31 @@ int main(int argc, char* argv[])
 					DATACHNL = CMDFRM[IDX_CHNL];
 					// Get Command Length
 					DATALENGTH = (CMDFRM[IDX_LENMSB]<<8) + CMDFRM[IDX_LENLSB];
-					if (DATALENGTH == 0){
+					// CMDFRM holds CMDSIZE bytes and a waveform 2*BurstSize bytes at most, resampled or not
+					MAXLENGTH = DATACMD==CMD_DATA ? 2*BurstSize : CMDSIZE;
+					if (DATALENGTH > MAXLENGTH){
+						printf("Incorrect length (%d) of command 0x%02X, %d bytes at most, payload dropped\n", DATALENGTH, DATACMD, MAXLENGTH);
+						if(DATACMD==CMD_STRMFRAME)
+							SendStreamStatus(client, CMD_STRMFRAME, FMC204_STREAM_ERR_ARGUMENT);
+						DRAINCOUNT = DATALENGTH;
+						DATALENGTH = PRELIM_LEN;
+						FLG_PRELIM0_DATA1 = false;
+					}
+					else if (DATALENGTH == 0){
+						trace_start(&span, DATACMD, rxstart);
+						trace_mark(&span, PH_RECEIVE);
+						// the feeder thread owns the DAC while streaming
+						CheckStream(&STREAMING);
+						if(STREAMING && (DATACMD==CMD_ENCHNL || DATACMD==CMD_ARMDAC)) {
+							printf("Ignoring command 0x%02X while streaming\n", DATACMD);
+							DATACMD = 0;
+						}
 						switch(DATACMD){
 							case CMD_ENCHNL:
-								if(FMC204_ctrl_enable_channel(AddrSipFMC204Ctrl, ENABLED, DISABLED, DISABLED, ENABLED)!=FMC204_CTRL_ERR_OK) {
+								sipif_lock();
+								rc = FMC204_ctrl_enable_channel(AddrSipFMC204Ctrl, ENABLED, DISABLED, DISABLED, ENABLED);
+								sipif_unlock();
+								if(rc!=FMC204_CTRL_ERR_OK) {
 									printf("Could not enable, exiting\n");
 									sipif_free();
 									 return -26;
@@ -725,16 +1119,33 @@ int main(int argc, char* argv[])
 								break;
 							case CMD_ARMDAC:
 								// arm the DAC
-								if(FMC204_ctrl_arm_dac(AddrSipFMC204Ctrl)!=FMC204_CTRL_ERR_OK) {
+								sipif_lock();
+								rc = FMC204_ctrl_arm_dac(AddrSipFMC204Ctrl);
+								sipif_unlock();
+								if(rc!=FMC204_CTRL_ERR_OK) {
 									printf("Could not arm, exiting\n");
 									sipif_free();
 									 return -27;
 								}
 								printf("Arming channels\n");
 								break;
+							case CMD_STRMSTATUS:
+								SendStreamStatus(client, CMD_STRMSTATUS, FMC204_STREAM_ERR_OK);
+								break;
+							case CMD_STRMSTOP:
+								streamErr = FMC204_stream_stop();
+								STREAMING = false;
+								SendStreamStatus(client, CMD_STRMSTOP, streamErr);
+								printf("Stream stopped\n");
+								break;
+							case CMD_TELEMETRY:
+								SendTelemetry(client);
+								break;
 							default:
 								break;
 						}
+						trace_mark(&span, PH_HANDLE);
+						trace_end(&span);
 						DATALENGTH = PRELIM_LEN;
 						FLG_PRELIM0_DATA1 = false;
 					}
@@ -756,12 +1167,23 @@ int main(int argc, char* argv[])
 		}
 	} while(iResult > 0);
 	
+	if(STREAMING)
+		FMC204_stream_stop();
 	closesocket(server);
 	WSACleanup();
 
+	// latency of the session
+	trace_report(stdout);
+	strcpy(filename, dirCurrent);
+	strcat(filename, "\\trace.json");
+	if(trace_export(filename)==TRACE_ERR_OK)
+		printf("Session trace saved to %s ( open with chrome://tracing )\n", filename);
+
 	// Close the device
 	printf("\nEnd of program.\n\n\n");
+	FMC204_telemetry_stop();
 	sipif_free();
+	dsp_resample_free(&resampler);
 	//_aligned_free(BSData);
 	_aligned_free(CMDFRM);
 	//_aligned_free(pOutData);
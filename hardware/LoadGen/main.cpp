@@ -0,0 +1,455 @@
+/**
+@file main.cpp
+@author Pankil Butala (MCL, BU)
+@brief Load generator for the FMC116 and FMC204 socket servers
+*************************************************************************/
+
+
+// system includes
+#include <winsock2.h>
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// project includes
+#include "FMC204_IF.h"			// the command header and the command codes are the same in FMC116_IF.h
+#include "trace.h"
+
+#define BOARD_FMC116			116				/*!< {board} value of the FMC116 server */
+#define BOARD_FMC204			204				/*!< {board} value of the FMC204 server */
+#define PORT_FMC116				30002			/*!< SKT_PORT of FMC116_IF.h */
+#define PORT_FMC204				30001			/*!< SKT_PORT of FMC204_IF.h */
+
+#define MAX_CONNECTIONS			64				/*!< Connections driven at once */
+#define MAX_SERVERS				16				/*!< Addresses in {servers} */
+#define DEFAULT_BURSTSIZE		1024			/*!< Samples per CMD_DATA when {burst size} is not given */
+#define MAX_BURSTSIZE			32767			/*!< The FMC204 CMD_DATA payload length is 16 bit */
+#define TLM_MAX_NBVAL			64				/*!< Largest telemetry reply accepted */
+
+// Command mix
+#define MIX_BURSTSIZE			0				/*!< CMD_BURSTSIZE, fenced */
+#define MIX_DATA				1				/*!< CMD_DATA, answered by the FMC116 server, fenced on the FMC204 server */
+#define MIX_ENCHNL				2				/*!< CMD_ENCHNL, FMC204 only, fenced */
+#define MIX_ARMDAC				3				/*!< CMD_ARMDAC, FMC204 only, fenced */
+#define MIX_TELEMETRY			4				/*!< CMD_TELEMETRY, answered */
+#define MIX_NB					5				/*!< Number of command kinds */
+
+static const char *g_mixname[MIX_NB] = { "burstsize", "data", "enchnl", "armdac", "telemetry" };	/*!< {mix} names */
+static const unsigned char g_mixcmd[MIX_NB] = { CMD_BURSTSIZE, CMD_DATA, CMD_ENCHNL, CMD_ARMDAC, CMD_TELEMETRY };
+static const unsigned char g_chnl[4] = { CHNL_1, CHNL_2, CHNL_3, CHNL_4 };						/*!< CMD_DATA channels, used in turn */
+
+/**
+ * Settings shared by all connections.
+ */
+typedef struct {
+	int board;											/*!< BOARD_FMC116 or BOARD_FMC204 */
+	unsigned int weight[MIX_NB];						/*!< relative frequency of each command */
+	unsigned int weighttotal;							/*!< sum of weight */
+	unsigned int burstsize;								/*!< samples per CMD_DATA */
+	unsigned int nbconns;								/*!< number of connections */
+	unsigned long long intervalus;						/*!< time between two commands of one connection, 0 for maximum rate */
+	unsigned long long durationus;						/*!< length of the run */
+} loadgen_config;
+
+/**
+ * One connection and its results.
+ */
+typedef struct {
+	const loadgen_config *config;						/*!< settings */
+	unsigned int index;									/*!< connection number */
+	const char *address;								/*!< server address */
+	unsigned short port;								/*!< server port */
+	SOCKET sock;										/*!< connection to the server */
+	HANDLE hthread;										/*!< connection thread */
+	unsigned char *frame;								/*!< command and data buffer */
+	unsigned long long bytessent;						/*!< bytes sent to the server */
+	unsigned long long bytesreceived;					/*!< bytes received from the server */
+	unsigned long commands[MIX_NB];						/*!< commands completed */
+	unsigned long late;									/*!< commands sent after their scheduled time */
+	int error;											/*!< 0, or the socket error that ended the connection */
+	TRACE_HIST latency[MIX_NB];							/*!< completion latency per command kind */
+} loadgen_connection;
+
+
+/**
+ *  Send or receive a whole buffer.
+ *
+ *  @return 1 on success, 0 when the connection failed.
+ */
+static int SendAll(loadgen_connection *conn, const unsigned char *buf, unsigned int size)
+{
+	int rc;
+
+	while(size>0) {
+		rc = send(conn->sock, (const char *)buf, size, 0);
+		if(rc==SOCKET_ERROR || rc==0)
+			return 0;
+		buf += rc;
+		size -= rc;
+		conn->bytessent += rc;
+	}
+	return 1;
+}
+
+static int ReceiveAll(loadgen_connection *conn, unsigned char *buf, unsigned int size)
+{
+	int rc;
+
+	while(size>0) {
+		rc = recv(conn->sock, (char *)buf, size, 0);
+		if(rc==SOCKET_ERROR || rc==0)
+			return 0;
+		buf += rc;
+		size -= rc;
+		conn->bytesreceived += rc;
+	}
+	return 1;
+}
+
+/**
+ *  Send a command header, see FMC204_IF.h.
+ */
+static int SendHeader(loadgen_connection *conn, unsigned char cmd, unsigned char chnl, unsigned int length)
+{
+	unsigned char header[PRELIM_LEN];
+
+	header[IDX_CMD] = cmd;
+	header[IDX_CHNL] = chnl;
+	header[IDX_LENLSB] = (unsigned char)(length>>0);
+	header[IDX_LENMSB] = (unsigned char)(length>>8);
+	return SendAll(conn, header, PRELIM_LEN);
+}
+
+/**
+ *  Send CMD_TELEMETRY and receive the reply. The servers handle one command at a time, the reply therefore also marks the
+ *  completion of every command sent before ( this is how the commands without reply are timed ).
+ */
+static int Fence(loadgen_connection *conn)
+{
+	unsigned char tlm[IDX_TLM_VALUES+4*TLM_MAX_NBVAL];
+	unsigned int nbval;
+
+	if(!SendHeader(conn, CMD_TELEMETRY, 0, 0) || !ReceiveAll(conn, tlm, IDX_TLM_VALUES))
+		return 0;
+	nbval = tlm[IDX_TLM_NBVAL] + (tlm[IDX_TLM_NBVAL+1]<<8);
+	if(tlm[IDX_TLM_CMD]!=CMD_TELEMETRY || nbval>TLM_MAX_NBVAL)
+		return 0;
+	return ReceiveAll(conn, tlm+IDX_TLM_VALUES, 4*nbval);
+}
+
+/**
+ *  Run one command of the mix until its completion.
+ *
+ *  @return 1 on success, 0 when the connection failed.
+ */
+static int RunCommand(loadgen_connection *conn, unsigned int kind, unsigned char chnl)
+{
+	const loadgen_config *config = conn->config;
+	unsigned int size = 2*config->burstsize;
+
+	switch(kind) {
+	case MIX_BURSTSIZE:
+		conn->frame[0] = (unsigned char)(config->burstsize>>0);
+		conn->frame[1] = (unsigned char)(config->burstsize>>8);
+		return SendHeader(conn, CMD_BURSTSIZE, 0, 2) && SendAll(conn, conn->frame, 2) && Fence(conn);
+	case MIX_DATA:
+		// FMC116 sends a burst back, FMC204 receives a waveform
+		if(config->board==BOARD_FMC116)
+			return SendHeader(conn, CMD_DATA, chnl, 0) && ReceiveAll(conn, conn->frame, size);
+		return SendHeader(conn, CMD_DATA, chnl, size) && SendAll(conn, conn->frame, size) && Fence(conn);
+	case MIX_ENCHNL:
+	case MIX_ARMDAC:
+		return SendHeader(conn, g_mixcmd[kind], 0, 0) && Fence(conn);
+	default:
+		return Fence(conn);
+	}
+}
+
+static DWORD WINAPI ConnectionThread(LPVOID arg)
+{
+	loadgen_connection *conn = (loadgen_connection *)arg;
+	const loadgen_config *config = conn->config;
+	unsigned long long start, scheduled, now;
+	unsigned int seed = 0x9E3779B9*(conn->index+1);
+	unsigned int pick, kind, n = 0;
+
+	// every connection starts with the burst size, CMD_DATA depends on it
+	if(!RunCommand(conn, MIX_BURSTSIZE, 0)) {
+		conn->error = WSAGetLastError();
+		return 0;
+	}
+
+	// connections are spread over the interval so that the target rate is smooth
+	start = trace_now();
+	if(config->intervalus)
+		start += config->intervalus*conn->index/config->nbconns;
+	for(scheduled = start; scheduled-start < config->durationus; scheduled += config->intervalus) {
+		// pace, the latency is counted from the scheduled time so a stalled server is not hidden by the pacing
+		now = trace_now();
+		if(config->intervalus==0)
+			scheduled = now;
+		else if(now>scheduled)
+			conn->late++;
+		while(now<scheduled) {
+			if(scheduled-now>2000)
+				Sleep(1);
+			else
+				SwitchToThread();
+			now = trace_now();
+		}
+
+		// weighted pick
+		seed = seed*1103515245+12345;
+		pick = (seed>>8)%config->weighttotal;
+		for(kind = 0; pick>=config->weight[kind]; kind++)
+			pick -= config->weight[kind];
+
+		if(!RunCommand(conn, kind, g_chnl[n++&3])) {
+			conn->error = WSAGetLastError();
+			break;
+		}
+		trace_histadd(&conn->latency[kind], trace_now()-scheduled);
+		conn->commands[kind]++;
+	}
+
+	return 0;
+}
+
+/**
+ *  Parse the {mix} argument, a comma separated list of name:weight.
+ *
+ *  @return 0 on success, -1 when the mix is invalid for the board.
+ */
+static int ParseMix(const char *mix, loadgen_config *config)
+{
+	char name[32];
+	unsigned int weight;
+	int len, kind;
+
+	memset(config->weight, 0, sizeof(config->weight));
+	config->weighttotal = 0;
+	while(*mix) {
+		if(sscanf(mix, "%31[a-z]:%u%n", name, &weight, &len)!=2)
+			return -1;
+		for(kind = 0; kind < MIX_NB && strcmp(name, g_mixname[kind]); kind++)
+			;
+		if(kind==MIX_NB)
+			return -1;
+		if(config->board==BOARD_FMC116 && (kind==MIX_ENCHNL || kind==MIX_ARMDAC))
+			return -1;
+		config->weight[kind] += weight;
+		config->weighttotal += weight;
+		mix += len;
+		if(*mix==',')
+			mix++;
+	}
+	return config->weighttotal ? 0 : -1;
+}
+
+/**
+ *  Print one line of latency statistics.
+ */
+static void PrintLatency(const char *name, unsigned long count, double seconds, const TRACE_HIST *hist)
+{
+	printf("%-12s %10lu %10.1f %10llu %10llu %10llu %10llu\n", name, count, count/seconds, trace_percentile(hist, 50.0),
+		trace_percentile(hist, 99.0), trace_percentile(hist, 99.9), hist->max);
+}
+
+/**
+ *  \brief Load generator (main).
+ *
+ *  This application drives the FMC116 or the FMC204 socket server with a configurable mix of commands, from several
+ *  connections, at maximum rate or at a target rate. It is the acceptance test for the server throughput work.
+ *
+ *  Description of the software sequence :
+ *	- Check and convert arguments passed to the application.
+ *	- Open one connection per thread, connections are spread over the servers given.
+ *	- Configure the burst size on every connection with CMD_BURSTSIZE.
+ *	- Send commands picked at random following the mix weights until the end of the run. Commands without reply are
+ *	  followed by CMD_TELEMETRY, its reply marks their completion.
+ *	- Report commands per second ( frames/s ), MB/s and the p50/p99/p99.9 latency per command kind.
+ *
+ *  @param argc the command line
+ *  @param argv the number of options in the command line.
+ *  @return 0 ( success ) or any other error code.
+ */
+int main(int argc, char* argv[])
+{
+	loadgen_config config;
+	loadgen_connection *conns;
+	const char *servers[MAX_SERVERS];
+	unsigned short ports[MAX_SERVERS];
+	unsigned int nbservers = 0, nbconns;
+	char addresses[1024];
+	char *token;
+	double rate, seconds;
+	unsigned long long start, bytes = 0;
+	unsigned long commands[MIX_NB], total = 0, late = 0;
+	TRACE_HIST latency[MIX_NB], all;
+	WSADATA wsaData;
+	sockaddr_in remote;
+	int errors = 0, nodelay = 1;
+
+	// Parse the application arguments
+	if(argc!=7 && argc!=8) {
+		printf("Usage: LoadGen.exe {board} {servers} {connections} {duration} {rate} {mix} [{burst size}]\n\n");
+		printf(" {board} is either 116 (FMC116 server) or 204 (FMC204 server)\n");
+		printf(" {servers} comma separated list of ip[:port], the connections are spread over the list\n");
+		printf("    each server accepts a single connection\n");
+		printf(" {connections} number of connections, 1 to %d and the number of servers at most\n", MAX_CONNECTIONS);
+		printf(" {duration} length of the run in seconds\n");
+		printf(" {rate} target commands per second for all connections together, 0 for the maximum rate\n");
+		printf(" {mix} comma separated list of command:weight, command is one of\n");
+		printf("    burstsize, data, telemetry, enchnl (FMC204 only), armdac (FMC204 only)\n");
+		printf("    e.g. data:8,enchnl:1,armdac:1\n");
+		printf(" {burst size} samples per CMD_DATA, %d by default\n", DEFAULT_BURSTSIZE);
+		printf("\n");
+		return -1;
+	}
+
+	// Convert arguments
+	config.board = atoi(argv[1]);
+	nbconns = (unsigned int)atoi(argv[3]);
+	seconds = atof(argv[4]);
+	rate = atof(argv[5]);
+	config.burstsize = argc==8 ? (unsigned int)atoi(argv[7]) : DEFAULT_BURSTSIZE;
+	if(config.board!=BOARD_FMC116 && config.board!=BOARD_FMC204) {
+		printf("Unknown board %s\n", argv[1]);
+		return -1;
+	}
+	if(nbconns<1 || nbconns>MAX_CONNECTIONS || seconds<=0 || rate<0 || config.burstsize<1 || config.burstsize>MAX_BURSTSIZE) {
+		printf("Invalid connections, duration, rate or burst size\n");
+		return -1;
+	}
+	if(ParseMix(argv[6], &config)!=0) {
+		printf("Invalid mix '%s' for board %d\n", argv[6], config.board);
+		return -1;
+	}
+	config.nbconns = nbconns;
+	config.durationus = (unsigned long long)(seconds*1e6);
+	config.intervalus = rate>0 ? (unsigned long long)(nbconns*1e6/rate) : 0;
+	if(rate>0 && config.intervalus==0)
+		config.intervalus = 1;
+
+	strncpy(addresses, argv[2], sizeof(addresses)-1);
+	addresses[sizeof(addresses)-1] = 0;
+	for(token = strtok(addresses, ","); token && nbservers < MAX_SERVERS; token = strtok(NULL, ",")) {
+		char *colon = strchr(token, ':');
+
+		ports[nbservers] = config.board==BOARD_FMC116 ? PORT_FMC116 : PORT_FMC204;
+		if(colon) {
+			*colon = 0;
+			ports[nbservers] = (unsigned short)atoi(colon+1);
+		}
+		servers[nbservers++] = token;
+	}
+	if(nbservers==0) {
+		printf("No server given\n");
+		return -1;
+	}
+	// a second connection to the same server would never be accepted and its thread would wait forever
+	if(nbconns>nbservers) {
+		printf("%d connection(s) for %d server(s), each server accepts a single connection\n", nbconns, nbservers);
+		return -1;
+	}
+
+	conns = (loadgen_connection *)calloc(nbconns, sizeof(loadgen_connection));
+	if(conns==NULL)
+		return -2;
+
+	if(WSAStartup(MAKEWORD(2,2), &wsaData)!=NO_ERROR) {
+		free(conns);
+		return -3;
+	}
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Connect everything first, the run starts once all connections are up
+	trace_init();
+	for(unsigned int i = 0; i < nbconns; i++) {
+		loadgen_connection *conn = &conns[i];
+
+		conn->config = &config;
+		conn->index = i;
+		conn->address = servers[i%nbservers];
+		conn->port = ports[i%nbservers];
+		conn->frame = (unsigned char *)malloc(2*config.burstsize);
+		conn->sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if(conn->frame==NULL || conn->sock==INVALID_SOCKET) {
+			printf("Could not allocate connection %d\n", i);
+			return -4;
+		}
+		memset(conn->frame, 0, 2*config.burstsize);
+		remote.sin_family = AF_INET;
+		remote.sin_addr.s_addr = inet_addr(conn->address);
+		remote.sin_port = htons(conn->port);
+		if(connect(conn->sock, (SOCKADDR*)&remote, sizeof(remote))==SOCKET_ERROR) {
+			printf("Could not connect to %s:%d\n", conn->address, conn->port);
+			return -5;
+		}
+		// the commands are small, they must not wait for the previous reply to be acked
+		setsockopt(conn->sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&nodelay, sizeof(nodelay));
+	}
+
+	printf("Running %d connection(s) for %.1f s ", nbconns, seconds);
+	if(rate>0)
+		printf("at %.1f commands/s\n", rate);
+	else
+		printf("at the maximum rate\n");
+
+	start = trace_now();
+	for(unsigned int i = 0; i < nbconns; i++) {
+		conns[i].hthread = CreateThread(NULL, 0, ConnectionThread, &conns[i], 0, NULL);
+		if(!conns[i].hthread) {
+			printf("Could not start connection %d\n", i);
+			return -6;
+		}
+	}
+	for(unsigned int i = 0; i < nbconns; i++) {
+		WaitForSingleObject(conns[i].hthread, INFINITE);
+		CloseHandle(conns[i].hthread);
+	}
+	seconds = (trace_now()-start)/1e6;
+
+	/////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Merge and report
+	memset(latency, 0, sizeof(latency));
+	memset(&all, 0, sizeof(all));
+	memset(commands, 0, sizeof(commands));
+	for(unsigned int i = 0; i < nbconns; i++) {
+		loadgen_connection *conn = &conns[i];
+
+		for(int k = 0; k < MIX_NB; k++) {
+			trace_histmerge(&latency[k], &conn->latency[k]);
+			trace_histmerge(&all, &conn->latency[k]);
+			commands[k] += conn->commands[k];
+			total += conn->commands[k];
+		}
+		bytes += conn->bytessent+conn->bytesreceived;
+		late += conn->late;
+		if(conn->error) {
+			printf("Connection %d to %s:%d failed (error %d)\n", i, conn->address, conn->port, conn->error);
+			errors++;
+		}
+		closesocket(conn->sock);
+		free(conn->frame);
+	}
+	WSACleanup();
+
+	printf("--------------------------------------------------------------------------\n");
+	printf("Elapsed          : %.2f s\n", seconds);
+	printf("Frames           : %lu ( %.1f frames/s )\n", total, total/seconds);
+	printf("Throughput       : %.2f MB/s\n", bytes/seconds/1e6);
+	printf("Late commands    : %lu\n", late);
+	printf("Failed conns     : %d\n", errors);
+	printf("\n%-12s %10s %10s %10s %10s %10s %10s\n", "latency (us)", "count", "per s", "p50", "p99", "p99.9", "max");
+	for(int k = 0; k < MIX_NB; k++) {
+		if(commands[k])
+			PrintLatency(g_mixname[k], commands[k], seconds, &latency[k]);
+	}
+	PrintLatency("all", total, seconds, &all);
+	printf("--------------------------------------------------------------------------\n");
+
+	free(conns);
+	return errors ? -7 : 0;
+}